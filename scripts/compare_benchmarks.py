@@ -0,0 +1,87 @@
+#!/usr/bin/python
+#
+# Copyright 2010-present Facebook.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+# 
+#    http://www.apache.org/licenses/LICENSE-2.0
+# 
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+
+# Compares benchmark results written by the FacebookSDKBenchmarks target (or the
+# GNUstep fb-benchmarks tool) against a stored baseline.
+#
+# usage: compare_benchmarks.py RESULTS BASELINE [TOLERANCE]
+#
+# A benchmark regresses when its ns_per_op exceeds the baseline by more than
+# TOLERANCE (a fraction, e.g. 0.2 for 20%). The tolerance defaults to the
+# baseline's "tolerance" value, or 0.2. Exits with status 1 if anything regressed,
+# or if a benchmark has no baseline to be compared against (including when the
+# baseline is empty); record one with run_benchmarks.sh -u.
+
+import sys
+import json
+
+DEFAULT_TOLERANCE = 0.2
+
+def load(path):
+    with open(path) as f:
+        return json.load(f)
+
+def main(argv):
+    if len(argv) not in (3, 4):
+        print("usage: %s RESULTS BASELINE [TOLERANCE]" % argv[0])
+        return 2
+
+    results = load(argv[1]).get("benchmarks", {})
+    baseline_file = load(argv[2])
+    baseline = baseline_file.get("benchmarks", {})
+    if len(argv) == 4:
+        tolerance = float(argv[3])
+    else:
+        tolerance = float(baseline_file.get("tolerance", DEFAULT_TOLERANCE))
+
+    if not baseline:
+        print("%s has no recorded benchmarks; record a baseline with run_benchmarks.sh -u" % argv[2])
+        return 1
+
+    regressions = []
+    unrecorded = []
+    print("%-32s %14s %14s %9s" % ("benchmark", "baseline ns", "current ns", "change"))
+    for name in sorted(results):
+        current = results[name]["ns_per_op"]
+        if name not in baseline:
+            unrecorded.append(name)
+            print("%-32s %14s %14.1f %9s" % (name, "-", current, "new"))
+            continue
+        expected = baseline[name]["ns_per_op"]
+        change = (current - expected) / expected if expected else 0.0
+        flag = ""
+        if change > tolerance:
+            regressions.append(name)
+            flag = "  REGRESSED"
+        print("%-32s %14.1f %14.1f %+8.1f%%%s" % (name, expected, current, change * 100, flag))
+
+    for name in sorted(set(baseline) - set(results)):
+        print("%-32s %14.1f %14s %9s" % (name, baseline[name]["ns_per_op"], "-", "missing"))
+
+    if regressions:
+        print("%d benchmark(s) regressed by more than %.0f%%: %s" %
+              (len(regressions), tolerance * 100, ", ".join(regressions)))
+    if unrecorded:
+        print("%d benchmark(s) have no baseline; record one with run_benchmarks.sh -u: %s" %
+              (len(unrecorded), ", ".join(unrecorded)))
+    if regressions or unrecorded:
+        return 1
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,103 @@
+#!/bin/sh
+#
+# Copyright 2010-present Facebook.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+# 
+#    http://www.apache.org/licenses/LICENSE-2.0
+# 
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+
+. ${FB_SDK_SCRIPT:-$(dirname $0)}/common.sh
+
+# process options, valid arguments -c [Debug|Release] -t tolerance -g -u
+BUILDCONFIGURATION=Release
+SCHEME=FacebookSDKBenchmarks
+BENCHMARKS_DIR=$FB_SDK_SRC/FacebookSDKBenchmarks
+BASELINE=$BENCHMARKS_DIR/FBBenchmarkBaseline.json
+RESULTS=$FB_SDK_BUILD/FacebookSDKBenchmarks.json
+
+while getopts ":c:t:gu" OPTNAME
+do
+  case "$OPTNAME" in
+    "c")
+      BUILDCONFIGURATION=$OPTARG
+      ;;
+    "t")
+      TOLERANCE=$OPTARG
+      ;;
+    "g")
+      GNUSTEP=1
+      ;;
+    "u")
+      UPDATE_BASELINE=1
+      ;;
+    "?")
+      echo "$0 [-c [Debug|Release]] [-t TOLERANCE] [-g] [-u]"
+      echo "       -c sets configuration (default Release)"
+      echo "       -t fails the run if a benchmark is slower than its baseline by more"
+      echo "          than this fraction (default: the baseline's tolerance, or 0.2)"
+      echo "       -g runs the Foundation-only benchmarks with GNUstep instead of the simulator"
+      echo "       -u records the results as the new baseline instead of comparing"
+      die
+      ;;
+    ":")
+      echo "Missing argument value for option $OPTARG"
+      die
+      ;;
+    *)
+    # Should not occur
+      echo "Unknown error while processing options"
+      die
+      ;;
+  esac
+done
+
+mkdir -p $FB_SDK_BUILD || die "Could not create directory $FB_SDK_BUILD"
+\rm -f $RESULTS
+
+if [ -n "$GNUSTEP" ]; then
+    BASELINE=$BENCHMARKS_DIR/FBBenchmarkBaseline-gnustep.json
+    test -n "$GNUSTEP_MAKEFILES" || die 'GNUstep is not set up; source GNUstep.sh first'
+
+    cd $BENCHMARKS_DIR
+    make || die "Error while building benchmarks"
+    ./obj/fb-benchmarks $RESULTS || die "Error while running benchmarks"
+    make clean
+else
+    test -x "$XCODEBUILD" || die 'Could not find xcodebuild in $PATH'
+
+    cd $FB_SDK_SRC
+    $XCODEBUILD \
+	-sdk iphonesimulator \
+	-configuration $BUILDCONFIGURATION \
+	-scheme $SCHEME \
+	FB_BENCHMARK_OUTPUT=$RESULTS \
+	test \
+	|| die "Error while running benchmarks"
+fi
+
+test -r $RESULTS || die "Benchmarks did not write $RESULTS"
+
+if [ -n "$UPDATE_BASELINE" ]; then
+    progress_message "Recording new baseline in $BASELINE"
+    python -c "
+import json, sys
+results = json.load(open('$RESULTS'))
+results['tolerance'] = json.load(open('$BASELINE')).get('tolerance', 0.2)
+json.dump(results, open('$BASELINE', 'w'), indent=2, sort_keys=True)
+" || die "Could not update $BASELINE"
+else
+    python $FB_SDK_SCRIPT/compare_benchmarks.py $RESULTS $BASELINE $TOLERANCE \
+	|| die "Benchmarks regressed, or have no baseline, in $BASELINE"
+fi
+
+common_success
@@ -15,7 +15,6 @@
  */
 
 #import <Foundation/Foundation.h>
-#import "FBUtility.h"
 
 // Given a byte array, returns an NSString containing those bytes encoded in Base64 encoding.
 extern NSString* FBEncodeBase64(NSData* data);
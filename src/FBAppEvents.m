@@ -22,6 +22,7 @@
 #import "FBError.h"
 #import "FBLogger.h"
 #import "FBRequest+Internal.h"
+#import "FBRequestConnection+Internal.h"
 #import "FBSession+Internal.h"
 #import "FBSessionAppEventsState.h"
 #import "FBSessionManualTokenCachingStrategy.h"
@@ -525,7 +526,7 @@ const int MAX_IDENTIFIER_LENGTH                      = 40;
     NSMutableDictionary *eventDictionary = [NSMutableDictionary dictionaryWithDictionary:parameters];
 
     long logTime = [FBAppEvents unixTimeNow];
-    [eventDictionary setObject:eventName forKey:@"_eventName"];
+    [eventDictionary setObject:[FBSessionAppEventsState internedString:eventName] forKey:@"_eventName"];
     [eventDictionary setObject:[NSNumber numberWithLong:logTime] forKey:@"_logTime"];
 
     if (valueToSum != nil) {
@@ -538,7 +539,7 @@ const int MAX_IDENTIFIER_LENGTH                      = 40;
 
     @synchronized (self) {
         if ([FBSettings appVersion]) {
-            [eventDictionary setObject:[FBSettings appVersion] forKey:@"_appVersion"];
+            [eventDictionary setObject:[FBSessionAppEventsState internedString:[FBSettings appVersion]] forKey:@"_appVersion"];
         }
 
         // If this is a different session than the most recent we logged to, set up that earlier session for flushing, and update
@@ -665,27 +666,61 @@ const int MAX_IDENTIFIER_LENGTH                      = 40;
 
     }
 
-    NSString *jsonEncodedEvents;
-    NSUInteger eventCount, numSkipped;
+    NSArray *events;
+    NSUInteger numSkipped;
     @synchronized (appEventsState) {
+        events = [appEventsState beginFlushingEvents];
+        numSkipped = appEventsState.numSkippedEventsDueToFullBuffer;
+    }
 
-        [appEventsState.inFlightEvents addObjectsFromArray:appEventsState.accumulatedEvents];
-        [appEventsState.accumulatedEvents removeAllObjects];
-        eventCount = appEventsState.inFlightEvents.count;
+    if (!events.count) {
+        return;
+    }
 
-        if (!eventCount) {
-            return;
+    // Encoding (and pretty printing for the log) happens off the main thread; the in-flight
+    // flag keeps further flushes of this session out until the request completes.
+    appEventsState.requestInFlight = YES;
+    BOOL includeImplicitEvents = self.appSupportsImplicitLogging;
+    BOOL logEvents = [[FBSettings loggingBehavior] containsObject:FBLoggingBehaviorAppEvents];
+
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+
+        // Move custom events field off the URL and into a POST field only by encoding into UTF8, which the server
+        // will then handle as an uploaded file.  It also allows request compression to work on event data.
+        NSData *utf8EncodedEvents = [FBSessionAppEventsState jsonEncodeEvents:events
+                                                       includeImplicitEvents:includeImplicitEvents];
+
+        NSString *prettyPrintedJsonEvents = nil;
+        if (utf8EncodedEvents && logEvents) {
+            id decodedEvents = [NSJSONSerialization JSONObjectWithData:utf8EncodedEvents options:0 error:nil];
+            prettyPrintedJsonEvents = [FBUtility simpleJSONEncode:decodedEvents
+                                                            error:nil
+                                                   writingOptions:NSJSONWritingPrettyPrinted];
         }
 
-        jsonEncodedEvents = [appEventsState jsonEncodeInFlightEvents:self.appSupportsImplicitLogging];
-        numSkipped = appEventsState.numSkippedEventsDueToFullBuffer;
-    }
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self sendEncodedEvents:utf8EncodedEvents
+                         eventCount:events.count
+                         numSkipped:numSkipped
+            prettyPrintedJsonEvents:prettyPrintedJsonEvents
+                        flushReason:flushReason
+                            session:session];
+        });
+    });
+}
+
+- (void)sendEncodedEvents:(NSData *)utf8EncodedEvents
+               eventCount:(NSUInteger)eventCount
+               numSkipped:(NSUInteger)numSkipped
+  prettyPrintedJsonEvents:(NSString *)prettyPrintedJsonEvents
+              flushReason:(FBAppEventsFlushReason)flushReason
+                  session:(FBSession *)session {
 
-    // Move custom events field off the URL and into a POST field only by encoding into UTF8, which the server
-    // will then handle as an uploaded file.  It also allows request compression to work on event data.
-    NSData *utf8EncodedEvents = [jsonEncodedEvents dataUsingEncoding:NSUTF8StringEncoding];
+    [FBAppEvents ensureOnMainThread];
+    FBSessionAppEventsState *appEventsState = session.appEventsState;
 
     if (!utf8EncodedEvents) {
+        appEventsState.requestInFlight = NO;
         [FBLogger singleShotLogEntry:FBLoggingBehaviorAppEvents
                             logEntry:@"FBAppEvents: Flushing skipped - no events after removing implicitly logged ones.\n"];
         return;
@@ -706,12 +741,7 @@ const int MAX_IDENTIFIER_LENGTH                      = 40;
                                               session:session];
 
     NSString *loggingEntry = nil;
-    if ([[FBSettings loggingBehavior] containsObject:FBLoggingBehaviorAppEvents]) {
-
-        id decodedEvents = [FBUtility simpleJSONDecode:jsonEncodedEvents];
-        NSString *prettyPrintedJsonEvents = [FBUtility simpleJSONEncode:decodedEvents
-                                                                  error:nil
-                                                         writingOptions:NSJSONWritingPrettyPrinted];
+    if (prettyPrintedJsonEvents) {
 
         // Remove this param -- just an encoding of the events which we pretty print later.
         NSMutableDictionary *paramsForPrinting = [NSMutableDictionary dictionaryWithDictionary:postParameters];
@@ -726,18 +756,20 @@ const int MAX_IDENTIFIER_LENGTH                      = 40;
     }
 
     FBRequest *request = [[[FBRequest alloc] initWithSession:session
-                                                   graphPath:[NSString stringWithFormat:@"%@/activities", appid]
+                                                   graphPath:[NSString stringWithFormat:@"%@/activities", session.appID]
                                                   parameters:postParameters
                                                   HTTPMethod:@"POST"] autorelease];
     request.canCloseSessionOnError = NO;
 
-    [request startWithCompletionHandler:^(FBRequestConnection *connection, id result, NSError *error) {
+    // Nobody waits on the upload, so let Graph calls and pictures go first.
+    FBRequestConnection *flushConnection = [[[FBRequestConnection alloc] init] autorelease];
+    flushConnection.urlConnectionPriority = FBURLConnectionPriorityBackground;
+    [flushConnection addRequest:request completionHandler:^(FBRequestConnection *connection, id result, NSError *error) {
         [self handleActivitiesPostCompletion:error
                                 loggingEntry:loggingEntry
                                      session:session];
     }];
-
-    appEventsState.requestInFlight = YES;
+    [flushConnection start];
 }
 
 - (void)appendAttributionAndAdvertiserIDs:(NSMutableDictionary *)postParameters
@@ -800,8 +832,8 @@ const int MAX_IDENTIFIER_LENGTH                      = 40;
                         tokenCaching.expirationDate = [NSDate dateWithTimeIntervalSinceNow:315360000]; // 10 years from now
 
                         // Create session with explicit token and stash with appID.
-                        appAuthSession = [FBAppEvents unaffinitizedSessionFromToken:tokenCaching
-                                                                              appID:appID];
+                        appAuthSession = [FBAppEvents sessionFromToken:tokenCaching
+                                                                 appID:appID];
                         [tokenCaching release];
 
                         [self.appAuthSessions setObject:appAuthSession forKey:appID];
@@ -819,8 +851,8 @@ const int MAX_IDENTIFIER_LENGTH                      = 40;
                 @synchronized(self) {
 
                     if (!self.anonymousSession) {  // in case it snuck in
-                        self.anonymousSession = [FBAppEvents unaffinitizedSessionFromToken:[FBSessionTokenCachingStrategy nullCacheInstance]
-                                                                                     appID:appID];
+                        self.anonymousSession = [FBAppEvents sessionFromToken:[FBSessionTokenCachingStrategy nullCacheInstance]
+                                                                        appID:appID];
                     }
                 }
             }
@@ -832,8 +864,8 @@ const int MAX_IDENTIFIER_LENGTH                      = 40;
     return session;
 }
 
-+ (FBSession *)unaffinitizedSessionFromToken:(FBSessionTokenCachingStrategy *)tokenCachingStrategy
-                                       appID:(NSString *)appID {
++ (FBSession *)sessionFromToken:(FBSessionTokenCachingStrategy *)tokenCachingStrategy
+                          appID:(NSString *)appID {
 
     // Passing in nil for appID will result in using [FBSettings defaultAppID], and the right exception
     // behavior will happen if that is null.
@@ -843,10 +875,6 @@ const int MAX_IDENTIFIER_LENGTH                      = 40;
                                         tokenCacheStrategy:tokenCachingStrategy]
                           autorelease];
 
-    // This may have been created off of the main thread, so clear out the affinitizedThread, and it will be
-    // reset to the main thread on the first "real" operation on it.
-    [session clearAffinitizedThread];
-
     return session;
 }
 
@@ -18,19 +18,36 @@
 
 #import <Foundation/Foundation.h>
 
+#import "FBMemoryCache.h"
+
 @class FBCacheIndex;
 
 @protocol FBCacheIndexFileDelegate <NSObject>
 
 @required
 // Informs the disk cache to write contents to the specified file.  The callback
-// should not block and should be executed in order.
+// should not block and should be executed in order.  The file must appear
+// under its name complete or not at all (write elsewhere and rename), and
+// `completion` is called once it is in place; the entry is only indexed then.
 - (void) cacheIndex:(FBCacheIndex*)cacheIndex
     writeFileWithName:(NSString*)name
-    data:(NSData*)data;
+    data:(NSData*)data
+    completion:(void (^)(BOOL placed))completion;
+// Informs the disk cache to move a file it wrote itself (see
+// storeFileForKey:withFileAtPath:...) into place under the specified name.
+// The callback should not block and should be executed in order with the
+// other file operations; `completion` is called as for writes.
+- (void) cacheIndex:(FBCacheIndex*)cacheIndex
+    moveFileAtPath:(NSString*)path
+    toFileWithName:(NSString*)name
+    completion:(void (^)(BOOL placed))completion;
 // Informs the disk cache to delete the specified file.
 - (void) cacheIndex:(FBCacheIndex*)cacheIndex
     deleteFileWithName:(NSString*)name;
+// Informs the disk cache to delete a batch of files.  Called on the index's
+// database queue, so the callback should hand the work off and return.
+- (void) cacheIndex:(FBCacheIndex*)cacheIndex
+    deleteFilesWithNames:(NSArray*)names;
 
 @end
 
@@ -40,6 +57,11 @@
     id <FBCacheIndexFileDelegate> _delegate;
 
     NSCache* _cachedEntries;
+    FBCacheTierStatistics _entryCacheStatistics;
+    // Entries whose file is still being placed, by key, and the file names
+    // they use.  Only touched on the database queue.
+    NSMutableDictionary* _pendingEntries;
+    NSCountedSet* _pendingFileNames;
 
     NSUInteger _currentDiskUsage;
     NSUInteger _diskCapacity;
@@ -48,26 +70,76 @@
     sqlite3_stmt* _insertStatement;
     sqlite3_stmt* _removeByKeyStatement;
     sqlite3_stmt* _selectByKeyStatement;
-    sqlite3_stmt* _selectByKeyFragmentStatement;
-    sqlite3_stmt* _selectExcludingKeyFragmentStatement;
+    sqlite3_stmt* _selectByTagStatement;
+    sqlite3_stmt* _removeByTagStatement;
+    sqlite3_stmt* _countByFileNameStatement;
+    sqlite3_stmt* _selectAfterRowStatement;
     sqlite3_stmt* _trimStatement;
     sqlite3_stmt* _updateStatement;
+    sqlite3_stmt* _selectMostRecentStatement;
 
     dispatch_queue_t _databaseQueue;
+    volatile int32_t _openState;
 }
 
+// Opening the database happens asynchronously on databaseQueue, so init
+// returns immediately.  Until the index is ready, lookups miss rather than
+// wait on the open; stores and removals queue up behind it.
 - (id)initWithCacheFolder:(NSString*)folderPath;
 
 @property (assign) id delegate;
+// Size of the files backing the index; a file shared by several entries
+// is counted once.
 @property (nonatomic, readonly) NSUInteger currentDiskUsage;
 @property (nonatomic, assign) NSUInteger diskCapacity;
 @property (nonatomic, assign) NSUInteger entryCacheCountLimit;
+// Hits and misses of the in-memory entry cache in front of the database
+@property (nonatomic, readonly) FBCacheTierStatistics entryCacheStatistics;
 @property (nonatomic, readonly) dispatch_queue_t databaseQueue;
+// YES once the database is open.  If opening fails the index stays empty
+// and every operation becomes a no-op; failedToOpen reports that.
+@property (nonatomic, readonly, getter = isReady) BOOL ready;
+@property (nonatomic, readonly) BOOL failedToOpen;
 
 - (NSString*)fileNameForKey:(NSString*)key;
+// Stores return the entry's file name right away, but fileNameForKey: only
+// finds the entry once its file is in place.
 - (NSString*)storeFileForKey:(NSString*)key withData:(NSData*)data;
+// Entries stored with a tag can later be removed in bulk through
+// removeEntriesWithTag:.  A nil tag marks the entry as untagged.
+- (NSString*)storeFileForKey:(NSString*)key
+    withData:(NSData*)data
+    tag:(NSString*)tag;
+// Indexes a file that was streamed to `path` instead of being held in memory;
+// `digest` is the CC_SHA1 of its contents, which names the file in the cache.
+- (NSString*)storeFileForKey:(NSString*)key
+    withFileAtPath:(NSString*)path
+    digest:(const unsigned char*)digest
+    fileSize:(NSUInteger)fileSize
+    tag:(NSString*)tag;
 - (void)removeEntryForKey:(NSString*)key;
-- (void)removeEntries:(NSString*)keyFragment excludingFragment:(BOOL)exclude;
+// Asynchronously removes every entry stored with the given tag (nil removes
+// the untagged entries), along with any entry that predates tagging.
+- (void)removeEntriesWithTag:(NSString*)tag;
+// Re-reads the disk usage from the index, correcting any accounting drift.
+- (void)refreshCurrentDiskUsage;
+// Once the database is open, loads the `count` most recently used entries
+// into the in-memory entry cache so that early lookups don't go to disk.
+- (void)warmUpWithMostRecentlyUsedCount:(NSUInteger)count;
+
+// The following must be called on databaseQueue.  They back incremental
+// reconciliation of the index against the files on disk.
+
+// Appends up to `limit` entries with a row id greater than `row` to the
+// arrays, in row order, and returns the row id of the last one read.
+- (NSInteger)readEntriesAfterRow:(NSInteger)row
+    limit:(NSUInteger)limit
+    fileNames:(NSMutableArray*)fileNames
+    keys:(NSMutableArray*)keys
+    fileSizes:(NSMutableArray*)fileSizes;
+// Returns the subset of fileNames that no entry, indexed or still being
+// placed, refers to.
+- (NSArray*)unreferencedFileNames:(NSArray*)fileNames;
 
 @end
 
@@ -16,6 +16,9 @@
 
 #import "FBCacheIndex.h"
 
+#import <CommonCrypto/CommonDigest.h>
+#import <libkern/OSAtomic.h>
+
 #import "FBDynamicFrameworkLoader.h"
 
 #define CHECK_SQLITE(res, expectedResult, db) { \
@@ -37,30 +40,74 @@
 // Number of entries cached to memory
 static const NSInteger kDefaultCacheCountLimit = 500;
 
+typedef enum {
+    FBCacheIndexOpening,
+    FBCacheIndexReady,
+    FBCacheIndexFailed,
+} FBCacheIndexOpenState;
+
 static NSString* const cacheFilename = @"cache.db";
+// Untagged entries are stored with an empty tag; NULL is reserved for rows
+// written before the tag column existed.
+static NSString* const kUntaggedEntryTag = @"";
+
+// The uuid column holds the name of the file backing an entry.  Older entries
+// use a flat CFUUID name; newer ones are content-addressed and sharded into
+// two levels of directories (see fileNameForData), so several keys with the
+// same payload can share one file.
 static const char* schema =
     "CREATE TABLE IF NOT EXISTS cache_index "
-    "(uuid TEXT, key TEXT PRIMARY KEY, access_time REAL, file_size INTEGER)";
+    "(uuid TEXT, key TEXT PRIMARY KEY, access_time REAL, file_size INTEGER, "
+    "tag TEXT)";
+
+// Upgrades an index created before tagging; fails harmlessly when the
+// column is already there.
+static const char* addTagColumnMigration =
+    "ALTER TABLE cache_index ADD COLUMN tag TEXT";
+
+static const char* tagIndexSchema =
+    "CREATE INDEX IF NOT EXISTS cache_index_tag ON cache_index (tag)";
+
+static const char* fileNameIndexSchema =
+    "CREATE INDEX IF NOT EXISTS cache_index_uuid ON cache_index (uuid)";
+
+static const char* accessTimeIndexSchema =
+    "CREATE INDEX IF NOT EXISTS cache_index_access_time "
+    "ON cache_index (access_time)";
 
 static const char* insertQuery =
-    "INSERT INTO cache_index VALUES (?, ?, ?, ?)";
+    "INSERT INTO cache_index (uuid, key, access_time, file_size, tag) "
+    "VALUES (?, ?, ?, ?, ?)";
 
 static const char* updateQuery =
     "UPDATE cache_index "
-    "SET uuid=?, access_time=?, file_size=? "
+    "SET uuid=?, access_time=?, file_size=?, tag=? "
     "WHERE key=?";
 
 static const char* selectByKeyQuery =
-    "SELECT uuid, key, access_time, file_size FROM cache_index WHERE key = ?";
+    "SELECT uuid, key, access_time, file_size, tag FROM cache_index WHERE key = ?";
+
+static const char* selectByTagQuery =
+    "SELECT uuid, key, file_size FROM cache_index WHERE tag = ? OR tag IS NULL";
+
+static const char* deleteByTagQuery =
+    "DELETE FROM cache_index WHERE tag = ? OR tag IS NULL";
 
-static const char* selectByKeyFragmentQuery =
-    "SELECT uuid, key, access_time, file_size FROM cache_index WHERE key LIKE ?";
+static const char* countByFileNameQuery =
+    "SELECT COUNT(*) FROM cache_index WHERE uuid = ?";
 
-static const char* selectExcludingKeyFragmentQuery =
-    "SELECT uuid, key, access_time, file_size FROM cache_index WHERE key NOT LIKE ?";
+static const char* selectAfterRowQuery =
+    "SELECT rowid, uuid, key, file_size FROM cache_index "
+    "WHERE rowid > ? ORDER BY rowid LIMIT ?";
 
+static const char* selectMostRecentQuery =
+    "SELECT uuid, key, access_time, file_size, tag FROM cache_index "
+    "ORDER BY access_time DESC LIMIT ?";
+
+// Entries sharing a file count it once
 static const char* selectStorageSizeQuery =
-    "SELECT SUM(file_size) FROM cache_index";
+    "SELECT SUM(file_size) FROM "
+        "(SELECT MAX(file_size) AS file_size FROM cache_index GROUP BY uuid)";
 
 static const char* deleteEntryQuery =
     "DELETE FROM cache_index WHERE key=?";
@@ -73,8 +120,8 @@ static const char* trimQuery =
                 "a1.file_size, SUM(a2.file_size) running_total "
             "FROM cache_index a1, cache_index a2 "
             "WHERE a1.access_time > a2.access_time OR "
-                "(a1.access_time = a2.access_time AND a1.uuid = a2.uuid) "
-            "GROUP BY a1.uuid ORDER BY a1.access_time) rt "
+                "(a1.access_time = a2.access_time AND a1.key = a2.key) "
+            "GROUP BY a1.key ORDER BY a1.access_time) rt "
         "WHERE rt.running_total <= ?";
 
 #pragma mark - C Helpers
@@ -101,11 +148,31 @@ static void releaseStatement(sqlite3_stmt* statement, sqlite3* database)
     }
 }
 
+// Content-addressed file name: the SHA-1 of the payload, laid out as
+// "ab/cd/abcd..." so that no single directory grows too large.
+static NSString* fileNameForDigest(const unsigned char* digest)
+{
+    char hex[CC_SHA1_DIGEST_LENGTH * 2 + 1];
+    for (int i = 0; i < CC_SHA1_DIGEST_LENGTH; i++) {
+        snprintf(hex + i * 2, 3, "%02x", digest[i]);
+    }
+
+    return [NSString stringWithFormat:@"%.2s/%.2s/%s", hex, hex + 2, hex];
+}
+
+static NSString* fileNameForData(NSData* data)
+{
+    unsigned char digest[CC_SHA1_DIGEST_LENGTH];
+    CC_SHA1(data.bytes, (CC_LONG)data.length, digest);
+    return fileNameForDigest(digest);
+}
+
 @interface FBCacheEntityInfo : NSObject
 {
 @private
     NSString* _uuid;
     NSString* _key;
+    NSString* _tag;
     CFTimeInterval _accessTime;
     NSUInteger _fileSize;
     BOOL _dirty;
@@ -113,11 +180,13 @@ static void releaseStatement(sqlite3_stmt* statement, sqlite3* database)
 
 - (id)initWithKey:(NSString*)key
     uuid:(NSString*)uuid
+    tag:(NSString*)tag
     accessTime:(CFTimeInterval)accessTime
     fileSize:(NSUInteger)fileSize;
 
 @property (copy, readonly) NSString* key;
 @property (copy, readonly) NSString* uuid;
+@property (copy, readonly) NSString* tag;
 @property (assign, readonly) CFTimeInterval accessTime;
 @property (assign, readonly) NSUInteger fileSize;
 @property (assign, getter = isDirty) BOOL dirty;
@@ -128,16 +197,29 @@ static void releaseStatement(sqlite3_stmt* statement, sqlite3* database)
 
 @interface FBCacheIndex() <NSCacheDelegate>
 
+- (void)_openDatabaseAtPath:(NSString*)path;
 - (FBCacheEntityInfo*)_entryForKey:(NSString*)key;
 - (void)_fetchCurrentDiskUsage;
 - (FBCacheEntityInfo*)_readEntryFromDatabase:(NSString*)key;
-- (NSMutableArray*) _readEntriesFromDatabase: (NSString*)keyFragment excludingFragment:(BOOL)exclude;
 - (FBCacheEntityInfo*)_createCacheEntityInfo:(sqlite3_stmt*)selectStatement;
 - (void)_removeEntryFromDatabaseForKey:(NSString*)key;
+- (void)_removeEntriesFromDatabaseWithTag:(NSString*)tag;
+- (NSInteger)_countEntriesWithFileName:(NSString*)fileName;
+- (BOOL)_isFileNamePending:(NSString*)fileName;
+- (void)_addPendingEntry:(FBCacheEntityInfo*)entry;
+- (void)_removePendingEntryForKey:(NSString*)key;
+- (void)_deleteFilesIfUnreferenced:(NSDictionary*)fileSizes;
+- (void)_reduceDiskUsageBy:(NSUInteger)space;
 - (void)_trimDatabase;
 - (void)_updateEntryInDatabaseForKey:(NSString*)key
                      entry:(FBCacheEntityInfo*)entry;
 - (void)_writeEntryInDatabase:(FBCacheEntityInfo*)entry;
+- (void)_storeEntryForKey:(NSString*)key
+                 fileName:(NSString*)fileName
+                 fileSize:(NSUInteger)fileSize
+                      tag:(NSString*)tag
+                placeFile:(void (^)(void (^completion)(BOOL placed)))placeFile;
+- (void)_publishEntry:(FBCacheEntityInfo*)entry placed:(BOOL)placed;
 
 @end
 
@@ -164,43 +246,19 @@ static void releaseStatement(sqlite3_stmt* statement, sqlite3* database)
             DISPATCH_QUEUE_SERIAL);
         dispatch_set_target_queue(_databaseQueue, lowPriQueue);
 
-        __block BOOL success = YES;
-
-        // TODO: This is really bad if higher layers are going to be
-        // multi-threaded.  And this has to be unblocked.
-        dispatch_sync(
-            _databaseQueue,
-            ^{
-                success = (fbdfl_sqlite3_open_v2(
-                    cacheDBFullPath.UTF8String,
-                    &_database,
-                    SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
-                    nil) == SQLITE_OK);
-
-                if (success) {
-                    success = (fbdfl_sqlite3_exec(
-                        _database,
-                        schema,
-                        nil,
-                        nil,
-                        nil) == SQLITE_OK);
-                }
-            }
-        );
+        _cachedEntries = [[NSCache alloc] init];
+        _cachedEntries.delegate = self;
+        _cachedEntries.countLimit = kDefaultCacheCountLimit;
 
-        if (!success) {
-            [self release];
-            return nil;
-        }
+        _pendingEntries = [[NSMutableDictionary alloc] init];
+        _pendingFileNames = [[NSCountedSet alloc] init];
 
-        // Get disk usage asynchronously
+        // Everything else touching the database is queued behind this
+        NSString* boundPath = [cacheDBFullPath copy];
         dispatch_async(_databaseQueue, ^{
-            [self _fetchCurrentDiskUsage];
+            [self _openDatabaseAtPath:boundPath];
+            [boundPath release];
         });
-
-        _cachedEntries = [[NSCache alloc] init];
-        _cachedEntries.delegate = self;
-        _cachedEntries.countLimit = kDefaultCacheCountLimit;
     }
 
     return self;
@@ -212,21 +270,29 @@ static void releaseStatement(sqlite3_stmt* statement, sqlite3* database)
         sqlite3* const db = _database;
         sqlite3_stmt* const is = _insertStatement;
         sqlite3_stmt* const sbks = _selectByKeyStatement;
-        sqlite3_stmt* const sbkfs = _selectByKeyFragmentStatement;
-        sqlite3_stmt* const sekfs = _selectExcludingKeyFragmentStatement;
+        sqlite3_stmt* const sbts = _selectByTagStatement;
+        sqlite3_stmt* const rbts = _removeByTagStatement;
+        sqlite3_stmt* const cbfs = _countByFileNameStatement;
+        sqlite3_stmt* const sars = _selectAfterRowStatement;
         sqlite3_stmt* const rbks = _removeByKeyStatement;
         sqlite3_stmt* const ts = _trimStatement;
         sqlite3_stmt* const us = _updateStatement;
+        sqlite3_stmt* const smrs = _selectMostRecentStatement;
         dispatch_async(_databaseQueue, ^{
             releaseStatement(is, nil);
             releaseStatement(sbks, nil);
-            releaseStatement(sbkfs, nil);
-            releaseStatement(sekfs, nil);
+            releaseStatement(sbts, nil);
+            releaseStatement(rbts, nil);
+            releaseStatement(cbfs, nil);
+            releaseStatement(sars, nil);
             releaseStatement(rbks, nil);
             releaseStatement(ts, nil);
             releaseStatement(us, nil);
+            releaseStatement(smrs, nil);
 
-            CHECK_SQLITE_SUCCESS(fbdfl_sqlite3_close(db), nil);
+            if (db) {
+                CHECK_SQLITE_SUCCESS(fbdfl_sqlite3_close(db), nil);
+            }
         });
 
         dispatch_release(_databaseQueue);
@@ -234,6 +300,8 @@ static void releaseStatement(sqlite3_stmt* statement, sqlite3* database)
 
     _cachedEntries.delegate = nil;
     [_cachedEntries release];
+    [_pendingEntries release];
+    [_pendingFileNames release];
     [super dealloc];
 }
 
@@ -249,6 +317,25 @@ static void releaseStatement(sqlite3_stmt* statement, sqlite3* database)
     _cachedEntries.countLimit = entryCacheCountLimit;
 }
 
+- (BOOL)isReady
+{
+    return _openState == FBCacheIndexReady;
+}
+
+- (BOOL)failedToOpen
+{
+    return _openState == FBCacheIndexFailed;
+}
+
+- (FBCacheTierStatistics)entryCacheStatistics
+{
+    FBCacheTierStatistics statistics;
+    @synchronized(_cachedEntries) {
+        statistics = _entryCacheStatistics;
+    }
+    return statistics;
+}
+
 #pragma mark - Public
 
 - (NSString*)fileNameForKey:(NSString*)key
@@ -264,83 +351,260 @@ static void releaseStatement(sqlite3_stmt* statement, sqlite3* database)
 
 - (NSString*)storeFileForKey:(NSString*)key withData:(NSData*)data
 {
-    CFUUIDRef uuid = CFUUIDCreate(kCFAllocatorDefault);
-    NSString* uuidString =
-        (NSString*)CFUUIDCreateString(kCFAllocatorDefault, uuid);
+    return [self storeFileForKey:key withData:data tag:nil];
+}
+
+- (NSString*)storeFileForKey:(NSString*)key
+    withData:(NSData*)data
+    tag:(NSString*)tag
+{
+    NSString* fileName = fileNameForData(data);
+    [self
+        _storeEntryForKey:key
+        fileName:fileName
+        fileSize:data.length
+        tag:tag
+        placeFile:^(void (^completion)(BOOL placed)) {
+            [self.delegate
+                cacheIndex:self
+                writeFileWithName:fileName
+                data:data
+                completion:completion];
+        }];
+
+    return fileName;
+}
+
+- (NSString*)storeFileForKey:(NSString*)key
+    withFileAtPath:(NSString*)path
+    digest:(const unsigned char*)digest
+    fileSize:(NSUInteger)fileSize
+    tag:(NSString*)tag
+{
+    NSString* fileName = fileNameForDigest(digest);
+    NSString* boundPath = [[path copy] autorelease];
+    [self
+        _storeEntryForKey:key
+        fileName:fileName
+        fileSize:fileSize
+        tag:tag
+        placeFile:^(void (^completion)(BOOL placed)) {
+            [self.delegate
+                cacheIndex:self
+                moveFileAtPath:boundPath
+                toFileWithName:fileName
+                completion:completion];
+        }];
+
+    return fileName;
+}
 
-    CFRelease(uuid);
+- (void)_storeEntryForKey:(NSString*)key
+    fileName:(NSString*)fileName
+    fileSize:(NSUInteger)fileSize
+    tag:(NSString*)tag
+    placeFile:(void (^)(void (^completion)(BOOL placed)))placeFile
+{
     FBCacheEntityInfo* entry = [[FBCacheEntityInfo alloc]
         initWithKey:key
-        uuid:uuidString
+        uuid:fileName
+        tag:(tag ?: kUntaggedEntryTag)
         accessTime:0
-        fileSize:data.length];
+        fileSize:fileSize];
 
     [entry registerAccess];
     dispatch_async(_databaseQueue, ^{
-        [self _writeEntryInDatabase:entry];
-
-        _currentDiskUsage += data.length;
-        if (_currentDiskUsage > _diskCapacity) {
-            [self _trimDatabase];
+        if (_database == nil) {
+            return;
         }
-    });
 
-    [self.delegate cacheIndex:self writeFileWithName:uuidString data:data];
+        // Until the file is in place the entry is only pending: lookups
+        // miss, and its file name is kept from being deleted as unreferenced.
+        // A later store for the same key supersedes it.
+        [self _addPendingEntry:entry];
+        placeFile(^(BOOL placed) {
+            dispatch_async(_databaseQueue, ^{
+                [self _publishEntry:entry placed:placed];
+            });
+        });
+    });
 
-    [_cachedEntries setObject:entry forKey:key];
     [entry release];
+}
 
-    return [uuidString autorelease];
+- (void)_publishEntry:(FBCacheEntityInfo*)entry placed:(BOOL)placed
+{
+    if ([_pendingEntries objectForKey:entry.key] != entry) {
+        // Removed or superseded while its file was being placed
+        if (placed) {
+            [self _deleteFilesIfUnreferenced:[NSDictionary
+                dictionaryWithObject:[NSNumber numberWithUnsignedInteger:0]
+                forKey:entry.uuid]];
+        }
+        return;
+    }
+
+    [self _removePendingEntryForKey:entry.key];
+    if (!placed || _database == nil) {
+        return;
+    }
+
+    BOOL isNewFile = ([self _countEntriesWithFileName:entry.uuid] == 0);
+    [self _writeEntryInDatabase:entry];
+    if (isNewFile) {
+        _currentDiskUsage += entry.fileSize;
+    }
+
+    [_cachedEntries setObject:entry forKey:entry.key];
+    if (_currentDiskUsage > _diskCapacity) {
+        [self _trimDatabase];
+    }
 }
 
 - (void)removeEntryForKey:(NSString*)key
 {
-    FBCacheEntityInfo* entry = [self _entryForKey:key];
-    entry.dirty = NO; // Removing, so no need to flush to disk
-
-    NSInteger spaceSaved = entry.fileSize;
+    FBCacheEntityInfo* cachedEntry = [self _entryForKey:key];
+    cachedEntry.dirty = NO; // Removing, so no need to flush to disk
+    [cachedEntry retain];
     [_cachedEntries removeObjectForKey:key];
 
     dispatch_async(_databaseQueue, ^{
+        if (_database == nil) {
+            [cachedEntry release];
+            return;
+        }
+
+        // A store whose file is still being placed is dropped as well
+        [self _removePendingEntryForKey:key];
+
+        // A lookup made before the index was ready misses, so the row may
+        // only be known to the database
+        FBCacheEntityInfo* entry =
+            cachedEntry ?: [self _readEntryFromDatabase:key];
+
         [self _removeEntryFromDatabaseForKey:key];
-        if (_currentDiskUsage >= spaceSaved) {
-            _currentDiskUsage -= spaceSaved;
-        } else {
-            NSCAssert(NO, @"Our disk usage is out of whack");
-            // This means current disk usage is out of whack - let's re-read
-            [self _fetchCurrentDiskUsage];
-        };
+        if (entry.uuid) {
+            [self _deleteFilesIfUnreferenced:[NSDictionary
+                dictionaryWithObject:[NSNumber numberWithUnsignedInteger:entry.fileSize]
+                forKey:entry.uuid]];
+        }
+        [cachedEntry release];
+    });
+}
 
-        [self.delegate cacheIndex:self deleteFileWithName:entry.uuid];
+- (void)removeEntriesWithTag:(NSString*)tag
+{
+    NSString* boundTag = [(tag ?: kUntaggedEntryTag) copy];
+    dispatch_async(_databaseQueue, ^{
+        if (_database) {
+            [self _removeEntriesFromDatabaseWithTag:boundTag];
+        }
     });
+    [boundTag release];
 }
 
-- (void)removeEntries:(NSString*)keyFragment excludingFragment:(BOOL)exclude
+- (NSInteger)readEntriesAfterRow:(NSInteger)row
+    limit:(NSUInteger)limit
+    fileNames:(NSMutableArray*)fileNames
+    keys:(NSMutableArray*)keys
+    fileSizes:(NSMutableArray*)fileSizes
 {
-    if (keyFragment == nil) {
-        return;
+    if (_database == nil) {
+        return row;
     }
 
-    __block NSMutableArray* entries;
+    initializeStatement(_database, &_selectAfterRowStatement, selectAfterRowQuery);
+    CHECK_SQLITE_SUCCESS(fbdfl_sqlite3_bind_int(
+        _selectAfterRowStatement,
+        1,
+        (int)row), _database);
+    CHECK_SQLITE_SUCCESS(fbdfl_sqlite3_bind_int(
+        _selectAfterRowStatement,
+        2,
+        (int)limit), _database);
 
-    dispatch_sync(_databaseQueue, ^{
-        entries = [self _readEntriesFromDatabase:keyFragment excludingFragment:exclude];
-    });
+    NSInteger lastRow = row;
+    while (fbdfl_sqlite3_step(_selectAfterRowStatement) == SQLITE_ROW) {
+        lastRow = fbdfl_sqlite3_column_int(_selectAfterRowStatement, 0);
+        const unsigned char* uuidStr =
+            fbdfl_sqlite3_column_text(_selectAfterRowStatement, 1);
+        const unsigned char* keyStr =
+            fbdfl_sqlite3_column_text(_selectAfterRowStatement, 2);
+
+        [fileNames addObject:[NSString
+            stringWithCString:(const char*)uuidStr
+            encoding:NSUTF8StringEncoding]];
+        [keys addObject:[NSString
+            stringWithCString:(const char*)keyStr
+            encoding:NSUTF8StringEncoding]];
+        [fileSizes addObject:[NSNumber numberWithInt:
+            fbdfl_sqlite3_column_int(_selectAfterRowStatement, 3)]];
+    }
+
+    return lastRow;
+}
+
+- (NSArray*)unreferencedFileNames:(NSArray*)fileNames
+{
+    if (_database == nil) {
+        return [NSArray array];
+    }
+
+    NSMutableSet* unreferenced = [NSMutableSet set];
+    for (NSString* fileName in fileNames) {
+        if (![unreferenced containsObject:fileName] &&
+            ![self _isFileNamePending:fileName] &&
+            [self _countEntriesWithFileName:fileName] == 0) {
+            [unreferenced addObject:fileName];
+        }
+    }
+
+    return unreferenced.allObjects;
+}
 
-    for (FBCacheEntityInfo* entry in entries) {
-        if ([_cachedEntries objectForKey:entry.key] == nil) {
-            // Adding to the cache since the call to removeEntryForKey will look for the entry and
-            // try to retrieve it from the DB which will in turn add it to the cache anyways. So
-            // pre-emptively adding it to the in memory cache saves some DB roundtrips.
-            //
-            // This is only done for NSCache entries that don't already exist since replacing the
-            // old one with the new one will trigger willEvictObject which will try and perform
-            // a DB write. Since the write is async, we might end up in a weird state.
-            [_cachedEntries setObject:entry forKey:entry.key];
+- (void)refreshCurrentDiskUsage
+{
+    dispatch_async(_databaseQueue, ^{
+        if (_database) {
+            [self _fetchCurrentDiskUsage];
         }
+    });
+}
 
-        [self removeEntryForKey:entry.key];
+- (void)warmUpWithMostRecentlyUsedCount:(NSUInteger)count
+{
+    if (count == 0) {
+        return;
     }
+
+    dispatch_async(_databaseQueue, ^{
+        if (_database == nil) {
+            return;
+        }
+
+        // No point reading more than the entry cache will hold
+        NSUInteger limit = _cachedEntries.countLimit;
+        if (limit == 0 || limit > count) {
+            limit = count;
+        }
+
+        initializeStatement(
+            _database,
+            &_selectMostRecentStatement,
+            selectMostRecentQuery);
+        CHECK_SQLITE_SUCCESS(fbdfl_sqlite3_bind_int(
+            _selectMostRecentStatement,
+            1,
+            (int)limit), _database);
+
+        FBCacheEntityInfo* entry;
+        while ((entry = [self _createCacheEntityInfo:_selectMostRecentStatement])) {
+            // Don't clobber an entry stored or touched since launch
+            if ([_cachedEntries objectForKey:entry.key] == nil) {
+                [_cachedEntries setObject:entry forKey:entry.key];
+            }
+        }
+    });
 }
 
 #pragma mark - NSCache delegate
@@ -350,13 +614,86 @@ static void releaseStatement(sqlite3_stmt* statement, sqlite3* database)
     FBCacheEntityInfo* entryInfo = (FBCacheEntityInfo*)obj;
     if (entryInfo.dirty) {
         dispatch_async(_databaseQueue, ^{
-            [self _writeEntryInDatabase:entryInfo];
+            if (_database) {
+                [self _writeEntryInDatabase:entryInfo];
+            }
         });
     }
 }
 
 #pragma mark - Private
 
+- (void)_openDatabaseAtPath:(NSString*)path
+{
+    BOOL success = (fbdfl_sqlite3_open_v2(
+        path.UTF8String,
+        &_database,
+        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
+        nil) == SQLITE_OK);
+
+    if (success) {
+        success = (fbdfl_sqlite3_exec(
+            _database,
+            schema,
+            nil,
+            nil,
+            nil) == SQLITE_OK);
+    }
+
+    if (success) {
+        fbdfl_sqlite3_exec(
+            _database,
+            addTagColumnMigration,
+            nil,
+            nil,
+            nil);
+        success = (fbdfl_sqlite3_exec(
+            _database,
+            tagIndexSchema,
+            nil,
+            nil,
+            nil) == SQLITE_OK);
+    }
+
+    if (success) {
+        success = (fbdfl_sqlite3_exec(
+            _database,
+            fileNameIndexSchema,
+            nil,
+            nil,
+            nil) == SQLITE_OK);
+    }
+
+    if (success) {
+        success = (fbdfl_sqlite3_exec(
+            _database,
+            accessTimeIndexSchema,
+            nil,
+            nil,
+            nil) == SQLITE_OK);
+    }
+
+    if (!success) {
+        NSLog(@"FBCacheIndex: Unable to open %@", path);
+        // sqlite hands back a handle even when the open fails
+        if (_database) {
+            fbdfl_sqlite3_close(_database);
+            _database = nil;
+        }
+        OSAtomicCompareAndSwap32Barrier(
+            FBCacheIndexOpening,
+            FBCacheIndexFailed,
+            &_openState);
+        return;
+    }
+
+    [self _fetchCurrentDiskUsage];
+    OSAtomicCompareAndSwap32Barrier(
+        FBCacheIndexOpening,
+        FBCacheIndexReady,
+        &_openState);
+}
+
 - (void)_updateEntryInDatabaseForKey:(NSString*)key
     entry:(FBCacheEntityInfo*)entry
 {
@@ -383,6 +720,13 @@ static void releaseStatement(sqlite3_stmt* statement, sqlite3* database)
     CHECK_SQLITE_SUCCESS(fbdfl_sqlite3_bind_text(
         _updateStatement,
         4,
+        entry.tag.UTF8String,
+        (int)entry.tag.length,
+        nil), _database);
+
+    CHECK_SQLITE_SUCCESS(fbdfl_sqlite3_bind_text(
+        _updateStatement,
+        5,
         entry.key.UTF8String,
         (int)entry.key.length,
         nil), _database);
@@ -403,7 +747,10 @@ static void releaseStatement(sqlite3_stmt* statement, sqlite3* database)
 
         if (![existing.uuid isEqualToString:entry.uuid]) {
             // The files have changed.  Schedule a delete for existing file
-            [self.delegate cacheIndex:self deleteFileWithName:existing.uuid];
+            // unless another entry shares it
+            [self _deleteFilesIfUnreferenced:[NSDictionary
+                dictionaryWithObject:[NSNumber numberWithUnsignedInteger:existing.fileSize]
+                forKey:existing.uuid]];
         }
         return;
     }
@@ -434,6 +781,13 @@ static void releaseStatement(sqlite3_stmt* statement, sqlite3* database)
         4,
         (int)entry.fileSize), _database);
 
+    CHECK_SQLITE_SUCCESS(fbdfl_sqlite3_bind_text(
+        _insertStatement,
+        5,
+        entry.tag.UTF8String,
+        (int)entry.tag.length,
+        nil), _database);
+
     CHECK_SQLITE_DONE(fbdfl_sqlite3_step(_insertStatement), _database);
 
     entry.dirty = NO;
@@ -453,39 +807,6 @@ static void releaseStatement(sqlite3_stmt* statement, sqlite3* database)
     return [self _createCacheEntityInfo:_selectByKeyStatement];
 }
 
-- (NSMutableArray*) _readEntriesFromDatabase:(NSString*)keyFragment
-                           excludingFragment:(BOOL)exclude
-{
-    sqlite3_stmt* selectStatement;
-    const char* query;
-    if (exclude) {
-        selectStatement = _selectExcludingKeyFragmentStatement;
-        query = selectExcludingKeyFragmentQuery;
-    } else {
-        selectStatement = _selectByKeyFragmentStatement;
-        query = selectByKeyFragmentQuery;
-    }
-
-    initializeStatement(_database, &selectStatement, query);
-    NSString* wildcardKeyFragment = [NSString stringWithFormat:@"%%%@%%", keyFragment];
-
-    CHECK_SQLITE_SUCCESS(fbdfl_sqlite3_bind_text(
-        selectStatement,
-        1,
-        wildcardKeyFragment.UTF8String,
-        (int)wildcardKeyFragment.length,
-        nil), _database);
-
-    NSMutableArray *entries = [[[NSMutableArray alloc] init] autorelease];
-    FBCacheEntityInfo* entry;
-
-    while ((entry = [self _createCacheEntityInfo:selectStatement]) != nil) {
-        [entries addObject:entry];
-    }
-
-    return entries;
-}
-
 -(FBCacheEntityInfo*)_createCacheEntityInfo:(sqlite3_stmt*)selectStatement
 {
     int result = fbdfl_sqlite3_step(selectStatement);
@@ -500,6 +821,9 @@ static void releaseStatement(sqlite3_stmt* statement, sqlite3* database)
     CFTimeInterval accessTime =
     fbdfl_sqlite3_column_double(selectStatement, 2);
     NSUInteger fileSize = fbdfl_sqlite3_column_int(selectStatement, 3);
+    // Rows that predate tagging have a NULL tag
+    const unsigned char* tag =
+    fbdfl_sqlite3_column_text(selectStatement, 4);
 
     FBCacheEntityInfo* entry = [[FBCacheEntityInfo alloc]
                                 initWithKey:[NSString
@@ -508,6 +832,9 @@ static void releaseStatement(sqlite3_stmt* statement, sqlite3* database)
                                 uuid:[NSString
                                       stringWithCString:(const char*)uuidStr
                                       encoding:NSUTF8StringEncoding]
+                                tag:(tag ? [NSString
+                                            stringWithCString:(const char*)tag
+                                            encoding:NSUTF8StringEncoding] : nil)
                                 accessTime:accessTime
                                 fileSize:fileSize];
     return [entry autorelease];
@@ -526,9 +853,17 @@ static void releaseStatement(sqlite3_stmt* statement, sqlite3* database)
 - (FBCacheEntityInfo*)_entryForKey:(NSString*)key
 {
     __block FBCacheEntityInfo *entryInfo = [_cachedEntries objectForKey:key];
-    if (entryInfo == nil) {
-        // TODO: This is really bad if higher layers are going to be
-        // multi-threaded.  And this has to be unblocked.
+    @synchronized(_cachedEntries) {
+        if (entryInfo) {
+            _entryCacheStatistics.hits++;
+        } else {
+            _entryCacheStatistics.misses++;
+        }
+    }
+
+    // Until the database is open, a lookup that isn't in memory misses
+    // instead of waiting behind the open on the database queue.
+    if (entryInfo == nil && _openState == FBCacheIndexReady) {
         dispatch_sync(_databaseQueue, ^{
             entryInfo = [self _readEntryFromDatabase:key];
         });
@@ -554,6 +889,153 @@ static void releaseStatement(sqlite3_stmt* statement, sqlite3* database)
     CHECK_SQLITE_DONE(fbdfl_sqlite3_step(_removeByKeyStatement), _database);
 }
 
+// Bulk removal of all entries carrying a tag, for session teardown.
+// The matching rows are found through the tag index and deleted in a single
+// statement inside one transaction; their files are handed to the delegate
+// as one batch instead of one delete per entry.
+- (void)_removeEntriesFromDatabaseWithTag:(NSString*)tag
+{
+    CHECK_SQLITE_SUCCESS(fbdfl_sqlite3_exec(
+        _database,
+        "BEGIN TRANSACTION",
+        nil,
+        nil,
+        nil), _database);
+
+    initializeStatement(_database, &_selectByTagStatement, selectByTagQuery);
+    CHECK_SQLITE_SUCCESS(fbdfl_sqlite3_bind_text(
+        _selectByTagStatement,
+        1,
+        tag.UTF8String,
+        (int)tag.length,
+        nil), _database);
+
+    NSMutableDictionary* fileSizes = [[NSMutableDictionary alloc] init];
+    while (fbdfl_sqlite3_step(_selectByTagStatement) == SQLITE_ROW) {
+        const unsigned char* uuidStr =
+            fbdfl_sqlite3_column_text(_selectByTagStatement, 0);
+        const unsigned char* keyStr =
+            fbdfl_sqlite3_column_text(_selectByTagStatement, 1);
+
+        NSString* key = [NSString
+            stringWithCString:(const char*)keyStr
+            encoding:NSUTF8StringEncoding];
+
+        // Removing, so no need to flush to disk on eviction
+        FBCacheEntityInfo* entry = [_cachedEntries objectForKey:key];
+        entry.dirty = NO;
+        [_cachedEntries removeObjectForKey:key];
+
+        [fileSizes
+            setObject:[NSNumber numberWithInt:
+                fbdfl_sqlite3_column_int(_selectByTagStatement, 2)]
+            forKey:[NSString
+                stringWithCString:(const char*)uuidStr
+                encoding:NSUTF8StringEncoding]];
+    }
+
+    // Stores still placing their file are dropped as well
+    for (FBCacheEntityInfo* entry in _pendingEntries.allValues) {
+        if ([entry.tag isEqualToString:tag]) {
+            [self _removePendingEntryForKey:entry.key];
+        }
+    }
+
+    initializeStatement(_database, &_removeByTagStatement, deleteByTagQuery);
+    CHECK_SQLITE_SUCCESS(fbdfl_sqlite3_bind_text(
+        _removeByTagStatement,
+        1,
+        tag.UTF8String,
+        (int)tag.length,
+        nil), _database);
+    CHECK_SQLITE_DONE(fbdfl_sqlite3_step(_removeByTagStatement), _database);
+
+    CHECK_SQLITE_SUCCESS(fbdfl_sqlite3_exec(
+        _database,
+        "COMMIT TRANSACTION",
+        nil,
+        nil,
+        nil), _database);
+
+    [self _deleteFilesIfUnreferenced:fileSizes];
+    [fileSizes release];
+}
+
+- (NSInteger)_countEntriesWithFileName:(NSString*)fileName
+{
+    initializeStatement(
+        _database,
+        &_countByFileNameStatement,
+        countByFileNameQuery);
+    CHECK_SQLITE_SUCCESS(fbdfl_sqlite3_bind_text(
+        _countByFileNameStatement,
+        1,
+        fileName.UTF8String,
+        (int)fileName.length,
+        nil), _database);
+
+    CHECK_SQLITE(
+        fbdfl_sqlite3_step(_countByFileNameStatement),
+        SQLITE_ROW,
+        _database);
+    return fbdfl_sqlite3_column_int(_countByFileNameStatement, 0);
+}
+
+- (BOOL)_isFileNamePending:(NSString*)fileName
+{
+    return [_pendingFileNames countForObject:fileName] > 0;
+}
+
+// Supersedes any entry pending for the same key
+- (void)_addPendingEntry:(FBCacheEntityInfo*)entry
+{
+    [self _removePendingEntryForKey:entry.key];
+    [_pendingEntries setObject:entry forKey:entry.key];
+    [_pendingFileNames addObject:entry.uuid];
+}
+
+- (void)_removePendingEntryForKey:(NSString*)key
+{
+    FBCacheEntityInfo* entry = [_pendingEntries objectForKey:key];
+    if (entry) {
+        [_pendingFileNames removeObject:entry.uuid];
+        [_pendingEntries removeObjectForKey:key];
+    }
+}
+
+// Takes the names of files that entries just stopped referring to, mapped
+// to their sizes.  Those no entry refers to any longer are deleted, and
+// only they are taken off the disk usage.
+- (void)_deleteFilesIfUnreferenced:(NSDictionary*)fileSizes
+{
+    NSArray* unreferenced = [self unreferencedFileNames:fileSizes.allKeys];
+    NSUInteger spaceCleaned = 0;
+    for (NSString* fileName in unreferenced) {
+        spaceCleaned +=
+            [[fileSizes objectForKey:fileName] unsignedIntegerValue];
+    }
+
+    if (unreferenced.count == 1) {
+        [self.delegate
+            cacheIndex:self
+            deleteFileWithName:[unreferenced objectAtIndex:0]];
+    } else if (unreferenced.count > 1) {
+        [self.delegate cacheIndex:self deleteFilesWithNames:unreferenced];
+    }
+
+    [self _reduceDiskUsageBy:spaceCleaned];
+}
+
+- (void)_reduceDiskUsageBy:(NSUInteger)space
+{
+    if (_currentDiskUsage >= space) {
+        _currentDiskUsage -= space;
+    } else {
+        // Disk usage is out of whack - let's re-read
+        [self _fetchCurrentDiskUsage];
+    }
+}
+
 - (void)_dropTrimmingTable
 {
     sqlite3_stmt* trimCleanStatement = nil;
@@ -605,13 +1087,12 @@ static void releaseStatement(sqlite3_stmt* statement, sqlite3* database)
         &trimSelectStatement,
         trimSelectQuery);
 
-    NSUInteger spaceCleaned = 0;
+    NSMutableDictionary* fileSizes = [[NSMutableDictionary alloc] init];
     while (fbdfl_sqlite3_step(trimSelectStatement) == SQLITE_ROW) {
         const unsigned char* uuidStr =
             fbdfl_sqlite3_column_text(trimSelectStatement, 0);
         const unsigned char* keyStr =
             fbdfl_sqlite3_column_text(trimSelectStatement, 1);
-        spaceCleaned += fbdfl_sqlite3_column_int(trimSelectStatement, 2);
 
         // Remove in-memory cache entry if present
         NSString* key = [NSString
@@ -626,8 +1107,10 @@ static void releaseStatement(sqlite3_stmt* statement, sqlite3* database)
         entry.dirty = NO;
         [_cachedEntries removeObjectForKey:key];
 
-        // Delete the file
-        [self.delegate cacheIndex:self deleteFileWithName:uuid];
+        [fileSizes
+            setObject:[NSNumber numberWithInt:
+                fbdfl_sqlite3_column_int(trimSelectStatement, 2)]
+            forKey:uuid];
     }
 
     releaseStatement(trimSelectStatement, _database);
@@ -643,8 +1126,10 @@ static void releaseStatement(sqlite3_stmt* statement, sqlite3* database)
     releaseStatement(trimCleanStatement, _database);
     trimCleanStatement = nil;
 
-    _currentDiskUsage -= spaceCleaned;
-    NSAssert(_currentDiskUsage <= _diskCapacity, @"");
+    // Delete the files no longer backing any entry.  Files still shared
+    // with a surviving entry stay, so usage may not drop below capacity.
+    [self _deleteFilesIfUnreferenced:fileSizes];
+    [fileSizes release];
 
     // Okay to drop the trimming table
     [self _dropTrimmingTable];
@@ -659,12 +1144,14 @@ static void releaseStatement(sqlite3_stmt* statement, sqlite3* database)
 @synthesize uuid = _uuid;
 @synthesize fileSize = _fileSize;
 @synthesize key = _key;
+@synthesize tag = _tag;
 @synthesize dirty = _dirty;
 
 #pragma mark - Lifecycle
 
 - (id)initWithKey:(NSString*)key
     uuid:(NSString*)uuid
+    tag:(NSString*)tag
     accessTime:(CFTimeInterval)accessTime
     fileSize:(NSUInteger)fileSize
 {
@@ -672,6 +1159,7 @@ static void releaseStatement(sqlite3_stmt* statement, sqlite3* database)
     if (self != nil) {
         _key = [key copy];
         _uuid = [uuid copy];
+        _tag = [tag copy];
         _accessTime = accessTime;
         _fileSize = fileSize;
     }
@@ -682,6 +1170,7 @@ static void releaseStatement(sqlite3_stmt* statement, sqlite3* database)
 - (void)dealloc {
     [_uuid release];
     [_key release];
+    [_tag release];
     [super dealloc];
 }
 
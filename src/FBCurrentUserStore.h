@@ -0,0 +1,58 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+#import "FBGraphUser.h"
+#import "FBSession.h"
+
+// Posted on the main thread whenever the store's user or picture URL changes, or a fetch
+// fails; the error, if any, is under FBCurrentUserStoreErrorKey in the userInfo.
+extern NSString *const FBCurrentUserStoreDidChangeNotification;
+extern NSString *const FBCurrentUserStoreErrorKey;
+
+// Width and height, in pixels, of the square picture the store fetches.
+extern const NSUInteger FBCurrentUserStorePictureSize;
+
+// FBCurrentUserStore
+//
+// Summary:
+// Holds the current user for FBLoginView, FBUserSettingsViewController and
+// FBProfilePictureView. One batched request fetches both `me` and the URL of the user's
+// picture; fetches for a session already being fetched are coalesced. The last result is
+// kept in the disk cache, tagged with the session's access token, so that a control can
+// show it before the round trip completes. Main thread only.
+@interface FBCurrentUserStore : NSObject
+
++ (FBCurrentUserStore *)sharedStore;
+
+@property (nonatomic, readonly) FBSession *session;
+@property (nonatomic, readonly) id<FBGraphUser> user;
+@property (nonatomic, readonly) NSURL *pictureURL;
+
+// Switches to `session`, loading any persisted user for it right away, and refreshes
+// from the server unless a refresh is already in flight. Does nothing for a closed session.
+- (void)fetchForSession:(FBSession *)session;
+
+// As fetchForSession:, except that a user already known for `session`, persisted or
+// fetched, is kept as is without a round trip to the server.
+- (void)fetchForSession:(FBSession *)session skipRoundtripIfCached:(BOOL)skipRoundtripIfCached;
+
+// Returns the picture URL if `profileID` is the current user and the picture is at
+// least `pixelWidth` wide, otherwise nil.
+- (NSURL *)pictureURLForProfileID:(NSString *)profileID pixelWidth:(NSUInteger)pixelWidth;
+
+@end
@@ -0,0 +1,242 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "FBCurrentUserStore.h"
+
+#import "FBAccessTokenData.h"
+#import "FBDataDiskCache.h"
+#import "FBGraphObject.h"
+#import "FBRequest.h"
+#import "FBRequestConnection.h"
+#import "FBSDKVersion.h"
+#import "FBSession+Internal.h"
+#import "FBUtility.h"
+
+NSString *const FBCurrentUserStoreDidChangeNotification = @"com.facebook.sdk:FBCurrentUserStoreDidChangeNotification";
+NSString *const FBCurrentUserStoreErrorKey = @"com.facebook.sdk:FBCurrentUserStoreErrorKey";
+
+const NSUInteger FBCurrentUserStorePictureSize = 200;
+
+static NSString *const kPersistedUserKey = @"user";
+static NSString *const kPersistedPictureURLKey = @"picture_url";
+
+@interface FBCurrentUserStore ()
+
+@property (nonatomic, retain) FBSession *session;
+@property (nonatomic, retain) id<FBGraphUser> user;
+@property (nonatomic, copy) NSURL *pictureURL;
+@property (nonatomic, retain) FBRequestConnection *connection;
+
+- (NSURL *)persistenceURLForSession:(FBSession *)session;
+- (void)loadPersistedUser;
+- (void)persistUser;
+- (void)postChangeWithError:(NSError *)error;
+- (void)handleActiveSessionClosed:(NSNotification *)notification;
+
+@end
+
+@implementation FBCurrentUserStore
+
+@synthesize session = _session;
+@synthesize user = _user;
+@synthesize pictureURL = _pictureURL;
+@synthesize connection = _connection;
+
++ (FBCurrentUserStore *)sharedStore {
+    static FBCurrentUserStore *_instance;
+    static dispatch_once_t onceToken;
+
+    dispatch_once(&onceToken, ^{
+        _instance = [[FBCurrentUserStore alloc] init];
+    });
+
+    return _instance;
+}
+
+- (id)init {
+    self = [super init];
+    if (self) {
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(handleActiveSessionClosed:)
+                                                     name:FBSessionDidBecomeClosedActiveSessionNotification
+                                                   object:nil];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    [_connection cancel];
+    [_connection release];
+    [_session release];
+    [_user release];
+    [_pictureURL release];
+    [super dealloc];
+}
+
+#pragma mark - Fetching
+
+- (void)fetchForSession:(FBSession *)session {
+    [self fetchForSession:session skipRoundtripIfCached:NO];
+}
+
+- (void)fetchForSession:(FBSession *)session skipRoundtripIfCached:(BOOL)skipRoundtripIfCached {
+    if (!session.isOpen) {
+        return;
+    }
+
+    if (session != self.session) {
+        [self.connection cancel];
+        self.connection = nil;
+        self.session = session;
+        self.user = nil;
+        self.pictureURL = nil;
+        [self loadPersistedUser];
+    }
+
+    if (self.connection || (skipRoundtripIfCached && self.user)) {
+        return;
+    }
+
+    FBRequest *meRequest = [FBRequest requestForMe];
+    meRequest.session = session;
+
+    NSString *size = [NSString stringWithFormat:@"%lu", (unsigned long)FBCurrentUserStorePictureSize];
+    NSDictionary *pictureParameters = @{ @"redirect" : @"false",
+                                         @"width" : size,
+                                         @"height" : size,
+                                         @"migration_bundle" : FB_IOS_SDK_MIGRATION_BUNDLE };
+    FBRequest *pictureRequest = [[[FBRequest alloc] initWithSession:session
+                                                          graphPath:@"me/picture"
+                                                         parameters:pictureParameters
+                                                         HTTPMethod:nil]
+                                 autorelease];
+
+    // Handlers run in order once the whole batch has completed; the picture handler is
+    // last, so it publishes the result of both.
+    __block NSError *meError = nil;
+    __block id<FBGraphUser> fetchedUser = nil;
+    FBRequestConnection *connection = [[[FBRequestConnection alloc] init] autorelease];
+    [connection addRequest:meRequest
+         completionHandler:^(FBRequestConnection *innerConnection, id result, NSError *error) {
+             meError = [error retain];
+             fetchedUser = [result retain];
+         }];
+    [connection addRequest:pictureRequest
+         completionHandler:^(FBRequestConnection *innerConnection, id result, NSError *error) {
+             if (innerConnection == self.connection) {
+                 self.connection = nil;
+                 if (fetchedUser) {
+                     self.user = fetchedUser;
+                     NSString *url = [[result objectForKey:@"data"] objectForKey:@"url"];
+                     if ([url isKindOfClass:[NSString class]]) {
+                         self.pictureURL = [NSURL URLWithString:url];
+                     }
+                     [self persistUser];
+                 }
+                 [self postChangeWithError:meError];
+             }
+             [meError release];
+             [fetchedUser release];
+         }];
+
+    self.connection = connection;
+    [connection start];
+}
+
+- (NSURL *)pictureURLForProfileID:(NSString *)profileID pixelWidth:(NSUInteger)pixelWidth {
+    if (self.pictureURL &&
+        pixelWidth <= FBCurrentUserStorePictureSize &&
+        [profileID isEqualToString:self.user.id]) {
+        return self.pictureURL;
+    }
+    return nil;
+}
+
+- (void)handleActiveSessionClosed:(NSNotification *)notification {
+    if (notification.object != self.session) {
+        return;
+    }
+
+    [self.connection cancel];
+    self.connection = nil;
+    self.session = nil;
+    self.user = nil;
+    self.pictureURL = nil;
+    [self postChangeWithError:nil];
+}
+
+- (void)postChangeWithError:(NSError *)error {
+    NSDictionary *userInfo = error ? @{ FBCurrentUserStoreErrorKey : error } : nil;
+    [[NSNotificationCenter defaultCenter] postNotificationName:FBCurrentUserStoreDidChangeNotification
+                                                        object:self
+                                                      userInfo:userInfo];
+}
+
+#pragma mark - Persistence
+
+// The access token in the URL tags the entry, so it goes away with the session's data.
+- (NSURL *)persistenceURLForSession:(FBSession *)session {
+    NSString *accessToken = session.accessTokenData.accessToken;
+    if (accessToken.length == 0) {
+        return nil;
+    }
+    NSString *urlString = [NSString stringWithFormat:@"FBRequestCache://FBCurrentUserStore/me?access_token=%@",
+                           [FBUtility stringByURLEncodingString:accessToken]];
+    return [NSURL URLWithString:urlString];
+}
+
+- (void)loadPersistedUser {
+    NSURL *url = [self persistenceURLForSession:self.session];
+    NSData *data = url ? [[FBDataDiskCache sharedCache] dataForURL:url] : nil;
+    if (!data) {
+        return;
+    }
+
+    NSDictionary *persisted = [FBUtility simpleJSONDecode:[[[NSString alloc] initWithData:data
+                                                                                  encoding:NSUTF8StringEncoding]
+                                                           autorelease]];
+    NSDictionary *user = [persisted objectForKey:kPersistedUserKey];
+    if (![user isKindOfClass:[NSDictionary class]]) {
+        return;
+    }
+
+    self.user = (id<FBGraphUser>)[FBGraphObject graphObjectWrappingDictionary:user];
+    NSString *pictureURL = [persisted objectForKey:kPersistedPictureURLKey];
+    if ([pictureURL isKindOfClass:[NSString class]]) {
+        self.pictureURL = [NSURL URLWithString:pictureURL];
+    }
+    [self postChangeWithError:nil];
+}
+
+- (void)persistUser {
+    NSURL *url = [self persistenceURLForSession:self.session];
+    if (!url || !self.user) {
+        return;
+    }
+
+    NSMutableDictionary *persisted = [NSMutableDictionary dictionaryWithObject:self.user
+                                                                        forKey:kPersistedUserKey];
+    if (self.pictureURL) {
+        [persisted setObject:self.pictureURL.absoluteString forKey:kPersistedPictureURLKey];
+    }
+    NSData *data = [[FBUtility simpleJSONEncode:persisted] dataUsingEncoding:NSUTF8StringEncoding];
+    if (data) {
+        [[FBDataDiskCache sharedCache] setData:data forURL:url];
+    }
+}
+
+@end
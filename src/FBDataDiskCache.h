@@ -17,29 +17,73 @@
 #import <Foundation/Foundation.h>
 #import <UIKit/UIKit.h>
 
+#import "FBMemoryCache.h"
 #import "FBSession.h"
 
 @class FBCacheIndex;
+@class FBDataDiskCacheWriter;
 
-// This is a Disk based cache used internally by Facebook SDK
+// This is a Disk based cache used internally by Facebook SDK.  It is the one
+// cache engine of the process: GBDataDiskCache fronts the same instance.
 @interface FBDataDiskCache : NSObject
 {
 @private
-    NSCache* _inMemoryCache;
+    FBMemoryCache* _inMemoryCache;
     FBCacheIndex* _cacheIndex;
     NSString* _dataCachePath;
 
     dispatch_queue_t _fileQueue;
+
+    // Only touched on the file queue
+    NSMutableSet* _knownDirectories;
+    NSDirectoryEnumerator* _sweepEnumerator;
+
+    // Memory budget: both in-memory tiers run at a fraction of their
+    // configured size, cut under memory pressure and regrown afterwards.
+    NSUInteger _cacheSizeMemory;
+    NSUInteger _entryCacheCountLimit;
+    NSUInteger _budgetDivisor;
+    CFAbsoluteTime _lastBudgetChangeTime;
+
+    FBCacheTierStatistics _diskStatistics;
 }
 
 + (FBDataDiskCache*)sharedCache;
 
 @property (nonatomic, assign) NSUInteger cacheSizeMemory;
 @property (nonatomic, readonly) dispatch_queue_t fileQueue;
+@property (nonatomic, readonly) FBCacheIndex* cacheIndex;
+@property (nonatomic, readonly) FBCacheTierStatistics memoryStatistics;
+@property (nonatomic, readonly) FBCacheTierStatistics diskStatistics;
+@property (nonatomic, readonly) FBCacheTierStatistics entryCacheStatistics;
 
 - (NSData*)dataForURL:(NSURL*)dataURL;
 - (void)setData:(NSData*)data forURL:(NSURL*)url;
 - (void)removeDataForUrl:(NSURL*)url;
 - (void)removeDataForSession:(FBSession*)session;
+- (void)removeDataForAccessToken:(NSString*)accessToken;
+
+// Returns a writer that streams a download for `url` straight to disk, or
+// nil if no file could be created for it.
+- (FBDataDiskCacheWriter*)writerForURL:(NSURL*)url;
+
+@end
+
+// Streams data into the disk cache a chunk at a time, so that large
+// downloads never need to be held in memory.  The data is not added to the
+// in-memory tier.  Thread-safe, so a writer fed on one queue may be aborted
+// from another.
+@interface FBDataDiskCacheWriter : NSObject
+
+@property (nonatomic, readonly) unsigned long long length;
+
+- (BOOL)appendData:(NSData*)data;
+
+// Closes the file, indexes it under the writer's URL and returns its
+// contents mapped into memory, or nil if any write failed.
+- (NSData*)commit;
+
+// Discards everything written so far; safe to call more than once.
+- (void)abort;
 
 @end
@@ -16,24 +16,80 @@
 
 #import "FBDataDiskCache.h"
 
+#import <CommonCrypto/CommonDigest.h>
+#import <errno.h>
+#import <fcntl.h>
+#import <unistd.h>
+
 #import "FBAccessTokenData.h"
 #import "FBCacheIndex.h"
+#import "FBUtility.h"
 
 static const NSUInteger kMaxDataInMemorySize = 1 * 1024 * 1024; // 1MB
 static const NSUInteger kMaxDiskCacheSize = 10 * 1024 * 1024; // 10MB
 
+// Index entries loaded into memory as soon as the index is open, so that
+// the first requests after launch don't each go to the database.
+static const NSUInteger kWarmUpEntryCount = 64;
+
+// The integrity sweep starts a while after launch and then walks the index
+// and the cache directory a slice at a time, yielding between slices.
+static const NSUInteger kSweepSliceSize = 64;
+static const NSTimeInterval kSweepStartDelay = 30;
+static const NSTimeInterval kSweepSliceInterval = 0.5;
+
+// Under memory pressure the in-memory tiers shrink to 1/kMaxBudgetDivisor
+// of their configured size.  Once no warning has arrived for
+// kBudgetGrowthInterval they grow back by doubling, one step per interval.
+static const NSUInteger kMaxBudgetDivisor = 8;
+static const NSTimeInterval kBudgetGrowthInterval = 30;
+
 static NSString* const kDataDiskCachePath = @"DataDiskCache";
 static NSString* const kCacheInfoFile = @"CacheInfo";
+
+// Streamed downloads and in-memory payloads are written here first and
+// renamed into place, so that a cache file is never seen half written and a
+// file already mapped by a reader is never rewritten.  The extension keeps
+// them out of the integrity sweep; anything left over from a previous run is
+// deleted at startup.
+static NSString* const kIncomingDirectory = @"Incoming";
+static NSString* const kIncomingFileExtension = @"part";
 static NSString *const kAccessTokenKey = @"access_token";
 
 @interface FBDataDiskCache() <FBCacheIndexFileDelegate>
 @property (nonatomic, copy) NSString* dataCachePath;
+
+- (void)_createDirectoryForFileAtPath:(NSString*)filePath;
+- (NSString*)_newIncomingFilePath;
+- (void)_sweepAfterDelay:(NSTimeInterval)delay block:(dispatch_block_t)block;
+- (void)_sweepEntriesAfterRow:(NSInteger)row;
+- (void)_sweepFiles;
+
+- (void)_applyBudget;
+- (void)_growBudgetIfIdle;
+- (void)_didReceiveMemoryWarning:(NSNotification*)notification;
+- (void)_didEnterBackground:(NSNotification*)notification;
+
+- (NSData*)_commitFileAtPath:(NSString*)path
+                      forURL:(NSURL*)url
+                      digest:(const unsigned char*)digest
+                      length:(unsigned long long)length;
+
+@end
+
+@interface FBDataDiskCacheWriter()
+
+- (id)initWithCache:(FBDataDiskCache*)cache
+                url:(NSURL*)url
+               path:(NSString*)path;
+
 @end
 
 @implementation FBDataDiskCache
 
 @synthesize dataCachePath = _dataCachePath;
 @synthesize fileQueue = _fileQueue;
+@synthesize cacheIndex = _cacheIndex;
 
 #pragma mark - Lifecycle
 
@@ -55,6 +111,10 @@ static NSString *const kAccessTokenKey = @"access_token";
             withIntermediateDirectories:YES
             attributes:nil
             error:nil];
+        [[NSFileManager defaultManager]
+            removeItemAtPath:[_dataCachePath
+                stringByAppendingPathComponent:kIncomingDirectory]
+            error:nil];
 
         dispatch_queue_t bgPriQueue =
             dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0);
@@ -66,9 +126,31 @@ static NSString *const kAccessTokenKey = @"access_token";
         _cacheIndex = [[FBCacheIndex alloc] initWithCacheFolder:_dataCachePath];
         _cacheIndex.diskCapacity = kMaxDiskCacheSize;
         _cacheIndex.delegate = self;
-
-        _inMemoryCache = [[NSCache alloc] init];
-        _inMemoryCache.totalCostLimit = kMaxDataInMemorySize;
+        [_cacheIndex warmUpWithMostRecentlyUsedCount:kWarmUpEntryCount];
+
+        _inMemoryCache = [[FBMemoryCache alloc] init];
+
+        _cacheSizeMemory = kMaxDataInMemorySize;
+        _entryCacheCountLimit = _cacheIndex.entryCacheCountLimit;
+        _budgetDivisor = 1;
+        [self _applyBudget];
+
+        [[NSNotificationCenter defaultCenter]
+            addObserver:self
+            selector:@selector(_didReceiveMemoryWarning:)
+            name:UIApplicationDidReceiveMemoryWarningNotification
+            object:nil];
+        [[NSNotificationCenter defaultCenter]
+            addObserver:self
+            selector:@selector(_didEnterBackground:)
+            name:UIApplicationDidEnterBackgroundNotification
+            object:nil];
+
+        _knownDirectories = [[NSMutableSet alloc] init];
+
+        [self _sweepAfterDelay:kSweepStartDelay block:^{
+            [self _sweepEntriesAfterRow:0];
+        }];
     }
 
     return self;
@@ -76,6 +158,7 @@ static NSString *const kAccessTokenKey = @"access_token";
 
 - (void)dealloc
 {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
     if (_fileQueue) {
         dispatch_release(_fileQueue);
     }
@@ -85,6 +168,8 @@ static NSString *const kAccessTokenKey = @"access_token";
     }
     [_dataCachePath release];
     [_inMemoryCache release];
+    [_knownDirectories release];
+    [_sweepEnumerator release];
     [super dealloc];
 }
 
@@ -104,12 +189,76 @@ static NSString *const kAccessTokenKey = @"access_token";
 
 - (NSUInteger)cacheSizeMemory
 {
-    return _inMemoryCache.totalCostLimit;
+    return _cacheSizeMemory;
 }
 
 - (void)setCacheSizeMemory:(NSUInteger)cacheSizeMemory
 {
-    _inMemoryCache.totalCostLimit = cacheSizeMemory;
+    @synchronized(self) {
+        _cacheSizeMemory = cacheSizeMemory;
+        [self _applyBudget];
+    }
+}
+
+- (FBCacheTierStatistics)memoryStatistics
+{
+    return _inMemoryCache.statistics;
+}
+
+- (FBCacheTierStatistics)diskStatistics
+{
+    FBCacheTierStatistics statistics;
+    @synchronized(self) {
+        statistics = _diskStatistics;
+    }
+    return statistics;
+}
+
+- (FBCacheTierStatistics)entryCacheStatistics
+{
+    return _cacheIndex.entryCacheStatistics;
+}
+
+#pragma mark - Memory budget
+
+// Must be called while synchronized on self
+- (void)_applyBudget
+{
+    _inMemoryCache.totalCostLimit = _cacheSizeMemory / _budgetDivisor;
+    _cacheIndex.entryCacheCountLimit =
+        MAX(_entryCacheCountLimit / _budgetDivisor, 1);
+    _lastBudgetChangeTime = CFAbsoluteTimeGetCurrent();
+}
+
+- (void)_growBudgetIfIdle
+{
+    @synchronized(self) {
+        if (_budgetDivisor > 1 &&
+            CFAbsoluteTimeGetCurrent() - _lastBudgetChangeTime >
+                kBudgetGrowthInterval) {
+            _budgetDivisor /= 2;
+            [self _applyBudget];
+        }
+    }
+}
+
+- (void)_didReceiveMemoryWarning:(NSNotification*)notification
+{
+    @synchronized(self) {
+        _budgetDivisor = kMaxBudgetDivisor;
+        [self _applyBudget];
+    }
+    [_inMemoryCache removeProbationaryObjects];
+}
+
+- (void)_didEnterBackground:(NSNotification*)notification
+{
+    // Hold less while in the background, where we're first to be killed
+    @synchronized(self) {
+        _budgetDivisor = MAX(_budgetDivisor, kMaxBudgetDivisor / 2);
+        [self _applyBudget];
+    }
+    [_inMemoryCache removeProbationaryObjects];
 }
 
 #pragma mark - FBCacheIndexFileDelegate
@@ -117,10 +266,53 @@ static NSString *const kAccessTokenKey = @"access_token";
 - (void) cacheIndex:(FBCacheIndex*)cacheIndex
     writeFileWithName:(NSString*)name
     data:(NSData*)data
+    completion:(void (^)(BOOL placed))completion
+{
+    NSString* filePath = [_dataCachePath stringByAppendingPathComponent:name];
+    dispatch_async(_fileQueue, ^{
+        // Names are content-addressed, so a file of the right size already
+        // holds this data (e.g. the same image served from another URL).
+        NSDictionary* attributes = [[NSFileManager defaultManager]
+            attributesOfItemAtPath:filePath
+            error:nil];
+        if (attributes && attributes.fileSize == data.length) {
+            completion(YES);
+            return;
+        }
+
+        NSString* incomingPath = [self _newIncomingFilePath];
+        BOOL placed = [data writeToFile:incomingPath atomically:NO];
+        if (placed) {
+            [self _createDirectoryForFileAtPath:filePath];
+            placed = (rename(incomingPath.fileSystemRepresentation,
+                             filePath.fileSystemRepresentation) == 0);
+        }
+        if (!placed) {
+            unlink(incomingPath.fileSystemRepresentation);
+        }
+        [incomingPath release];
+
+        completion(placed);
+    });
+}
+
+- (void) cacheIndex:(FBCacheIndex*)cacheIndex
+    moveFileAtPath:(NSString*)path
+    toFileWithName:(NSString*)name
+    completion:(void (^)(BOOL placed))completion
 {
     NSString* filePath = [_dataCachePath stringByAppendingPathComponent:name];
     dispatch_async(_fileQueue, ^{
-        [data writeToFile:filePath atomically:YES];
+        // rename() atomically replaces any copy of the same content, and
+        // leaves mappings of the streamed file valid.
+        [self _createDirectoryForFileAtPath:filePath];
+        BOOL placed = (rename(path.fileSystemRepresentation,
+                              filePath.fileSystemRepresentation) == 0);
+        if (!placed) {
+            [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+        }
+
+        completion(placed);
     });
 }
 
@@ -135,8 +327,165 @@ static NSString *const kAccessTokenKey = @"access_token";
     });
 }
 
+- (void) cacheIndex:(FBCacheIndex*)cacheIndex
+    deleteFilesWithNames:(NSArray*)names
+{
+    NSString* dataCachePath = _dataCachePath;
+    NSArray* namesCopy = [names copy];
+    dispatch_async(_fileQueue, ^{
+        NSFileManager* fileManager = [[NSFileManager alloc] init];
+        for (NSString* name in namesCopy) {
+            [fileManager
+                removeItemAtPath:[dataCachePath stringByAppendingPathComponent:name]
+                error:nil];
+        }
+        [fileManager release];
+    });
+    [namesCopy release];
+}
+
+#pragma mark - Integrity sweep
+
+- (void)_createDirectoryForFileAtPath:(NSString*)filePath
+{
+    NSString* directory = [filePath stringByDeletingLastPathComponent];
+    if (![_knownDirectories containsObject:directory]) {
+        [[NSFileManager defaultManager]
+            createDirectoryAtPath:directory
+            withIntermediateDirectories:YES
+            attributes:nil
+            error:nil];
+        [_knownDirectories addObject:directory];
+    }
+}
+
+- (NSString*)_newIncomingFilePath
+{
+    NSString* incomingPath =
+        [_dataCachePath stringByAppendingPathComponent:kIncomingDirectory];
+    NSString* fileName = [FBUtility newUUIDString];
+    NSString* path = [[[incomingPath stringByAppendingPathComponent:fileName]
+        stringByAppendingPathExtension:kIncomingFileExtension] retain];
+    [fileName release];
+
+    [self _createDirectoryForFileAtPath:path];
+    return path;
+}
+
+- (void)_sweepAfterDelay:(NSTimeInterval)delay block:(dispatch_block_t)block
+{
+    dispatch_after(
+        dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)),
+        _fileQueue,
+        block);
+}
+
+// First pass: drop index entries whose file is missing or has the wrong size.
+- (void)_sweepEntriesAfterRow:(NSInteger)row
+{
+    dispatch_async(_cacheIndex.databaseQueue, ^{
+        if (_cacheIndex.failedToOpen) {
+            return;
+        }
+
+        NSMutableArray* fileNames = [NSMutableArray array];
+        NSMutableArray* keys = [NSMutableArray array];
+        NSMutableArray* fileSizes = [NSMutableArray array];
+        NSInteger lastRow = [_cacheIndex
+            readEntriesAfterRow:row
+            limit:kSweepSliceSize
+            fileNames:fileNames
+            keys:keys
+            fileSizes:fileSizes];
+
+        // Any write for these entries was queued before this point
+        dispatch_async(_fileQueue, ^{
+            NSFileManager* fileManager = [NSFileManager defaultManager];
+            for (NSUInteger i = 0; i < keys.count; i++) {
+                NSString* filePath = [_dataCachePath
+                    stringByAppendingPathComponent:[fileNames objectAtIndex:i]];
+                NSDictionary* attributes =
+                    [fileManager attributesOfItemAtPath:filePath error:nil];
+                if (attributes == nil ||
+                    attributes.fileSize !=
+                        [[fileSizes objectAtIndex:i] unsignedLongLongValue]) {
+                    [_cacheIndex removeEntryForKey:[keys objectAtIndex:i]];
+                }
+            }
+
+            if (keys.count < kSweepSliceSize) {
+                [self _sweepAfterDelay:kSweepSliceInterval block:^{
+                    [self _sweepFiles];
+                }];
+            } else {
+                [self _sweepAfterDelay:kSweepSliceInterval block:^{
+                    [self _sweepEntriesAfterRow:lastRow];
+                }];
+            }
+        });
+    });
+}
+
+// Second pass: delete files that no index entry refers to, then re-read the
+// disk usage to correct any drift.
+- (void)_sweepFiles
+{
+    if (_sweepEnumerator == nil) {
+        _sweepEnumerator = [[[NSFileManager defaultManager]
+            enumeratorAtPath:_dataCachePath] retain];
+    }
+
+    NSMutableArray* fileNames = [NSMutableArray array];
+    NSString* fileName = nil;
+    while (fileNames.count < kSweepSliceSize &&
+           (fileName = [_sweepEnumerator nextObject]) != nil) {
+        // The index's own database files are the only ones with an extension
+        if (![_sweepEnumerator.fileAttributes.fileType
+                isEqualToString:NSFileTypeRegular] ||
+            fileName.pathExtension.length > 0) {
+            continue;
+        }
+        [fileNames addObject:fileName];
+    }
+
+    BOOL finished = (fileName == nil);
+    if (finished) {
+        [_sweepEnumerator release];
+        _sweepEnumerator = nil;
+    }
+
+    dispatch_async(_cacheIndex.databaseQueue, ^{
+        NSArray* orphans = [_cacheIndex unreferencedFileNames:fileNames];
+        if (orphans.count > 0) {
+            [self cacheIndex:_cacheIndex deleteFilesWithNames:orphans];
+        }
+
+        if (finished) {
+            [_cacheIndex refreshCurrentDiskUsage];
+        } else {
+            [self _sweepAfterDelay:kSweepSliceInterval block:^{
+                [self _sweepFiles];
+            }];
+        }
+    });
+}
+
 #pragma mark - Other Methods
 
+// Entries are tagged with the access token present in their URL, so that
+// everything belonging to a session can be dropped with one indexed delete.
++ (NSString*)_tagForURL:(NSURL*)url
+{
+    NSString* query = url.query;
+    if (query.length == 0 ||
+        [query rangeOfString:kAccessTokenKey].location == NSNotFound) {
+        return nil;
+    }
+
+    NSDictionary* params = [FBUtility dictionaryByParsingURLQueryPart:query];
+    return [params objectForKey:kAccessTokenKey];
+}
+
 - (BOOL)_doesFileExist:(NSString*)name
 {
     NSString* filePath = [_dataCachePath stringByAppendingPathComponent:name];
@@ -171,6 +520,15 @@ static NSString *const kAccessTokenKey = @"access_token";
                         cost:data.length];
                 }
             }
+
+            @synchronized(self) {
+                if (data) {
+                    _diskStatistics.hits++;
+                    _diskStatistics.bytes += data.length;
+                } else {
+                    _diskStatistics.misses++;
+                }
+            }
         }
     } @catch (NSException* exception) {
         NSLog(@"FBDiskCache error: %@", exception.reason);
@@ -196,28 +554,39 @@ static NSString *const kAccessTokenKey = @"access_token";
         return;
     }
 
+    [self removeDataForAccessToken:session.accessTokenData.accessToken];
+}
+
+- (void)removeDataForAccessToken:(NSString*)accessToken
+{
     // Here we are removing all cache entries that don't have session context
     // These are things like images and the like. The thorough way would
     // be to maintain refCounts of these entries associated with accessTokens
     // and use that to decide which images to delete. However, this might be
     // overkill for a cache. Maybe revisit later?
-    [_cacheIndex removeEntries:kAccessTokenKey excludingFragment:YES];
+    [_cacheIndex removeEntriesWithTag:nil];
 
-    NSString* accessToken = session.accessTokenData.accessToken;
     if (accessToken != nil) {
         // Here we are removing all cache entries that have this session's access
         // token in the url.
-        [_cacheIndex removeEntries:accessToken excludingFragment:NO];
+        [_cacheIndex removeEntriesWithTag:accessToken];
     }
+
+    // Both removals above run in the background; make sure nothing belonging
+    // to the session is still served from memory in the meantime.
+    [_inMemoryCache removeAllObjects];
 }
 
 - (void)setData:(NSData*)data forURL:(NSURL*)url
 {
+    [self _growBudgetIfIdle];
+
     // TODO: Synchronize this across threads
     @try {
         [_cacheIndex
             storeFileForKey:url.absoluteString
-            withData:data];
+            withData:data
+            tag:[FBDataDiskCache _tagForURL:url]];
 
         [_inMemoryCache
             setObject:data
@@ -228,4 +597,173 @@ static NSString *const kAccessTokenKey = @"access_token";
     }
 }
 
+- (FBDataDiskCacheWriter*)writerForURL:(NSURL*)url
+{
+    if (_cacheIndex.failedToOpen) {
+        return nil;
+    }
+
+    NSString* incomingPath =
+        [_dataCachePath stringByAppendingPathComponent:kIncomingDirectory];
+    [[NSFileManager defaultManager]
+        createDirectoryAtPath:incomingPath
+        withIntermediateDirectories:YES
+        attributes:nil
+        error:nil];
+
+    NSString* fileName = [[FBUtility newUUIDString] autorelease];
+    NSString* path = [[incomingPath stringByAppendingPathComponent:fileName]
+        stringByAppendingPathExtension:kIncomingFileExtension];
+
+    return [[[FBDataDiskCacheWriter alloc]
+        initWithCache:self
+        url:url
+        path:path] autorelease];
+}
+
+- (NSData*)_commitFileAtPath:(NSString*)path
+                      forURL:(NSURL*)url
+                      digest:(const unsigned char*)digest
+                      length:(unsigned long long)length
+{
+    // Map before indexing: the file may be renamed, or replaced by an
+    // identical one, as soon as the index hands it back to us.
+    NSData* data = [NSData
+        dataWithContentsOfFile:path
+        options:NSDataReadingMappedAlways | NSDataReadingUncached
+        error:nil];
+    if (data == nil) {
+        [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+        return nil;
+    }
+
+    [self _growBudgetIfIdle];
+
+    @try {
+        // Drop any smaller copy held in memory from an earlier download
+        [_inMemoryCache removeObjectForKey:url];
+        [_cacheIndex
+            storeFileForKey:url.absoluteString
+            withFileAtPath:path
+            digest:digest
+            fileSize:(NSUInteger)length
+            tag:[FBDataDiskCache _tagForURL:url]];
+    } @catch (NSException* exception) {
+        NSLog(@"FBDiskCache error: %@", exception.reason);
+    }
+
+    return data;
+}
+
+@end
+
+@implementation FBDataDiskCacheWriter
+{
+    FBDataDiskCache* _cache;
+    NSURL* _url;
+    NSString* _path;
+    int _fd;
+    BOOL _failed;
+    unsigned long long _length;
+    CC_SHA1_CTX _digestContext;
+}
+
+@synthesize length = _length;
+
+- (id)initWithCache:(FBDataDiskCache*)cache
+                url:(NSURL*)url
+               path:(NSString*)path
+{
+    self = [super init];
+    if (self) {
+        _fd = open(path.fileSystemRepresentation,
+                   O_WRONLY | O_CREAT | O_TRUNC,
+                   0600);
+        if (_fd < 0) {
+            [self release];
+            return nil;
+        }
+
+        _cache = [cache retain];
+        _url = [url copy];
+        _path = [path copy];
+        CC_SHA1_Init(&_digestContext);
+    }
+
+    return self;
+}
+
+- (void)dealloc
+{
+    [self abort];
+    [_cache release];
+    [_url release];
+    [_path release];
+    [super dealloc];
+}
+
+- (BOOL)appendData:(NSData*)data
+{
+    @synchronized(self) {
+        if (_fd < 0 || _failed) {
+            return NO;
+        }
+
+        const char* bytes = data.bytes;
+        NSUInteger remaining = data.length;
+        while (remaining > 0) {
+            ssize_t written = write(_fd, bytes, remaining);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                _failed = YES;
+                return NO;
+            }
+            bytes += written;
+            remaining -= written;
+        }
+
+        CC_SHA1_Update(&_digestContext, data.bytes, (CC_LONG)data.length);
+        _length += data.length;
+        return YES;
+    }
+}
+
+- (NSData*)commit
+{
+    @synchronized(self) {
+        if (_fd < 0) {
+            return nil;
+        }
+
+        BOOL closed = (close(_fd) == 0);
+        _fd = -1;
+        if (_failed || !closed) {
+            unlink(_path.fileSystemRepresentation);
+            return nil;
+        }
+
+        unsigned char digest[CC_SHA1_DIGEST_LENGTH];
+        CC_SHA1_Final(digest, &_digestContext);
+
+        return [_cache
+            _commitFileAtPath:_path
+            forURL:_url
+            digest:digest
+            length:_length];
+    }
+}
+
+- (void)abort
+{
+    @synchronized(self) {
+        if (_fd >= 0) {
+            close(_fd);
+            _fd = -1;
+            unlink(_path.fileSystemRepresentation);
+        }
+    }
+}
+
 @end
@@ -68,6 +68,18 @@
  */
 - (void)show;
 
+/**
+ * Starts loading the dialog's page ahead of show, for example while the user is
+ * still on the preceding screen, so that it is ready when the dialog appears.
+ */
+- (void)prefetch;
+
+/**
+ * Creates a spare web view for the next dialog and opens a connection to the host of
+ * serverURL, for example when a screen that may show a dialog appears.
+ */
++ (void)warmUpForURL:(NSString *)serverURL;
+
 /**
  * Displays the first page of the dialog.
  *
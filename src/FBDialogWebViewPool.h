@@ -0,0 +1,65 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+#import <UIKit/UIKit.h>
+
+// FBDialogWebViewPool
+//
+// Summary:
+// Keeps the web views behind FBDialog, GDialog and FTDialog warm between dialogs.
+// A spare web view is created ahead of time and handed to the next dialog, and a
+// dismissed dialog's web view is replaced by a fresh spare, since a web view cannot be
+// made to forget its back/forward list. A dialog page can be prefetched into the spare
+// while the user is still on the preceding screen; the dialog that then loads the same
+// URL takes over the web view with the page already loaded or in flight. Callbacks the
+// page made in the meantime (fbconnect://success and the like) are held back and
+// replayed to that dialog. Preconnecting opens a connection to a dialog host so that
+// the first page load doesn't pay for DNS and TLS setup.
+//
+// Main thread only.
+@interface FBDialogWebViewPool : NSObject
+
++ (FBDialogWebViewPool *)sharedPool;
+
+// Creates the spare web view if there is none.
+- (void)warmUp;
+
+// Issues a lightweight request to the host of url so that its connection is open
+// by the time a dialog loads from it.
+- (void)preconnectToURL:(NSURL *)url;
+
+// Preconnects to url and starts loading it in the spare web view. A prefetch expires
+// after a couple of minutes, or when another URL is prefetched.
+- (void)prefetchURL:(NSURL *)url;
+
+// Returns a web view for a dialog to own, creating one if there is no spare.
+- (UIWebView *)dequeueWebView;
+
+// Loads url for dialog, whose web view is webView, and returns the web view that is
+// now the dialog's. That is webView, unless url was prefetched: then the prefetching
+// web view takes webView's place in the dialog and webView is taken back. A finished
+// load, or a callback the page made, is then delivered to dialog on a later turn of
+// the run loop, provided the dialog is still on screen.
+- (UIWebView *)loadURL:(NSURL *)url
+             inWebView:(UIWebView *)webView
+              ofDialog:(UIView<UIWebViewDelegate> *)dialog;
+
+// Takes back a web view from a dismissed dialog. A fresh spare is created in its place
+// if there is none.
+- (void)enqueueWebView:(UIWebView *)webView;
+
+@end
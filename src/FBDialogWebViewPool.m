@@ -0,0 +1,288 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "FBDialogWebViewPool.h"
+
+// Frame the dialogs give a new web view before laying it out
+static const CGRect FBDialogWebViewPoolInitialFrame = {{0, 0}, {480, 480}};
+
+// A prefetched page older than this is thrown away rather than shown
+static const NSTimeInterval FBDialogWebViewPoolPrefetchLifetime = 120;
+
+// Preconnects to the same host are not repeated within this interval
+static const NSTimeInterval FBDialogWebViewPoolPreconnectInterval = 30;
+
+@interface FBDialogWebViewPool () <UIWebViewDelegate>
+
+@property (nonatomic, retain) UIWebView *spareWebView;
+@property (nonatomic, retain) UIWebView *prefetchWebView;
+@property (nonatomic, copy) NSURL *prefetchURL;
+@property (nonatomic, retain) NSDate *prefetchDate;
+@property (nonatomic, assign) BOOL prefetchLoaded;
+@property (nonatomic, retain) NSURLRequest *prefetchBlockedRequest;
+
+- (UIWebView *)newWebView;
+- (UIWebView *)dequeueWebViewPrefetchedForURL:(NSURL *)url
+                                       loaded:(BOOL *)loaded
+                               blockedRequest:(NSURLRequest **)blockedRequest;
+- (void)discardPrefetch;
+- (void)didReceiveMemoryWarning:(NSNotification *)notification;
+
+@end
+
+@implementation FBDialogWebViewPool {
+    NSMutableDictionary *_preconnectDates;
+    NSOperationQueue *_preconnectQueue;
+}
+
+@synthesize spareWebView = _spareWebView;
+@synthesize prefetchWebView = _prefetchWebView;
+@synthesize prefetchURL = _prefetchURL;
+@synthesize prefetchDate = _prefetchDate;
+@synthesize prefetchLoaded = _prefetchLoaded;
+@synthesize prefetchBlockedRequest = _prefetchBlockedRequest;
+
++ (FBDialogWebViewPool *)sharedPool {
+    static FBDialogWebViewPool *pool = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        pool = [[FBDialogWebViewPool alloc] init];
+    });
+    return pool;
+}
+
+- (id)init {
+    if ((self = [super init])) {
+        _preconnectDates = [[NSMutableDictionary alloc] init];
+        _preconnectQueue = [[NSOperationQueue alloc] init];
+        _preconnectQueue.maxConcurrentOperationCount = 1;
+
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(didReceiveMemoryWarning:)
+                                                     name:UIApplicationDidReceiveMemoryWarningNotification
+                                                   object:nil];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    [self discardPrefetch];
+    [_spareWebView release];
+    [_preconnectDates release];
+    [_preconnectQueue release];
+    [super dealloc];
+}
+
+#pragma mark - Public
+
+- (void)warmUp {
+    if (!self.spareWebView) {
+        UIWebView *webView = [self newWebView];
+        self.spareWebView = webView;
+        [webView release];
+    }
+}
+
+- (void)preconnectToURL:(NSURL *)url {
+    NSString *host = url.host;
+    if (!host) {
+        return;
+    }
+
+    NSDate *lastPreconnect = [_preconnectDates objectForKey:host];
+    if (lastPreconnect && -[lastPreconnect timeIntervalSinceNow] < FBDialogWebViewPoolPreconnectInterval) {
+        return;
+    }
+    [_preconnectDates setObject:[NSDate date] forKey:host];
+
+    // Only the connection matters; the response is dropped
+    NSURL *rootURL = [NSURL URLWithString:[NSString stringWithFormat:@"%@://%@/", url.scheme, host]];
+    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:rootURL];
+    request.HTTPMethod = @"HEAD";
+    [NSURLConnection sendAsynchronousRequest:request
+                                       queue:_preconnectQueue
+                           completionHandler:^(NSURLResponse *response, NSData *data, NSError *error) {}];
+}
+
+- (void)prefetchURL:(NSURL *)url {
+    if (!url) {
+        return;
+    }
+    if ([self.prefetchURL isEqual:url] &&
+        -[self.prefetchDate timeIntervalSinceNow] < FBDialogWebViewPoolPrefetchLifetime) {
+        return;
+    }
+
+    [self discardPrefetch];
+    [self preconnectToURL:url];
+
+    UIWebView *webView = self.spareWebView ? [self.spareWebView retain] : [self newWebView];
+    self.spareWebView = nil;
+    webView.delegate = self;
+    self.prefetchWebView = webView;
+    [webView release];
+
+    self.prefetchURL = url;
+    self.prefetchDate = [NSDate date];
+    self.prefetchLoaded = NO;
+    [webView loadRequest:[NSURLRequest requestWithURL:url]];
+}
+
+- (UIWebView *)dequeueWebView {
+    UIWebView *webView = self.spareWebView;
+    if (webView) {
+        [[webView retain] autorelease];
+        self.spareWebView = nil;
+        return webView;
+    }
+    return [[self newWebView] autorelease];
+}
+
+- (UIWebView *)loadURL:(NSURL *)url
+             inWebView:(UIWebView *)webView
+              ofDialog:(UIView<UIWebViewDelegate> *)dialog {
+    BOOL loaded = NO;
+    NSURLRequest *blockedRequest = nil;
+    UIWebView *prefetched = [self dequeueWebViewPrefetchedForURL:url
+                                                          loaded:&loaded
+                                                  blockedRequest:&blockedRequest];
+    if (!prefetched) {
+        [webView loadRequest:[NSURLRequest requestWithURL:url]];
+        return webView;
+    }
+
+    prefetched.transform = webView.transform;
+    prefetched.bounds = webView.bounds;
+    prefetched.center = webView.center;
+    prefetched.autoresizingMask = webView.autoresizingMask;
+    prefetched.delegate = dialog;
+    [dialog insertSubview:prefetched aboveSubview:webView];
+    [self enqueueWebView:webView];
+
+    if (blockedRequest || loaded) {
+        // Let the dialog finish showing before acting on the page; the blocks keep the
+        // dialog alive until then, and a dialog dismissed meanwhile is left alone. Invisible
+        // dialogs are never in a window, so the web view's place in the dialog is what counts.
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (prefetched.delegate != dialog || prefetched.superview != dialog) {
+                return;
+            }
+            if (blockedRequest) {
+                [dialog webView:prefetched
+                    shouldStartLoadWithRequest:blockedRequest
+                                navigationType:UIWebViewNavigationTypeOther];
+            } else {
+                [dialog webViewDidFinishLoad:prefetched];
+            }
+        });
+    }
+    return prefetched;
+}
+
+- (void)enqueueWebView:(UIWebView *)webView {
+    if (!webView) {
+        return;
+    }
+
+    webView.delegate = nil;
+    [webView stopLoading];
+    [webView removeFromSuperview];
+    if (webView == self.prefetchWebView) {
+        return;
+    }
+
+    // The previous dialog's pages stay in a web view's back/forward list, so the next
+    // dialog gets a new one rather than this one
+    [self warmUp];
+}
+
+#pragma mark - UIWebViewDelegate
+
+- (BOOL)webView:(UIWebView *)webView shouldStartLoadWithRequest:(NSURLRequest *)request
+ navigationType:(UIWebViewNavigationType)navigationType {
+    // Dialog callbacks (fbconnect:// and the like) are for the dialog to handle, so
+    // the first one is kept for the dialog that takes the web view over
+    NSString *scheme = request.URL.scheme;
+    if ([scheme isEqualToString:@"http"] || [scheme isEqualToString:@"https"]) {
+        return YES;
+    }
+    if (webView == self.prefetchWebView && !self.prefetchBlockedRequest) {
+        self.prefetchBlockedRequest = request;
+    }
+    return NO;
+}
+
+- (void)webViewDidFinishLoad:(UIWebView *)webView {
+    if (webView == self.prefetchWebView) {
+        self.prefetchLoaded = YES;
+    }
+}
+
+- (void)webView:(UIWebView *)webView didFailLoadWithError:(NSError *)error {
+    // A blocked callback fails the load it interrupted; the callback still counts
+    if (webView == self.prefetchWebView && !self.prefetchBlockedRequest) {
+        [self discardPrefetch];
+    }
+}
+
+#pragma mark - Private
+
+- (UIWebView *)newWebView {
+    UIWebView *webView = [[UIWebView alloc] initWithFrame:FBDialogWebViewPoolInitialFrame];
+    webView.autoresizingMask = UIViewAutoresizingFlexibleWidth | UIViewAutoresizingFlexibleHeight;
+    return webView;
+}
+
+- (UIWebView *)dequeueWebViewPrefetchedForURL:(NSURL *)url
+                                       loaded:(BOOL *)loaded
+                               blockedRequest:(NSURLRequest **)blockedRequest {
+    if (!self.prefetchWebView || ![self.prefetchURL isEqual:url]) {
+        return nil;
+    }
+    if (-[self.prefetchDate timeIntervalSinceNow] >= FBDialogWebViewPoolPrefetchLifetime) {
+        [self discardPrefetch];
+        return nil;
+    }
+
+    UIWebView *webView = [[self.prefetchWebView retain] autorelease];
+    webView.delegate = nil;
+    *loaded = self.prefetchLoaded;
+    *blockedRequest = [[self.prefetchBlockedRequest retain] autorelease];
+    self.prefetchWebView = nil;
+    self.prefetchURL = nil;
+    self.prefetchDate = nil;
+    self.prefetchLoaded = NO;
+    self.prefetchBlockedRequest = nil;
+    return webView;
+}
+
+- (void)discardPrefetch {
+    self.prefetchWebView.delegate = nil;
+    [self.prefetchWebView stopLoading];
+    self.prefetchWebView = nil;
+    self.prefetchURL = nil;
+    self.prefetchDate = nil;
+    self.prefetchLoaded = NO;
+    self.prefetchBlockedRequest = nil;
+}
+
+- (void)didReceiveMemoryWarning:(NSNotification *)notification {
+    [self discardPrefetch];
+    self.spareWebView = nil;
+}
+
+@end
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+#import "FBLogSink.h"
+
+/*!
+ @class FBFileLogSink
+
+ @abstract
+ An <FBLogSink> that appends entries to a size-capped set of rotating files in a directory.
+ Register one with <[FBSettings addLogSink:]>.
+
+ @discussion
+ The current file is FBSDKLog.txt; once it would grow past maximumFileSize it becomes
+ FBSDKLog.1.txt, FBSDKLog.1.txt becomes FBSDKLog.2.txt and so on, and the oldest file past
+ maximumFileCount is deleted, so the sink never uses more than
+ maximumFileSize * maximumFileCount bytes of disk.
+
+ Logging never blocks the caller: entries are formatted and written on a private serial
+ queue. At most maximumPendingBytes of entries wait for that queue; entries logged past the
+ limit are dropped and counted, and the count is noted in the file once the queue catches up.
+ All methods are thread-safe.
+ */
+@interface FBFileLogSink : NSObject <FBLogSink>
+
+/*!
+ @abstract
+ Creates a sink writing to directory, which is created if needed, with the default file
+ size and count limits.
+ */
+- (id)initWithDirectory:(NSString *)directory;
+
+/*!
+ @abstract
+ Creates a sink writing to directory, which is created if needed.
+
+ @param directory          The directory to hold the log files.
+ @param maximumFileSize    The size in bytes at which the current file is rotated.
+ @param maximumFileCount   The number of files kept, including the current one.
+ */
+- (id)initWithDirectory:(NSString *)directory
+        maximumFileSize:(unsigned long long)maximumFileSize
+       maximumFileCount:(NSUInteger)maximumFileCount;
+
+/*! @abstract The directory holding the log files. */
+@property (nonatomic, readonly, copy) NSString *directory;
+
+/*! @abstract The size in bytes at which the current file is rotated. */
+@property (nonatomic, readonly) unsigned long long maximumFileSize;
+
+/*! @abstract The number of files kept, including the current one. */
+@property (nonatomic, readonly) NSUInteger maximumFileCount;
+
+/*! @abstract The bytes of entries allowed to wait to be written before entries are dropped. */
+@property (nonatomic, assign) NSUInteger maximumPendingBytes;
+
+/*! @abstract The number of entries dropped so far because too many were waiting. */
+@property (nonatomic, readonly) NSUInteger droppedEntryCount;
+
+/*! @abstract Paths of the log files currently on disk, newest first. */
+@property (nonatomic, readonly) NSArray *logFilePaths;
+
+/*! @abstract Waits for pending entries to be written and synced to disk. */
+- (void)flush;
+
+@end
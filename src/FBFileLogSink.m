@@ -0,0 +1,213 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "FBFileLogSink.h"
+
+#import <libkern/OSAtomic.h>
+
+static NSString *const kLogFileBaseName = @"FBSDKLog";
+static NSString *const kLogFileExtension = @"txt";
+
+static const unsigned long long kDefaultMaximumFileSize = 512 * 1024;
+static const NSUInteger kDefaultMaximumFileCount = 4;
+static const NSUInteger kDefaultMaximumPendingBytes = 256 * 1024;
+
+@interface FBFileLogSink ()
+
+- (NSString *)pathForFileAtIndex:(NSUInteger)index;
+- (void)writeData:(NSData *)data;
+- (void)openFile;
+- (void)rotateFiles;
+
+@end
+
+@implementation FBFileLogSink
+{
+    dispatch_queue_t _queue;
+    volatile int32_t _pendingBytes;
+    volatile int32_t _droppedEntryCount;
+
+    // Only touched on _queue
+    NSFileHandle *_fileHandle;
+    unsigned long long _fileSize;
+    int32_t _reportedDropCount;
+    NSDateFormatter *_dateFormatter;
+}
+
+@synthesize directory = _directory;
+@synthesize maximumFileSize = _maximumFileSize;
+@synthesize maximumFileCount = _maximumFileCount;
+@synthesize maximumPendingBytes = _maximumPendingBytes;
+
+- (id)initWithDirectory:(NSString *)directory {
+    return [self initWithDirectory:directory
+                   maximumFileSize:kDefaultMaximumFileSize
+                  maximumFileCount:kDefaultMaximumFileCount];
+}
+
+- (id)initWithDirectory:(NSString *)directory
+        maximumFileSize:(unsigned long long)maximumFileSize
+       maximumFileCount:(NSUInteger)maximumFileCount {
+    if (self = [super init]) {
+        _directory = [directory copy];
+        _maximumFileSize = MAX(maximumFileSize, 1);
+        _maximumFileCount = MAX(maximumFileCount, 1);
+        _maximumPendingBytes = kDefaultMaximumPendingBytes;
+
+        _dateFormatter = [[NSDateFormatter alloc] init];
+        _dateFormatter.locale = [[[NSLocale alloc] initWithLocaleIdentifier:@"en_US_POSIX"] autorelease];
+        _dateFormatter.dateFormat = @"yyyy-MM-dd HH:mm:ss.SSS";
+
+        _queue = dispatch_queue_create("com.facebook.sdk.FBFileLogSink", DISPATCH_QUEUE_SERIAL);
+        dispatch_async(_queue, ^{
+            [self openFile];
+        });
+    }
+    return self;
+}
+
+- (void)dealloc {
+    // Every block on the queue retains self, so it is idle by now
+    dispatch_release(_queue);
+    [_fileHandle closeFile];
+    [_fileHandle release];
+    [_dateFormatter release];
+    [_directory release];
+    [super dealloc];
+}
+
+#pragma mark - Public
+
+- (NSUInteger)droppedEntryCount {
+    return (NSUInteger)_droppedEntryCount;
+}
+
+- (NSArray *)logFilePaths {
+    __block NSMutableArray *paths = [NSMutableArray array];
+    dispatch_sync(_queue, ^{
+        NSFileManager *fileManager = [NSFileManager defaultManager];
+        for (NSUInteger i = 0; i < _maximumFileCount; i++) {
+            NSString *path = [self pathForFileAtIndex:i];
+            if ([fileManager fileExistsAtPath:path]) {
+                [paths addObject:path];
+            }
+        }
+    });
+    return paths;
+}
+
+- (void)flush {
+    dispatch_sync(_queue, ^{
+        [_fileHandle synchronizeFile];
+    });
+}
+
+#pragma mark - FBLogSink
+
+- (void)logEntry:(NSString *)entry loggingBehavior:(NSString *)loggingBehavior {
+    // Charge the entry against the pending budget before queueing it; UTF-16 length is
+    // close enough to the written size for a bound.
+    int32_t cost = (int32_t)MIN(entry.length, (NSUInteger)INT32_MAX / 2);
+    if (OSAtomicAdd32Barrier(cost, &_pendingBytes) > (int32_t)_maximumPendingBytes) {
+        OSAtomicAdd32Barrier(-cost, &_pendingBytes);
+        OSAtomicIncrement32Barrier(&_droppedEntryCount);
+        return;
+    }
+
+    CFAbsoluteTime time = CFAbsoluteTimeGetCurrent();
+    entry = [entry copy];
+    loggingBehavior = [loggingBehavior copy];
+    dispatch_async(_queue, ^{
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        NSString *timestamp = [_dateFormatter stringFromDate:[NSDate dateWithTimeIntervalSinceReferenceDate:time]];
+
+        int32_t dropped = _droppedEntryCount;
+        if (dropped != _reportedDropCount) {
+            NSString *note = [NSString stringWithFormat:@"%@ [FBFileLogSink] %d entries dropped\n",
+                              timestamp, dropped - _reportedDropCount];
+            [self writeData:[note dataUsingEncoding:NSUTF8StringEncoding]];
+            _reportedDropCount = dropped;
+        }
+
+        NSString *line = [NSString stringWithFormat:@"%@ [%@] %@\n", timestamp, loggingBehavior, entry];
+        [self writeData:[line dataUsingEncoding:NSUTF8StringEncoding]];
+
+        OSAtomicAdd32Barrier(-cost, &_pendingBytes);
+        [entry release];
+        [loggingBehavior release];
+        [pool drain];
+    });
+}
+
+#pragma mark - Private
+
+- (NSString *)pathForFileAtIndex:(NSUInteger)index {
+    NSString *name = index == 0
+        ? kLogFileBaseName
+        : [NSString stringWithFormat:@"%@.%lu", kLogFileBaseName, (unsigned long)index];
+    return [_directory stringByAppendingPathComponent:[name stringByAppendingPathExtension:kLogFileExtension]];
+}
+
+- (void)writeData:(NSData *)data {
+    if (_fileSize > 0 && _fileSize + data.length > _maximumFileSize) {
+        [self rotateFiles];
+    }
+    if (!_fileHandle) {
+        return;
+    }
+
+    @try {
+        [_fileHandle writeData:data];
+        _fileSize += data.length;
+    } @catch (NSException *exception) {
+        // Out of disk space or the file went away; start over with a fresh file
+        [_fileHandle release];
+        _fileHandle = nil;
+        [self openFile];
+    }
+}
+
+- (void)openFile {
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    [fileManager createDirectoryAtPath:_directory withIntermediateDirectories:YES attributes:nil error:nil];
+
+    NSString *path = [self pathForFileAtIndex:0];
+    if (![fileManager fileExistsAtPath:path]) {
+        [fileManager createFileAtPath:path contents:nil attributes:nil];
+    }
+
+    _fileHandle = [[NSFileHandle fileHandleForWritingAtPath:path] retain];
+    _fileSize = [_fileHandle seekToEndOfFile];
+}
+
+- (void)rotateFiles {
+    [_fileHandle closeFile];
+    [_fileHandle release];
+    _fileHandle = nil;
+    _fileSize = 0;
+
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    [fileManager removeItemAtPath:[self pathForFileAtIndex:_maximumFileCount - 1] error:nil];
+    for (NSUInteger i = _maximumFileCount - 1; i > 0; i--) {
+        [fileManager moveItemAtPath:[self pathForFileAtIndex:i - 1]
+                             toPath:[self pathForFileAtIndex:i]
+                              error:nil];
+    }
+
+    [self openFile];
+}
+
+@end
@@ -16,6 +16,7 @@
 
 #import "FBFrictionlessRecipientCache.h"
 
+#import "FBCurrentUserStore.h"
 #import "FBFrictionlessDialogSupportDelegate.h"
 #import "FBFrictionlessRequestSettings.h"
 #import "FBSession+Internal.h"
@@ -36,11 +37,19 @@
     if (self) {
         self.frictionlessSettings = [[[FBFrictionlessRequestSettings alloc] init] autorelease];
         [self.frictionlessSettings enableWithFacebook:nil]; // sets the flag on
+
+        // recipients belong to the user who was logged in; persisted copies are keyed by
+        // user, and the ones in memory are dropped when that user's session closes
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(activeSessionDidClose:)
+                                                     name:FBSessionDidBecomeClosedActiveSessionNotification
+                                                   object:nil];
     }
     return self;
 }
 
 - (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
     self.frictionlessSettings = nil;
     [super dealloc];
 }
@@ -55,7 +64,10 @@
 
 - (BOOL)isFrictionlessRecipient:(id)fbid {
     // we support NSString, NSNumber and dictionary with id-key of string or number
-    return [self.frictionlessSettings isFrictionlessEnabledForRecipient:[FBUtility stringFBIDFromObject:fbid]];
+    if ([fbid isKindOfClass:[NSDictionary class]]) {
+        fbid = [fbid objectForKey:@"id"];
+    }
+    return [self.frictionlessSettings isFrictionlessEnabledForRecipient:fbid];
 }
 
 - (BOOL)areFrictionlessRecipients:(NSArray*)fbids {
@@ -83,15 +95,45 @@
         session = [FBSession activeSessionIfOpen];
     }
 
-    [[[[FBRequest alloc] initWithSession:session
-                               graphPath:@"me/apprequestformerrecipients"]
-      autorelease]
-     startWithCompletionHandler:^(FBRequestConnection *connection, id result, NSError *error) {
-         [self.frictionlessSettings updateRecipientCacheWithRequestResult:result];
-         if (handler) {
-             handler(connection, result, error);
-         }
-     }];
+    FBRequestConnection *connection = [[[FBRequestConnection alloc] init] autorelease];
+
+    // the persisted recipients are keyed by user, so the user's id is needed first; it is
+    // fetched in the same batch unless the current user store already has it
+    FBCurrentUserStore *store = [FBCurrentUserStore sharedStore];
+    if (session && store.session == session && store.user.id) {
+        [self.frictionlessSettings persistRecipientCacheForAppID:session.appID userID:store.user.id];
+    } else if (session) {
+        FBRequest *meRequest = [[[FBRequest alloc] initWithSession:session
+                                                        graphPath:@"me"
+                                                       parameters:@{@"fields": @"id"}
+                                                       HTTPMethod:nil]
+                                autorelease];
+        [connection addRequest:meRequest
+             completionHandler:^(FBRequestConnection *connection, id result, NSError *error) {
+                 if (!error) {
+                     [self.frictionlessSettings persistRecipientCacheForAppID:session.appID
+                                                                       userID:[result objectForKey:@"id"]];
+                 }
+             }];
+    }
+
+    FBRequest *request = [[[FBRequest alloc] initWithSession:session
+                                                   graphPath:@"me/apprequestformerrecipients"]
+                          autorelease];
+    [connection addRequest:request
+         completionHandler:^(FBRequestConnection *connection, id result, NSError *error) {
+             [self.frictionlessSettings updateRecipientCacheWithRequestResult:result];
+             if (handler) {
+                 handler(connection, result, error);
+             }
+         }];
+    [connection start];
+}
+
+- (void)activeSessionDidClose:(NSNotification *)notification {
+    // apps close the session on every termination, so the persisted copy is kept for the
+    // next launch; logging out removes it through closeAndClearTokenInformation
+    [self.frictionlessSettings unloadRecipientCache];
 }
 
 - (void)webDialogsWillPresentDialog:(NSString *)dialog
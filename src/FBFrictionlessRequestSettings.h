@@ -38,7 +38,7 @@
 @property (nonatomic, readonly) BOOL enabled;
 
 /**
- * NSArray of recipients
+ * NSArray of recipients, as fbid strings
  */
 @property (nonatomic, readonly) NSArray *recipientIDs;
 
@@ -49,6 +49,31 @@
  */
 - (void)enableWithFacebook:(Facebook*)facebook;
 
+/**
+ * Persist the recipient cache across launches, keyed by app ID and user ID; any
+ * recipients persisted for that user by an earlier launch are loaded immediately,
+ * so the cache is usable before the first reload completes. Recipients cached for
+ * a different user are dropped
+ */
+- (void)persistRecipientCacheForAppID:(NSString*)appID userID:(NSString*)userID;
+
+/**
+ * Empty the recipient cache, delete its persisted copy and stop persisting it;
+ * called by the sdk when the user logs out
+ */
+- (void)clearRecipientCache;
+
+/**
+ * Empty the recipient cache and stop persisting it, keeping its persisted copy
+ * for that user's next session; called by the sdk when the session closes
+ */
+- (void)unloadRecipientCache;
+
+/**
+ * Delete the recipients persisted for every user of the given app
+ */
++ (void)removePersistedRecipientsForAppID:(NSString*)appID;
+
 /**
  * Reload recipient cache; called by the sdk to keep the cache fresh;
  * method makes graph request: me/apprequestformerrecipients
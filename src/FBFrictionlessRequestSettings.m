@@ -18,13 +18,152 @@
 
 #import "Facebook.h"
 
+// The recipient cache is an open-addressed hash set of 64-bit fbids; zero is never a
+// valid fbid, so it marks an empty slot.
+typedef struct {
+    uint64_t *slots;
+    NSUInteger capacity;   // always a power of two, at least twice count
+    NSUInteger count;
+} FBRecipientSet;
+
+static NSUInteger FBRecipientSetSlot(uint64_t fbid, NSUInteger capacity) {
+    // fbids are not uniformly distributed in their low bits; mix before masking
+    fbid ^= fbid >> 33;
+    fbid *= 0xff51afd7ed558ccdULL;
+    fbid ^= fbid >> 33;
+    return (NSUInteger)fbid & (capacity - 1);
+}
+
+static void FBRecipientSetInit(FBRecipientSet *set, NSUInteger expectedCount) {
+    NSUInteger capacity = 16;
+    while (capacity < expectedCount * 2) {
+        capacity <<= 1;
+    }
+    set->slots = calloc(capacity, sizeof(uint64_t));
+    set->capacity = capacity;
+    set->count = 0;
+}
+
+static void FBRecipientSetFree(FBRecipientSet *set) {
+    free(set->slots);
+    set->slots = NULL;
+    set->capacity = 0;
+    set->count = 0;
+}
+
+static BOOL FBRecipientSetContains(const FBRecipientSet *set, uint64_t fbid) {
+    if (fbid == 0 || set->count == 0) {
+        return NO;
+    }
+    for (NSUInteger slot = FBRecipientSetSlot(fbid, set->capacity); ; slot = (slot + 1) & (set->capacity - 1)) {
+        if (set->slots[slot] == fbid) {
+            return YES;
+        } else if (set->slots[slot] == 0) {
+            return NO;
+        }
+    }
+}
+
+static void FBRecipientSetAdd(FBRecipientSet *set, uint64_t fbid) {
+    if (fbid == 0) {
+        return;
+    }
+
+    if ((set->count + 1) * 2 > set->capacity) {
+        FBRecipientSet grown;
+        FBRecipientSetInit(&grown, set->count + 1);
+        for (NSUInteger i = 0; i < set->capacity; i++) {
+            if (set->slots[i]) {
+                FBRecipientSetAdd(&grown, set->slots[i]);
+            }
+        }
+        FBRecipientSetFree(set);
+        *set = grown;
+    }
+
+    NSUInteger slot = FBRecipientSetSlot(fbid, set->capacity);
+    while (set->slots[slot] != 0) {
+        if (set->slots[slot] == fbid) {
+            return;
+        }
+        slot = (slot + 1) & (set->capacity - 1);
+    }
+    set->slots[slot] = fbid;
+    set->count++;
+}
+
+static BOOL FBRecipientSetIsEqual(const FBRecipientSet *set, const FBRecipientSet *other) {
+    if (set->count != other->count) {
+        return NO;
+    }
+    for (NSUInteger i = 0; i < set->capacity; i++) {
+        if (set->slots[i] && !FBRecipientSetContains(other, set->slots[i])) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+// Canonicalizes an fbid given as an NSNumber or a (possibly padded) decimal NSString;
+// returns 0 for anything that is not a valid fbid.
+static uint64_t FBRecipientIDFromObject(id fbid) {
+    if ([fbid isKindOfClass:[NSNumber class]]) {
+        return [(NSNumber *)fbid unsignedLongLongValue];
+    } else if ([fbid isKindOfClass:[NSString class]]) {
+        const char *chars = [(NSString *)fbid UTF8String];
+        while (*chars == ' ' || *chars == '\t') {
+            chars++;
+        }
+
+        uint64_t value = 0;
+        const char *digits = chars;
+        while (*chars >= '0' && *chars <= '9') {
+            uint64_t digit = (uint64_t)(*chars - '0');
+            if (value > (UINT64_MAX - digit) / 10) {
+                return 0;
+            }
+            value = value * 10 + digit;
+            chars++;
+        }
+        if (chars == digits) {
+            return 0;
+        }
+
+        while (*chars == ' ' || *chars == '\t') {
+            chars++;
+        }
+        return *chars ? 0 : value;
+    }
+    return 0;
+}
+
+static NSString *const FBRecipientPersistencePrefix = @"com.facebook.sdk.frictionlessRecipients.";
+
+// Persisted recipient lists are written, and removed, in order on one background queue.
+static dispatch_queue_t FBRecipientPersistenceQueue() {
+    static dispatch_queue_t queue;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        queue = dispatch_queue_create("com.facebook.sdk.FBFrictionlessRequestSettings", DISPATCH_QUEUE_SERIAL);
+    });
+    return queue;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 // private interface
 //
-@interface FBFrictionlessRequestSettings () <FBRequestDelegate>
+@interface FBFrictionlessRequestSettings () <FBRequestDelegate> {
+    // guarded by @synchronized (self), together with allowedRecipients and persistencePath;
+    // sets are replaced and freed under the lock, so lookups must hold it too
+    FBRecipientSet _recipients;
+}
 
 @property (readwrite, retain) NSArray *allowedRecipients;
 @property (readwrite, retain) FBRequest *activeRequest;
+@property (readwrite, copy) NSString *persistencePath;
+
+- (void)replaceRecipientsWithSet:(FBRecipientSet *)recipients;
+- (NSString *)unloadRecipientCacheAtPath;
 
 @end
 
@@ -40,7 +179,7 @@
 - (id)init {
     if (self = [super init]) {
         // start life with an empty frictionless cache
-        self.allowedRecipients = [[[NSArray alloc] init] autorelease];
+        FBRecipientSetInit(&_recipients, 0);
     }
     return self;
 }
@@ -54,6 +193,96 @@
     }
 }
 
++ (NSString *)persistencePathForAppID:(NSString *)appID userID:(NSString *)userID {
+    NSString *cachesDirectory = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) objectAtIndex:0];
+    return [cachesDirectory stringByAppendingPathComponent:
+            [NSString stringWithFormat:@"%@%@.%@", FBRecipientPersistencePrefix, appID, userID]];
+}
+
++ (void)removePersistedRecipientsForAppID:(NSString *)appID {
+    if (!appID) {
+        return;
+    }
+
+    NSString *cachesDirectory = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) objectAtIndex:0];
+    NSString *prefix = [NSString stringWithFormat:@"%@%@.", FBRecipientPersistencePrefix, appID];
+    dispatch_async(FBRecipientPersistenceQueue(), ^{
+        NSFileManager *fileManager = [[[NSFileManager alloc] init] autorelease];
+        for (NSString *fileName in [fileManager contentsOfDirectoryAtPath:cachesDirectory error:nil]) {
+            if ([fileName hasPrefix:prefix]) {
+                [fileManager removeItemAtPath:[cachesDirectory stringByAppendingPathComponent:fileName] error:nil];
+            }
+        }
+    });
+}
+
+- (void)persistRecipientCacheForAppID:(NSString *)appID userID:(NSString *)userID {
+    if (!appID || !userID) {
+        return;
+    }
+
+    NSString *path = [FBFrictionlessRequestSettings persistencePathForAppID:appID userID:userID];
+
+    // stored as the raw little-endian fbids, so loading is a single read
+    @synchronized (self) {
+        if ([path isEqualToString:self.persistencePath]) {
+            return;
+        }
+    }
+    NSData *data = [NSData dataWithContentsOfFile:path];
+
+    NSUInteger count = data.length / sizeof(uint64_t);
+    const uint64_t *fbids = (const uint64_t *)data.bytes;
+    FBRecipientSet recipients;
+    FBRecipientSetInit(&recipients, count);
+    for (NSUInteger i = 0; i < count; i++) {
+        FBRecipientSetAdd(&recipients, CFSwapInt64LittleToHost(fbids[i]));
+    }
+
+    @synchronized (self) {
+        // anything learned before the user was known came from this user's session, and is
+        // at least as fresh as what was persisted; a previous user's recipients are dropped
+        if (!self.persistencePath) {
+            for (NSUInteger i = 0; i < _recipients.capacity; i++) {
+                FBRecipientSetAdd(&recipients, _recipients.slots[i]);
+            }
+        }
+        FBRecipientSetFree(&_recipients);
+        _recipients = recipients;
+        self.allowedRecipients = nil;
+        self.persistencePath = path;
+    }
+}
+
+- (void)clearRecipientCache {
+    NSString *path = [self unloadRecipientCacheAtPath];
+    if (path) {
+        dispatch_async(FBRecipientPersistenceQueue(), ^{
+            [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+        });
+    }
+}
+
+- (void)unloadRecipientCache {
+    [self unloadRecipientCacheAtPath];
+}
+
+// Returns the path the recipients were being persisted to, if any.
+- (NSString *)unloadRecipientCacheAtPath {
+    // also terminates any active request for the recipients
+    self.activeRequest = nil;
+
+    NSString *path = nil;
+    @synchronized (self) {
+        path = [[self.persistencePath retain] autorelease];
+        self.persistencePath = nil;
+        FBRecipientSetFree(&_recipients);
+        FBRecipientSetInit(&_recipients, 0);
+        self.allowedRecipients = nil;
+    }
+    return path;
+}
+
 - (void)reloadRecipientCacheWithFacebook:(Facebook *)facebook {
     // request the list of frictionless recipients from the server
     id request = [facebook requestWithGraphPath:@"me/apprequestformerrecipients"
@@ -64,45 +293,47 @@
 }
 
 - (NSArray *)recipientIDs {
-    return self.allowedRecipients;
+    @synchronized (self) {
+        if (!self.allowedRecipients) {
+            NSMutableArray *recipients = [NSMutableArray arrayWithCapacity:_recipients.count];
+            for (NSUInteger i = 0; i < _recipients.capacity; i++) {
+                if (_recipients.slots[i]) {
+                    [recipients addObject:[NSString stringWithFormat:@"%llu", _recipients.slots[i]]];
+                }
+            }
+            self.allowedRecipients = recipients;
+        }
+        return [[self.allowedRecipients retain] autorelease];
+    }
 }
 
 - (void)updateRecipientCacheWithRecipients:(NSArray*)ids {
     // if setting recipients directly, no need to complete pending request
     self.activeRequest = nil;
 
-    if (ids == nil) {
-        self.allowedRecipients = [[[NSArray alloc] init] autorelease];
-    } else {
-        self.allowedRecipients = [[[NSArray alloc] initWithArray:ids] autorelease];
+    FBRecipientSet recipients;
+    FBRecipientSetInit(&recipients, ids.count);
+    for (id fbid in ids) {
+        FBRecipientSetAdd(&recipients, FBRecipientIDFromObject(fbid));
     }
+    [self replaceRecipientsWithSet:&recipients];
 }
 
-- (BOOL)isFrictionlessEnabledForRecipient:(NSString *)fbid {
-    // trim whitespace from edges
-    fbid = [fbid stringByTrimmingCharactersInSet:
-                             [NSCharacterSet whitespaceCharacterSet]];
-
-    // linear search through cache for a match
-    for (NSString *entry in self.allowedRecipients) {
-        if ([entry isEqualToString:fbid]) {
-            return YES;
-        }
+- (BOOL)isFrictionlessEnabledForRecipient:(id)fbid {
+    uint64_t recipient = FBRecipientIDFromObject(fbid);
+    @synchronized (self) {
+        return FBRecipientSetContains(&_recipients, recipient);
     }
-    return NO;
 }
 
 - (BOOL)isFrictionlessEnabledForRecipients:(NSArray*)fbids {
-    // we handle arrays of NSString and NSNumber, and throw on anything else
+    // we handle arrays of NSString and NSNumber, and throw on anything else; ids are
+    // canonicalized before taking the lock so that it is held only for the lookups
+    NSMutableData *recipients = [NSMutableData dataWithLength:fbids.count * sizeof(uint64_t)];
+    uint64_t *ids = (uint64_t *)recipients.mutableBytes;
+    NSUInteger count = 0;
     for (id fbid in fbids) {
-        NSString* fbidstr;
-        // give us a number, and we convert it to a string
-        if ([fbid isKindOfClass:[NSNumber class]]) {
-            fbidstr = [(NSNumber*)fbid stringValue];
-        } else if ([fbid isKindOfClass:[NSString class]]) {
-            // or give us a string, and we just use it as is
-            fbidstr = (NSString*)fbid;
-        } else {
+        if (![fbid isKindOfClass:[NSNumber class]] && ![fbid isKindOfClass:[NSString class]]) {
             // unexpected type found in the array of fbids
             @throw [NSException exceptionWithName:NSInvalidArgumentException
                                            reason:@"items in fbids must be NSString or NSNumber"
@@ -110,10 +341,15 @@
                                                    [fbid class], @"invalid class",
                                                    nil]];
         }
+        ids[count++] = FBRecipientIDFromObject(fbid);
+    }
 
-        // if we miss our cache once, we fail the set
-        if (![self isFrictionlessEnabledForRecipient:fbidstr]) {
-            return NO;
+    @synchronized (self) {
+        for (NSUInteger i = 0; i < count; i++) {
+            // if we miss our cache once, we fail the set
+            if (!FBRecipientSetContains(&_recipients, ids[i])) {
+                return NO;
+            }
         }
     }
     return YES;
@@ -123,16 +359,13 @@
     // a little request bookkeeping
     self.activeRequest = nil;
 
-    NSUInteger items = [[result objectForKey: @"data"] count];
-    NSMutableArray* recipients = [[[NSMutableArray alloc] initWithCapacity: items] autorelease];
-
-    for (NSUInteger i = 0; i < items; i++) {
-        [recipients addObject: [[[result objectForKey: @"data"]
-                                 objectAtIndex: i]
-                                objectForKey: @"recipient_id"]] ;
+    NSArray *data = [result objectForKey:@"data"];
+    FBRecipientSet recipients;
+    FBRecipientSetInit(&recipients, data.count);
+    for (id item in data) {
+        FBRecipientSetAdd(&recipients, FBRecipientIDFromObject([item objectForKey:@"recipient_id"]));
     }
-
-    self.allowedRecipients = recipients;
+    [self replaceRecipientsWithSet:&recipients];
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -158,6 +391,8 @@
 - (void)dealloc {
     self.activeRequest = nil;
     self.allowedRecipients = nil;
+    self.persistencePath = nil;
+    FBRecipientSetFree(&_recipients);
     [super dealloc];
 }
 
@@ -167,5 +402,39 @@
 
 @synthesize allowedRecipients = _allowedRecipients;
 @synthesize activeRequest = _activeRequest;
+@synthesize persistencePath = _persistencePath;
+
+// takes ownership of recipients; only touches the disk if the set actually changed
+- (void)replaceRecipientsWithSet:(FBRecipientSet *)recipients {
+    NSString *path = nil;
+    NSMutableData *data = nil;
+    @synchronized (self) {
+        if (FBRecipientSetIsEqual(&_recipients, recipients)) {
+            FBRecipientSetFree(recipients);
+            return;
+        }
+
+        FBRecipientSetFree(&_recipients);
+        _recipients = *recipients;
+        self.allowedRecipients = nil;
+
+        path = [[self.persistencePath retain] autorelease];
+        if (path) {
+            data = [NSMutableData dataWithCapacity:_recipients.count * sizeof(uint64_t)];
+            for (NSUInteger i = 0; i < _recipients.capacity; i++) {
+                if (_recipients.slots[i]) {
+                    uint64_t fbid = CFSwapInt64HostToLittle(_recipients.slots[i]);
+                    [data appendBytes:&fbid length:sizeof(fbid)];
+                }
+            }
+        }
+    }
+
+    if (path) {
+        dispatch_async(FBRecipientPersistenceQueue(), ^{
+            [data writeToFile:path atomically:YES];
+        });
+    }
+}
 
 @end
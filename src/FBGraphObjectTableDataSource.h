@@ -35,6 +35,9 @@
 @property (nonatomic, assign) id<FBGraphObjectSelectionQueryDelegate> selectionDelegate;
 @property (nonatomic, assign) id<FBGraphObjectDataSourceDataNeededDelegate> dataNeededDelegate;
 @property (nonatomic, copy) NSArray *sortDescriptors;
+// When set (the default), pictures for rows about to scroll into view are
+// fetched ahead of time; see prefetchPicturesForTableView:.
+@property (nonatomic) BOOL picturePrefetchEnabled;
 
 - (NSString *)fieldsForRequestIncluding:(NSSet *)customFields, ...;
 
@@ -52,6 +55,13 @@
 
 - (void)cancelPendingRequests;
 
+// Call this as the table scrolls (the table delegate's scrollViewDidScroll:).
+// Queues picture fetches for a window of upcoming rows, sized by how fast the
+// table is scrolling and ordered nearest first, and cancels fetches for rows
+// that have scrolled far out of view.  Calls that find the same rows visible
+// as the last one return right away.
+- (void)prefetchPicturesForTableView:(UITableView *)tableView;
+
 // Call this when updating any property or if
 // delegate.filterIncludesItem would return a different answer now.
 - (void)update;
@@ -24,6 +24,18 @@
 // Magic number - iPhone address book doesn't show scrubber for less than 5 contacts
 static const NSInteger kMinimumCountToCollate = 6;
 
+// Picture prefetching: rows ahead of the visible ones are prefetched, more of
+// them the faster the table scrolls, a few at a time.  Prefetches for rows
+// further than kPrefetchCancelDistance from the visible ones are cancelled.
+// The work is only redone when the visible rows change, and at most
+// kMaxPrefetchedURLs fetched URLs are remembered to skip refetching.
+static const NSInteger kPrefetchMinimumWindow = 8;
+static const NSInteger kPrefetchMaximumWindow = 40;
+static const NSTimeInterval kPrefetchLookahead = 0.5;
+static const NSInteger kPrefetchCancelDistance = 60;
+static const NSUInteger kMaxConcurrentPrefetches = 4;
+static const NSUInteger kMaxPrefetchedURLs = 256;
+
 @interface FBGraphObjectTableDataSource ()
 
 @property (nonatomic, retain) NSArray *data;
@@ -33,6 +45,13 @@ static const NSInteger kMinimumCountToCollate = 6;
 @property (nonatomic, assign) BOOL expectingMoreGraphObjects;
 @property (nonatomic, retain) UILocalizedIndexedCollation *collation;
 @property (nonatomic, assign) BOOL showSections;
+@property (nonatomic, retain) NSMutableArray *queuedPrefetchURLs;
+@property (nonatomic, retain) NSMutableDictionary *prefetchConnections;
+@property (nonatomic, retain) NSMutableSet *prefetchedURLs;
+@property (nonatomic, assign) CGFloat lastPrefetchOffset;
+@property (nonatomic, assign) CFAbsoluteTime lastPrefetchTime;
+@property (nonatomic, retain) NSIndexPath *lastPrefetchFirstVisible;
+@property (nonatomic, retain) NSIndexPath *lastPrefetchLastVisible;
 
 - (BOOL)filterIncludesItem:(FBGraphObject *)item;
 - (FBGraphObjectTableCell *)cellWithTableView:(UITableView *)tableView;
@@ -41,6 +60,15 @@ static const NSInteger kMinimumCountToCollate = 6;
 - (void)addOrRemovePendingConnection:(FBURLConnection *)connection;
 - (BOOL)isActivityIndicatorIndexPath:(NSIndexPath *)indexPath;
 - (BOOL)isLastSection:(NSInteger)section;
+- (NSIndexPath *)tableView:(UITableView *)tableView
+     indexPathAdjacentTo:(NSIndexPath *)indexPath
+                 forward:(BOOL)forward;
+- (NSArray *)tableView:(UITableView *)tableView
+  pictureURLsFromIndexPath:(NSIndexPath *)indexPath
+               forward:(BOOL)forward
+                 count:(NSInteger)count;
+- (void)startQueuedPrefetches;
+- (void)cancelPrefetches;
 
 @end
 
@@ -63,6 +91,14 @@ static const NSInteger kMinimumCountToCollate = 6;
 @synthesize dataNeededDelegate = _dataNeededDelegate;
 @synthesize expectingMoreGraphObjects = _expectingMoreGraphObjects;
 @synthesize collation = _collation;
+@synthesize picturePrefetchEnabled = _picturePrefetchEnabled;
+@synthesize queuedPrefetchURLs = _queuedPrefetchURLs;
+@synthesize prefetchConnections = _prefetchConnections;
+@synthesize prefetchedURLs = _prefetchedURLs;
+@synthesize lastPrefetchOffset = _lastPrefetchOffset;
+@synthesize lastPrefetchTime = _lastPrefetchTime;
+@synthesize lastPrefetchFirstVisible = _lastPrefetchFirstVisible;
+@synthesize lastPrefetchLastVisible = _lastPrefetchLastVisible;
 
 - (void)setUseCollation:(BOOL)useCollation
 {
@@ -81,6 +117,11 @@ static const NSInteger kMinimumCountToCollate = 6;
         self.pendingURLConnections = pendingURLConnections;
         [pendingURLConnections release];
         self.expectingMoreGraphObjects = YES;
+
+        self.picturePrefetchEnabled = YES;
+        self.queuedPrefetchURLs = [NSMutableArray array];
+        self.prefetchConnections = [NSMutableDictionary dictionary];
+        self.prefetchedURLs = [NSMutableSet set];
     }
 
     return self;
@@ -91,6 +132,9 @@ static const NSInteger kMinimumCountToCollate = 6;
     FBConditionalLog(![_pendingURLConnections count],
                      @"FBGraphObjectTableDataSource pending connection did not retain self");
 
+    // Prefetch handlers don't retain self, so none may outlive it
+    [self cancelPrefetches];
+
     [_collation release];
     [_data release];
     [_defaultPicture release];
@@ -99,6 +143,11 @@ static const NSInteger kMinimumCountToCollate = 6;
     [_indexMap release];
     [_pendingURLConnections release];
     [_sortDescriptors release];
+    [_queuedPrefetchURLs release];
+    [_prefetchConnections release];
+    [_prefetchedURLs release];
+    [_lastPrefetchFirstVisible release];
+    [_lastPrefetchLastVisible release];
 
     [super dealloc];
 }
@@ -152,6 +201,9 @@ static const NSInteger kMinimumCountToCollate = 6;
 - (void)clearGraphObjects {
     self.indexKeys = nil;
     self.indexMap = nil;
+    self.lastPrefetchFirstVisible = nil;
+    self.lastPrefetchLastVisible = nil;
+    [self.prefetchedURLs removeAllObjects];
     [self prepareForNewRequest];
 }
 
@@ -183,6 +235,97 @@ static const NSInteger kMinimumCountToCollate = 6;
     for (FBURLConnection *connection in _pendingURLConnections) {
         [connection cancel];
     }
+
+    [self cancelPrefetches];
+}
+
+- (void)cancelPrefetches
+{
+    [_queuedPrefetchURLs removeAllObjects];
+    // Cancelling calls back into the handler, which mutates the dictionary
+    for (FBURLConnection *connection in [_prefetchConnections allValues]) {
+        [connection cancel];
+    }
+}
+
+- (void)prefetchPicturesForTableView:(UITableView *)tableView
+{
+    if (!self.picturePrefetchEnabled ||
+        !self.itemPicturesEnabled ||
+        ![self.controllerDelegate respondsToSelector:
+          @selector(graphObjectTableDataSource:pictureUrlOfItem:)]) {
+        return;
+    }
+
+    NSArray *visibleIndexPaths = [tableView indexPathsForVisibleRows];
+    if (visibleIndexPaths.count == 0) {
+        return;
+    }
+
+    // Scroll events arrive every frame; nothing changes until a row scrolls
+    // in or out of view
+    NSIndexPath *firstVisible = [visibleIndexPaths objectAtIndex:0];
+    NSIndexPath *lastVisible = [visibleIndexPaths lastObject];
+    if ([firstVisible isEqual:self.lastPrefetchFirstVisible] &&
+        [lastVisible isEqual:self.lastPrefetchLastVisible]) {
+        return;
+    }
+    self.lastPrefetchFirstVisible = firstVisible;
+    self.lastPrefetchLastVisible = lastVisible;
+
+    // Estimate the scroll velocity, in rows per second, since the visible
+    // rows last changed
+    CGFloat offset = tableView.contentOffset.y;
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    CFTimeInterval elapsed = now - self.lastPrefetchTime;
+    CGFloat rowsPerSecond = 0;
+    if (self.lastPrefetchTime > 0 && elapsed > 0 && tableView.rowHeight > 0) {
+        rowsPerSecond = (offset - self.lastPrefetchOffset) / tableView.rowHeight / elapsed;
+    }
+    self.lastPrefetchOffset = offset;
+    self.lastPrefetchTime = now;
+
+    BOOL forward = rowsPerSecond >= 0;
+    NSInteger window = kPrefetchMinimumWindow + (NSInteger)(fabs(rowsPerSecond) * kPrefetchLookahead);
+    window = MIN(window, kPrefetchMaximumWindow);
+
+    // Upcoming rows, nearest first, replace whatever was queued before
+    NSArray *upcomingURLs = [self tableView:tableView
+                   pictureURLsFromIndexPath:(forward ? lastVisible : firstVisible)
+                                    forward:forward
+                                      count:window];
+    [self.queuedPrefetchURLs removeAllObjects];
+    for (NSString *url in upcomingURLs) {
+        if (![self.prefetchedURLs containsObject:url] &&
+            [self.prefetchConnections objectForKey:url] == nil) {
+            [self.queuedPrefetchURLs addObject:url];
+        }
+    }
+
+    // Cancel in-flight prefetches for rows that are now far away
+    if (self.prefetchConnections.count > 0) {
+        NSMutableSet *nearbyURLs = [NSMutableSet set];
+        [nearbyURLs addObjectsFromArray:
+         [self tableView:tableView pictureURLsFromIndexPath:lastVisible forward:YES count:kPrefetchCancelDistance]];
+        [nearbyURLs addObjectsFromArray:
+         [self tableView:tableView pictureURLsFromIndexPath:firstVisible forward:NO count:kPrefetchCancelDistance]];
+        for (NSIndexPath *indexPath in visibleIndexPaths) {
+            FBGraphObject *item = [self itemAtIndexPath:indexPath];
+            NSString *url = item ? [self.controllerDelegate graphObjectTableDataSource:self
+                                                                      pictureUrlOfItem:item] : nil;
+            if (url) {
+                [nearbyURLs addObject:url];
+            }
+        }
+
+        for (NSString *url in [self.prefetchConnections allKeys]) {
+            if (![nearbyURLs containsObject:url]) {
+                [[self.prefetchConnections objectForKey:url] cancel];
+            }
+        }
+    }
+
+    [self startQueuedPrefetches];
 }
 
 // Called after changing any properties.  To simplify the code here,
@@ -437,6 +580,88 @@ static const NSInteger kMinimumCountToCollate = 6;
     return self.defaultPicture;
 }
 
+- (NSIndexPath *)tableView:(UITableView *)tableView
+     indexPathAdjacentTo:(NSIndexPath *)indexPath
+                 forward:(BOOL)forward
+{
+    NSInteger section = indexPath.section;
+    NSInteger row = indexPath.row + (forward ? 1 : -1);
+
+    // Step over section boundaries, skipping empty sections
+    while (row < 0 || row >= [tableView numberOfRowsInSection:section]) {
+        section += forward ? 1 : -1;
+        if (section < 0 || section >= [tableView numberOfSections]) {
+            return nil;
+        }
+        row = forward ? 0 : [tableView numberOfRowsInSection:section] - 1;
+    }
+
+    return [NSIndexPath indexPathForRow:row inSection:section];
+}
+
+- (NSArray *)tableView:(UITableView *)tableView
+  pictureURLsFromIndexPath:(NSIndexPath *)indexPath
+               forward:(BOOL)forward
+                 count:(NSInteger)count
+{
+    NSMutableArray *urls = [NSMutableArray arrayWithCapacity:count];
+    for (NSInteger i = 0; i < count; i++) {
+        indexPath = [self tableView:tableView indexPathAdjacentTo:indexPath forward:forward];
+        if (!indexPath) {
+            break;
+        }
+
+        FBGraphObject *item = [self itemAtIndexPath:indexPath];
+        NSString *url = item ? [self.controllerDelegate graphObjectTableDataSource:self
+                                                                  pictureUrlOfItem:item] : nil;
+        if (url) {
+            [urls addObject:url];
+        }
+    }
+    return urls;
+}
+
+- (void)startQueuedPrefetches
+{
+    while (self.prefetchConnections.count < kMaxConcurrentPrefetches &&
+           self.queuedPrefetchURLs.count > 0) {
+        NSString *url = [[[self.queuedPrefetchURLs objectAtIndex:0] retain] autorelease];
+        [self.queuedPrefetchURLs removeObjectAtIndex:0];
+
+        // The connection stores the picture in FBDataDiskCache, from where
+        // imageForItem: picks it up once the row is shown.  A cached picture
+        // completes synchronously inside init.  The handler doesn't retain
+        // self; dealloc cancels whatever is still in flight.
+        __block BOOL completed = NO;
+        __block FBGraphObjectTableDataSource *weakSelf = self;
+        FBURLConnectionHandler handler =
+        ^(FBURLConnection *connection, NSError *error, NSURLResponse *response, NSData *data) {
+            completed = YES;
+            if (!error) {
+                if (weakSelf.prefetchedURLs.count >= kMaxPrefetchedURLs) {
+                    [weakSelf.prefetchedURLs removeAllObjects];
+                }
+                [weakSelf.prefetchedURLs addObject:url];
+            }
+            if ([weakSelf.prefetchConnections objectForKey:url] == connection) {
+                [weakSelf.prefetchConnections removeObjectForKey:url];
+                [weakSelf startQueuedPrefetches];
+            }
+        };
+
+        FBURLConnection *connection = [[FBURLConnection alloc]
+                                       initWithRequest:[NSURLRequest requestWithURL:[NSURL URLWithString:url]]
+                                       skipRoundTripIfCached:YES
+                                       priority:FBURLConnectionPriorityPrefetch
+                                       callbackQueue:nil
+                                       completionHandler:handler];
+        if (!completed) {
+            [self.prefetchConnections setObject:connection forKey:url];
+        }
+        [connection release];
+    }
+}
+
 // In tableView:imageForItem:, there are two code-paths, and both always run.
 // Whichever runs first adds the connection to the collection of pending requests,
 // and whichever runs second removes it.  This allows us to track all requests
@@ -205,6 +205,15 @@
     }
 }
 
+#pragma mark - UIScrollViewDelegate
+
+- (void)scrollViewDidScroll:(UIScrollView *)scrollView
+{
+    if ([scrollView isKindOfClass:[UITableView class]]) {
+        [self.dataSource prefetchPicturesForTableView:(UITableView *)scrollView];
+    }
+}
+
 #pragma mark Debugging helpers
 
 - (NSString*)description {
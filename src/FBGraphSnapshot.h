@@ -0,0 +1,53 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+// FBGraphSnapshot
+//
+// Summary:
+// A binary form of a parsed Graph response that can be read straight out of a memory-mapped
+// file. Objects and arrays are offset-indexed tables, and every string (keys and values
+// alike) is stored once in a string table. Nothing is decoded up front: rootObject returns
+// containers that decode an entry the first time it is read, so a list of thousands of
+// friends costs nothing until rows are read, and then only the rows read.
+// JSON is produced only when asked for.
+//
+// Snapshots and their containers are immutable, and may be read from any thread; an entry
+// decoded by two threads at once is published once, and the other decode is dropped.
+@interface FBGraphSnapshot : NSObject
+
+// Returns nil if `object` holds anything other than JSON types.
++ (NSData *)dataWithJSONObject:(id)object;
+
++ (BOOL)isSnapshotData:(NSData *)data;
+
+// Returns nil if `data` is not a well-formed snapshot. The data is retained, not copied.
+- (id)initWithData:(NSData *)data;
+
+// An FBGraphSnapshotDictionary or FBGraphSnapshotArray, or a scalar. Each call returns a new
+// container, which keeps the snapshot alive; hold on to it rather than asking again.
+@property (nonatomic, readonly) id rootObject;
+
+- (NSString *)JSONString;
+
+@end
+
+@interface FBGraphSnapshotDictionary : NSDictionary
+@end
+
+@interface FBGraphSnapshotArray : NSArray
+@end
@@ -0,0 +1,532 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "FBGraphSnapshot.h"
+
+#import <stdlib.h>
+#import <string.h>
+
+// Layout, in host byte order (snapshots never leave the device):
+//
+//   FBGraphSnapshotHeader
+//   FBGraphSnapshotRange  objects[objectCount]    -> ranges of pairs
+//   FBGraphSnapshotPair   pairs[pairCount]
+//   FBGraphSnapshotRange  arrays[arrayCount]      -> ranges of elements
+//   FBGraphSnapshotValue  elements[elementCount]
+//   FBGraphSnapshotRange  strings[stringCount]    -> ranges of the blob
+//   char                  blob[blobLength]        UTF-8, not terminated
+
+static const uint32_t FBGraphSnapshotMagic = 0x53474246; // "FBGS"
+static const uint32_t FBGraphSnapshotVersion = 1;
+
+typedef enum {
+    FBGraphSnapshotKindNull = 0,
+    FBGraphSnapshotKindTrue,
+    FBGraphSnapshotKindFalse,
+    FBGraphSnapshotKindNumber,  // payload is the string index of its decimal form
+    FBGraphSnapshotKindString,
+    FBGraphSnapshotKindObject,
+    FBGraphSnapshotKindArray,
+} FBGraphSnapshotKind;
+
+typedef struct {
+    uint32_t kind;
+    uint32_t payload;
+} FBGraphSnapshotValue;
+
+typedef struct {
+    uint32_t key;
+    FBGraphSnapshotValue value;
+} FBGraphSnapshotPair;
+
+typedef struct {
+    uint32_t location;
+    uint32_t length;
+} FBGraphSnapshotRange;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    FBGraphSnapshotValue root;
+    uint32_t objectCount;
+    uint32_t pairCount;
+    uint32_t arrayCount;
+    uint32_t elementCount;
+    uint32_t stringCount;
+    uint32_t blobLength;
+} FBGraphSnapshotHeader;
+
+#pragma mark - Encoding
+
+@interface FBGraphSnapshotEncoder : NSObject {
+@public
+    NSMutableData *_objects;
+    NSMutableData *_pairs;
+    NSMutableData *_arrays;
+    NSMutableData *_elements;
+    NSMutableData *_strings;
+    NSMutableData *_blob;
+    NSMutableDictionary *_stringIndexes;
+}
+
+- (uint32_t)indexOfString:(NSString *)string;
+- (BOOL)encodeObject:(id)object value:(FBGraphSnapshotValue *)value;
+
+@end
+
+@implementation FBGraphSnapshotEncoder
+
+- (id)init {
+    self = [super init];
+    if (self) {
+        _objects = [[NSMutableData alloc] init];
+        _pairs = [[NSMutableData alloc] init];
+        _arrays = [[NSMutableData alloc] init];
+        _elements = [[NSMutableData alloc] init];
+        _strings = [[NSMutableData alloc] init];
+        _blob = [[NSMutableData alloc] init];
+        _stringIndexes = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [_objects release];
+    [_pairs release];
+    [_arrays release];
+    [_elements release];
+    [_strings release];
+    [_blob release];
+    [_stringIndexes release];
+    [super dealloc];
+}
+
+- (uint32_t)indexOfString:(NSString *)string {
+    NSNumber *index = [_stringIndexes objectForKey:string];
+    if (index) {
+        return (uint32_t)index.unsignedIntValue;
+    }
+
+    NSData *utf8 = [string dataUsingEncoding:NSUTF8StringEncoding];
+    FBGraphSnapshotRange range = { (uint32_t)_blob.length, (uint32_t)utf8.length };
+    [_blob appendData:utf8];
+
+    uint32_t newIndex = (uint32_t)(_strings.length / sizeof(range));
+    [_strings appendBytes:&range length:sizeof(range)];
+    [_stringIndexes setObject:[NSNumber numberWithUnsignedInt:newIndex] forKey:string];
+    return newIndex;
+}
+
+- (BOOL)encodeObject:(id)object value:(FBGraphSnapshotValue *)value {
+    if (object == nil || object == [NSNull null]) {
+        value->kind = FBGraphSnapshotKindNull;
+        value->payload = 0;
+    } else if ([object isKindOfClass:[NSString class]]) {
+        value->kind = FBGraphSnapshotKindString;
+        value->payload = [self indexOfString:object];
+    } else if ([object isKindOfClass:[NSNumber class]]) {
+        // JSON booleans are the only numbers of type char
+        if (strcmp([object objCType], @encode(char)) == 0) {
+            value->kind = [object boolValue] ? FBGraphSnapshotKindTrue : FBGraphSnapshotKindFalse;
+            value->payload = 0;
+        } else {
+            value->kind = FBGraphSnapshotKindNumber;
+            value->payload = [self indexOfString:[object stringValue]];
+        }
+    } else if ([object isKindOfClass:[NSDictionary class]]) {
+        // Children first, since nested containers append to the same tables
+        NSMutableData *pairs = [NSMutableData dataWithCapacity:[object count] * sizeof(FBGraphSnapshotPair)];
+        for (id key in object) {
+            if (![key isKindOfClass:[NSString class]]) {
+                return NO;
+            }
+            FBGraphSnapshotPair pair;
+            pair.key = [self indexOfString:key];
+            if (![self encodeObject:[object objectForKey:key] value:&pair.value]) {
+                return NO;
+            }
+            [pairs appendBytes:&pair length:sizeof(pair)];
+        }
+
+        FBGraphSnapshotRange range = { (uint32_t)(_pairs.length / sizeof(FBGraphSnapshotPair)),
+                                       (uint32_t)[object count] };
+        [_pairs appendData:pairs];
+        value->kind = FBGraphSnapshotKindObject;
+        value->payload = (uint32_t)(_objects.length / sizeof(range));
+        [_objects appendBytes:&range length:sizeof(range)];
+    } else if ([object isKindOfClass:[NSArray class]]) {
+        NSMutableData *elements = [NSMutableData dataWithCapacity:[object count] * sizeof(FBGraphSnapshotValue)];
+        for (id element in object) {
+            FBGraphSnapshotValue elementValue;
+            if (![self encodeObject:element value:&elementValue]) {
+                return NO;
+            }
+            [elements appendBytes:&elementValue length:sizeof(elementValue)];
+        }
+
+        FBGraphSnapshotRange range = { (uint32_t)(_elements.length / sizeof(FBGraphSnapshotValue)),
+                                       (uint32_t)[object count] };
+        [_elements appendData:elements];
+        value->kind = FBGraphSnapshotKindArray;
+        value->payload = (uint32_t)(_arrays.length / sizeof(range));
+        [_arrays appendBytes:&range length:sizeof(range)];
+    } else {
+        return NO;
+    }
+    return YES;
+}
+
+@end
+
+#pragma mark - Decoding
+
+// Stores `object` in `*slot` unless another thread got there first, and returns whichever
+// object the slot ends up holding. The slot owns a reference to it. The GCC builtin is a full
+// barrier and, unlike libkern, is also available to the GNUstep benchmark build.
+static id FBGraphSnapshotPublish(id *slot, id object) {
+    [object retain];
+    if (!__sync_bool_compare_and_swap((void * volatile *)slot, (void *)nil, (void *)object)) {
+        [object release];
+    }
+    return *slot;
+}
+
+@interface FBGraphSnapshot () {
+    NSData *_data;
+    const FBGraphSnapshotHeader *_header;
+    const FBGraphSnapshotRange *_objects;
+    const FBGraphSnapshotPair *_pairs;
+    const FBGraphSnapshotRange *_arrays;
+    const FBGraphSnapshotValue *_elements;
+    const FBGraphSnapshotRange *_strings;
+    const char *_blob;
+
+    // Strings are decoded once and shared by every container of the snapshot
+    id *_decodedStrings;
+}
+
+- (NSString *)stringAtIndex:(uint32_t)index;
+- (id)objectForValue:(FBGraphSnapshotValue)value;
+- (const FBGraphSnapshotPair *)pairsOfObject:(uint32_t)object count:(uint32_t *)count;
+- (NSUInteger)countOfArray:(uint32_t)array;
+- (id)elementAtIndex:(NSUInteger)index ofArray:(uint32_t)array;
+
+@end
+
+@interface FBGraphSnapshotDictionary () {
+    FBGraphSnapshot *_snapshot;
+    const FBGraphSnapshotPair *_pairs;
+    uint32_t _count;
+    id *_values;
+}
+
+- (id)initWithSnapshot:(FBGraphSnapshot *)snapshot index:(uint32_t)index;
+
+@end
+
+@interface FBGraphSnapshotArray () {
+    FBGraphSnapshot *_snapshot;
+    uint32_t _index;
+    NSUInteger _count;
+    id *_elements;
+}
+
+- (id)initWithSnapshot:(FBGraphSnapshot *)snapshot index:(uint32_t)index;
+
+@end
+
+@implementation FBGraphSnapshot
+
++ (NSData *)dataWithJSONObject:(id)object {
+    FBGraphSnapshotEncoder *encoder = [[[FBGraphSnapshotEncoder alloc] init] autorelease];
+
+    FBGraphSnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    if (![encoder encodeObject:object value:&header.root]) {
+        return nil;
+    }
+
+    header.magic = FBGraphSnapshotMagic;
+    header.version = FBGraphSnapshotVersion;
+    header.objectCount = (uint32_t)(encoder->_objects.length / sizeof(FBGraphSnapshotRange));
+    header.pairCount = (uint32_t)(encoder->_pairs.length / sizeof(FBGraphSnapshotPair));
+    header.arrayCount = (uint32_t)(encoder->_arrays.length / sizeof(FBGraphSnapshotRange));
+    header.elementCount = (uint32_t)(encoder->_elements.length / sizeof(FBGraphSnapshotValue));
+    header.stringCount = (uint32_t)(encoder->_strings.length / sizeof(FBGraphSnapshotRange));
+    header.blobLength = (uint32_t)encoder->_blob.length;
+
+    NSMutableData *data = [NSMutableData dataWithCapacity:sizeof(header) +
+                           encoder->_objects.length + encoder->_pairs.length +
+                           encoder->_arrays.length + encoder->_elements.length +
+                           encoder->_strings.length + encoder->_blob.length];
+    [data appendBytes:&header length:sizeof(header)];
+    [data appendData:encoder->_objects];
+    [data appendData:encoder->_pairs];
+    [data appendData:encoder->_arrays];
+    [data appendData:encoder->_elements];
+    [data appendData:encoder->_strings];
+    [data appendData:encoder->_blob];
+    return data;
+}
+
++ (BOOL)isSnapshotData:(NSData *)data {
+    if (data.length < sizeof(FBGraphSnapshotHeader)) {
+        return NO;
+    }
+    const FBGraphSnapshotHeader *header = data.bytes;
+    return header->magic == FBGraphSnapshotMagic;
+}
+
+- (id)initWithData:(NSData *)data {
+    self = [super init];
+    if (self) {
+        if (![FBGraphSnapshot isSnapshotData:data]) {
+            [self release];
+            return nil;
+        }
+
+        const FBGraphSnapshotHeader *header = data.bytes;
+        uint64_t length = sizeof(*header) +
+            (uint64_t)header->objectCount * sizeof(FBGraphSnapshotRange) +
+            (uint64_t)header->pairCount * sizeof(FBGraphSnapshotPair) +
+            (uint64_t)header->arrayCount * sizeof(FBGraphSnapshotRange) +
+            (uint64_t)header->elementCount * sizeof(FBGraphSnapshotValue) +
+            (uint64_t)header->stringCount * sizeof(FBGraphSnapshotRange) +
+            header->blobLength;
+        if (header->version != FBGraphSnapshotVersion || length != data.length) {
+            [self release];
+            return nil;
+        }
+
+        _data = [data retain];
+        _header = header;
+        _objects = (const FBGraphSnapshotRange *)(header + 1);
+        _pairs = (const FBGraphSnapshotPair *)(_objects + header->objectCount);
+        _arrays = (const FBGraphSnapshotRange *)(_pairs + header->pairCount);
+        _elements = (const FBGraphSnapshotValue *)(_arrays + header->arrayCount);
+        _strings = (const FBGraphSnapshotRange *)(_elements + header->elementCount);
+        _blob = (const char *)(_strings + header->stringCount);
+        _decodedStrings = calloc(header->stringCount ?: 1, sizeof(id));
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_decodedStrings) {
+        for (uint32_t i = 0; i < _header->stringCount; i++) {
+            [_decodedStrings[i] release];
+        }
+        free(_decodedStrings);
+    }
+    [_data release];
+    [super dealloc];
+}
+
+// Not cached: containers retain the snapshot, so holding the root here would keep both alive forever.
+- (id)rootObject {
+    return [self objectForValue:_header->root];
+}
+
+- (NSString *)JSONString {
+    id root = self.rootObject;
+    if (![root isKindOfClass:[NSDictionary class]] && ![root isKindOfClass:[NSArray class]]) {
+        return nil;
+    }
+    NSData *json = [NSJSONSerialization dataWithJSONObject:root options:0 error:nil];
+    return json ? [[[NSString alloc] initWithData:json encoding:NSUTF8StringEncoding] autorelease] : nil;
+}
+
+#pragma mark - Tables
+
+// Indexes are checked on every read rather than all at once when opening, so that a
+// corrupt entry costs only the value it describes.
+- (NSString *)stringAtIndex:(uint32_t)index {
+    if (index >= _header->stringCount) {
+        return nil;
+    }
+
+    NSString *string = _decodedStrings[index];
+    if (!string) {
+        FBGraphSnapshotRange range = _strings[index];
+        if ((uint64_t)range.location + range.length > _header->blobLength) {
+            return nil;
+        }
+        string = [[[NSString alloc] initWithBytes:_blob + range.location
+                                           length:range.length
+                                         encoding:NSUTF8StringEncoding] autorelease];
+        string = FBGraphSnapshotPublish(&_decodedStrings[index], string);
+    }
+    return string;
+}
+
+- (id)objectForValue:(FBGraphSnapshotValue)value {
+    switch (value.kind) {
+        case FBGraphSnapshotKindNull:
+            return [NSNull null];
+        case FBGraphSnapshotKindTrue:
+            return [NSNumber numberWithBool:YES];
+        case FBGraphSnapshotKindFalse:
+            return [NSNumber numberWithBool:NO];
+        case FBGraphSnapshotKindNumber: {
+            NSString *string = [self stringAtIndex:value.payload];
+            if ([string rangeOfCharacterFromSet:[NSCharacterSet characterSetWithCharactersInString:@".eE"]].location != NSNotFound) {
+                return [NSNumber numberWithDouble:string.doubleValue];
+            }
+            return [NSNumber numberWithLongLong:string.longLongValue];
+        }
+        case FBGraphSnapshotKindString:
+            return [self stringAtIndex:value.payload];
+        case FBGraphSnapshotKindObject:
+            if (value.payload < _header->objectCount) {
+                return [[[FBGraphSnapshotDictionary alloc] initWithSnapshot:self index:value.payload] autorelease];
+            }
+            return nil;
+        case FBGraphSnapshotKindArray:
+            if (value.payload < _header->arrayCount) {
+                return [[[FBGraphSnapshotArray alloc] initWithSnapshot:self index:value.payload] autorelease];
+            }
+            return nil;
+        default:
+            return nil;
+    }
+}
+
+- (const FBGraphSnapshotPair *)pairsOfObject:(uint32_t)object count:(uint32_t *)count {
+    FBGraphSnapshotRange range = _objects[object];
+    if ((uint64_t)range.location + range.length > _header->pairCount) {
+        *count = 0;
+        return NULL;
+    }
+    *count = range.length;
+    return _pairs + range.location;
+}
+
+- (NSUInteger)countOfArray:(uint32_t)array {
+    FBGraphSnapshotRange range = _arrays[array];
+    if ((uint64_t)range.location + range.length > _header->elementCount) {
+        return 0;
+    }
+    return range.length;
+}
+
+- (id)elementAtIndex:(NSUInteger)index ofArray:(uint32_t)array {
+    // A corrupt element decodes as null rather than leaving a hole in the array
+    id element = [self objectForValue:_elements[_arrays[array].location + index]];
+    return element ?: [NSNull null];
+}
+
+@end
+
+#pragma mark - Containers
+
+@implementation FBGraphSnapshotDictionary
+
+- (id)initWithSnapshot:(FBGraphSnapshot *)snapshot index:(uint32_t)index {
+    self = [super init];
+    if (self) {
+        _snapshot = [snapshot retain];
+        _pairs = [snapshot pairsOfObject:index count:&_count];
+        _values = calloc(_count ?: 1, sizeof(id));
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_values) {
+        for (uint32_t i = 0; i < _count; i++) {
+            [_values[i] release];
+        }
+        free(_values);
+    }
+    [_snapshot release];
+    [super dealloc];
+}
+
+- (NSUInteger)count {
+    return _count;
+}
+
+- (id)objectForKey:(id)key {
+    if (![key isKindOfClass:[NSString class]]) {
+        return nil;
+    }
+    for (uint32_t i = 0; i < _count; i++) {
+        if ([[_snapshot stringAtIndex:_pairs[i].key] isEqualToString:key]) {
+            id value = _values[i];
+            if (!value) {
+                value = [_snapshot objectForValue:_pairs[i].value];
+                value = value ? FBGraphSnapshotPublish(&_values[i], value) : nil;
+            }
+            return value;
+        }
+    }
+    return nil;
+}
+
+- (NSEnumerator *)keyEnumerator {
+    NSMutableArray *keys = [NSMutableArray arrayWithCapacity:_count];
+    for (uint32_t i = 0; i < _count; i++) {
+        NSString *key = [_snapshot stringAtIndex:_pairs[i].key];
+        if (key) {
+            [keys addObject:key];
+        }
+    }
+    return [keys objectEnumerator];
+}
+
+@end
+
+@implementation FBGraphSnapshotArray
+
+- (id)initWithSnapshot:(FBGraphSnapshot *)snapshot index:(uint32_t)index {
+    self = [super init];
+    if (self) {
+        _snapshot = [snapshot retain];
+        _index = index;
+        _count = [snapshot countOfArray:index];
+        _elements = calloc(_count ?: 1, sizeof(id));
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_elements) {
+        for (NSUInteger i = 0; i < _count; i++) {
+            [_elements[i] release];
+        }
+        free(_elements);
+    }
+    [_snapshot release];
+    [super dealloc];
+}
+
+- (NSUInteger)count {
+    return _count;
+}
+
+- (id)objectAtIndex:(NSUInteger)index {
+    if (index >= _count) {
+        [NSException raise:NSRangeException
+                    format:@"index %lu beyond bounds [0 .. %lu]", (unsigned long)index, (unsigned long)_count];
+    }
+    id element = _elements[index];
+    if (!element) {
+        element = FBGraphSnapshotPublish(&_elements[index], [_snapshot elementAtIndex:index ofArray:_index]);
+    }
+    return element;
+}
+
+@end
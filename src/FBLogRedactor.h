@@ -0,0 +1,43 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+// FBLogRedactor
+//
+// Summary:
+// Replaces registered strings, such as access tokens, in log output. All registered
+// strings are compiled into one Aho-Corasick automaton over their UTF-8 bytes, so a log
+// entry is redacted in a single pass whatever the number of strings. The automaton is
+// rebuilt on the first redaction after the registered set changes.
+//
+// At most `capacity` strings are kept; registering past that drops the string that was
+// least recently registered or found in a log entry. Where matches overlap, the one that
+// starts first wins, then the longest. All methods are thread-safe.
+@interface FBLogRedactor : NSObject
+
+- (id)initWithCapacity:(NSUInteger)capacity;
+
+@property (nonatomic, readonly) NSUInteger capacity;
+@property (nonatomic, readonly) NSUInteger count;
+
+- (void)registerString:(NSString *)string replacement:(NSString *)replacement;
+
+// Returns `string` with every registered string replaced; never returns the mutable
+// instance that was passed in.
+- (NSString *)redactString:(NSString *)string;
+
+@end
@@ -0,0 +1,427 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "FBLogRedactor.h"
+
+#pragma mark - Automaton
+
+// States are numbered in insertion order with the root at 0. Transitions out of the
+// root are a full table; every other state keeps a short linked list of edges and falls
+// back along its failure link.
+typedef struct {
+    int32_t fail;
+    int32_t firstEdge;
+    // Longest pattern that ends at this state, itself or through failure links, or -1
+    int32_t match;
+} FBLogRedactorState;
+
+typedef struct {
+    int32_t target;
+    int32_t next;
+    uint8_t byte;
+} FBLogRedactorEdge;
+
+typedef struct {
+    NSUInteger location;
+    NSUInteger length;
+    int32_t pattern;
+} FBLogRedactorMatch;
+
+typedef struct {
+    FBLogRedactorState *states;
+    FBLogRedactorEdge *edges;
+    int32_t rootTable[256];
+    int32_t patternCount;
+    int32_t *patternLengths;
+    // Next shorter pattern that is a suffix of each pattern, or -1
+    int32_t *patternSuffixes;
+} FBLogRedactorAutomaton;
+
+static int32_t FBLogRedactorChild(const FBLogRedactorAutomaton *automaton, int32_t state, uint8_t byte) {
+    if (state == 0) {
+        return automaton->rootTable[byte];
+    }
+    for (int32_t edge = automaton->states[state].firstEdge; edge >= 0; edge = automaton->edges[edge].next) {
+        if (automaton->edges[edge].byte == byte) {
+            return automaton->edges[edge].target;
+        }
+    }
+    return -1;
+}
+
+static int32_t FBLogRedactorStep(const FBLogRedactorAutomaton *automaton, int32_t state, uint8_t byte) {
+    for (;;) {
+        int32_t child = FBLogRedactorChild(automaton, state, byte);
+        if (child > 0) {
+            return child;
+        }
+        if (state == 0) {
+            return 0;
+        }
+        state = automaton->states[state].fail;
+    }
+}
+
+// Returns NULL if memory runs out.
+static FBLogRedactorAutomaton *FBLogRedactorAutomatonCreate(const uint8_t **patterns,
+                                                            const int32_t *lengths,
+                                                            int32_t patternCount) {
+    int32_t byteCount = 0;
+    for (int32_t i = 0; i < patternCount; i++) {
+        byteCount += lengths[i];
+    }
+
+    FBLogRedactorAutomaton *automaton = calloc(1, sizeof(FBLogRedactorAutomaton));
+    if (!automaton) {
+        return NULL;
+    }
+    automaton->states = malloc(sizeof(FBLogRedactorState) * (byteCount + 1));
+    automaton->edges = malloc(sizeof(FBLogRedactorEdge) * (byteCount + 1));
+    automaton->patternLengths = malloc(sizeof(int32_t) * (patternCount + 1));
+    automaton->patternSuffixes = malloc(sizeof(int32_t) * (patternCount + 1));
+    int32_t *queue = malloc(sizeof(int32_t) * (byteCount + 1));
+    int32_t *terminalStates = malloc(sizeof(int32_t) * (patternCount + 1));
+    if (!automaton->states || !automaton->edges || !automaton->patternLengths ||
+        !automaton->patternSuffixes || !queue || !terminalStates) {
+        free(queue);
+        free(terminalStates);
+        free(automaton->states);
+        free(automaton->edges);
+        free(automaton->patternLengths);
+        free(automaton->patternSuffixes);
+        free(automaton);
+        return NULL;
+    }
+    automaton->patternCount = patternCount;
+    memcpy(automaton->patternLengths, lengths, sizeof(int32_t) * patternCount);
+
+    // Build the trie
+    int32_t stateCount = 1;
+    int32_t edgeCount = 0;
+    automaton->states[0].fail = 0;
+    automaton->states[0].firstEdge = -1;
+    automaton->states[0].match = -1;
+    for (int32_t i = 0; i < patternCount; i++) {
+        int32_t state = 0;
+        for (int32_t j = 0; j < lengths[i]; j++) {
+            uint8_t byte = patterns[i][j];
+            int32_t child = FBLogRedactorChild(automaton, state, byte);
+            if (child <= 0) {
+                child = stateCount++;
+                automaton->states[child].fail = 0;
+                automaton->states[child].firstEdge = -1;
+                automaton->states[child].match = -1;
+                if (state == 0) {
+                    automaton->rootTable[byte] = child;
+                } else {
+                    FBLogRedactorEdge *edge = &automaton->edges[edgeCount];
+                    edge->target = child;
+                    edge->byte = byte;
+                    edge->next = automaton->states[state].firstEdge;
+                    automaton->states[state].firstEdge = edgeCount++;
+                }
+            }
+            state = child;
+        }
+        automaton->states[state].match = i;
+        terminalStates[i] = state;
+    }
+
+    // Failure links, breadth first so that every state's failure target is done before it
+    int32_t head = 0;
+    int32_t tail = 0;
+    for (int byte = 0; byte < 256; byte++) {
+        if (automaton->rootTable[byte] > 0) {
+            queue[tail++] = automaton->rootTable[byte];
+        }
+    }
+    while (head < tail) {
+        int32_t state = queue[head++];
+        FBLogRedactorState *info = &automaton->states[state];
+        if (info->match < 0) {
+            info->match = automaton->states[info->fail].match;
+        }
+        for (int32_t edge = info->firstEdge; edge >= 0; edge = automaton->edges[edge].next) {
+            int32_t child = automaton->edges[edge].target;
+            automaton->states[child].fail = FBLogRedactorStep(automaton, info->fail, automaton->edges[edge].byte);
+            queue[tail++] = child;
+        }
+    }
+
+    for (int32_t i = 0; i < patternCount; i++) {
+        int32_t fail = automaton->states[terminalStates[i]].fail;
+        automaton->patternSuffixes[i] = automaton->states[fail].match;
+    }
+
+    free(queue);
+    free(terminalStates);
+    return automaton;
+}
+
+static void FBLogRedactorAutomatonFree(FBLogRedactorAutomaton *automaton) {
+    if (automaton) {
+        free(automaton->states);
+        free(automaton->edges);
+        free(automaton->patternLengths);
+        free(automaton->patternSuffixes);
+        free(automaton);
+    }
+}
+
+static int FBLogRedactorMatchCompare(const void *a, const void *b) {
+    const FBLogRedactorMatch *left = a;
+    const FBLogRedactorMatch *right = b;
+    if (left->location != right->location) {
+        return left->location < right->location ? -1 : 1;
+    }
+    if (left->length != right->length) {
+        return left->length > right->length ? -1 : 1;
+    }
+    return 0;
+}
+
+// Finds every occurrence of every pattern in `bytes`, then keeps the non-overlapping ones,
+// earliest and then longest first. Returns the number of matches written to `*matches`,
+// which the caller frees; 0 leaves `*matches` NULL.
+static NSUInteger FBLogRedactorFindMatches(const FBLogRedactorAutomaton *automaton,
+                                           const uint8_t *bytes,
+                                           NSUInteger length,
+                                           FBLogRedactorMatch **matches) {
+    *matches = NULL;
+    NSUInteger count = 0;
+    NSUInteger capacity = 0;
+    int32_t state = 0;
+    for (NSUInteger i = 0; i < length; i++) {
+        state = FBLogRedactorStep(automaton, state, bytes[i]);
+        for (int32_t pattern = automaton->states[state].match; pattern >= 0; pattern = automaton->patternSuffixes[pattern]) {
+            if (count == capacity) {
+                capacity = capacity ? capacity * 2 : 8;
+                FBLogRedactorMatch *grown = realloc(*matches, sizeof(FBLogRedactorMatch) * capacity);
+                if (!grown) {
+                    free(*matches);
+                    *matches = NULL;
+                    return 0;
+                }
+                *matches = grown;
+            }
+            NSUInteger patternLength = automaton->patternLengths[pattern];
+            (*matches)[count].location = i + 1 - patternLength;
+            (*matches)[count].length = patternLength;
+            (*matches)[count].pattern = pattern;
+            count++;
+        }
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    qsort(*matches, count, sizeof(FBLogRedactorMatch), FBLogRedactorMatchCompare);
+    NSUInteger kept = 0;
+    NSUInteger end = 0;
+    for (NSUInteger i = 0; i < count; i++) {
+        if ((*matches)[i].location >= end) {
+            end = (*matches)[i].location + (*matches)[i].length;
+            (*matches)[kept++] = (*matches)[i];
+        }
+    }
+    return kept;
+}
+
+#pragma mark - FBLogRedactorSnapshot
+
+// An automaton together with the strings it was built from; immutable once built, so
+// redaction runs without holding the redactor's lock.
+@interface FBLogRedactorSnapshot : NSObject
+{
+@public
+    FBLogRedactorAutomaton *_automaton;
+    NSArray *_strings;
+    NSArray *_replacements;
+}
+
+- (id)initWithStrings:(NSArray *)strings replacements:(NSArray *)replacements;
+
+@end
+
+@implementation FBLogRedactorSnapshot
+
+- (id)initWithStrings:(NSArray *)strings replacements:(NSArray *)replacements {
+    if (self = [super init]) {
+        _strings = [strings copy];
+        NSMutableArray *replacementData = [NSMutableArray arrayWithCapacity:replacements.count];
+        for (NSString *replacement in replacements) {
+            [replacementData addObject:[replacement dataUsingEncoding:NSUTF8StringEncoding]];
+        }
+        _replacements = [replacementData copy];
+
+        NSMutableArray *patternData = [NSMutableArray arrayWithCapacity:strings.count];
+        const uint8_t **patterns = malloc(sizeof(uint8_t *) * (strings.count + 1));
+        int32_t *lengths = malloc(sizeof(int32_t) * (strings.count + 1));
+        if (patterns && lengths) {
+            for (NSUInteger i = 0; i < strings.count; i++) {
+                NSData *data = [[strings objectAtIndex:i] dataUsingEncoding:NSUTF8StringEncoding];
+                [patternData addObject:data];
+                patterns[i] = data.bytes;
+                lengths[i] = (int32_t)data.length;
+            }
+            _automaton = FBLogRedactorAutomatonCreate(patterns, lengths, (int32_t)strings.count);
+        }
+        free(patterns);
+        free(lengths);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    FBLogRedactorAutomatonFree(_automaton);
+    [_strings release];
+    [_replacements release];
+    [super dealloc];
+}
+
+@end
+
+#pragma mark - FBLogRedactor
+
+@interface FBLogRedactor ()
+
+- (FBLogRedactorSnapshot *)currentSnapshot;
+- (void)touchStrings:(NSArray *)strings;
+
+@end
+
+@implementation FBLogRedactor
+{
+    // Guarded by @synchronized(self)
+    NSMutableDictionary *_replacements;
+    NSMutableDictionary *_lastUses;
+    uint64_t _clock;
+    FBLogRedactorSnapshot *_snapshot;
+}
+
+@synthesize capacity = _capacity;
+
+- (id)initWithCapacity:(NSUInteger)capacity {
+    if (self = [super init]) {
+        _capacity = MAX(capacity, 1);
+        _replacements = [[NSMutableDictionary alloc] init];
+        _lastUses = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [_replacements release];
+    [_lastUses release];
+    [_snapshot release];
+    [super dealloc];
+}
+
+- (NSUInteger)count {
+    @synchronized(self) {
+        return _replacements.count;
+    }
+}
+
+- (void)registerString:(NSString *)string replacement:(NSString *)replacement {
+    if (!string.length || !replacement) {
+        return;
+    }
+
+    @synchronized(self) {
+        [_lastUses setObject:[NSNumber numberWithUnsignedLongLong:++_clock] forKey:string];
+        // Re-registering an unchanged string, as happens for every request made with the
+        // same token, keeps the automaton
+        if ([[_replacements objectForKey:string] isEqualToString:replacement]) {
+            return;
+        }
+        [_replacements setObject:replacement forKey:string];
+
+        if (_replacements.count > _capacity) {
+            NSString *oldest = nil;
+            uint64_t oldestUse = UINT64_MAX;
+            for (NSString *key in _lastUses) {
+                uint64_t use = [[_lastUses objectForKey:key] unsignedLongLongValue];
+                if (use < oldestUse) {
+                    oldest = key;
+                    oldestUse = use;
+                }
+            }
+            [_replacements removeObjectForKey:oldest];
+            [_lastUses removeObjectForKey:oldest];
+        }
+
+        [_snapshot release];
+        _snapshot = nil;
+    }
+}
+
+- (NSString *)redactString:(NSString *)string {
+    FBLogRedactorSnapshot *snapshot = [self currentSnapshot];
+    if (!snapshot || !snapshot->_automaton || !string.length) {
+        return [[string copy] autorelease];
+    }
+
+    const uint8_t *bytes = (const uint8_t *)[string UTF8String];
+    NSUInteger length = [string lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    FBLogRedactorMatch *matches = NULL;
+    NSUInteger matchCount = FBLogRedactorFindMatches(snapshot->_automaton, bytes, length, &matches);
+    if (matchCount == 0) {
+        return [[string copy] autorelease];
+    }
+
+    NSMutableData *redacted = [NSMutableData dataWithCapacity:length];
+    NSMutableArray *matchedStrings = [NSMutableArray arrayWithCapacity:matchCount];
+    NSUInteger location = 0;
+    for (NSUInteger i = 0; i < matchCount; i++) {
+        NSData *replacement = [snapshot->_replacements objectAtIndex:matches[i].pattern];
+        [redacted appendBytes:bytes + location length:matches[i].location - location];
+        [redacted appendData:replacement];
+        location = matches[i].location + matches[i].length;
+        [matchedStrings addObject:[snapshot->_strings objectAtIndex:matches[i].pattern]];
+    }
+    [redacted appendBytes:bytes + location length:length - location];
+    free(matches);
+
+    [self touchStrings:matchedStrings];
+    return [[[NSString alloc] initWithData:redacted encoding:NSUTF8StringEncoding] autorelease];
+}
+
+#pragma mark - Private
+
+- (FBLogRedactorSnapshot *)currentSnapshot {
+    @synchronized(self) {
+        if (!_snapshot && _replacements.count) {
+            NSArray *strings = [_replacements allKeys];
+            NSArray *replacements = [_replacements objectsForKeys:strings notFoundMarker:@""];
+            _snapshot = [[FBLogRedactorSnapshot alloc] initWithStrings:strings replacements:replacements];
+        }
+        return [[_snapshot retain] autorelease];
+    }
+}
+
+- (void)touchStrings:(NSArray *)strings {
+    @synchronized(self) {
+        for (NSString *string in strings) {
+            // Skip strings evicted since the snapshot was taken
+            if ([_lastUses objectForKey:string]) {
+                [_lastUses setObject:[NSNumber numberWithUnsignedLongLong:++_clock] forKey:string];
+            }
+        }
+    }
+}
+
+@end
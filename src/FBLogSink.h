@@ -0,0 +1,44 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+/*!
+ @protocol
+
+ @abstract
+ Receives the log entries the SDK emits, in addition to or instead of NSLog(). Register one
+ with <[FBSettings addLogSink:]>; only entries for the behaviors enabled with
+ <[FBSettings setLoggingBehavior:]> are emitted.
+
+ @discussion
+ Entries arrive already scrubbed of access tokens (unless FBLoggingBehaviorAccessTokens is
+ enabled) and are not truncated. Sinks are called synchronously on the emitting thread, which
+ may be any thread, so implementations should be thread-safe and hand expensive work off to a
+ queue of their own. See FBFileLogSink for a sink that writes to rotating files.
+ */
+@protocol FBLogSink <NSObject>
+
+/*!
+ @abstract
+ Called with each emitted entry.
+
+ @param entry             The text of the entry.
+ @param loggingBehavior   The FBLoggingBehavior* constant the entry was logged under.
+ */
+- (void)logEntry:(NSString *)entry loggingBehavior:(NSString *)loggingBehavior;
+
+@end
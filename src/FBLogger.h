@@ -16,6 +16,8 @@
 
 #import <Foundation/Foundation.h>
 
+#import "FBLogSink.h"
+
 /*!
  @class FBLogger
 
@@ -51,7 +53,7 @@
 - (void)appendFormat:(NSString *)formatString, ... NS_FORMAT_FUNCTION(1,2);
 - (void)appendKey:(NSString *)key value:(NSString *)value;
 
-// Emit log, clearing out the logger contents.
+// Emit log to NSLog and any registered sinks, clearing out the logger contents.
 - (void)emitToNSLog;
 
 //
@@ -75,12 +77,42 @@
               formatString:(NSString *)formatString, ... NS_FORMAT_FUNCTION(3,4);
 
 // Register a timestamp label with the "current" time, to then be retrieved by singleShotLogEntry
-// to include a duration.
+// to include a duration.  Durations are also added to the behavior's histogram, see timingStatistics.
 + (void)registerCurrentTime:(NSString *)loggingBehavior
                     withTag:(NSObject *)timestampTag;
 
 // When logging strings, replace all instances of 'replace' with instances of 'replaceWith'.
+// Only the most recently used strings are kept, see FBLogRedactor.
 + (void)registerStringToReplace:(NSString *)replace
                     replaceWith:(NSString *)replaceWith;
 
+// Add or remove a sink that receives every emitted entry. Sinks are retained. Apps reach
+// these, and logsToSystemLog, through FBSettings.
++ (void)addSink:(id<FBLogSink>)sink;
++ (void)removeSink:(id<FBLogSink>)sink;
+
+// Whether emitted entries also go to NSLog; defaults to YES. Turning this off with a
+// sink registered keeps verbose logging out of the system log.
++ (BOOL)logsToSystemLog;
++ (void)setLogsToSystemLog:(BOOL)logsToSystemLog;
+
+// Whether timestamped durations are measured even for behaviors that are not being logged;
+// defaults to NO. Cheap enough to leave on in production to feed timingStatistics.
++ (BOOL)collectsTimingStatistics;
++ (void)setCollectsTimingStatistics:(BOOL)collectsTimingStatistics;
+
+// Count, p50, p99 and max in msec of the durations measured so far, keyed by logging behavior.
+// See FBSettings.h for the keys. Apps reach these timing methods through FBSettings.
++ (NSDictionary *)timingStatistics;
+
+// Opens a span nested in any already open for the tag, unlike registerCurrentTime:withTag:,
+// which restarts the innermost one. Closed innermost first by endTimingSpanWithTag:.
++ (void)beginTimingSpanWithTag:(NSObject *)timestampTag;
+
+// Closes the innermost span open for the tag and adds its duration to the behavior's
+// histogram. Returns NO if no span was open.
++ (BOOL)endTimingSpanWithTag:(NSObject *)timestampTag
+             loggingBehavior:(NSString *)loggingBehavior
+                    duration:(NSTimeInterval *)duration;
+
 @end
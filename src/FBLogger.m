@@ -16,13 +16,20 @@
 
 #import "FBLogger.h"
 
+#import "FBLogRedactor.h"
 #import "FBSession.h"
 #import "FBSettings.h"
-#import "FBUtility.h"
+#import "FBTimingRegistry.h"
 
 static NSUInteger g_serialNumberCounter = 1111;
-static NSMutableDictionary *g_stringsToReplace = nil;
-static NSMutableDictionary *g_startTimesWithTags = nil;
+// Tokens are registered per request; the least recently used past this many are dropped
+static const NSUInteger kMaximumStringsToReplace = 64;
+
+static FBLogRedactor *g_stringsToReplace = nil;
+// Copied on write so that emitting never holds the lock while calling out to sinks
+static NSArray *g_sinks = nil;
+static BOOL g_logsToSystemLog = YES;
+static BOOL g_collectsTimingStatistics = NO;
 
 @interface FBLogger ()
 
@@ -99,20 +106,27 @@ static NSMutableDictionary *g_startTimesWithTags = nil;
 - (void)emitToNSLog {
     if (_isActive) {
 
-        for (NSString *key in [g_stringsToReplace keyEnumerator]) {
-            [_internalContents replaceOccurrencesOfString:key
-                                               withString:[g_stringsToReplace objectForKey:key]
-                                                  options:NSLiteralSearch
-                                                    range:NSMakeRange(0, _internalContents.length)];
+        NSString *entry = g_stringsToReplace
+            ? [g_stringsToReplace redactString:_internalContents]
+            : [[_internalContents copy] autorelease];
+
+        NSArray *sinks = nil;
+        @synchronized([FBLogger class]) {
+            sinks = [[g_sinks retain] autorelease];
+        }
+        for (id<FBLogSink> sink in sinks) {
+            [sink logEntry:entry loggingBehavior:_loggingBehavior];
         }
 
-        // Xcode 4.4 hangs on extremely long NSLog output (http://openradar.appspot.com/11972490).  Truncate if needed.
-        const int MAX_LOG_STRING_LENGTH = 10000;
-        NSString *logString = _internalContents;
-        if (_internalContents.length > MAX_LOG_STRING_LENGTH) {
-            logString = [NSString stringWithFormat:@"TRUNCATED: %@", [_internalContents substringToIndex:MAX_LOG_STRING_LENGTH]];
+        if (g_logsToSystemLog) {
+            // Xcode 4.4 hangs on extremely long NSLog output (http://openradar.appspot.com/11972490).  Truncate if needed.
+            const int MAX_LOG_STRING_LENGTH = 10000;
+            NSString *logString = entry;
+            if (entry.length > MAX_LOG_STRING_LENGTH) {
+                logString = [NSString stringWithFormat:@"TRUNCATED: %@", [entry substringToIndex:MAX_LOG_STRING_LENGTH]];
+            }
+            NSLog(@"FBSDKLog: %@", logString);
         }
-        NSLog(@"FBSDKLog: %@", logString);
 
         [_internalContents setString:@""];
     }
@@ -152,25 +166,24 @@ static NSMutableDictionary *g_startTimesWithTags = nil;
               timestampTag:(NSObject *)timestampTag
               formatString:(NSString *)formatString, ... {
 
-    if ([[FBSettings loggingBehavior] containsObject:loggingBehavior]) {
-        va_list vaArguments;
-        va_start(vaArguments, formatString);
-        NSString *logString = [[[NSString alloc] initWithFormat:formatString arguments:vaArguments] autorelease];
-        va_end(vaArguments);
-
-        // Start time of this "timestampTag" is stashed in the dictionary.
-        // Treat the incoming object tag simply as an address, since it's only used to identify during lifetime.  If
-        // we send in as an object, the dictionary will try to copy it.
-        NSNumber *tagAsNumber = [NSNumber numberWithUnsignedLong:(unsigned long)(void *)timestampTag];
-        NSNumber *startTimeNumber = [g_startTimesWithTags objectForKey:tagAsNumber];
+    BOOL isLogging = [[FBSettings loggingBehavior] containsObject:loggingBehavior];
+    if (isLogging || g_collectsTimingStatistics) {
+        // Start time of this "timestampTag" is stashed in the timing registry, which treats the tag simply as an
+        // address, since it's only used to identify during lifetime.
+        NSTimeInterval elapsed = 0;
+        BOOL hasStartTime = [[FBTimingRegistry sharedRegistry] endSpanWithTag:timestampTag
+                                                              loggingBehavior:loggingBehavior
+                                                                     duration:&elapsed];
 
         // Only log if there's been an associated start time.
-        if (startTimeNumber) {
-            unsigned long elapsed = [FBUtility currentTimeInMilliseconds] - startTimeNumber.unsignedLongValue;
-            [g_startTimesWithTags removeObjectForKey:tagAsNumber];  // served its purpose, remove
+        if (hasStartTime && isLogging) {
+            va_list vaArguments;
+            va_start(vaArguments, formatString);
+            NSString *logString = [[[NSString alloc] initWithFormat:formatString arguments:vaArguments] autorelease];
+            va_end(vaArguments);
 
             // Log string is appended with "%d msec", with nothing intervening.  This gives the most control to the caller.
-            logString = [NSString stringWithFormat:@"%@%lu msec", logString, elapsed];
+            logString = [NSString stringWithFormat:@"%@%lu msec", logString, (unsigned long)(elapsed * 1000)];
 
             [self singleShotLogEntry:loggingBehavior logEntry:logString];
         }
@@ -180,24 +193,11 @@ static NSMutableDictionary *g_startTimesWithTags = nil;
 + (void)registerCurrentTime:(NSString *)loggingBehavior
                     withTag:(NSObject *)timestampTag {
 
-    if ([[FBSettings loggingBehavior] containsObject:loggingBehavior]) {
-
-        if (!g_startTimesWithTags) {
-            g_startTimesWithTags = [[NSMutableDictionary alloc] init];
-        }
-
-        if (g_startTimesWithTags.count >= 1000) {
+    if (g_collectsTimingStatistics || [[FBSettings loggingBehavior] containsObject:loggingBehavior]) {
+        if (![[FBTimingRegistry sharedRegistry] restartSpanWithTag:timestampTag]) {
             [FBLogger singleShotLogEntry:FBLoggingBehaviorDeveloperErrors logEntry:
                     @"Unexpectedly large number of outstanding perf logging start times, something is likely wrong."];
         }
-
-        unsigned long currTime = [FBUtility currentTimeInMilliseconds];
-
-        // Treat the incoming object tag simply as an address, since it's only used to identify during lifetime.  If
-        // we send in as an object, the dictionary will try to copy it.
-        unsigned long tagAsNumber = (unsigned long)(void *)timestampTag;
-        [g_startTimesWithTags setObject:[NSNumber numberWithUnsignedLong:currTime]
-                                 forKey:[NSNumber numberWithUnsignedLong:tagAsNumber]];
     }
 }
 
@@ -205,18 +205,71 @@ static NSMutableDictionary *g_startTimesWithTags = nil;
 + (void)registerStringToReplace:(NSString *)replace
                     replaceWith:(NSString *)replaceWith {
 
-    // Strings sent in here never get cleaned up, but that's OK, don't ever expect too many.
-
     if ([[FBSettings loggingBehavior] count] > 0) {  // otherwise there's no logging.
 
-        if (!g_stringsToReplace) {
-            g_stringsToReplace = [[NSMutableDictionary alloc] init];
+        static dispatch_once_t onceToken;
+        dispatch_once(&onceToken, ^{
+            g_stringsToReplace = [[FBLogRedactor alloc] initWithCapacity:kMaximumStringsToReplace];
+        });
+
+        [g_stringsToReplace registerString:replace replacement:replaceWith];
+    }
+}
+
++ (void)addSink:(id<FBLogSink>)sink {
+    @synchronized([FBLogger class]) {
+        if (![g_sinks containsObject:sink]) {
+            NSArray *sinks = g_sinks ? [g_sinks arrayByAddingObject:sink] : [NSArray arrayWithObject:sink];
+            [g_sinks release];
+            g_sinks = [sinks retain];
         }
+    }
+}
+
++ (void)removeSink:(id<FBLogSink>)sink {
+    @synchronized([FBLogger class]) {
+        NSMutableArray *sinks = [[g_sinks mutableCopy] autorelease];
+        [sinks removeObject:sink];
+        [g_sinks release];
+        g_sinks = [sinks copy];
+    }
+}
+
++ (BOOL)logsToSystemLog {
+    return g_logsToSystemLog;
+}
+
++ (void)setLogsToSystemLog:(BOOL)logsToSystemLog {
+    g_logsToSystemLog = logsToSystemLog;
+}
+
++ (BOOL)collectsTimingStatistics {
+    return g_collectsTimingStatistics;
+}
+
++ (void)setCollectsTimingStatistics:(BOOL)collectsTimingStatistics {
+    g_collectsTimingStatistics = collectsTimingStatistics;
+}
 
-        [g_stringsToReplace setValue:replaceWith forKey:replace];
++ (NSDictionary *)timingStatistics {
+    return [[FBTimingRegistry sharedRegistry] statistics];
+}
+
++ (void)beginTimingSpanWithTag:(NSObject *)timestampTag {
+    if (![[FBTimingRegistry sharedRegistry] beginSpanWithTag:timestampTag]) {
+        [FBLogger singleShotLogEntry:FBLoggingBehaviorDeveloperErrors logEntry:
+                @"Unexpectedly large number of outstanding perf logging start times, something is likely wrong."];
     }
 }
 
++ (BOOL)endTimingSpanWithTag:(NSObject *)timestampTag
+             loggingBehavior:(NSString *)loggingBehavior
+                    duration:(NSTimeInterval *)duration {
+    return [[FBTimingRegistry sharedRegistry] endSpanWithTag:timestampTag
+                                             loggingBehavior:loggingBehavior
+                                                    duration:duration];
+}
+
 
 
 @end
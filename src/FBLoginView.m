@@ -17,17 +17,15 @@
 #import "FBLoginView.h"
 
 #import "FBAppEvents+Internal.h"
+#import "FBCurrentUserStore.h"
 #import "FBGraphUser.h"
 #import "FBLoginViewButtonPNG.h"
 #import "FBLoginViewButtonPressedPNG.h"
 #import "FBProfilePictureView.h"
-#import "FBRequest.h"
-#import "FBRequestConnection+Internal.h"
 #import "FBSession+Internal.h"
 #import "FBSession.h"
 #import "FBUtility.h"
 
-static NSString *const FBLoginViewCacheIdentity = @"FBLoginView";
 // The design calls for 16 pixels of space on the right edge of the button
 static const float kButtonEndCapWidth = 16.0;
 // The button has a 12 pixel buffer to the right of the f logo
@@ -45,10 +43,8 @@ static CGSize g_buttonSize;
 @property (retain, nonatomic) UILabel *label;
 @property (retain, nonatomic) UIButton *button;
 @property (retain, nonatomic) FBSession *session;
-@property (retain, nonatomic) FBRequestConnection *request;
 @property (retain, nonatomic) id<FBGraphUser> user;
 @property (copy, nonatomic) FBSessionStateHandler sessionStateHandler;
-@property (copy, nonatomic) FBRequestHandler requestHandler;
 // lastObservedStateWasOpen is essentially a nullable bool to track if the
 // the session state was open when the inform delegate is called. This is
 // to prevent messaging the delegate again in state transfers that are
@@ -119,18 +115,13 @@ static CGSize g_buttonSize;
     // to prevent EXC_BAD_ACCESS errors.
     self.sessionStateHandler(nil, FBSessionStateClosed, nil);
     [_sessionStateHandler release];
-    [_requestHandler release];
 
     // removes all observers for self
     [[NSNotificationCenter defaultCenter] removeObserver:self];
 
-    // if we have an outstanding request, cancel
-    [self.request cancel];
-
     // unwire the session to release KVO.
     [self unwireViewForSession];
 
-    [_request release];
     [_label release];
     [_button release];
     [_session release];
@@ -160,27 +151,12 @@ static CGSize g_buttonSize;
     __block FBLoginView *weakSelf = self;
     self.sessionStateHandler = ^(FBSession *session, FBSessionState status, NSError *error) {
         if (session == nil) {
-            // The nil sentinel value for session indicates both blocks should no-op thereafter.
+            // The nil sentinel value for session indicates the block should no-op thereafter.
             weakSelf = nil;
         } else if (error) {
             [weakSelf informDelegateOfError:error];
         }
     };
-    self.requestHandler = ^(FBRequestConnection *connection, NSMutableDictionary<FBGraphUser> *result, NSError *error) {
-        if (result) {
-            weakSelf.user = result;
-            [weakSelf informDelegate:YES];
-        } else {
-            weakSelf.user = nil;
-            if (weakSelf.session.isOpen) {
-                // Only inform the delegate of errors if the session remains open;
-                // since session closure errors will surface through the openActiveSession
-                // block.
-                [weakSelf informDelegateOfError:error];
-            }
-        }
-        weakSelf.request = nil;
-    };
 }
 
 #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
@@ -218,6 +194,11 @@ static CGSize g_buttonSize;
                                                  name:FBSessionDidUnsetActiveSessionNotification
                                                object:nil];
 
+    [[NSNotificationCenter defaultCenter] addObserver:self
+                                             selector:@selector(handleCurrentUserStoreDidChange:)
+                                                 name:FBCurrentUserStoreDidChangeNotification
+                                               object:nil];
+
     // setup button
     self.button = [UIButton buttonWithType:UIButtonTypeCustom];
     [self.button addTarget:self
@@ -310,14 +291,37 @@ static CGSize g_buttonSize;
 }
 
 - (void)fetchMeInfo {
-    FBRequest *request = [FBRequest requestForMe];
-    [request setSession:self.session];
-    self.request = [[[FBRequestConnection alloc] init] autorelease];
-    [self.request addRequest:request
-           completionHandler:self.requestHandler];
-    [self.request startWithCacheIdentity:FBLoginViewCacheIdentity
-                   skipRoundtripIfCached:YES];
+    // The store batches this with the profile picture fetch and shares the result
+    // with any other login controls on screen; a user it already has for this
+    // session is shown without another round trip.
+    FBCurrentUserStore *store = [FBCurrentUserStore sharedStore];
+    [store fetchForSession:self.session skipRoundtripIfCached:YES];
+
+    // another control may already have fetched the user for this session
+    [self updateUserFromStore:store error:nil];
+}
 
+- (void)handleCurrentUserStoreDidChange:(NSNotification *)notification {
+    [self updateUserFromStore:notification.object
+                        error:[notification.userInfo objectForKey:FBCurrentUserStoreErrorKey]];
+}
+
+- (void)updateUserFromStore:(FBCurrentUserStore *)store error:(NSError *)error {
+    if (store.session != self.session || !self.session.isOpen) {
+        return;
+    }
+
+    if (store.user) {
+        if (self.user != store.user) {
+            self.user = store.user;
+            [self informDelegate:YES];
+        }
+    } else if (error) {
+        // Only inform the delegate of errors if the session remains open;
+        // since session closure errors will surface through the openActiveSession
+        // block.
+        [self informDelegateOfError:error];
+    }
 }
 
 - (void)informDelegate:(BOOL)userOnly {
@@ -360,10 +364,6 @@ static CGSize g_buttonSize;
 }
 
 - (void)wireViewForSessionWithoutOpening:(FBSession *)session {
-    // if there is an outstanding request for the previous session, cancel
-    [self.request cancel];
-    self.request = nil;
-
     self.session = session;
 
     // register a KVO observer
@@ -396,6 +396,16 @@ static CGSize g_buttonSize;
                       ofObject:(id)object
                         change:(NSDictionary *)change
                        context:(void *)context {
+    // sessions may change state on any thread, and notify us there
+    if (![NSThread isMainThread]) {
+        [self retain];
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self observeValueForKeyPath:keyPath ofObject:object change:change context:context];
+            [self release];
+        });
+        return;
+    }
+
     if (self.session.isOpen) {
         [self fetchMeInfo];
         [self configureViewForStateLoggedIn:YES];
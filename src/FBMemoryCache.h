@@ -0,0 +1,72 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+// Running counters for one tier of the cache.  Bytes counts the payload
+// served from the tier on hits.
+typedef struct {
+    int64_t hits;
+    int64_t misses;
+    int64_t bytes;
+} FBCacheTierStatistics;
+
+// Scan-resistant in-memory cache used internally by the disk cache.
+//
+// This is a simplified 2Q: objects seen for the first time go into a small
+// probationary queue, and only objects stored again while their key is
+// still remembered from an earlier visit are admitted to the main queue.
+// A single pass over many one-off objects (e.g. scrolling a long friend
+// list) therefore churns the probationary queue and leaves the hot working
+// set in the main queue alone.
+//
+// The probationary queue is held in a plain dictionary, kept in insertion
+// order and trimmed to its share of the cost limit here, rather than left to
+// NSCache's eviction, so that a scan always pushes out the oldest one-off
+// objects first and its cost accounting never refers to evicted objects.
+// Under memory pressure, the owner drops it with removeProbationaryObjects.
+@interface FBMemoryCache : NSObject
+{
+@private
+    NSMutableDictionary* _probationObjects;
+    NSCache* _mainCache;
+    NSUInteger _totalCostLimit;
+
+    NSMutableOrderedSet* _probationKeys;
+    NSMutableDictionary* _probationCosts;
+    NSUInteger _probationCost;
+    NSUInteger _probationCostLimit;
+
+    NSMutableOrderedSet* _recentKeys;
+    NSUInteger _recentKeysLimit;
+
+    FBCacheTierStatistics _statistics;
+}
+
+@property (nonatomic, assign) NSUInteger totalCostLimit;
+@property (nonatomic, readonly) FBCacheTierStatistics statistics;
+// Keys held in the probationary queue, oldest first, and their total cost.
+@property (nonatomic, readonly) NSArray* probationaryKeys;
+@property (nonatomic, readonly) NSUInteger probationaryCost;
+
+- (id)objectForKey:(id)key;
+- (void)setObject:(id)obj forKey:(id)key cost:(NSUInteger)cost;
+- (void)removeObjectForKey:(id)key;
+- (void)removeAllObjects;
+// Drops the probationary queue, keeping only the main working set.
+- (void)removeProbationaryObjects;
+
+@end
@@ -0,0 +1,217 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "FBMemoryCache.h"
+
+// Share of the cost limit given to the probationary queue
+static const double kProbationCostFraction = 0.25;
+
+// Number of keys remembered from earlier visits
+static const NSUInteger kDefaultRecentKeysLimit = 1024;
+
+@interface FBMemoryCache ()
+
+- (void)_removeProbationaryKey:(id)key;
+- (void)_trimProbation;
+
+@end
+
+@implementation FBMemoryCache
+
+@synthesize totalCostLimit = _totalCostLimit;
+
+#pragma mark - Lifecycle
+
+- (id)init
+{
+    self = [super init];
+    if (self) {
+        _probationObjects = [[NSMutableDictionary alloc] init];
+        _mainCache = [[NSCache alloc] init];
+        _recentKeys = [[NSMutableOrderedSet alloc] init];
+        _recentKeysLimit = kDefaultRecentKeysLimit;
+        _probationKeys = [[NSMutableOrderedSet alloc] init];
+        _probationCosts = [[NSMutableDictionary alloc] init];
+    }
+
+    return self;
+}
+
+- (void)dealloc
+{
+    [_probationObjects release];
+    [_mainCache release];
+    [_recentKeys release];
+    [_probationKeys release];
+    [_probationCosts release];
+    [super dealloc];
+}
+
+#pragma mark - Properties
+
+- (void)setTotalCostLimit:(NSUInteger)totalCostLimit
+{
+    NSUInteger probationCostLimit =
+        (NSUInteger)(totalCostLimit * kProbationCostFraction);
+    _mainCache.totalCostLimit = totalCostLimit - probationCostLimit;
+
+    @synchronized(self) {
+        _totalCostLimit = totalCostLimit;
+        _probationCostLimit = probationCostLimit;
+        [self _trimProbation];
+    }
+}
+
+- (NSArray*)probationaryKeys
+{
+    @synchronized(self) {
+        return [[_probationKeys.array copy] autorelease];
+    }
+}
+
+- (NSUInteger)probationaryCost
+{
+    @synchronized(self) {
+        return _probationCost;
+    }
+}
+
+- (FBCacheTierStatistics)statistics
+{
+    FBCacheTierStatistics statistics;
+    @synchronized(self) {
+        statistics = _statistics;
+    }
+    return statistics;
+}
+
+#pragma mark - Public
+
+- (id)objectForKey:(id)key
+{
+    // Hits in the probationary queue are not promoted: repeated lookups
+    // while an object is on screen say nothing about it being reused later.
+    id obj = [_mainCache objectForKey:key];
+
+    @synchronized(self) {
+        if (obj == nil) {
+            obj = [[[_probationObjects objectForKey:key] retain] autorelease];
+        }
+        if (obj) {
+            _statistics.hits++;
+            if ([obj respondsToSelector:@selector(length)]) {
+                _statistics.bytes += [obj length];
+            }
+        } else {
+            _statistics.misses++;
+        }
+    }
+
+    return obj;
+}
+
+- (void)setObject:(id)obj forKey:(id)key cost:(NSUInteger)cost
+{
+    BOOL admitToMain;
+    @synchronized(self) {
+        admitToMain = [_recentKeys containsObject:key];
+        if (!admitToMain) {
+            [_recentKeys addObject:key];
+            if (_recentKeys.count > _recentKeysLimit) {
+                [_recentKeys removeObjectAtIndex:0];
+            }
+        }
+    }
+
+    if (admitToMain || [_mainCache objectForKey:key] != nil) {
+        @synchronized(self) {
+            [self _removeProbationaryKey:key];
+        }
+        [_mainCache setObject:obj forKey:key cost:cost];
+    } else {
+        @synchronized(self) {
+            // A store replaces the earlier one and goes to the back
+            [self _removeProbationaryKey:key];
+            [_probationObjects setObject:obj forKey:key];
+            [_probationKeys addObject:key];
+            [_probationCosts
+                setObject:[NSNumber numberWithUnsignedInteger:cost]
+                forKey:key];
+            _probationCost += cost;
+            [self _trimProbation];
+        }
+    }
+}
+
+- (void)removeObjectForKey:(id)key
+{
+    @synchronized(self) {
+        [self _removeProbationaryKey:key];
+    }
+    [_mainCache removeObjectForKey:key];
+}
+
+- (void)removeAllObjects
+{
+    [_mainCache removeAllObjects];
+    @synchronized(self) {
+        [_probationObjects removeAllObjects];
+        [_probationKeys removeAllObjects];
+        [_probationCosts removeAllObjects];
+        _probationCost = 0;
+        [_recentKeys removeAllObjects];
+    }
+}
+
+- (void)removeProbationaryObjects
+{
+    @synchronized(self) {
+        [_probationObjects removeAllObjects];
+        [_probationKeys removeAllObjects];
+        [_probationCosts removeAllObjects];
+        _probationCost = 0;
+    }
+}
+
+#pragma mark - Private
+
+// Must be called while synchronized on self
+- (void)_removeProbationaryKey:(id)key
+{
+    NSNumber* cost = [_probationCosts objectForKey:key];
+    if (cost == nil) {
+        return;
+    }
+
+    _probationCost -= cost.unsignedIntegerValue;
+    [_probationCosts removeObjectForKey:key];
+    [_probationKeys removeObject:key];
+    [_probationObjects removeObjectForKey:key];
+}
+
+// Must be called while synchronized on self.  Drops the oldest probationary
+// objects until the queue fits its share of the cost limit; a limit of zero
+// means no limit, as for NSCache.
+- (void)_trimProbation
+{
+    while (_probationCostLimit > 0 &&
+           _probationCost > _probationCostLimit &&
+           _probationKeys.count > 0) {
+        [self _removeProbationaryKey:[_probationKeys objectAtIndex:0]];
+    }
+}
+
+@end
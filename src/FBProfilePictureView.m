@@ -16,6 +16,7 @@
 
 #import "FBProfilePictureView.h"
 
+#import "FBCurrentUserStore.h"
 #import "FBProfilePictureViewBlankProfilePortraitPNG.h"
 #import "FBProfilePictureViewBlankProfileSquarePNG.h"
 #import "FBRequest.h"
@@ -25,8 +26,10 @@
 
 @interface FBProfilePictureView()
 
+@property (readonly, nonatomic) int imagePixelWidth;
 @property (readonly, nonatomic) NSString *imageQueryParamString;
 @property (retain, nonatomic) NSString *previousImageQueryParamString;
+@property (retain, nonatomic) NSURL *previousImageURL;
 
 @property (retain, nonatomic) FBURLConnection *connection;
 @property (retain, nonatomic) UIImageView *imageView;
@@ -34,6 +37,8 @@
 - (void)initialize;
 - (void)refreshImage:(BOOL)forceRefresh;
 - (void)ensureImageViewContentMode;
+- (NSURL *)imageURLWithQueryParamString:(NSString *)imageQueryParamString;
+- (void)handleCurrentUserStoreDidChange:(NSNotification *)notification;
 
 @end
 
@@ -44,14 +49,17 @@
 @synthesize connection = _connection;
 @synthesize imageView = _imageView;
 @synthesize previousImageQueryParamString = _previousImageQueryParamString;
+@synthesize previousImageURL = _previousImageURL;
 
 #pragma mark - Lifecycle
 
 - (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
     [_profileID release];
     [_imageView release];
     [_connection release];
     [_previousImageQueryParamString release];
+    [_previousImageURL release];
 
     [super dealloc];
 }
@@ -95,8 +103,7 @@
 
 #pragma mark -
 
-- (NSString *)imageQueryParamString  {
-
+- (int)imagePixelWidth {
     static CGFloat screenScaleFactor = 0.0;
     if (screenScaleFactor == 0.0) {
         screenScaleFactor = [[UIScreen mainScreen] scale];
@@ -104,7 +111,11 @@
 
     // Retina display doesn't increase the bounds that iOS returns.  The larger size to fetch needs
     // to be calculated using the scale factor accessed above.
-    int width = (int)(self.bounds.size.width * screenScaleFactor);
+    return (int)(self.bounds.size.width * screenScaleFactor);
+}
+
+- (NSString *)imageQueryParamString  {
+    int width = self.imagePixelWidth;
 
     if (self.pictureCropping == FBProfilePictureCroppingSquare) {
         return [NSString stringWithFormat:@"width=%d&height=%d&migration_bundle=%@",
@@ -139,6 +150,11 @@
     self.clipsToBounds = YES;
 
     [self addSubview:self.imageView];
+
+    [[NSNotificationCenter defaultCenter] addObserver:self
+                                             selector:@selector(handleCurrentUserStoreDidChange:)
+                                                 name:FBCurrentUserStoreDidChangeNotification
+                                               object:nil];
 }
 
 - (void)refreshImage:(BOOL)forceRefresh  {
@@ -169,17 +185,14 @@
                 }
             };
 
-        NSString *template = @"%@/%@/picture?%@";
-        NSString *urlString = [NSString stringWithFormat:template,
-                               [FBUtility buildFacebookUrlWithPre:@"https://graph."],
-                               self.profileID,
-                               newImageQueryParamString];
-        NSURL *url = [NSURL URLWithString:urlString];
+        NSURL *url = [self imageURLWithQueryParamString:newImageQueryParamString];
+        self.previousImageURL = url;
 
         self.connection = [[[FBURLConnection alloc] initWithURL:url
                                               completionHandler:handler]
                            autorelease];
     } else {
+        self.previousImageURL = nil;
         BOOL isSquare = (self.pictureCropping == FBProfilePictureCroppingSquare);
 
         self.imageView.image = isSquare ?
@@ -191,6 +204,25 @@
     self.previousImageQueryParamString = newImageQueryParamString;
 }
 
+- (NSURL *)imageURLWithQueryParamString:(NSString *)imageQueryParamString {
+    // The current user's picture URL is already known to the store, which saves the
+    // redirect through graph; it is square and large enough for most views.
+    if (self.pictureCropping == FBProfilePictureCroppingSquare) {
+        NSURL *url = [[FBCurrentUserStore sharedStore] pictureURLForProfileID:self.profileID
+                                                                   pixelWidth:self.imagePixelWidth];
+        if (url) {
+            return url;
+        }
+    }
+
+    NSString *template = @"%@/%@/picture?%@";
+    NSString *urlString = [NSString stringWithFormat:template,
+                           [FBUtility buildFacebookUrlWithPre:@"https://graph."],
+                           self.profileID,
+                           imageQueryParamString];
+    return [NSURL URLWithString:urlString];
+}
+
 - (void)ensureImageViewContentMode {
     // Set the image's contentMode such that if the image is larger than the control, we scale it down, preserving aspect
     // ratio.  Otherwise, we center it.  This ensures that we never scale up, and pixellate, the image.
@@ -211,6 +243,18 @@
     self.imageView.contentMode = contentMode;
 }
 
+- (void)handleCurrentUserStoreDidChange:(NSNotification *)notification {
+    FBCurrentUserStore *store = notification.object;
+    if ([notification.userInfo objectForKey:FBCurrentUserStoreErrorKey] == nil &&
+        self.profileID && [self.profileID isEqualToString:store.user.id]) {
+        // the store posts for every fetch; only reload if the picture actually moved
+        NSURL *url = [self imageURLWithQueryParamString:self.imageQueryParamString];
+        if (![url isEqual:self.previousImageURL]) {
+            [self refreshImage:YES];
+        }
+    }
+}
+
 - (void)setProfileID:(NSString*)profileID {
     if (!_profileID || ![_profileID isEqualToString:profileID]) {
         [_profileID release];
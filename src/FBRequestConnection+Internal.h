@@ -16,6 +16,7 @@
 
 #import "FBRequestConnection.h"
 #import "FBRequestMetadata.h"
+#import "FBURLConnection.h"
 
 @class FBRequestConnectionRetryManager;
 
@@ -24,6 +25,8 @@
 @property (nonatomic, readonly) BOOL isResultFromCache;
 @property (nonatomic, readonly) NSMutableArray *requests;
 @property (nonatomic, readonly) FBRequestConnectionRetryManager *retryManager;
+// Priority of the underlying FBURLConnection; defaults to FBURLConnectionPriorityUserInitiated.
+@property (nonatomic) FBURLConnectionPriority urlConnectionPriority;
 
 - (id)initWithMetadata:(NSArray *)metadataArray;
 
@@ -32,4 +35,12 @@
 
 - (FBRequestMetadata *) getRequestMetadata:(FBRequest *)request;
 
+- (NSArray *)parseJSONResponse:(NSData *)data
+                         error:(NSError **)error
+                    statusCode:(NSInteger)statusCode;
+
++ (void)addRequestToExtendTokenForSession:(FBSession*)session connection:(FBRequestConnection*)connection;
+
++ (void)addRequestToRefreshPermissionsSession:(FBSession*)session connection:(FBRequestConnection*)connection;
+
 @end
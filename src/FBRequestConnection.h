@@ -196,6 +196,21 @@ typedef void (^FBRequestHandler)(FBRequestConnection *connection,
 */
 @property (nonatomic, assign) FBRequestConnectionErrorBehavior errorBehavior;
 
+/*!
+ @abstract
+ The queue on which completion handlers are invoked.
+
+ @discussion
+ Defaults to NULL, meaning the main queue.  Setting a serial or concurrent queue
+ lets response processing stay off the main thread.  Session repair and token
+ extension are still done on the main thread, and when an errorBehavior is set,
+ handlers for failed requests are invoked on the main thread so that any alerts
+ can be shown.
+
+ This must be set before the connection is started.
+*/
+@property (nonatomic, assign) dispatch_queue_t completionQueue;
+
 /*!
  @methodgroup Adding requests
 */
@@ -23,6 +23,7 @@
 #import "FBError.h"
 #import "FBErrorUtility+Internal.h"
 #import "FBGraphObject.h"
+#import "FBGraphSnapshot.h"
 #import "FBLogger.h"
 #import "FBRequest+Internal.h"
 #import "FBRequestBody.h"
@@ -82,6 +83,7 @@ typedef enum FBRequestConnectionState {
 
 @interface FBRequestConnection () {
     BOOL _errorBehavior;
+    dispatch_queue_t _completionQueue;
 }
 
 @property (nonatomic, retain) FBURLConnection *connection;
@@ -95,6 +97,8 @@ typedef enum FBRequestConnectionState {
 @property (nonatomic) unsigned long requestStartTime;
 @property (nonatomic, readonly) BOOL isResultFromCache;
 @property (nonatomic, retain) FBRequestConnectionRetryManager *retryManager;
+@property (nonatomic) FBURLConnectionPriority urlConnectionPriority;
+@property (nonatomic, retain) NSURL *cacheIdentityURL;
 
 @end
 
@@ -143,6 +147,24 @@ typedef enum FBRequestConnectionState {
     _errorBehavior = errorBehavior;
 }
 
+- (dispatch_queue_t)completionQueue
+{
+    return _completionQueue;
+}
+
+- (void)setCompletionQueue:(dispatch_queue_t)completionQueue
+{
+    NSAssert(self.state == kStateCreated || self.state == kStateSerialized,
+             @"Cannot set completionQueue after starting or cancelling.");
+    if (completionQueue) {
+        dispatch_retain(completionQueue);
+    }
+    if (_completionQueue) {
+        dispatch_release(_completionQueue);
+    }
+    _completionQueue = completionQueue;
+}
+
 // ----------------------------------------------------------------------------
 // Lifetime
 
@@ -184,6 +206,10 @@ typedef enum FBRequestConnectionState {
     [_deprecatedRequest release];
     [_logger release];
     [_retryManager release];
+    [_cacheIdentityURL release];
+    if (_completionQueue) {
+        dispatch_release(_completionQueue);
+    }
 
     [super dealloc];
 }
@@ -425,6 +451,7 @@ typedef enum FBRequestConnectionState {
             cachedData = [[FBDataDiskCache sharedCache] dataForURL:cacheIdentityURL];
         }
     }
+    self.cacheIdentityURL = cacheIdentityURL;
 
     if (self.internalUrlRequest == nil && !cacheIdentity) {
         // If we have all Graph API calls, see if we want to piggyback any internal calls onto
@@ -467,14 +494,8 @@ typedef enum FBRequestConnectionState {
           NSError *error,
           NSURLResponse *response,
           NSData *responseData) {
-            // cache this data if we have successful response and a cache identity to work with
-            if (cacheIdentityURL &&
-                [response isKindOfClass:[NSHTTPURLResponse class]] &&
-                ((NSHTTPURLResponse*)response).statusCode == 200) {
-                [[FBDataDiskCache sharedCache] setData:responseData
-                                                forURL:cacheIdentityURL];
-            }
-            // complete on result from round-trip to server
+            // complete on result from round-trip to server; successful results
+            // are cached there once parsed, if we have a cache identity
             [self completeWithResponse:response
                                   data:responseData
                                orError:error];
@@ -489,11 +510,17 @@ typedef enum FBRequestConnectionState {
     } else {
         _isResultFromCache = YES;
 
-        // complete on result from cache
-        [self completeWithResponse:nil
-                              data:cachedData
-                           orError:nil];
-
+        // complete on result from cache, but never from within start: callers
+        // expect to finish their own bookkeeping before any handler runs, and
+        // may cancel meanwhile, in which case the result is dropped
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (self.state == kStateCancelled) {
+                return;
+            }
+            [self completeWithResponse:nil
+                                  data:cachedData
+                               orError:nil];
+        });
     }
 }
 
@@ -502,6 +529,8 @@ typedef enum FBRequestConnectionState {
                     completionHandler:(FBURLConnectionHandler) handler {
     FBURLConnection *connection = [[self newFBURLConnection] initWithRequest:request
                                                           skipRoundTripIfCached:skipRoundTripIfCached
+                                                                       priority:self.urlConnectionPriority
+                                                                  callbackQueue:nil
                                                               completionHandler:handler];
     self.connection = connection;
     [connection release];
@@ -938,10 +967,31 @@ typedef enum FBRequestConnectionState {
 
 
     NSArray *results = nil;
-    if (!error) {
+    FBGraphSnapshot *snapshot = nil;
+    if (!error && !response && [FBGraphSnapshot isSnapshotData:data]) {
+        // results cached as a snapshot are read in place, without parsing
+        snapshot = [[[FBGraphSnapshot alloc] initWithData:data] autorelease];
+        id rootObject = snapshot.rootObject;
+        if ([rootObject isKindOfClass:[NSArray class]]) {
+            results = rootObject;
+        } else {
+            error = [self errorWithCode:FBErrorProtocolMismatch
+                             statusCode:statusCode
+                     parsedJSONResponse:nil
+                             innerError:nil
+                                message:nil];
+        }
+    } else if (!error) {
         results = [self parseJSONResponse:data
                                     error:&error
                                statusCode:statusCode];
+
+        // cache this data if we have successful response and a cache identity to work with
+        if (!error && self.cacheIdentityURL && statusCode == 200) {
+            NSData *snapshotData = [FBGraphSnapshot dataWithJSONObject:results];
+            [[FBDataDiskCache sharedCache] setData:(snapshotData ?: data)
+                                            forURL:self.cacheIdentityURL];
+        }
     }
 
     // the cached case has data but no response,
@@ -983,6 +1033,10 @@ typedef enum FBRequestConnectionState {
     [_logger emitToNSLog];
 
     if (self.deprecatedRequest) {
+        if (snapshot) {
+            // the raw response is only produced when someone asks for it
+            data = [self rawResponseDataWithResults:results];
+        }
         [self completeDeprecatedWithData:data results:results orError:error];
     } else {
         [self completeWithResults:results orError:error];
@@ -992,6 +1046,32 @@ typedef enum FBRequestConnectionState {
     self.urlResponse = (NSHTTPURLResponse *)response;
 }
 
+// Rebuilds the JSON the server sent for results that were read from a snapshot, in the
+// format parseJSONResponse: accepts.
+- (NSData *)rawResponseDataWithResults:(NSArray *)results
+{
+    id response = nil;
+    if ([self.requests count] == 1) {
+        response = [[results objectAtIndex:0] objectForKey:@"body"];
+    } else {
+        NSMutableArray *items = [NSMutableArray arrayWithCapacity:results.count];
+        for (id result in results) {
+            if (![result isKindOfClass:[NSDictionary class]]) {
+                [items addObject:result];
+                continue;
+            }
+            NSMutableDictionary *item = [NSMutableDictionary dictionaryWithDictionary:result];
+            id body = [result objectForKey:@"body"];
+            if (body) {
+                [item setObject:[FBUtility simpleJSONEncode:body] ?: @"" forKey:@"body"];
+            }
+            [items addObject:item];
+        }
+        response = items;
+    }
+    return [[FBUtility simpleJSONEncode:response] dataUsingEncoding:NSUTF8StringEncoding];
+}
+
 //
 // If there is one request, the JSON is the response.
 // If there are multiple requests, the JSON has an array of dictionaries whose
@@ -1173,14 +1253,86 @@ typedef enum FBRequestConnectionState {
     return request.canCloseSessionOnError && !request.session.isRepairing;
 }
 
+// Fast path for a batch in which every request succeeded: there is no session
+// to repair or close, so handlers are invoked directly rather than through a
+// task chain per request.  Returns NO, having done nothing, if any request
+// failed and the batch needs the full error handling below.
+- (BOOL)completeWithSuccessfulResults:(NSArray *)results
+{
+    NSUInteger count = [self.requests count];
+    NSMutableArray *bodies = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger i = 0; i < count; i++) {
+        id result = [results objectAtIndex:i];
+        if ([self errorFromResult:result]) {
+            return NO;
+        }
+
+        id body = nil;
+        if ([result isKindOfClass:[NSDictionary class]]) {
+            NSDictionary *resultDictionary = (NSDictionary *)result;
+            body = [FBGraphObject graphObjectWrappingDictionary:[resultDictionary objectForKey:@"body"]];
+        }
+        [bodies addObject:body ?: [NSNull null]];
+    }
+
+    // If we have not had the opportunity to piggyback a token-extension request,
+    // but we need to, the session's coordinator sends it separately.
+    NSMutableSet *sessions = [NSMutableSet set];
+    for (FBRequestMetadata *metadata in self.requests) {
+        if (metadata.request.session) {
+            [sessions addObject:metadata.request.session];
+        }
+    }
+
+    void (^invokeHandlers)(void) = ^{
+        for (NSUInteger i = 0; i < count; i++) {
+            FBRequestMetadata *metadata = [self.requests objectAtIndex:i];
+            id body = [bodies objectAtIndex:i];
+            [metadata invokeCompletionHandlerForConnection:self
+                                               withResults:(body == [NSNull null] ? nil : body)
+                                                     error:nil];
+        }
+    };
+
+    void (^finish)(void) = ^{
+        for (FBSession *session in sessions) {
+            [session.refreshCoordinator refreshIfNeeded];
+        }
+        [self.retryManager performRetries];
+    };
+
+    // Always dispatched, even when already on the main thread, so that handlers
+    // never run re-entrantly from the caller of start or the connection callback.
+    dispatch_async(self.completionQueue ?: dispatch_get_main_queue(), ^{
+        invokeHandlers();
+        if ([NSThread isMainThread]) {
+            finish();
+        } else {
+            dispatch_async(dispatch_get_main_queue(), finish);
+        }
+    });
+    return YES;
+}
+
 - (void)completeWithResults:(NSArray *)results
                     orError:(NSError *)error
 {
     // set up a new retry manager for this flow.
     self.retryManager = [[[FBRequestConnectionRetryManager alloc] initWithFBRequestConnection:self] autorelease];
 
+    if (!error && [self completeWithSuccessfulResults:results]) {
+        return;
+    }
+
+    // Automatic error handling may need to present UI, so it keeps handlers on the main thread.
+    dispatch_queue_t handlerQueue = dispatch_get_main_queue();
+    if (self.completionQueue && self.errorBehavior == FBRequestConnectionErrorBehaviorNone) {
+        handlerQueue = self.completionQueue;
+    }
+
     NSUInteger count = [self.requests count];
     NSMutableArray *tasks = [[NSMutableArray alloc] init];
+    NSMutableSet *sessions = [NSMutableSet set];
     for (NSUInteger i = 0; i < count; i++) {
         FBRequestMetadata *metadata = [self.requests objectAtIndex:i];
         id result = error ? nil : [results objectAtIndex:i];
@@ -1262,17 +1414,11 @@ typedef enum FBRequestConnectionState {
                 }
                 return [FBTask taskWithResult:nil];
             } queue:dispatch_get_main_queue()];
-        } else if ([metadata.request.session shouldExtendAccessToken]) {
+        } else if (metadata.request.session) {
             // If we have not had the opportunity to piggyback a token-extension request,
-            // but we need to, do so now as a separate request.
-            taskWork = [taskWork dependentTaskWithBlock:^id(FBTask *task) {
-                FBRequestConnection *connection = [[FBRequestConnection alloc] init];
-                [FBRequestConnection addRequestToExtendTokenForSession:metadata.request.session
-                                                            connection:connection];
-                [connection start];
-                [connection release];
-                return [FBTask taskWithResult:nil];
-            } queue:dispatch_get_main_queue()];
+            // but we need to, the session's coordinator sends it separately once the
+            // handlers have run.
+            [sessions addObject:metadata.request.session];
         }
 
         // Always invoke handler at the end.
@@ -1282,13 +1428,16 @@ typedef enum FBRequestConnectionState {
             }
             [metadata invokeCompletionHandlerForConnection:self withResults:body error:unpackedError];
             return [FBTask taskWithResult:nil];
-        } queue:dispatch_get_main_queue()];
+        } queue:handlerQueue];
         [tasks addObject:taskWork];
     } //end for loop
 
 
     FBTask *finalTask = [FBTask taskDependentOnTasks:tasks];
     [finalTask dependentTaskWithBlock:^id(FBTask *task) {
+        for (FBSession *session in sessions) {
+            [session.refreshCoordinator refreshIfNeeded];
+        }
         [self.retryManager performRetries];
         return [FBTask taskWithResult:nil];
     } queue:dispatch_get_main_queue()];
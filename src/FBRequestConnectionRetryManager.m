@@ -115,17 +115,20 @@
             }
             case FBRequestConnectionRetryManagerStateRepairSession : {
                 [_requestConnection retain];
-                NSThread *thread = self.sessionToReconnect.affinitizedThread ?: [NSThread mainThread];
-                FBSessionRequestPermissionResultHandler handler = [[^(FBSession *session, NSError *sessionError) {
+                FBSessionRequestPermissionResultHandler handler = ^(FBSession *session, NSError *sessionError) {
                     if (session.isOpen && !sessionError) {
                         [self repairSuccess];
                     } else {
                         [self repairFailed];
                     }
                     [_requestConnection release];
-                } copy] autorelease];
+                };
 
-                [self.sessionToReconnect performSelector:@selector(repairWithHandler:) onThread:thread withObject:handler waitUntilDone:NO];
+                // The session can be used from any thread, but repairing it may show login UI
+                FBSession *session = self.sessionToReconnect;
+                dispatch_async(dispatch_get_main_queue(), ^{
+                    [session repairWithHandler:handler];
+                });
 
                 break;
             }
@@ -16,6 +16,7 @@
 
 #import "FBSession.h"
 #import "FBSessionAppEventsState.h"
+#import "FBSessionRefreshCoordinator.h"
 #import "FBSystemAccountStoreAdapter.h"
 
 extern NSString *const FBLoginUXClientState;
@@ -33,15 +34,17 @@ extern NSString *const FacebookNativeApplicationLoginDomain;
 
 @property (readonly) FBSessionDefaultAudience lastRequestedSystemAudience;
 @property (readonly, retain) FBSessionAppEventsState *appEventsState;
-@property (readonly) NSThread *affinitizedThread;
+@property (readonly, retain) FBSessionRefreshCoordinator *refreshCoordinator;
 @property (atomic, readonly) BOOL isRepairing;
 
 - (void)refreshAccessToken:(NSString*)token expirationDate:(NSDate*)expireDate;
 - (BOOL)shouldExtendAccessToken;
+- (BOOL)canExtendAccessTokenData:(FBAccessTokenData *)tokenData;
 - (BOOL)shouldRefreshPermissions;
 - (void)refreshPermissions:(NSArray *)permissions;
 - (void)closeAndClearTokenInformation:(NSError*) error;
-- (void)clearAffinitizedThread;
+// Reads state and token together, as a single transition left them.
+- (FBSessionState)stateAndAccessTokenData:(FBAccessTokenData **)accessTokenData;
 
 + (FBSession*)activeSessionIfExists;
 
@@ -36,10 +36,10 @@ extern NSString *const FBSessionDidSetActiveSessionNotification;
 /*! NSNotificationCenter name indicating that an active session was unset */
 extern NSString *const FBSessionDidUnsetActiveSessionNotification;
 
-/*! NSNotificationCenter name indicating that the active session is open */
+/*! NSNotificationCenter name indicating that the active session is open; posted on the main thread */
 extern NSString *const FBSessionDidBecomeOpenActiveSessionNotification;
 
-/*! NSNotificationCenter name indicating that there is no longer an open active session */
+/*! NSNotificationCenter name indicating that there is no longer an open active session; posted on the main thread */
 extern NSString *const FBSessionDidBecomeClosedActiveSessionNotification;
 
 /*!
@@ -234,6 +234,16 @@ typedef void (^FBSessionRenewSystemCredentialsHandler)(ACAccountCredentialRenewR
  back in the course of state transitions for the session (e.g. login or session closed).
 
  2. The object supports Key-Value Observing (KVO) for property changes.
+
+ The session's state, token and permissions may be read, and requests prepared with it, from any
+ thread. State changes are serialized, and handlers are called on the thread that caused the change
+ unless a <handlerQueue> is set.
+
+ KVO notifications for state changes are sent synchronously on the thread that caused the change,
+ while the change is in progress, so observers that update views must hop to the main thread
+ themselves, and must not wait on work that changes the session from another thread.
+ `FBSessionDidBecomeOpenActiveSessionNotification` and `FBSessionDidBecomeClosedActiveSessionNotification`
+ are posted on the main thread once the change has completed.
  */
 @interface FBSession : NSObject
 
@@ -359,6 +369,17 @@ __attribute__((deprecated));
 @property (readonly, copy) NSDictionary *parameters;
 /*! @abstract Gets the redirectUri for the session */
 @property (readonly, copy) NSString *redirectUri;
+
+/*!
+ @abstract
+ The queue on which state change and permission request handlers are invoked.
+
+ @discussion
+ Defaults to NULL, meaning handlers are invoked synchronously on the thread that caused the
+ state change.  When set, handlers are invoked asynchronously on this queue, and receive the
+ state the session had right after the change.  KVO notifications are not affected.
+*/
+@property (nonatomic, assign) dispatch_queue_t handlerQueue;
 /*!
  @methodgroup Instance methods
  */
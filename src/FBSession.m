@@ -20,6 +20,7 @@
 #import <Accounts/Accounts.h>
 #import <Foundation/Foundation.h>
 #import <UIKit/UIDevice.h>
+#import <pthread.h>
 
 #import "FBAccessTokenData+Internal.h"
 #import "FBAppBridge.h"
@@ -29,6 +30,7 @@
 #import "FBDataDiskCache.h"
 #import "FBDialogs+Internal.h"
 #import "FBError.h"
+#import "FBFrictionlessRequestSettings.h"
 #import "FBLogger.h"
 #import "FBLoginDialog.h"
 #import "FBLoginDialogParams.h"
@@ -86,8 +88,6 @@ static NSString *const FBaccessTokenPropertyName = @"accessToken";
 static NSString *const FBexpirationDatePropertyName = @"expirationDate";
 static NSString *const FBaccessTokenDataPropertyName = @"accessTokenData";
 
-static int const FBTokenExtendThresholdSeconds = 24 * 60 * 60;  // day
-static int const FBTokenRetryExtendSeconds = 60 * 60;           // hour
 
 // the following constant strings are used as keys into response url parameters during authorization flow
 
@@ -104,6 +104,19 @@ static FBSession *g_activeSession = nil;
     // public-property ivars
     NSString *_urlSchemeSuffix;
 
+    // state and token may be read from any thread, and are only accessed under _stateLock; a
+    // mutex rather than a spin lock, since readers at different priorities must not starve its holder
+    pthread_mutex_t _stateLock;
+    FBSessionState _state;
+    FBAccessTokenData *_accessTokenData;
+    // serializes state transitions and token updates, which may also come from any thread;
+    // taken with lockTransitions and released with unlockTransitions
+    NSRecursiveLock *_transitionLock;
+    NSUInteger _transitionDepth;
+    // active session notifications raised under _transitionLock, posted once it is released
+    NSMutableArray *_pendingNotificationNames;
+    dispatch_queue_t _handlerQueue;
+
     // private property and non-property ivars
     BOOL _isInStateTransition;
     FBSessionLoginType _loginTypeOfPendingOpenUrlCallback;
@@ -128,14 +141,12 @@ static FBSession *g_activeSession = nil;
 
 // private properties
 @property (readwrite, retain) FBSessionTokenCachingStrategy *tokenCachingStrategy;
-@property (readwrite, copy) NSDate *attemptedRefreshDate;
-@property (readwrite, copy) NSDate *attemptedPermissionsRefreshDate;
 @property (readwrite, copy) FBSessionStateHandler loginHandler;
 @property (readwrite, copy) FBSessionRequestPermissionResultHandler reauthorizeHandler;
 @property (readonly) NSString *appBaseUrl;
 @property (readwrite, retain) FBLoginDialog *loginDialog;
-@property (readwrite, retain) NSThread *affinitizedThread;
 @property (readwrite, retain) FBSessionAppEventsState *appEventsState;
+@property (readwrite, retain) FBSessionRefreshCoordinator *refreshCoordinator;
 @property (readwrite, retain) FBSessionAuthLogger *authLogger;
 
 @property (readwrite, copy) NSString *code;
@@ -217,10 +228,10 @@ static FBSession *g_activeSession = nil;
         _defaultDefaultAudience = defaultAudience;
         _appEventsState = [[FBSessionAppEventsState alloc] init];
 
-        _attemptedRefreshDate = [[NSDate distantPast] copy];
-        _attemptedPermissionsRefreshDate = [[NSDate distantPast] copy];
+        _refreshCoordinator = [[FBSessionRefreshCoordinator alloc] initWithSession:self];
+        pthread_mutex_init(&_stateLock, NULL);
         _state = FBSessionStateCreated;
-        _affinitizedThread = [[NSThread currentThread] retain];
+        _transitionLock = [[NSRecursiveLock alloc] init];
 
         [FBLogger registerCurrentTime:FBLoggingBehaviorPerformanceCharacteristics
                               withTag:self];
@@ -257,8 +268,8 @@ static FBSession *g_activeSession = nil;
 
 - (void)dealloc {
     [_loginDialog release];
-    [_attemptedRefreshDate release];
-    [_attemptedPermissionsRefreshDate release];
+    [_refreshCoordinator invalidate];
+    [_refreshCoordinator release];
     [_accessTokenData release];
     [_reauthorizeHandler release];
     [_loginHandler release];
@@ -266,7 +277,12 @@ static FBSession *g_activeSession = nil;
     [_urlSchemeSuffix release];
     [_initializedPermissions release];
     [_tokenCachingStrategy release];
-    [_affinitizedThread release];
+    [_transitionLock release];
+    [_pendingNotificationNames release];
+    pthread_mutex_destroy(&_stateLock);
+    if (_handlerQueue) {
+        dispatch_release(_handlerQueue);
+    }
     [_appEventsState release];
     [_authLogger release];
     [_code release];
@@ -277,9 +293,53 @@ static FBSession *g_activeSession = nil;
 
 #pragma mark - Public Properties
 
+- (FBSessionState)state {
+    pthread_mutex_lock(&_stateLock);
+    FBSessionState state = _state;
+    pthread_mutex_unlock(&_stateLock);
+    return state;
+}
+
+- (void)setState:(FBSessionState)state {
+    pthread_mutex_lock(&_stateLock);
+    _state = state;
+    pthread_mutex_unlock(&_stateLock);
+}
+
+- (FBAccessTokenData *)accessTokenData {
+    pthread_mutex_lock(&_stateLock);
+    FBAccessTokenData *accessTokenData = [_accessTokenData retain];
+    pthread_mutex_unlock(&_stateLock);
+    return [accessTokenData autorelease];
+}
+
+- (void)setAccessTokenData:(FBAccessTokenData *)accessTokenData {
+    FBAccessTokenData *newAccessTokenData = [accessTokenData copy];
+    pthread_mutex_lock(&_stateLock);
+    FBAccessTokenData *oldAccessTokenData = _accessTokenData;
+    _accessTokenData = newAccessTokenData;
+    pthread_mutex_unlock(&_stateLock);
+    [oldAccessTokenData release];
+}
+
+- (dispatch_queue_t)handlerQueue {
+    return _handlerQueue;
+}
+
+- (void)setHandlerQueue:(dispatch_queue_t)handlerQueue {
+    if (handlerQueue) {
+        dispatch_retain(handlerQueue);
+    }
+    if (_handlerQueue) {
+        dispatch_release(_handlerQueue);
+    }
+    _handlerQueue = handlerQueue;
+}
+
 - (NSArray *)permissions {
-    if (self.accessTokenData) {
-        return self.accessTokenData.permissions;
+    FBAccessTokenData *accessTokenData = self.accessTokenData;
+    if (accessTokenData) {
+        return accessTokenData.permissions;
     } else {
         return self.initializedPermissions;
     }
@@ -298,8 +358,9 @@ static FBSession *g_activeSession = nil;
 }
 
 - (FBSessionLoginType) loginType {
-    if (self.accessTokenData) {
-        return self.accessTokenData.loginType;
+    FBAccessTokenData *accessTokenData = self.accessTokenData;
+    if (accessTokenData) {
+        return accessTokenData.loginType;
     } else {
         return FBSessionLoginTypeNone;
     }
@@ -328,8 +389,6 @@ static FBSession *g_activeSession = nil;
 - (void)openWithBehavior:(FBSessionLoginBehavior)behavior
        completionHandler:(FBSessionStateHandler)handler {
 
-    [self checkThreadAffinity];
-
     switch (behavior) {
         case FBSessionLoginBehaviorForcingWebView:
         case FBSessionLoginBehaviorUseSystemAccountIfPresent:
@@ -427,8 +486,6 @@ static FBSession *g_activeSession = nil;
 }
 
 - (void)close {
-    [self checkThreadAffinity];
-
     FBSessionState state;
     if (self.state == FBSessionStateCreatedOpening) {
         state = FBSessionStateClosedLoginFailed;
@@ -483,8 +540,6 @@ static FBSession *g_activeSession = nil;
 }
 
 - (BOOL)handleOpenURL:(NSURL *)url {
-    [self checkThreadAffinity];
-
     NSDictionary *params = [FBSessionUtility queryParamsFromLoginURL:url
                                                         appID:self.appID
                                               urlSchemeSuffix:self.urlSchemeSuffix];
@@ -533,7 +588,6 @@ static FBSession *g_activeSession = nil;
 }
 
 - (NSString*)urlSchemeSuffix {
-    [self checkThreadAffinity];
     return _urlSchemeSuffix ? _urlSchemeSuffix : @"";
 }
 
@@ -705,9 +759,59 @@ static FBSession *g_activeSession = nil;
 // `tokenData` will NOT be retained, it will be used to construct a
 // new instance - the difference is for things that should not change
 // if the session already had a token (e.g., loginType).
+// Transitions may come from any thread; they are serialized so that each sees the state the last left.
 - (BOOL)transitionToState:(FBSessionState)state
       withAccessTokenData:(FBAccessTokenData *)tokenData
               shouldCache:(BOOL)shouldCache {
+    [self lockTransitions];
+    @try {
+        return [self performTransitionToState:state
+                          withAccessTokenData:tokenData
+                                  shouldCache:shouldCache];
+    }
+    @finally {
+        [self unlockTransitions];
+    }
+}
+
+// Transitions hold _transitionLock, which handlers and KVO observers may re-enter. Notifications
+// raised meanwhile wait for the outermost holder to unlock, so that no observer runs with
+// the lock held, and are posted on the main thread, since observers update views.
+- (void)lockTransitions {
+    [_transitionLock lock];
+    _transitionDepth++;
+}
+
+- (void)unlockTransitions {
+    NSArray *notificationNames = nil;
+    if (--_transitionDepth == 0 && _pendingNotificationNames.count) {
+        notificationNames = [_pendingNotificationNames autorelease];
+        _pendingNotificationNames = nil;
+    }
+    [_transitionLock unlock];
+
+    for (NSString *name in notificationNames) {
+        if ([NSThread isMainThread]) {
+            [[NSNotificationCenter defaultCenter] postNotificationName:name object:self];
+        } else {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                [[NSNotificationCenter defaultCenter] postNotificationName:name object:self];
+            });
+        }
+    }
+}
+
+// Called under _transitionLock.
+- (void)postNotificationNameAfterTransition:(NSString *)name {
+    if (!_pendingNotificationNames) {
+        _pendingNotificationNames = [[NSMutableArray alloc] init];
+    }
+    [_pendingNotificationNames addObject:name];
+}
+
+- (BOOL)performTransitionToState:(FBSessionState)state
+             withAccessTokenData:(FBAccessTokenData *)tokenData
+                     shouldCache:(BOOL)shouldCache {
 
     // is this a valid transition?
     BOOL isValidTransition;
@@ -821,26 +925,35 @@ static FBSession *g_activeSession = nil;
         // token string and expiration date.
         // Note if we're opening for the first time, we always set permissions refresh date to distantPast
         // to force a permissions refresh piggyback with the next request.
+        FBAccessTokenData *fbAccessToken = nil;
         if (tokenData.accessToken) {
-            FBAccessTokenData *fbAccessToken = [FBAccessTokenData createTokenFromString:tokenData.accessToken
-                                                                            permissions:tokenData.permissions
-                                                                         expirationDate:tokenData.expirationDate
-                                                                              loginType:loginTypeUpdated
-                                                                            refreshDate:tokenData.refreshDate
-                                                                 permissionsRefreshDate:changingIsOpen ? [NSDate distantPast] : tokenData.permissionsRefreshDate];
-            self.accessTokenData = fbAccessToken;
-        } else {
-            self.accessTokenData = nil;
+            fbAccessToken = [FBAccessTokenData createTokenFromString:tokenData.accessToken
+                                                         permissions:tokenData.permissions
+                                                      expirationDate:tokenData.expirationDate
+                                                           loginType:loginTypeUpdated
+                                                         refreshDate:tokenData.refreshDate
+                                              permissionsRefreshDate:changingIsOpen ? [NSDate distantPast] : tokenData.permissionsRefreshDate];
         }
-    }
 
-    // change the actual state
-    // note: we should not inject any callbacks between this and the token/date changes above
-    self.state = state;
+        // change the token and the actual state together
+        [self setState:state accessTokenData:fbAccessToken];
+    } else {
+        // change the actual state
+        self.state = state;
+    }
 
     // ... to here -- if YES
     _isInStateTransition = NO;
 
+    // keep the token fresh in the background while open, rather than waiting for a request to need it
+    if (FB_ISSESSIONOPENWITHSTATE(state)) {
+        if (changingIsOpen || changingTokenAndDate) {
+            [self.refreshCoordinator scheduleProactiveRefresh];
+        }
+    } else if (changingIsOpen) {
+        [self.refreshCoordinator cancelProactiveRefresh];
+    }
+
     if (changingTokenAndDate) {
         // update the cache
         if (shouldCache) {
@@ -859,14 +972,12 @@ static FBSession *g_activeSession = nil;
     }
     [self didChangeValueForKey:FBstatusPropertyName];
 
-    // if we are the active session, and we changed is-valid, notify
+    // if we are the active session, and we changed is-valid, notify once the transition is done
     if (changingIsOpen && g_activeSession == self) {
         if (FB_ISSESSIONOPENWITHSTATE(state)) {
-            [[NSNotificationCenter defaultCenter] postNotificationName:FBSessionDidBecomeOpenActiveSessionNotification
-                                                                object:self];
+            [self postNotificationNameAfterTransition:FBSessionDidBecomeOpenActiveSessionNotification];
         } else {
-            [[NSNotificationCenter defaultCenter] postNotificationName:FBSessionDidBecomeClosedActiveSessionNotification
-                                                                object:self];
+            [self postNotificationNameAfterTransition:FBSessionDidBecomeClosedActiveSessionNotification];
         }
     }
 
@@ -885,6 +996,17 @@ static FBSession *g_activeSession = nil;
 // if the session already had a token (e.g., loginType).
 - (BOOL)transitionToState:(FBSessionState)state
       withCode:(NSString *)code {
+    [self lockTransitions];
+    @try {
+        return [self performTransitionToState:state withCode:code];
+    }
+    @finally {
+        [self unlockTransitions];
+    }
+}
+
+- (BOOL)performTransitionToState:(FBSessionState)state
+                        withCode:(NSString *)code {
     
     // is this a valid transition?
     BOOL isValidTransition;
@@ -985,14 +1107,12 @@ static FBSession *g_activeSession = nil;
     }
     [self didChangeValueForKey:FBstatusPropertyName];
     
-    // if we are the active session, and we changed is-valid, notify
+    // if we are the active session, and we changed is-valid, notify once the transition is done
     if (changingIsOpen && g_activeSession == self) {
         if (FB_ISSESSIONOPENWITHSTATE(state)) {
-            [[NSNotificationCenter defaultCenter] postNotificationName:FBSessionDidBecomeOpenActiveSessionNotification
-                                                                object:self];
+            [self postNotificationNameAfterTransition:FBSessionDidBecomeOpenActiveSessionNotification];
         } else {
-            [[NSNotificationCenter defaultCenter] postNotificationName:FBSessionDidBecomeClosedActiveSessionNotification
-                                                                object:self];
+            [self postNotificationNameAfterTransition:FBSessionDidBecomeClosedActiveSessionNotification];
         }
     }
     
@@ -1829,7 +1949,10 @@ static FBSession *g_activeSession = nil;
             // be treated as errors (i.e., we do not support queueing
             // until the repair is resolved).
             if (handler) {
-                handler(self, [NSError errorWithDomain:FacebookSDKDomain code:FBErrorSessionReconnectInProgess userInfo:nil]);
+                NSError *error = [NSError errorWithDomain:FacebookSDKDomain code:FBErrorSessionReconnectInProgess userInfo:nil];
+                [self performHandlerBlock:^{
+                    handler(self, error);
+                }];
             }
         }
     }
@@ -1903,21 +2026,21 @@ static FBSession *g_activeSession = nil;
                                 shouldCache:YES];
 }
 
+// Like `shouldRefreshPermissions`, a YES claims the extension for the next hour, across
+// all connections and threads, so you should only call this method if you are also
+// prepared to actually send the extension request.
 - (BOOL)shouldExtendAccessToken {
-    BOOL result = NO;
-    NSDate *now = [NSDate date];
-    BOOL isFacebookLogin = self.accessTokenData.loginType == FBSessionLoginTypeFacebookApplication
-                            || self.accessTokenData.loginType == FBSessionLoginTypeFacebookViaSafari
-                            || self.accessTokenData.loginType == FBSessionLoginTypeSystemAccount;
+    FBAccessTokenData *tokenData = self.accessTokenData;
+    return self.isOpen &&
+        [self canExtendAccessTokenData:tokenData] &&
+        [self.refreshCoordinator claimTokenExtensionWithRefreshDate:tokenData.refreshDate];
+}
 
-    if (self.isOpen &&
-        isFacebookLogin &&
-        [now timeIntervalSinceDate:self.attemptedRefreshDate] > FBTokenRetryExtendSeconds &&
-        [now timeIntervalSinceDate:self.accessTokenData.refreshDate] > FBTokenExtendThresholdSeconds) {
-        result = YES;
-        self.attemptedRefreshDate = now;
-    }
-    return result;
+// Only tokens from a Facebook login can be extended.
+- (BOOL)canExtendAccessTokenData:(FBAccessTokenData *)tokenData {
+    return tokenData.loginType == FBSessionLoginTypeFacebookApplication
+        || tokenData.loginType == FBSessionLoginTypeFacebookViaSafari
+        || tokenData.loginType == FBSessionLoginTypeSystemAccount;
 }
 
 // For simplicity, checking `shouldRefreshPermission` will toggle the flag
@@ -1925,48 +2048,56 @@ static FBSession *g_activeSession = nil;
 // will return NO. Therefore, you should only call this method if you are also
 // prepared to actually `refreshPermissions`.
 - (BOOL)shouldRefreshPermissions {
-    @synchronized(self.attemptedPermissionsRefreshDate) {
-        NSDate *now = [NSDate date];
-
-        if (self.isOpen &&
-            // Share the same thresholds as the access token string for convenience, we may change in the future.
-            [now timeIntervalSinceDate:self.attemptedPermissionsRefreshDate] > FBTokenRetryExtendSeconds &&
-            [now timeIntervalSinceDate:self.accessTokenData.permissionsRefreshDate] > FBTokenExtendThresholdSeconds) {
-            self.attemptedPermissionsRefreshDate = now;
-            return YES;
-        }
-    }
-    return NO;
+    return self.isOpen &&
+        [self.refreshCoordinator claimPermissionsRefreshWithRefreshDate:self.accessTokenData.permissionsRefreshDate];
 }
 
 - (void)refreshPermissions:(NSArray *)permissions {
     NSDate *now = [NSDate date];
-    FBAccessTokenData *tokenData = [FBAccessTokenData createTokenFromString:self.accessTokenData.accessToken
+    // hold off transitions so that a token replaced meanwhile is not overwritten with the old one
+    [self lockTransitions];
+    FBAccessTokenData *accessTokenData = self.accessTokenData;
+    FBAccessTokenData *tokenData = [FBAccessTokenData createTokenFromString:accessTokenData.accessToken
                                                                 permissions:permissions
-                                                             expirationDate:self.accessTokenData.expirationDate
-                                                                  loginType:self.accessTokenData.loginType
-                                                                refreshDate:self.accessTokenData.refreshDate
+                                                             expirationDate:accessTokenData.expirationDate
+                                                                  loginType:accessTokenData.loginType
+                                                                refreshDate:accessTokenData.refreshDate
                                                      permissionsRefreshDate:now];
-    self.attemptedPermissionsRefreshDate = now;
+    [self.refreshCoordinator permissionsRefreshedAtDate:now];
     // Note we intentionally do not notify KVO that `accessTokenData `is changing since
     // the implied contract is for that to only occur during state transitions.
     self.accessTokenData = tokenData;
-    [self.tokenCachingStrategy cacheFBAccessTokenData:self.accessTokenData];
-}
-
-// Internally accessed, so we can bind the affinitized thread later.
-- (void)clearAffinitizedThread {
-    self.affinitizedThread = nil;
-}
-
-- (void)checkThreadAffinity {
-
-    // Validate affinity, or, if not established, establish it.
-    if (self.affinitizedThread) {
-        NSAssert(self.affinitizedThread == [NSThread currentThread],
-                 @"FBSession: should only be used from a single thread");
+    [self unlockTransitions];
+    [self.tokenCachingStrategy cacheFBAccessTokenData:tokenData];
+}
+
+// Swaps state and token together, so that readers on other threads never see one without the other.
+- (void)setState:(FBSessionState)state accessTokenData:(FBAccessTokenData *)accessTokenData {
+    FBAccessTokenData *newAccessTokenData = [accessTokenData copy];
+    pthread_mutex_lock(&_stateLock);
+    _state = state;
+    FBAccessTokenData *oldAccessTokenData = _accessTokenData;
+    _accessTokenData = newAccessTokenData;
+    pthread_mutex_unlock(&_stateLock);
+    [oldAccessTokenData release];
+}
+
+- (FBSessionState)stateAndAccessTokenData:(FBAccessTokenData **)accessTokenData {
+    pthread_mutex_lock(&_stateLock);
+    FBSessionState state = _state;
+    FBAccessTokenData *currentAccessTokenData = [_accessTokenData retain];
+    pthread_mutex_unlock(&_stateLock);
+    *accessTokenData = [currentAccessTokenData autorelease];
+    return state;
+}
+
+// Calls `block` on the handler queue if there is one, or right away otherwise.
+- (void)performHandlerBlock:(void (^)(void))block {
+    dispatch_queue_t handlerQueue = self.handlerQueue;
+    if (handlerQueue) {
+        dispatch_async(handlerQueue, block);
     } else {
-        self.affinitizedThread = [NSThread currentThread];
+        block();
     }
 }
 
@@ -2022,69 +2153,85 @@ static FBSession *g_activeSession = nil;
                                     error:(NSError*)error
                                 tokenData:(FBAccessTokenData *)tokenData
                               shouldCache:(BOOL)shouldCache {
+    BOOL didTransition;
+    FBSessionState state;
+    FBSessionStateHandler handler;
+    FBSessionAuthLogger *authLogger;
 
-
-    // lets get the state transition out of the way
-    BOOL didTransition = [self transitionToState:status
-                             withAccessTokenData:tokenData
-                                     shouldCache:shouldCache];
-
-    NSString *authLoggerResult = FBSessionAuthLoggerResultError;
-    if (!error) {
-        authLoggerResult = ((status == FBSessionStateClosedLoginFailed) ?
-                            FBSessionAuthLoggerResultCancelled :
-                            FBSessionAuthLoggerResultSuccess);
-    } else if ([error.userInfo[FBErrorLoginFailedReason] isEqualToString:FBErrorLoginFailedReasonUserCancelledValue]) {
-        authLoggerResult = FBSessionAuthLoggerResultCancelled;
+    [self lockTransitions];
+    @try {
+        // lets get the state transition out of the way
+        didTransition = [self performTransitionToState:status
+                                   withAccessTokenData:tokenData
+                                           shouldCache:shouldCache];
+        handler = [self takeHandlerAfterTransition:didTransition state:&state authLogger:&authLogger];
+    }
+    @finally {
+        [self unlockTransitions];
     }
 
-    [self.authLogger logEndAuthWithResult:authLoggerResult error:error];
-    self.authLogger = nil; // Nil out the logger so there aren't any rogue events logged.
-
-    // if we are given a handler, we promise to call it once per transition from open to close
+    [self callHandler:handler
+           authLogger:authLogger
+afterTransitionToState:status
+        didTransition:didTransition
+                state:state
+                error:error];
+}
 
-    // note the retain message works the same as a copy because loginHandler was already declared
-    // as a copy property.
-    FBSessionStateHandler handler = [self.loginHandler retain];
+// helper to wrap-up handler callback and state-change
+- (void)transitionAndCallHandlerWithState:(FBSessionState)status
+                                    error:(NSError*)error
+                                code:(NSString *)code {
+    BOOL didTransition;
+    FBSessionState state;
+    FBSessionStateHandler handler;
+    FBSessionAuthLogger *authLogger;
 
+    [self lockTransitions];
     @try {
-        // the moment we transition to a terminal state, we release our handlers, and possibly fail-call reauthorize
-        if (didTransition && FB_ISSESSIONSTATETERMINAL(self.state)) {
-            self.loginHandler = nil;
-
-            NSError *error = [self errorLoginFailedWithReason:FBErrorReauthorizeFailedReasonSessionClosed
-                                                    errorCode:nil
-                                                   innerError:nil];
-            [self callReauthorizeHandlerAndClearState:error];
-        }
+        // lets get the state transition out of the way
+        didTransition = [self performTransitionToState:status
+                                              withCode:code];
+        handler = [self takeHandlerAfterTransition:didTransition state:&state authLogger:&authLogger];
+    }
+    @finally {
+        [self unlockTransitions];
+    }
 
-        // if we have a handler, call it and release our
-        // final retain on the handler
-        if (handler) {
+    [self callHandler:handler
+           authLogger:authLogger
+afterTransitionToState:status
+        didTransition:didTransition
+                state:state
+                error:error];
+}
 
-            // unsuccessful transitions don't change state and don't propagate the error object
-            handler(self,
-                    self.state,
-                    didTransition ? error : nil);
+// Called under _transitionLock right after a transition, so that the state reported is the one the
+// transition left. The moment we transition to a terminal state we release our handler, so that no
+// later transition can call it again.
+- (FBSessionStateHandler)takeHandlerAfterTransition:(BOOL)didTransition
+                                              state:(FBSessionState *)state
+                                         authLogger:(FBSessionAuthLogger **)authLogger {
+    *state = self.state;
 
-        }
-    }
-    @finally {
-        // now release our stack reference
-        [handler release];
+    // note the retain message works the same as a copy because loginHandler was already declared
+    // as a copy property.
+    FBSessionStateHandler handler = [[self.loginHandler retain] autorelease];
+    if (didTransition && FB_ISSESSIONSTATETERMINAL(*state)) {
+        self.loginHandler = nil;
     }
+
+    *authLogger = [[self.authLogger retain] autorelease];
+    self.authLogger = nil; // Nil out the logger so there aren't any rogue events logged.
+    return handler;
 }
 
-// helper to wrap-up handler callback and state-change
-- (void)transitionAndCallHandlerWithState:(FBSessionState)status
-                                    error:(NSError*)error
-                                code:(NSString *)code {
-    
-    
-    // lets get the state transition out of the way
-    BOOL didTransition = [self transitionToState:status
-                             withCode:code];
-    
+- (void)callHandler:(FBSessionStateHandler)handler
+             authLogger:(FBSessionAuthLogger *)authLogger
+ afterTransitionToState:(FBSessionState)status
+          didTransition:(BOOL)didTransition
+                  state:(FBSessionState)state
+                  error:(NSError *)error {
     NSString *authLoggerResult = FBSessionAuthLoggerResultError;
     if (!error) {
         authLoggerResult = ((status == FBSessionStateClosedLoginFailed) ?
@@ -2093,41 +2240,23 @@ static FBSession *g_activeSession = nil;
     } else if ([error.userInfo[FBErrorLoginFailedReason] isEqualToString:FBErrorLoginFailedReasonUserCancelledValue]) {
         authLoggerResult = FBSessionAuthLoggerResultCancelled;
     }
-    
-    [self.authLogger logEndAuthWithResult:authLoggerResult error:error];
-    self.authLogger = nil; // Nil out the logger so there aren't any rogue events logged.
-    
-    // if we are given a handler, we promise to call it once per transition from open to close
-    
-    // note the retain message works the same as a copy because loginHandler was already declared
-    // as a copy property.
-    FBSessionStateHandler handler = [self.loginHandler retain];
-    
-    @try {
-        // the moment we transition to a terminal state, we release our handlers, and possibly fail-call reauthorize
-        if (didTransition && FB_ISSESSIONSTATETERMINAL(self.state)) {
-            self.loginHandler = nil;
-            
-            NSError *error = [self errorLoginFailedWithReason:FBErrorReauthorizeFailedReasonSessionClosed
-                                                    errorCode:nil
-                                                   innerError:nil];
-            [self callReauthorizeHandlerAndClearState:error];
-        }
-        
-        // if we have a handler, call it and release our
-        // final retain on the handler
-        if (handler) {
-            
-            // unsuccessful transitions don't change state and don't propagate the error object
-            handler(self,
-                    self.state,
-                    didTransition ? error : nil);
-            
-        }
+    [authLogger logEndAuthWithResult:authLoggerResult error:error];
+
+    // the moment we transition to a terminal state, we possibly fail-call reauthorize
+    if (didTransition && FB_ISSESSIONSTATETERMINAL(state)) {
+        NSError *error = [self errorLoginFailedWithReason:FBErrorReauthorizeFailedReasonSessionClosed
+                                                errorCode:nil
+                                               innerError:nil];
+        [self callReauthorizeHandlerAndClearState:error];
     }
-    @finally {
-        // now release our stack reference
-        [handler release];
+
+    // if we are given a handler, we promise to call it once per transition from open to close
+    if (handler) {
+        // unsuccessful transitions don't change state and don't propagate the error object
+        NSError *handlerError = didTransition ? error : nil;
+        [self performHandlerBlock:^{
+            handler(self, state, handlerError);
+        }];
     }
 }
 
@@ -2148,7 +2277,9 @@ static FBSession *g_activeSession = nil;
         self.reauthorizeHandler = nil;
 
         if (reauthorizeHandler) {
-            reauthorizeHandler(self, error);
+            [self performHandlerBlock:^{
+                reauthorizeHandler(self, error);
+            }];
         }
     }
     @finally {
@@ -2325,9 +2456,8 @@ static FBSession *g_activeSession = nil;
 }
 
 - (void)closeAndClearTokenInformation:(NSError*) error {
-    [self checkThreadAffinity];
-
     [[FBDataDiskCache sharedCache] removeDataForSession:self];
+    [FBFrictionlessRequestSettings removePersistedRecipientsForAppID:self.appID];
     [self.tokenCachingStrategy clearToken];
     
     [FBUtility deleteFacebookCookies];
@@ -2356,7 +2486,7 @@ static FBSession *g_activeSession = nil;
             [self.tokenCachingStrategy description],
             self.accessTokenData.expirationDate,
             self.accessTokenData.refreshDate,
-            self.attemptedRefreshDate,
+            self.refreshCoordinator.attemptedRefreshDate,
             [self.accessTokenData.permissions description]];
 }
 
@@ -31,8 +31,20 @@ extern NSString *const kFBAppEventIsImplicit;
 
 - (void)addEvent:(NSDictionary *)eventDictionary
       isImplicit:(BOOL)isImplicit;
-- (NSString *)jsonEncodeInFlightEvents:(BOOL)includeImplicitEvents;
+// Moves the accumulated events to the in-flight list and returns a snapshot of
+// the in-flight list, which can then be encoded without holding the lock.
+- (NSArray *)beginFlushingEvents;
 - (NSUInteger)getAccumulatedEventCount;
 - (void)clearInFlightAndStats;
 
+// UTF-8 JSON array of the given events (as returned by beginFlushingEvents),
+// potentially excluding those marked as implicit.  Returns nil if the
+// resultant set of events is empty.  Safe to call on any thread; large
+// batches are encoded in parallel.
++ (NSData *)jsonEncodeEvents:(NSArray *)events
+       includeImplicitEvents:(BOOL)includeImplicitEvents;
+// Returns the canonical instance of a frequently repeated string (event
+// names, app version), so events share it and the encoder can recognize it.
++ (NSString *)internedString:(NSString *)string;
+
 @end
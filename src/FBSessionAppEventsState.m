@@ -19,6 +19,119 @@
 
 NSString *const kFBAppEventIsImplicit = @"isImplicit";
 
+// Events per encoding chunk; larger flushes are split and encoded in parallel
+static const NSUInteger kEventsPerEncodingChunk = 128;
+
+// Bound on the number of interned strings, in case an app generates names
+static const NSUInteger kMaxInternedStrings = 512;
+
+static NSMutableSet *g_internedStrings;
+
+#pragma mark - JSON encoding
+
+static void appendBytes(NSMutableData *buffer, const char *bytes) {
+    [buffer appendBytes:bytes length:strlen(bytes)];
+}
+
+// Returns NO for strings that have no UTF-8 form (unpaired surrogates).
+static BOOL appendJSONString(NSMutableData *buffer, NSString *string) {
+    static const char hexDigits[] = "0123456789abcdef";
+
+    const unsigned char *bytes = (const unsigned char *)[string UTF8String];
+    if (!bytes) {
+        return NO;
+    }
+    NSUInteger length = [string lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+
+    appendBytes(buffer, "\"");
+    NSUInteger runStart = 0;
+    for (NSUInteger i = 0; i < length; i++) {
+        unsigned char c = bytes[i];
+        if (c != '"' && c != '\\' && c >= 0x20) {
+            continue;
+        }
+
+        [buffer appendBytes:bytes + runStart length:i - runStart];
+        runStart = i + 1;
+
+        if (c == '"') {
+            appendBytes(buffer, "\\\"");
+        } else if (c == '\\') {
+            appendBytes(buffer, "\\\\");
+        } else {
+            char escaped[] = { '\\', 'u', '0', '0', hexDigits[c >> 4], hexDigits[c & 0xF] };
+            [buffer appendBytes:escaped length:sizeof(escaped)];
+        }
+    }
+    [buffer appendBytes:bytes + runStart length:length - runStart];
+    appendBytes(buffer, "\"");
+    return YES;
+}
+
+// Strings seen before (keys, interned values) are looked up by identity and
+// their encoded form reused.
+static BOOL appendCachedJSONString(NSMutableData *buffer, NSString *string, NSMapTable *cache) {
+    NSData *encoded = [cache objectForKey:string];
+    if (!encoded) {
+        NSMutableData *encodedString = [NSMutableData dataWithCapacity:string.length + 2];
+        if (!appendJSONString(encodedString, string)) {
+            return NO;
+        }
+        [cache setObject:encodedString forKey:string];
+        encoded = encodedString;
+    }
+    [buffer appendData:encoded];
+    return YES;
+}
+
+// Appends the event as a JSON object.  Events only hold string and number
+// values; returns NO (leaving the buffer unspecified) for anything else.
+static BOOL appendJSONEvent(NSMutableData *buffer, NSDictionary *event, NSMapTable *cache, NSSet *internedStrings) {
+    appendBytes(buffer, "{");
+
+    BOOL first = YES;
+    for (NSString *key in event) {
+        if (![key isKindOfClass:[NSString class]]) {
+            return NO;
+        }
+
+        if (!first) {
+            appendBytes(buffer, ",");
+        }
+        first = NO;
+
+        if (!appendCachedJSONString(buffer, key, cache)) {
+            return NO;
+        }
+        appendBytes(buffer, ":");
+
+        id value = [event objectForKey:key];
+        if ([value isKindOfClass:[NSString class]]) {
+            BOOL appended = ([internedStrings member:value] == value) ?
+                appendCachedJSONString(buffer, value, cache) :
+                appendJSONString(buffer, value);
+            if (!appended) {
+                return NO;
+            }
+        } else if ([value isKindOfClass:[NSNumber class]]) {
+            if (CFGetTypeID(value) == CFBooleanGetTypeID()) {
+                appendBytes(buffer, [value boolValue] ? "true" : "false");
+            } else {
+                double doubleValue = [value doubleValue];
+                if (isnan(doubleValue) || isinf(doubleValue)) {
+                    return NO;
+                }
+                appendBytes(buffer, [[value stringValue] UTF8String]);
+            }
+        } else {
+            return NO;
+        }
+    }
+
+    appendBytes(buffer, "}");
+    return YES;
+}
+
 @interface FBSessionAppEventsState ()
 
 @property (readwrite, retain) NSMutableArray *accumulatedEvents;
@@ -65,6 +178,14 @@ const int MAX_ACCUMULATED_LOG_EVENTS                 = 1000;
     }
 }
 
+- (NSArray *)beginFlushingEvents {
+    @synchronized (self) {
+        [self.inFlightEvents addObjectsFromArray:self.accumulatedEvents];
+        [self.accumulatedEvents removeAllObjects];
+        return [[self.inFlightEvents copy] autorelease];
+    }
+}
+
 - (NSUInteger)getAccumulatedEventCount {
     @synchronized (self) {
         return self.accumulatedEvents.count;
@@ -78,29 +199,114 @@ const int MAX_ACCUMULATED_LOG_EVENTS                 = 1000;
     }
 }
 
-// JSON representation of the in-flight events, potentially excluding those marked as implicit.  Return
-// nil if the resultant set of events is empty.
-- (NSString *)jsonEncodeInFlightEvents:(BOOL)includeImplicitEvents {
++ (NSString *)internedString:(NSString *)string {
+    if (!string) {
+        return nil;
+    }
 
-    NSMutableArray *eventArray = [[NSMutableArray alloc] initWithCapacity:self.inFlightEvents.count];
+    @synchronized (self) {
+        if (!g_internedStrings) {
+            g_internedStrings = [[NSMutableSet alloc] init];
+        }
 
-    for (NSDictionary *eventAndImplicitFlag in self.inFlightEvents) {
+        NSString *interned = [g_internedStrings member:string];
+        if (!interned && g_internedStrings.count < kMaxInternedStrings) {
+            interned = [[string copy] autorelease];
+            [g_internedStrings addObject:interned];
+        }
+        return interned ?: string;
+    }
+}
+
++ (NSData *)jsonEncodeEvents:(NSArray *)events
+       includeImplicitEvents:(BOOL)includeImplicitEvents {
+
+    NSMutableArray *eventArray = [NSMutableArray arrayWithCapacity:events.count];
+    for (NSDictionary *eventAndImplicitFlag in events) {
         if (!includeImplicitEvents && [[eventAndImplicitFlag objectForKey:kFBAppEventIsImplicit] boolValue]) {
             continue;
         }
         [eventArray addObject:[eventAndImplicitFlag objectForKey:@"event"]];
     }
 
-    NSString *jsonEncodedEvents = nil;
-    if (eventArray.count != 0) {
-        jsonEncodedEvents = [FBUtility simpleJSONEncode:eventArray];
+    if (eventArray.count == 0) {
+        return nil;
     }
 
-    [eventArray release];
+    // Snapshot the interned strings so the workers can read them unlocked
+    NSSet *internedStrings = nil;
+    @synchronized (self) {
+        internedStrings = [[g_internedStrings copy] autorelease];
+    }
 
-    return jsonEncodedEvents;
-}
+    // Encode chunks in parallel, each into its own buffer.  A chunk that
+    // can't be encoded here leaves its slot nil; workers share nothing else.
+    size_t chunkCount = (eventArray.count + kEventsPerEncodingChunk - 1) / kEventsPerEncodingChunk;
+    NSMutableData **chunks = calloc(chunkCount, sizeof(NSMutableData *));
+
+    dispatch_apply(chunkCount, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t chunk) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        NSUInteger start = chunk * kEventsPerEncodingChunk;
+        NSUInteger end = MIN(start + kEventsPerEncodingChunk, eventArray.count);
 
+        NSMapTable *cache = [[NSMapTable alloc] initWithKeyOptions:NSPointerFunctionsObjectPointerPersonality
+                                                      valueOptions:NSPointerFunctionsStrongMemory
+                                                          capacity:64];
+        NSMutableData *buffer = [[NSMutableData alloc] initWithCapacity:(end - start) * 128];
+        for (NSUInteger i = start; i < end; i++) {
+            if (i > start) {
+                appendBytes(buffer, ",");
+            }
+            if (!appendJSONEvent(buffer, [eventArray objectAtIndex:i], cache, internedStrings)) {
+                [buffer release];
+                buffer = nil;
+                break;
+            }
+        }
+        chunks[chunk] = buffer;
+
+        [cache release];
+        [pool drain];
+    });
+
+    BOOL failed = NO;
+    for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+        if (!chunks[chunk]) {
+            failed = YES;
+        }
+    }
+
+    NSMutableData *result = nil;
+    if (!failed) {
+        NSUInteger totalLength = 2;
+        for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+            totalLength += chunks[chunk].length + 1;
+        }
+
+        result = [NSMutableData dataWithCapacity:totalLength];
+        appendBytes(result, "[");
+        for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+            if (chunk > 0) {
+                appendBytes(result, ",");
+            }
+            [result appendData:chunks[chunk]];
+        }
+        appendBytes(result, "]");
+    }
+
+    for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+        [chunks[chunk] release];
+    }
+    free(chunks);
+
+    if (failed) {
+        // Something other than a plain string/number event; let the general
+        // purpose encoder handle it.
+        return [[FBUtility simpleJSONEncode:eventArray] dataUsingEncoding:NSUTF8StringEncoding];
+    }
+
+    return result;
+}
 
 @end
 
@@ -0,0 +1,55 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+@class FBSession;
+
+/**
+ Internal class that owns token extension and permissions refresh for a particular FBSession.
+ An instance of this lives on FBSession.
+
+ At most one extension and one permissions refresh are claimed at a time, however many
+ connections ask, and the claim is checked and taken atomically so that connections
+ completing on different threads cannot each start their own. While the session is open,
+ a refresh is also scheduled for when the token becomes due, so that it is not sent
+ inline with (or piggybacked on) a user's request.
+ */
+@interface FBSessionRefreshCoordinator : NSObject
+
+@property (readonly, copy) NSDate *attemptedRefreshDate;
+@property (readonly, copy) NSDate *attemptedPermissionsRefreshDate;
+
+// The session is held by a zeroing weak reference; it owns this object and calls invalidate when it goes away.
+- (id)initWithSession:(FBSession *)session;
+
+// Return YES, and record the attempt, if the caller should send the corresponding request
+// now.  Once claimed, no one else gets YES until the retry interval has passed, so other
+// connections pick up the result through the session instead of sending their own.
+- (BOOL)claimTokenExtensionWithRefreshDate:(NSDate *)refreshDate;
+- (BOOL)claimPermissionsRefreshWithRefreshDate:(NSDate *)permissionsRefreshDate;
+
+// Marks the permissions as refreshed, e.g. by a response that carried them.
+- (void)permissionsRefreshedAtDate:(NSDate *)date;
+
+// Starts a standalone connection for whatever is due, if anything, and returns whether it did.
+- (BOOL)refreshIfNeeded;
+
+- (void)scheduleProactiveRefresh;
+- (void)cancelProactiveRefresh;
+- (void)invalidate;
+
+@end
@@ -0,0 +1,196 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "FBSessionRefreshCoordinator.h"
+
+#import <objc/runtime.h>
+
+#import "FBAccessTokenData.h"
+#import "FBRequestConnection+Internal.h"
+#import "FBSession+Internal.h"
+
+static NSTimeInterval const FBTokenExtendThresholdSeconds = 24 * 60 * 60;  // day
+static NSTimeInterval const FBTokenRetryExtendSeconds = 60 * 60;           // hour
+
+// Keeps a proactive refresh from going out alongside whatever opened the session.
+static NSTimeInterval const FBMinimumProactiveRefreshDelaySeconds = 10;
+
+@interface FBSessionRefreshCoordinator () {
+    // A zeroing weak reference, only accessed through objc_loadWeak/objc_storeWeak: the
+    // session can be released on any thread, and a plain retain of it from here could
+    // race with its dealloc.
+    FBSession *_session;
+    NSUInteger _scheduleGeneration;
+}
+
+@property (readwrite, copy) NSDate *attemptedRefreshDate;
+@property (readwrite, copy) NSDate *attemptedPermissionsRefreshDate;
+
+@end
+
+@implementation FBSessionRefreshCoordinator
+
+@synthesize attemptedRefreshDate = _attemptedRefreshDate;
+@synthesize attemptedPermissionsRefreshDate = _attemptedPermissionsRefreshDate;
+
+- (id)initWithSession:(FBSession *)session {
+    if ((self = [super init])) {
+        objc_storeWeak(&_session, session);
+        _attemptedRefreshDate = [[NSDate distantPast] copy];
+        _attemptedPermissionsRefreshDate = [[NSDate distantPast] copy];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    objc_storeWeak(&_session, nil);
+    [_attemptedRefreshDate release];
+    [_attemptedPermissionsRefreshDate release];
+    [super dealloc];
+}
+
+#pragma mark - Claims
+
+- (BOOL)claimTokenExtensionWithRefreshDate:(NSDate *)refreshDate {
+    @synchronized (self) {
+        NSDate *now = [NSDate date];
+        if ([now timeIntervalSinceDate:self.attemptedRefreshDate] > FBTokenRetryExtendSeconds &&
+            [now timeIntervalSinceDate:refreshDate] > FBTokenExtendThresholdSeconds) {
+            self.attemptedRefreshDate = now;
+            return YES;
+        }
+        return NO;
+    }
+}
+
+- (BOOL)claimPermissionsRefreshWithRefreshDate:(NSDate *)permissionsRefreshDate {
+    @synchronized (self) {
+        // Share the same thresholds as the access token string for convenience, we may change in the future.
+        NSDate *now = [NSDate date];
+        if ([now timeIntervalSinceDate:self.attemptedPermissionsRefreshDate] > FBTokenRetryExtendSeconds &&
+            [now timeIntervalSinceDate:permissionsRefreshDate] > FBTokenExtendThresholdSeconds) {
+            self.attemptedPermissionsRefreshDate = now;
+            return YES;
+        }
+        return NO;
+    }
+}
+
+- (void)permissionsRefreshedAtDate:(NSDate *)date {
+    @synchronized (self) {
+        self.attemptedPermissionsRefreshDate = date;
+    }
+}
+
+#pragma mark - Refreshing
+
+- (FBSession *)session {
+    // nil once the session has started deallocating
+    return objc_loadWeak(&_session);
+}
+
+- (BOOL)refreshIfNeeded {
+    FBSession *session = [self session];
+    if (!session.isOpen) {
+        return NO;
+    }
+
+    // Going through the session lets subclasses (e.g. test sessions) force or veto a refresh.
+    BOOL extendToken = [session shouldExtendAccessToken];
+    BOOL refreshPermissions = [session shouldRefreshPermissions];
+    if (!extendToken && !refreshPermissions) {
+        return NO;
+    }
+
+    FBRequestConnection *connection = [[FBRequestConnection alloc] init];
+    if (extendToken) {
+        [FBRequestConnection addRequestToExtendTokenForSession:session connection:connection];
+    }
+    if (refreshPermissions) {
+        [FBRequestConnection addRequestToRefreshPermissionsSession:session connection:connection];
+    }
+    [connection start];
+    [connection release];
+    return YES;
+}
+
+- (NSDate *)nextRefreshDate {
+    FBSession *session = [self session];
+    FBAccessTokenData *tokenData = session.accessTokenData;
+    if (!tokenData) {
+        return nil;
+    }
+
+    @synchronized (self) {
+        NSDate *permissionsDueDate = [[(tokenData.permissionsRefreshDate ?: [NSDate distantPast]) dateByAddingTimeInterval:FBTokenExtendThresholdSeconds]
+                                      laterDate:[self.attemptedPermissionsRefreshDate dateByAddingTimeInterval:FBTokenRetryExtendSeconds]];
+        // A token that can't be extended is never claimed, so it is never due.
+        if (![session canExtendAccessTokenData:tokenData]) {
+            return permissionsDueDate;
+        }
+        NSDate *tokenDueDate = [[(tokenData.refreshDate ?: [NSDate distantPast]) dateByAddingTimeInterval:FBTokenExtendThresholdSeconds]
+                                laterDate:[self.attemptedRefreshDate dateByAddingTimeInterval:FBTokenRetryExtendSeconds]];
+        return [tokenDueDate earlierDate:permissionsDueDate];
+    }
+}
+
+- (void)scheduleProactiveRefresh {
+    NSDate *refreshDate = [self nextRefreshDate];
+    if (!refreshDate) {
+        return;
+    }
+
+    NSUInteger generation;
+    @synchronized (self) {
+        generation = ++_scheduleGeneration;
+    }
+
+    // The thresholds are exclusive, so fire just after the due date.
+    NSTimeInterval delay = MAX([refreshDate timeIntervalSinceNow] + 1, FBMinimumProactiveRefreshDelaySeconds);
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        @synchronized (self) {
+            if (generation != _scheduleGeneration) {
+                return;
+            }
+        }
+
+        if (![self refreshIfNeeded]) {
+            // Something vetoed what looked due (e.g. a test session); count it as an attempt rather
+            // than waking up again every few seconds.
+            @synchronized (self) {
+                self.attemptedRefreshDate = [NSDate date];
+            }
+        }
+
+        // If the refresh failed, the session will not have been updated; try again after the retry interval.
+        [self scheduleProactiveRefresh];
+    });
+}
+
+- (void)cancelProactiveRefresh {
+    @synchronized (self) {
+        _scheduleGeneration++;
+    }
+}
+
+- (void)invalidate {
+    @synchronized (self) {
+        _scheduleGeneration++;
+    }
+    objc_storeWeak(&_session, nil);
+}
+
+@end
@@ -45,7 +45,24 @@ extern NSString *const FBLoggingBehaviorInformational;
 /*! Log errors likely to be preventable by the developer. This is in the default set of enabled logging behaviors. */
 extern NSString *const FBLoggingBehaviorDeveloperErrors;
 
+/*
+ * Keys of the dictionaries returned by <[FBSettings timingStatistics]>.  Durations are in msec.
+ */
+
+/*! The number of spans measured, an NSNumber */
+extern NSString *const FBTimingStatisticsCountKey;
+
+/*! The median duration, an NSNumber */
+extern NSString *const FBTimingStatisticsP50Key;
+
+/*! The 99th percentile duration, an NSNumber */
+extern NSString *const FBTimingStatisticsP99Key;
+
+/*! The longest duration, an NSNumber */
+extern NSString *const FBTimingStatisticsMaxKey;
+
 @class FBGraphObject;
+@protocol FBLogSink;
 
 /*!
  @typedef
@@ -99,6 +116,91 @@ typedef enum : NSUInteger {
  */
 + (void)setLoggingBehavior:(NSSet *)loggingBehavior;
 
+/*!
+ @method
+
+ @abstract Adds a sink that receives every log entry emitted for the enabled logging behaviors, for
+ example an FBFileLogSink. The sink is retained until it is removed.
+
+ @param sink The sink to add.
+ */
++ (void)addLogSink:(id<FBLogSink>)sink;
+
+/*!
+ @method
+
+ @abstract Removes a sink added with <[FBSettings addLogSink:]>.
+
+ @param sink The sink to remove.
+ */
++ (void)removeLogSink:(id<FBLogSink>)sink;
+
+/*!
+ @method
+
+ @abstract Retrieve whether log entries are also written to the system log with NSLog(). Defaults to YES.
+ */
++ (BOOL)logsToSystemLog;
+
+/*!
+ @method
+
+ @abstract Set whether log entries are also written to the system log with NSLog(). Turning this off with
+ a sink added keeps verbose logging out of the system log.
+
+ @param logsToSystemLog The desired value.
+ */
++ (void)setLogsToSystemLog:(BOOL)logsToSystemLog;
+
+/*!
+ @method
+
+ @abstract Retrieve whether the SDK measures the durations it logs under FBLoggingBehaviorPerformanceCharacteristics
+ even when that behavior is not enabled. Defaults to NO.
+ */
++ (BOOL)collectsTimingStatistics;
+
+/*!
+ @method
+
+ @abstract Set whether the SDK measures the durations it logs under FBLoggingBehaviorPerformanceCharacteristics
+ even when that behavior is not enabled, so that they show in <[FBSettings timingStatistics]>. Cheap enough to
+ leave on in production.
+
+ @param collectsTimingStatistics The desired value.
+ */
++ (void)setCollectsTimingStatistics:(BOOL)collectsTimingStatistics;
+
+/*!
+ @method
+
+ @abstract Retrieve the statistics of the durations measured so far, keyed by logging behavior. Each value is a
+ dictionary keyed by the FBTimingStatistics* constants.
+ */
++ (NSDictionary *)timingStatistics;
+
+/*!
+ @method
+
+ @abstract Starts timing a span identified by tag, for example to time an operation of the app alongside the
+ SDK's own. Spans started for a tag that already has spans open nest within them, and end innermost first.
+
+ @param tag An object identifying the span. It is used only for its address, and is not retained.
+ */
++ (void)beginTimingSpanWithTag:(id)tag;
+
+/*!
+ @method
+
+ @abstract Ends the innermost span open for tag, and adds its duration to the statistics of loggingBehavior.
+
+ @param tag               The object the span was started with.
+ @param loggingBehavior   The key under which the duration shows in <[FBSettings timingStatistics]>.
+
+ @return The duration of the span in seconds, or a negative number if no span was open for tag.
+ */
++ (NSTimeInterval)endTimingSpanWithTag:(id)tag loggingBehavior:(NSString *)loggingBehavior;
+
 /*! @abstract deprecated method */
 + (BOOL)shouldAutoPublishInstall __attribute__ ((deprecated));
 
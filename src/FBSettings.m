@@ -86,6 +86,46 @@ static NSUInteger g_betaFeatures = 0;
     g_loggingBehavior = newValue;
 }
 
++ (void)addLogSink:(id<FBLogSink>)sink {
+    [FBLogger addSink:sink];
+}
+
++ (void)removeLogSink:(id<FBLogSink>)sink {
+    [FBLogger removeSink:sink];
+}
+
++ (BOOL)logsToSystemLog {
+    return [FBLogger logsToSystemLog];
+}
+
++ (void)setLogsToSystemLog:(BOOL)logsToSystemLog {
+    [FBLogger setLogsToSystemLog:logsToSystemLog];
+}
+
++ (BOOL)collectsTimingStatistics {
+    return [FBLogger collectsTimingStatistics];
+}
+
++ (void)setCollectsTimingStatistics:(BOOL)collectsTimingStatistics {
+    [FBLogger setCollectsTimingStatistics:collectsTimingStatistics];
+}
+
++ (NSDictionary *)timingStatistics {
+    return [FBLogger timingStatistics];
+}
+
++ (void)beginTimingSpanWithTag:(id)tag {
+    [FBLogger beginTimingSpanWithTag:tag];
+}
+
++ (NSTimeInterval)endTimingSpanWithTag:(id)tag loggingBehavior:(NSString *)loggingBehavior {
+    NSTimeInterval duration = 0;
+    if (![FBLogger endTimingSpanWithTag:tag loggingBehavior:loggingBehavior duration:&duration]) {
+        return -1;
+    }
+    return duration;
+}
+
 + (NSString *)appVersion {
     return g_appVersion;
 }
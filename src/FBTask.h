@@ -56,6 +56,16 @@
  */
 + (FBTask *)taskWithDelay:(dispatch_time_t)delay;
 
+/*!
+ A queue that, when passed to `dependentTaskWithBlock:queue:` or
+ `completionTaskWithQueue:block:`, runs the block immediately on whichever
+ thread completes the task (or on the calling thread, if the task has already
+ completed) rather than dispatching it. Nesting is capped per thread; beyond
+ the cap blocks are dispatched to a global queue instead. Use it for short,
+ thread-agnostic blocks only.
+ */
++ (dispatch_queue_t)immediateQueue;
+
 // Properties that will be set on the task once it is completed.
 
 /*!
@@ -17,68 +17,126 @@
 #import "FBTask.h"
 
 #import <libkern/OSAtomic.h>
-
-#import "FBTaskCompletionSource.h"
+#import <pthread.h>
 
 __attribute__ ((noinline)) void logOperationOnMainThread() {
     NSLog(@"Warning: A long-running FBTask operation is being executed on the main thread. \n"
           " Break on logOperationOnMainThread() to debug.");
 }
 
+// A task moves from pending to completing exactly once (whoever wins the swap gets to
+// store the outcome), and then to completed once the outcome is visible to readers.
+enum {
+    FBTaskStatePending = 0,
+    FBTaskStateCompleting = 1,
+    FBTaskStateCompleted = 2,
+};
+
+// How many immediate continuations may run nested on one thread's stack before the
+// remainder are dispatched asynchronously instead.
+static const intptr_t kMaxImmediateContinuationDepth = 32;
+
+// Continuations waiting on a task are kept as an intrusive stack that is only ever
+// pushed onto, and then taken whole by the completing thread, so no locking is needed.
+typedef struct FBTaskContinuation {
+    struct FBTaskContinuation *next;
+    void (^block)(void);
+} FBTaskContinuation;
+
+// Marks the continuation stack of a completed task; nothing more can be pushed.
+static FBTaskContinuation *const kContinuationsClosed = (FBTaskContinuation *)(intptr_t)-1;
+
+static pthread_key_t g_immediateDepthKey;
+static dispatch_queue_t g_immediateQueue;
+
+static void runContinuationOnQueue(dispatch_queue_t queue, dispatch_block_t block) {
+    if (queue == g_immediateQueue) {
+        intptr_t depth = (intptr_t)pthread_getspecific(g_immediateDepthKey);
+        if (depth < kMaxImmediateContinuationDepth) {
+            pthread_setspecific(g_immediateDepthKey, (void *)(depth + 1));
+            block();
+            pthread_setspecific(g_immediateDepthKey, (void *)depth);
+            return;
+        }
+        queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+    }
+    dispatch_async(queue, block);
+}
+
 @interface FBTask () {
     id _result;
     NSError *_error;
     NSException *_exception;
     BOOL _cancelled;
+    volatile int32_t _state;
+    FBTaskContinuation *volatile _continuations;
 }
 
-@property (nonatomic, retain, readwrite) NSObject *lock;
-@property (nonatomic, retain, readwrite) NSCondition *condition;
-@property (nonatomic, assign, readwrite) BOOL completed;
-@property (nonatomic, retain, readwrite) NSMutableArray *callbacks;
+- (void)setResult:(id)result;
+- (void)setError:(NSError *)error;
+- (void)setException:(NSException *)exception;
+- (void)cancel;
+- (BOOL)trySetResult:(id)result;
+- (BOOL)trySetError:(NSError *)error;
+- (BOOL)trySetException:(NSException *)exception;
+- (BOOL)trySetCancelled;
+- (void)addContinuation:(void (^)(void))block;
+
 @end
 
 @implementation FBTask
 
-- (id)init {
-    if ((self = [super init])) {
-        _lock = [[NSObject alloc] init];
-        _condition = [[NSCondition alloc] init];
-        _callbacks = [[NSMutableArray array] retain];
++ (void)initialize {
+    if (self == [FBTask class]) {
+        pthread_key_create(&g_immediateDepthKey, NULL);
+        // Only ever compared against; continuations given this queue are never dispatched to it.
+        g_immediateQueue = dispatch_queue_create("com.facebook.sdk.FBTask.immediate", DISPATCH_QUEUE_SERIAL);
     }
-    return self;
 }
 
 - (void)dealloc {
-    [_lock release];
-    [_condition release];
-    [_callbacks release];
+    // A task that never completed may still hold continuations.
+    FBTaskContinuation *continuation = _continuations;
+    while (continuation && continuation != kContinuationsClosed) {
+        FBTaskContinuation *next = continuation->next;
+        [continuation->block release];
+        free(continuation);
+        continuation = next;
+    }
+
+    [_result release];
+    [_error release];
+    [_exception release];
 
     [super dealloc];
 }
 
++ (dispatch_queue_t)immediateQueue {
+    return g_immediateQueue;
+}
+
 + (FBTask *)taskWithResult:(id)result {
-    FBTaskCompletionSource *tcs = [FBTaskCompletionSource taskCompletionSource];
-    tcs.result = result;
-    return tcs.task;
+    FBTask *task = [[[FBTask alloc] init] autorelease];
+    [task trySetResult:result];
+    return task;
 }
 
 + (FBTask *)taskWithError:(NSError *)error {
-    FBTaskCompletionSource *tcs = [FBTaskCompletionSource taskCompletionSource];
-    tcs.error = error;
-    return tcs.task;
+    FBTask *task = [[[FBTask alloc] init] autorelease];
+    [task trySetError:error];
+    return task;
 }
 
 + (FBTask *)taskWithException:(NSException *)exception {
-    FBTaskCompletionSource *tcs = [FBTaskCompletionSource taskCompletionSource];
-    tcs.exception = exception;
-    return tcs.task;
+    FBTask *task = [[[FBTask alloc] init] autorelease];
+    [task trySetException:exception];
+    return task;
 }
 
 + (FBTask *)cancelledTask {
-    FBTaskCompletionSource *tcs = [FBTaskCompletionSource taskCompletionSource];
-    [tcs cancel];
-    return tcs.task;
+    FBTask *task = [[[FBTask alloc] init] autorelease];
+    [task trySetCancelled];
+    return task;
 }
 
 + (FBTask *)taskDependentOnTasks:(NSArray *)tasks {
@@ -87,30 +145,28 @@ __attribute__ ((noinline)) void logOperationOnMainThread() {
         return [FBTask taskWithResult:nil];
     }
 
-    FBTaskCompletionSource *tcs = [FBTaskCompletionSource taskCompletionSource];
-    for (FBTask *task in tasks) {
-        [task dependentTaskWithBlock:^id(FBTask *task) {
-            if (OSAtomicDecrement32(&total) == 0) {
-                tcs.result = nil;
+    // Every dependency decrements the one shared counter; no intermediate tasks are created.
+    FBTask *task = [[[FBTask alloc] init] autorelease];
+    for (FBTask *dependency in tasks) {
+        [dependency addContinuation:^{
+            if (OSAtomicDecrement32Barrier(&total) == 0) {
+                [task trySetResult:nil];
             }
-            return nil;
         }];
     }
-    return tcs.task;
+    return task;
 }
 
 + (FBTask *)taskWithDelay:(dispatch_time_t)delay {
-    FBTaskCompletionSource *tcs = [FBTaskCompletionSource taskCompletionSource];
+    FBTask *task = [[[FBTask alloc] init] autorelease];
     dispatch_after(delay, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(void){
-        tcs.result = nil;
+        [task trySetResult:nil];
     });
-    return tcs.task;
+    return task;
 }
 
 - (id)result {
-    @synchronized (self.lock) {
-        return _result;
-    }
+    return self.isCompleted ? _result : nil;
 }
 
 - (void)setResult:(id)result {
@@ -121,21 +177,11 @@ __attribute__ ((noinline)) void logOperationOnMainThread() {
 }
 
 - (BOOL)trySetResult:(id)result {
-    @synchronized (self.lock) {
-        if (self.completed) {
-            return NO;
-        }
-        self.completed = YES;
-        _result = result;
-        [self runContinuations];
-        return YES;
-    }
+    return [self tryCompleteWithResult:result error:nil exception:nil cancelled:NO];
 }
 
 - (NSError *)error {
-    @synchronized (self.lock) {
-        return _error;
-    }
+    return self.isCompleted ? _error : nil;
 }
 
 - (void)setError:(NSError *)error {
@@ -146,21 +192,11 @@ __attribute__ ((noinline)) void logOperationOnMainThread() {
 }
 
 - (BOOL)trySetError:(NSError *)error {
-    @synchronized (self.lock) {
-        if (self.completed) {
-            return NO;
-        }
-        self.completed = YES;
-        _error = error;
-        [self runContinuations];
-        return YES;
-    }
+    return [self tryCompleteWithResult:nil error:error exception:nil cancelled:NO];
 }
 
 - (NSException *)exception {
-    @synchronized (self.lock) {
-        return _exception;
-    }
+    return self.isCompleted ? _exception : nil;
 }
 
 - (void)setException:(NSException *)exception {
@@ -171,65 +207,97 @@ __attribute__ ((noinline)) void logOperationOnMainThread() {
 }
 
 - (BOOL)trySetException:(NSException *)exception {
-    @synchronized (self.lock) {
-        if (self.completed) {
-            return NO;
-        }
-        self.completed = YES;
-        _exception = exception;
-        [self runContinuations];
-        return YES;
-    }
+    return [self tryCompleteWithResult:nil error:nil exception:exception cancelled:NO];
 }
 
 - (BOOL)isCancelled {
-    @synchronized (self.lock) {
-        return _cancelled;
-    }
+    return self.isCompleted && _cancelled;
 }
 
 - (void)cancel {
-    @synchronized (self.lock) {
-        if (![self trySetCancelled]) {
-            [NSException raise:NSInternalInconsistencyException
-                        format:@"Cannot cancel a completed task."];
-        }
+    if (![self trySetCancelled]) {
+        [NSException raise:NSInternalInconsistencyException
+                    format:@"Cannot cancel a completed task."];
     }
 }
 
 - (BOOL)trySetCancelled {
-    @synchronized (self.lock) {
-        if (self.completed) {
-            return NO;
-        }
-        self.completed = YES;
-        _cancelled = YES;
-        [self runContinuations];
-        return YES;
-    }
+    return [self tryCompleteWithResult:nil error:nil exception:nil cancelled:YES];
 }
 
 - (BOOL)isCompleted {
-    @synchronized (self.lock) {
-        return _completed;
-    }
+    OSMemoryBarrier();
+    return _state == FBTaskStateCompleted;
 }
 
-- (void)setCompleted {
-    @synchronized (self.lock) {
-        _completed = YES;
+- (BOOL)tryCompleteWithResult:(id)result
+                        error:(NSError *)error
+                    exception:(NSException *)exception
+                    cancelled:(BOOL)cancelled {
+    if (!OSAtomicCompareAndSwap32Barrier(FBTaskStatePending, FBTaskStateCompleting, &_state)) {
+        return NO;
     }
+
+    _result = [result retain];
+    _error = [error retain];
+    _exception = [exception retain];
+    _cancelled = cancelled;
+
+    // Publishes the outcome; readers check the state before touching it.
+    OSAtomicCompareAndSwap32Barrier(FBTaskStateCompleting, FBTaskStateCompleted, &_state);
+
+    [self runContinuations];
+    return YES;
 }
 
 - (void)runContinuations {
-    @synchronized (self.lock) {
-        [self.condition lock];
-        [self.condition broadcast];
-        [self.condition unlock];
-        for (void (^callback)() in self.callbacks) {
-            callback();
+    FBTaskContinuation *stack;
+    do {
+        stack = _continuations;
+    } while (!OSAtomicCompareAndSwapPtrBarrier(stack, kContinuationsClosed, (void *volatile *)&_continuations));
+
+    // The stack is newest first; run continuations in the order they were added.
+    FBTaskContinuation *continuations = NULL;
+    while (stack) {
+        FBTaskContinuation *next = stack->next;
+        stack->next = continuations;
+        continuations = stack;
+        stack = next;
+    }
+
+    while (continuations) {
+        FBTaskContinuation *next = continuations->next;
+        continuations->block();
+        [continuations->block release];
+        free(continuations);
+        continuations = next;
+    }
+}
+
+// Runs block once this task is complete: synchronously, on the calling thread, if it
+// already is, and otherwise on whichever thread completes it.
+- (void)addContinuation:(void (^)(void))block {
+    if (_continuations == kContinuationsClosed) {
+        block();
+        return;
+    }
+
+    FBTaskContinuation *continuation = malloc(sizeof(FBTaskContinuation));
+    continuation->block = [block copy];
+
+    for (;;) {
+        FBTaskContinuation *head = _continuations;
+        if (head == kContinuationsClosed) {
+            [continuation->block release];
+            free(continuation);
+            block();
+            return;
+        }
+
+        continuation->next = head;
+        if (OSAtomicCompareAndSwapPtrBarrier(head, continuation, (void *volatile *)&_continuations)) {
+            return;
         }
-        [self.callbacks removeAllObjects];
     }
 }
 
@@ -238,78 +306,57 @@ __attribute__ ((noinline)) void logOperationOnMainThread() {
 }
 
 - (FBTask *)dependentTaskWithBlock:(id(^)(FBTask *task))block queue:(dispatch_queue_t)queue {
-    block = [[block copy] autorelease];
-
-    FBTaskCompletionSource *tcs = [FBTaskCompletionSource taskCompletionSource];
+    FBTask *dependentTask = [[FBTask alloc] init];
     queue = queue ?: dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
 
     // Capture all of the state that needs to used when the continuation is complete.
-    void (^wrappedBlock)() = ^() {
-        // Always dispatching callbacks async consumes less stack space, and seems
-        // to be a little faster, but loses stacktrace information. If you're debugging,
-        // consider commenting this line out and running the block synchronously.
-        dispatch_async(queue, ^{
+    // The continuation is copied once, which copies block along with it.
+    [self addContinuation:^{
+        // Dispatching callbacks async consumes less stack space, but loses stacktrace
+        // information. If you're debugging, consider passing +immediateQueue.
+        runContinuationOnQueue(queue, ^{
             id result = nil;
             @try {
                 result = block(self);
             } @catch (NSException *exception) {
-                tcs.exception = exception;
+                [dependentTask setException:exception];
                 return;
             }
 
             if ([result isKindOfClass:[FBTask class]]) {
-                [(FBTask *)result dependentTaskWithBlock:^id(FBTask *task) {
-                    if (task.isCancelled) {
-                        [tcs cancel];
-                    } else if (task.exception) {
-                        tcs.exception = task.exception;
-                    } else if (task.error) {
-                        tcs.error = task.error;
+                FBTask *resultTask = (FBTask *)result;
+                [resultTask addContinuation:^{
+                    if (resultTask.isCancelled) {
+                        [dependentTask cancel];
+                    } else if (resultTask.exception) {
+                        [dependentTask setException:resultTask.exception];
+                    } else if (resultTask.error) {
+                        [dependentTask setError:resultTask.error];
                     } else {
-                        tcs.result = task.result;
+                        [dependentTask setResult:resultTask.result];
                     }
-                    return nil;
-                } queue:queue];
+                }];
             } else {
-                tcs.result = result;
+                [dependentTask setResult:result];
             }
         });
-    };
-
-    BOOL completed;
-    @synchronized (self.lock) {
-        completed = self.completed;
-        if (!completed) {
-            [self.callbacks addObject:[[wrappedBlock copy] autorelease]];
-        }
-    }
-    if (completed) {
-        wrappedBlock();
-    }
+    }];
 
-    return tcs.task;
+    return [dependentTask autorelease];
 }
 
 - (FBTask *)completionTaskWithBlock:(id(^)(FBTask *task))block {
-    block = [block copy];
-    return [self dependentTaskWithBlock:^id(FBTask *task) {
-        if (task.error || task.exception || task.isCancelled) {
-            return task;
-        } else {
-            return [task dependentTaskWithBlock:block];
-        }
-    }];
+    return [self completionTaskWithQueue:nil block:block];
 }
 
 - (FBTask *)completionTaskWithQueue:(dispatch_queue_t)queue block:(id(^)(FBTask *task))block {
-    block = [block copy];
     return [self dependentTaskWithBlock:^id(FBTask *task) {
         if (task.error || task.exception || task.isCancelled) {
             return task;
         } else {
-            return [task dependentTaskWithBlock:block queue:queue];
+            return block(task);
         }
-    }];
+    } queue:queue];
 }
 
 - (void)warnOperationOnMainThread {
@@ -327,14 +374,16 @@ __attribute__ ((noinline)) void logOperationOnMainThread() {
         [self warnOperationOnMainThread];
     }
 
-    @synchronized (self.lock) {
-        if (self.isCompleted) {
-            return;
-        }
-        [self.condition lock];
+    if (self.isCompleted) {
+        return;
     }
-    [self.condition wait];
-    [self.condition unlock];
+
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    [self addContinuation:^{
+        dispatch_semaphore_signal(semaphore);
+    }];
+    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    dispatch_release(semaphore);
 }
 
 - (id)waitForResult:(NSError **)error {
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+// The FBTimingStatistics* keys of the dictionaries returned by -statisticsForLoggingBehavior:
+// are public, and declared in FBSettings.h
+#import "FBSettings.h"
+
+enum {
+    FBTimingRegistryMaximumDepth = 4,
+};
+
+// FBTimingRegistry
+//
+// Summary:
+// Keeps the start times of open timing spans, keyed by an object used only for its
+// address, and a latency histogram per logging behavior of the spans that ended.
+//
+// Spans live in a fixed-size open-addressed table, so registering one never allocates and
+// there is no global lock: slots are claimed and updated with atomic compare-and-swap,
+// each slot guarded by a flag held for a few instructions. A tag may have up to
+// FBTimingRegistryMaximumDepth nested spans open. Spans left open for longer than
+// maximumSpanAge are treated as abandoned, and their slots are reused when the table fills
+// up. Times are monotonic. All methods are thread-safe.
+@interface FBTimingRegistry : NSObject
+
++ (FBTimingRegistry *)sharedRegistry;
+
+- (id)initWithCapacity:(NSUInteger)capacity;
+
+@property (nonatomic, readonly) NSUInteger capacity;
+@property (nonatomic, assign) NSTimeInterval maximumSpanAge;
+// Spans that could not be registered because no slot was free
+@property (nonatomic, readonly) NSUInteger overflowCount;
+
+// Opens a span nested in any already open for `tag`; past the maximum depth the innermost
+// span is restarted instead. Returns NO if the table had no room for the tag.
+- (BOOL)beginSpanWithTag:(const void *)tag;
+
+// Restarts the innermost open span for `tag`, or opens one if there is none. Returns NO
+// if the table had no room for the tag.
+- (BOOL)restartSpanWithTag:(const void *)tag;
+
+// Closes the innermost open span for `tag` and adds its duration to the histogram of
+// `loggingBehavior`. Returns NO if no span was open.
+- (BOOL)endSpanWithTag:(const void *)tag
+       loggingBehavior:(NSString *)loggingBehavior
+              duration:(NSTimeInterval *)duration;
+
+// Count and p50, p99 and max durations of the spans ended for the behavior so far, or nil
+// if there were none.
+- (NSDictionary *)statisticsForLoggingBehavior:(NSString *)loggingBehavior;
+
+// Statistics of every behavior with ended spans, keyed by behavior.
+- (NSDictionary *)statistics;
+
+- (void)resetStatistics;
+
+@end
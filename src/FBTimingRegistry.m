@@ -0,0 +1,359 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "FBTimingRegistry.h"
+
+#import <libkern/OSAtomic.h>
+#import <mach/mach_time.h>
+
+NSString *const FBTimingStatisticsCountKey = @"count";
+NSString *const FBTimingStatisticsP50Key = @"p50";
+NSString *const FBTimingStatisticsP99Key = @"p99";
+NSString *const FBTimingStatisticsMaxKey = @"max";
+
+static const NSUInteger kDefaultCapacity = 1024;
+static const NSUInteger kMaximumProbeCount = 32;
+static const NSTimeInterval kDefaultMaximumSpanAge = 10 * 60;
+
+// Durations are bucketed in microseconds: exactly below 8, then 8 buckets per power of
+// two, which keeps percentiles within about 6% up to several hours.
+#define FB_TIMING_BUCKET_COUNT 256
+#define FB_TIMING_BEHAVIOR_COUNT 16
+
+typedef struct {
+    volatile uintptr_t tag;
+    volatile int32_t busy;
+    // Only touched while busy is held
+    int32_t depth;
+    uint64_t starts[FBTimingRegistryMaximumDepth];
+} FBTimingSlot;
+
+typedef struct {
+    volatile int64_t count;
+    volatile int64_t max;
+    volatile int64_t buckets[FB_TIMING_BUCKET_COUNT];
+} FBTimingHistogram;
+
+static uint64_t FBTimingNow(void) {
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+}
+
+static NSUInteger FBTimingBucketForMicroseconds(uint64_t microseconds) {
+    if (microseconds < 8) {
+        return (NSUInteger)microseconds;
+    }
+    int exponent = 63 - __builtin_clzll(microseconds);
+    NSUInteger bucket = 8 + (exponent - 3) * 8 + ((microseconds >> (exponent - 3)) & 7);
+    return MIN(bucket, FB_TIMING_BUCKET_COUNT - 1);
+}
+
+// Midpoint of the bucket's range
+static uint64_t FBTimingMicrosecondsForBucket(NSUInteger bucket) {
+    if (bucket < 8) {
+        return bucket;
+    }
+    int exponent = (int)(bucket - 8) / 8 + 3;
+    uint64_t width = 1ULL << (exponent - 3);
+    return (8 + (bucket - 8) % 8) * width + width / 2;
+}
+
+static void FBTimingLockSlot(FBTimingSlot *slot) {
+    while (!OSAtomicCompareAndSwap32Barrier(0, 1, &slot->busy)) {
+    }
+}
+
+static void FBTimingUnlockSlot(FBTimingSlot *slot) {
+    OSAtomicCompareAndSwap32Barrier(1, 0, &slot->busy);
+}
+
+@interface FBTimingRegistry ()
+
+- (FBTimingSlot *)lockSlotForTag:(uintptr_t)tag claim:(BOOL)claim now:(uint64_t)now;
+- (FBTimingHistogram *)histogramForLoggingBehavior:(NSString *)loggingBehavior create:(BOOL)create;
+
+@end
+
+@implementation FBTimingRegistry
+{
+    FBTimingSlot *_slots;
+    NSUInteger _mask;
+    volatile int32_t _overflowCount;
+
+    // Claimed once and never released, so lookups need no lock
+    NSString *volatile _behaviors[FB_TIMING_BEHAVIOR_COUNT];
+    FBTimingHistogram *_histograms;
+}
+
+@synthesize capacity = _capacity;
+@synthesize maximumSpanAge = _maximumSpanAge;
+
++ (FBTimingRegistry *)sharedRegistry {
+    static FBTimingRegistry *sharedRegistry = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedRegistry = [[FBTimingRegistry alloc] initWithCapacity:kDefaultCapacity];
+    });
+    return sharedRegistry;
+}
+
+- (id)initWithCapacity:(NSUInteger)capacity {
+    if (self = [super init]) {
+        // A power of two, so probing can mask instead of dividing
+        _capacity = kMaximumProbeCount;
+        while (_capacity < capacity) {
+            _capacity *= 2;
+        }
+        _mask = _capacity - 1;
+        _maximumSpanAge = kDefaultMaximumSpanAge;
+        _slots = calloc(_capacity, sizeof(FBTimingSlot));
+        _histograms = calloc(FB_TIMING_BEHAVIOR_COUNT, sizeof(FBTimingHistogram));
+        if (!_slots || !_histograms) {
+            [self release];
+            return nil;
+        }
+    }
+    return self;
+}
+
+- (void)dealloc {
+    for (NSUInteger i = 0; i < FB_TIMING_BEHAVIOR_COUNT; i++) {
+        [_behaviors[i] release];
+    }
+    free(_slots);
+    free(_histograms);
+    [super dealloc];
+}
+
+- (NSUInteger)overflowCount {
+    return (NSUInteger)_overflowCount;
+}
+
+#pragma mark - Spans
+
+- (BOOL)beginSpanWithTag:(const void *)tag {
+    uint64_t now = FBTimingNow();
+    FBTimingSlot *slot = [self lockSlotForTag:(uintptr_t)tag claim:YES now:now];
+    if (!slot) {
+        return NO;
+    }
+    if (slot->depth < FBTimingRegistryMaximumDepth) {
+        slot->depth++;
+    }
+    slot->starts[slot->depth - 1] = now;
+    FBTimingUnlockSlot(slot);
+    return YES;
+}
+
+- (BOOL)restartSpanWithTag:(const void *)tag {
+    uint64_t now = FBTimingNow();
+    FBTimingSlot *slot = [self lockSlotForTag:(uintptr_t)tag claim:YES now:now];
+    if (!slot) {
+        return NO;
+    }
+    if (slot->depth == 0) {
+        slot->depth = 1;
+    }
+    slot->starts[slot->depth - 1] = now;
+    FBTimingUnlockSlot(slot);
+    return YES;
+}
+
+- (BOOL)endSpanWithTag:(const void *)tag
+       loggingBehavior:(NSString *)loggingBehavior
+              duration:(NSTimeInterval *)duration {
+    uint64_t now = FBTimingNow();
+    FBTimingSlot *slot = [self lockSlotForTag:(uintptr_t)tag claim:NO now:now];
+    if (!slot) {
+        return NO;
+    }
+    uint64_t start = 0;
+    BOOL open = slot->depth > 0;
+    if (open) {
+        start = slot->starts[--slot->depth];
+    }
+    FBTimingUnlockSlot(slot);
+    if (!open) {
+        return NO;
+    }
+
+    uint64_t elapsed = now > start ? now - start : 0;
+    FBTimingHistogram *histogram = [self histogramForLoggingBehavior:loggingBehavior create:YES];
+    if (histogram) {
+        uint64_t microseconds = elapsed / 1000;
+        OSAtomicIncrement64Barrier(&histogram->buckets[FBTimingBucketForMicroseconds(microseconds)]);
+        OSAtomicIncrement64Barrier(&histogram->count);
+        int64_t max = histogram->max;
+        while ((int64_t)microseconds > max &&
+               !OSAtomicCompareAndSwap64Barrier(max, (int64_t)microseconds, &histogram->max)) {
+            max = histogram->max;
+        }
+    }
+
+    if (duration) {
+        *duration = elapsed / (double)NSEC_PER_SEC;
+    }
+    return YES;
+}
+
+#pragma mark - Statistics
+
+- (NSDictionary *)statisticsForLoggingBehavior:(NSString *)loggingBehavior {
+    FBTimingHistogram *histogram = [self histogramForLoggingBehavior:loggingBehavior create:NO];
+    if (!histogram) {
+        return nil;
+    }
+
+    // Buckets are read one at a time while spans keep ending, so the total is recounted
+    // from this copy rather than taken from the count
+    int64_t buckets[FB_TIMING_BUCKET_COUNT];
+    int64_t count = 0;
+    for (NSUInteger i = 0; i < FB_TIMING_BUCKET_COUNT; i++) {
+        buckets[i] = histogram->buckets[i];
+        count += buckets[i];
+    }
+    if (count == 0) {
+        return nil;
+    }
+
+    int64_t p50Rank = (count + 1) / 2;
+    int64_t p99Rank = count - count / 100;
+    uint64_t p50 = 0;
+    uint64_t p99 = 0;
+    int64_t seen = 0;
+    for (NSUInteger i = 0; i < FB_TIMING_BUCKET_COUNT; i++) {
+        if (seen < p50Rank && seen + buckets[i] >= p50Rank) {
+            p50 = FBTimingMicrosecondsForBucket(i);
+        }
+        if (seen < p99Rank && seen + buckets[i] >= p99Rank) {
+            p99 = FBTimingMicrosecondsForBucket(i);
+            break;
+        }
+        seen += buckets[i];
+    }
+
+    return [NSDictionary dictionaryWithObjectsAndKeys:
+            [NSNumber numberWithLongLong:count], FBTimingStatisticsCountKey,
+            [NSNumber numberWithDouble:p50 / 1000.0], FBTimingStatisticsP50Key,
+            [NSNumber numberWithDouble:p99 / 1000.0], FBTimingStatisticsP99Key,
+            [NSNumber numberWithDouble:histogram->max / 1000.0], FBTimingStatisticsMaxKey,
+            nil];
+}
+
+- (NSDictionary *)statistics {
+    NSMutableDictionary *statistics = [NSMutableDictionary dictionary];
+    for (NSUInteger i = 0; i < FB_TIMING_BEHAVIOR_COUNT && _behaviors[i]; i++) {
+        NSDictionary *behaviorStatistics = [self statisticsForLoggingBehavior:_behaviors[i]];
+        if (behaviorStatistics) {
+            [statistics setObject:behaviorStatistics forKey:_behaviors[i]];
+        }
+    }
+    return statistics;
+}
+
+// Spans ending while this runs may or may not be counted
+- (void)resetStatistics {
+    for (NSUInteger i = 0; i < FB_TIMING_BEHAVIOR_COUNT; i++) {
+        FBTimingHistogram *histogram = &_histograms[i];
+        for (NSUInteger j = 0; j < FB_TIMING_BUCKET_COUNT; j++) {
+            histogram->buckets[j] = 0;
+        }
+        histogram->count = 0;
+        histogram->max = 0;
+    }
+    OSMemoryBarrier();
+}
+
+#pragma mark - Private
+
+// Returns the tag's slot with its flag held, or NULL. Claimed slots never become empty
+// again, so a tag is never stored past an empty slot in its probe sequence, and the probe
+// can stop at the first one.
+- (FBTimingSlot *)lockSlotForTag:(uintptr_t)tag claim:(BOOL)claim now:(uint64_t)now {
+    NSUInteger start = (NSUInteger)(((uint64_t)tag * 0x9E3779B97F4A7C15ULL) >> 32) & _mask;
+    for (NSUInteger probe = 0; probe < kMaximumProbeCount; probe++) {
+        FBTimingSlot *slot = &_slots[(start + probe) & _mask];
+        uintptr_t slotTag = slot->tag;
+        if (slotTag == 0) {
+            if (!claim) {
+                return NULL;
+            }
+            if (OSAtomicCompareAndSwapPtrBarrier((void *)0, (void *)tag, (void * volatile *)&slot->tag)) {
+                FBTimingLockSlot(slot);
+                return slot;
+            }
+            slotTag = slot->tag;
+        }
+        if (slotTag == tag) {
+            FBTimingLockSlot(slot);
+            // The slot may have been reused for another tag in the meantime
+            if (slot->tag == tag) {
+                return slot;
+            }
+            FBTimingUnlockSlot(slot);
+        }
+    }
+    if (!claim) {
+        return NULL;
+    }
+
+    // No room left: take over a slot whose spans are all closed or abandoned
+    uint64_t maximumAge = (uint64_t)(_maximumSpanAge * NSEC_PER_SEC);
+    for (NSUInteger probe = 0; probe < kMaximumProbeCount; probe++) {
+        FBTimingSlot *slot = &_slots[(start + probe) & _mask];
+        if (OSAtomicCompareAndSwap32Barrier(0, 1, &slot->busy)) {
+            uint64_t lastStart = slot->depth > 0 ? slot->starts[slot->depth - 1] : now;
+            if (slot->depth == 0 || (now > lastStart && now - lastStart > maximumAge)) {
+                slot->tag = tag;
+                slot->depth = 0;
+                return slot;
+            }
+            FBTimingUnlockSlot(slot);
+        }
+    }
+
+    OSAtomicIncrement32Barrier(&_overflowCount);
+    return NULL;
+}
+
+- (FBTimingHistogram *)histogramForLoggingBehavior:(NSString *)loggingBehavior create:(BOOL)create {
+    if (!loggingBehavior) {
+        return NULL;
+    }
+    for (NSUInteger i = 0; i < FB_TIMING_BEHAVIOR_COUNT; i++) {
+        NSString *behavior = _behaviors[i];
+        if (!behavior) {
+            if (!create) {
+                return NULL;
+            }
+            NSString *copy = [loggingBehavior copy];
+            if (OSAtomicCompareAndSwapPtrBarrier(nil, copy, (void * volatile *)&_behaviors[i])) {
+                return &_histograms[i];
+            }
+            [copy release];
+            behavior = _behaviors[i];
+        }
+        if (behavior == loggingBehavior || [behavior isEqualToString:loggingBehavior]) {
+            return &_histograms[i];
+        }
+    }
+    return NULL;
+}
+
+@end
@@ -22,6 +22,19 @@ typedef void (^FBURLConnectionHandler)(FBURLConnection *connection,
                                        NSURLResponse *response,
                                        NSData *responseData);
 
+// Order in which waiting connections are started by FBURLConnectionPool.
+typedef enum {
+    // Requests someone is waiting on, such as Graph API calls and visible pictures.
+    FBURLConnectionPriorityUserInitiated = 0,
+    // Speculative loads, such as picture prefetching.
+    FBURLConnectionPriorityPrefetch,
+    // Uploads nobody waits on, such as app events.
+    FBURLConnectionPriorityBackground,
+} FBURLConnectionPriority;
+
+// Network callbacks are handled on a background queue; the completion handler is
+// called on the main queue unless another callbackQueue is given. A response cached
+// by FBDataDiskCache completes synchronously, inside init.
 @interface FBURLConnection : NSObject
 
 - (FBURLConnection *)initWithURL:(NSURL *)url
@@ -31,6 +44,12 @@ typedef void (^FBURLConnectionHandler)(FBURLConnection *connection,
                skipRoundTripIfCached:(BOOL)skipRoundtripIfCached
                    completionHandler:(FBURLConnectionHandler)handler;
 
+- (FBURLConnection *)initWithRequest:(NSURLRequest *)request
+               skipRoundTripIfCached:(BOOL)skipRoundtripIfCached
+                            priority:(FBURLConnectionPriority)priority
+                       callbackQueue:(dispatch_queue_t)callbackQueue
+                   completionHandler:(FBURLConnectionHandler)handler;
+
 - (void)cancel;
 
 @end
@@ -22,19 +22,34 @@
 #import "FBSession.h"
 #import "FBSettings+Internal.h"
 #import "FBSettings.h"
+#import "FBURLConnectionPool.h"
 #import "FBUtility.h"
 
+// Larger Content-Length values are not trusted for sizing the response buffer up front.
+static const long long FBURLConnectionMaxPresizedLength = 8 * 1024 * 1024;
+
+// CDN responses at least this large, or of unknown length, are streamed to the disk cache
+// rather than buffered, and handed to the handler as a memory-mapped file.
+static const long long FBURLConnectionStreamingThreshold = 256 * 1024;
+
 static NSArray* _cdnHosts;
 
-@interface FBURLConnection ()
+@interface FBURLConnection () {
+    dispatch_queue_t _callbackQueue;
+    BOOL _completed;
+}
 
 @property (nonatomic, retain) NSURLConnection *connection;
 @property (nonatomic, retain) NSMutableData *data;
+// Only touched on the pool's delegate queue, where the streaming callbacks run.
+@property (nonatomic, retain) FBDataDiskCacheWriter *cacheWriter;
 @property (nonatomic, copy) FBURLConnectionHandler handler;
 @property (nonatomic, retain) NSURLResponse *response;
 @property (nonatomic) unsigned long requestStartTime;
 @property (nonatomic, readonly) NSUInteger loggerSerialNumber;
 @property (nonatomic) BOOL skipRoundtripIfCached;
+@property (nonatomic) FBURLConnectionPriority priority;
+@property (nonatomic, assign) dispatch_queue_t callbackQueue;
 
 - (BOOL)isCDNURL:(NSURL *)url;
 
@@ -49,11 +64,13 @@ static NSArray* _cdnHosts;
 
 @synthesize connection = _connection;
 @synthesize data = _data;
+@synthesize cacheWriter = _cacheWriter;
 @synthesize handler = _handler;
 @synthesize loggerSerialNumber = _loggerSerialNumber;
 @synthesize requestStartTime = _requestStartTime;
 @synthesize response = _response;
 @synthesize skipRoundtripIfCached = _skipRoundtripIfCached;
+@synthesize priority = _priority;
 
 #pragma mark - Lifecycle
 
@@ -78,8 +95,22 @@ static NSArray* _cdnHosts;
 - (FBURLConnection *)initWithRequest:(NSURLRequest *)request
                skipRoundTripIfCached:(BOOL)skipRoundtripIfCached
                    completionHandler:(FBURLConnectionHandler)handler {
+    return [self initWithRequest:request
+           skipRoundTripIfCached:skipRoundtripIfCached
+                        priority:FBURLConnectionPriorityUserInitiated
+                   callbackQueue:nil
+               completionHandler:handler];
+}
+
+- (FBURLConnection *)initWithRequest:(NSURLRequest *)request
+               skipRoundTripIfCached:(BOOL)skipRoundtripIfCached
+                            priority:(FBURLConnectionPriority)priority
+                       callbackQueue:(dispatch_queue_t)callbackQueue
+                   completionHandler:(FBURLConnectionHandler)handler {
     if (self = [super init]) {
         self.skipRoundtripIfCached = skipRoundtripIfCached;
+        self.priority = priority;
+        self.callbackQueue = callbackQueue ?: dispatch_get_main_queue();
 
         // Check if this url is cached
         NSURL* url = request.URL;
@@ -89,6 +120,7 @@ static NSArray* _cdnHosts;
         if (cachedData) {
             // TODO: It seems wrong to call this within init.  There are cases
             // with UI where this is not ideal.  We should talk about this.
+            [self markCompleted];
             [self logAndInvokeHandler:handler cachedData:cachedData forURL:url];
         } else {
 
@@ -96,7 +128,8 @@ static NSArray* _cdnHosts;
             _loggerSerialNumber = [FBLogger newSerialNumber];
             _connection = [[NSURLConnection alloc]
                 initWithRequest:request
-                delegate:self];
+                delegate:self
+                startImmediately:NO];
             _data = [[NSMutableData alloc] init];
 
             [self logMessage:[NSString stringWithFormat:@"FBURLConnection <#%lu>:\n  URL: '%@'\n\n",
@@ -104,6 +137,7 @@ static NSArray* _cdnHosts;
                 url.absoluteString]];
 
             self.handler = handler;
+            [[FBURLConnectionPool sharedPool] enqueueConnection:_connection priority:priority];
         }
 
         // always attempt to autoPublish.  this function internally
@@ -177,13 +211,72 @@ static NSArray* _cdnHosts;
     [_response release];
     [_connection release];
     [_data release];
+    [_cacheWriter abort];
+    [_cacheWriter release];
     [_handler release];
+    if (_callbackQueue) {
+        dispatch_release(_callbackQueue);
+    }
     [super dealloc];
 }
 
+- (dispatch_queue_t)callbackQueue {
+    return _callbackQueue;
+}
+
+- (void)setCallbackQueue:(dispatch_queue_t)callbackQueue {
+    if (callbackQueue) {
+        dispatch_retain(callbackQueue);
+    }
+    if (_callbackQueue) {
+        dispatch_release(_callbackQueue);
+    }
+    _callbackQueue = callbackQueue;
+}
+
+// Returns YES exactly once, for whichever of completion or cancellation gets here first.
+- (BOOL)markCompleted {
+    @synchronized(self) {
+        if (_completed) {
+            return NO;
+        }
+        _completed = YES;
+        return YES;
+    }
+}
+
+// Called on the pool's delegate queue; the handler runs on the callback queue, where
+// it is checked against a cancel made there in the meantime.
+- (void)completeWithError:(NSError *)error
+                 response:(NSURLResponse *)response
+             responseData:(NSData *)responseData {
+    [[FBURLConnectionPool sharedPool] removeConnection:self.connection];
+
+    dispatch_async(self.callbackQueue, ^{
+        if (![self markCompleted]) {
+            return;
+        }
+        @try {
+            if (error) {
+                [self logAndInvokeHandler:self.handler error:error];
+            } else {
+                [self logAndInvokeHandler:self.handler response:response responseData:responseData];
+            }
+        } @finally {
+            self.handler = nil;
+        }
+    });
+}
+
 - (void)cancel {
     [self.connection cancel];
-    if (self.handler == nil) {
+    // Runs after any delegate callback already in flight; none follow the cancel.
+    [[FBURLConnectionPool sharedPool].delegateQueue addOperationWithBlock:^{
+        [self.cacheWriter abort];
+        self.cacheWriter = nil;
+    }];
+    [[FBURLConnectionPool sharedPool] removeConnection:self.connection];
+    if (![self markCompleted] || self.handler == nil) {
         return;
     }
 
@@ -209,24 +302,62 @@ static NSArray* _cdnHosts;
 - (void)connection:(NSURLConnection *)connection
 didReceiveResponse:(NSURLResponse *)response {
     self.response = response;
-    [self.data setLength:0];
+
+    [self.cacheWriter abort];
+    self.cacheWriter = nil;
+
+    long long expectedLength = response.expectedContentLength;
+    if ((expectedLength < 0 || expectedLength >= FBURLConnectionStreamingThreshold) &&
+        [self isCDNURL:response.URL]) {
+        // Falls back to buffering if the cache can't take the download
+        self.cacheWriter = [[self getCache] writerForURL:response.URL];
+    }
+
+    if (self.cacheWriter) {
+        self.data = nil;
+    } else if (expectedLength > 0 && expectedLength <= FBURLConnectionMaxPresizedLength) {
+        self.data = [NSMutableData dataWithCapacity:(NSUInteger)expectedLength];
+    } else {
+        [self.data setLength:0];
+    }
 }
 
 - (void)connection:(NSURLResponse *)connection
     didReceiveData:(NSData *)data {
-    [self.data appendData:data];
+    if (self.cacheWriter == nil) {
+        [self.data appendData:data];
+    } else if (![self.cacheWriter appendData:data]) {
+        // Out of disk space or similar; nothing to gain from the rest of the download
+        [self.connection cancel];
+        [self.cacheWriter abort];
+        NSError *error = [NSError errorWithDomain:NSCocoaErrorDomain
+                                             code:NSFileWriteUnknownError
+                                         userInfo:nil];
+        [self completeWithError:error response:nil responseData:nil];
+    }
 }
 
 - (void)connection:(NSURLConnection *)connection
   didFailWithError:(NSError *)error {
-    @try {
-        [self logAndInvokeHandler:self.handler error:error];
-    } @finally {
-        self.handler = nil;
-    }
+    [self.cacheWriter abort];
+    [self completeWithError:error response:nil responseData:nil];
 }
 
 - (void)connectionDidFinishLoading:(NSURLConnection *)connection {
+    if (self.cacheWriter) {
+        // Already indexed by the writer; the data is mapped from the cache file
+        NSData *mappedData = [self.cacheWriter commit];
+        if (mappedData) {
+            [self completeWithError:nil response:self.response responseData:mappedData];
+        } else {
+            NSError *error = [NSError errorWithDomain:NSCocoaErrorDomain
+                                                 code:NSFileWriteUnknownError
+                                             userInfo:nil];
+            [self completeWithError:error response:nil responseData:nil];
+        }
+        return;
+    }
+
     NSURL* dataURL = self.response.URL;
     if ([self isCDNURL:dataURL]) {
         // Cache this data
@@ -234,11 +365,7 @@ didReceiveResponse:(NSURLResponse *)response {
         [cache setData:self.data forURL:dataURL];
     }
 
-    @try {
-        [self logAndInvokeHandler:self.handler response:self.response responseData:self.data];
-    } @finally {
-        self.handler = nil;
-    }
+    [self completeWithError:nil response:self.response responseData:self.data];
 }
 
 -(NSURLRequest *)connection:(NSURLConnection *)connection
@@ -251,18 +378,14 @@ didReceiveResponse:(NSURLResponse *)response {
         FBDataDiskCache *cache = [self getCache];
         NSData* cachedData = [cache dataForURL:redirectURL];
         if (cachedData) {
-            @try {
-                // Fake a response
-                NSURLResponse* cacheResponse =
-                    [[NSURLResponse alloc] initWithURL:redirectURL
-                        MIMEType:@"application/octet-stream"
-                        expectedContentLength:cachedData.length
-                        textEncodingName:@"utf8"];
-                [self logAndInvokeHandler:self.handler response:cacheResponse responseData:cachedData];
-                [cacheResponse release];
-            } @finally {
-                self.handler = nil;
-            }
+            // Fake a response
+            NSURLResponse* cacheResponse =
+                [[NSURLResponse alloc] initWithURL:redirectURL
+                    MIMEType:@"application/octet-stream"
+                    expectedContentLength:cachedData.length
+                    textEncodingName:@"utf8"];
+            [self completeWithError:nil response:cacheResponse responseData:cachedData];
+            [cacheResponse release];
 
             return nil;
         }
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+#import "FBURLConnection.h"
+
+// FBURLConnectionPool
+//
+// Summary:
+// Schedules the NSURLConnections behind FBURLConnection. At most maxConnectionsPerHost
+// connections run against any one host (NSURLConnection keeps those sockets alive and
+// reuses them), and at most maxConnections run overall. Waiting connections start in
+// priority order, FIFO within a priority; prefetch and background connections never take
+// the last free slot of a host, so a user-initiated request can always start right away.
+//
+// Delegate callbacks of every pooled connection are delivered on delegateQueue, a serial
+// background queue. All methods are thread-safe.
+@interface FBURLConnectionPool : NSObject
+
++ (FBURLConnectionPool *)sharedPool;
+
+@property (nonatomic, assign) NSUInteger maxConnectionsPerHost;
+@property (nonatomic, assign) NSUInteger maxConnections;
+@property (nonatomic, readonly) NSOperationQueue *delegateQueue;
+
+// `connection` must have been created with startImmediately:NO; the pool starts it.
+- (void)enqueueConnection:(NSURLConnection *)connection
+                 priority:(FBURLConnectionPriority)priority;
+
+// Releases the connection's slot, or drops it if it has not started yet. Must be
+// called once the connection finishes, fails or is cancelled; extra calls are ignored.
+- (void)removeConnection:(NSURLConnection *)connection;
+
+@end
@@ -0,0 +1,140 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "FBURLConnectionPool.h"
+
+static const NSUInteger FBURLConnectionPoolDefaultMaxConnectionsPerHost = 4;
+static const NSUInteger FBURLConnectionPoolDefaultMaxConnections = 12;
+static const NSUInteger FBURLConnectionPriorityCount = FBURLConnectionPriorityBackground + 1;
+
+@interface FBURLConnectionPool () {
+    dispatch_queue_t _queue;
+
+    // Only touched on _queue
+    NSMutableArray *_pending[FBURLConnectionPriorityCount];
+    NSMutableSet *_active;
+    NSCountedSet *_activeHosts;
+}
+
+- (void)startPendingConnections;
+
+@end
+
+@implementation FBURLConnectionPool
+
+@synthesize maxConnectionsPerHost = _maxConnectionsPerHost;
+@synthesize maxConnections = _maxConnections;
+@synthesize delegateQueue = _delegateQueue;
+
++ (FBURLConnectionPool *)sharedPool {
+    static FBURLConnectionPool *sharedPool = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedPool = [[FBURLConnectionPool alloc] init];
+    });
+    return sharedPool;
+}
+
+- (id)init {
+    if ((self = [super init])) {
+        _maxConnectionsPerHost = FBURLConnectionPoolDefaultMaxConnectionsPerHost;
+        _maxConnections = FBURLConnectionPoolDefaultMaxConnections;
+
+        _queue = dispatch_queue_create("com.facebook.sdk.FBURLConnectionPool", DISPATCH_QUEUE_SERIAL);
+        for (NSUInteger i = 0; i < FBURLConnectionPriorityCount; i++) {
+            _pending[i] = [[NSMutableArray alloc] init];
+        }
+        _active = [[NSMutableSet alloc] init];
+        _activeHosts = [[NSCountedSet alloc] init];
+
+        // Callbacks only buffer data and hand off to the caller's queue, so one thread
+        // keeps each connection's callbacks ordered without starving the others.
+        _delegateQueue = [[NSOperationQueue alloc] init];
+        _delegateQueue.maxConcurrentOperationCount = 1;
+        _delegateQueue.name = @"com.facebook.sdk.FBURLConnectionPool.delegate";
+    }
+    return self;
+}
+
+- (void)dealloc {
+    dispatch_release(_queue);
+    for (NSUInteger i = 0; i < FBURLConnectionPriorityCount; i++) {
+        [_pending[i] release];
+    }
+    [_active release];
+    [_activeHosts release];
+    [_delegateQueue release];
+    [super dealloc];
+}
+
++ (NSString *)hostOfConnection:(NSURLConnection *)connection {
+    return [connection.originalRequest.URL.host lowercaseString] ?: @"";
+}
+
+- (void)enqueueConnection:(NSURLConnection *)connection
+                 priority:(FBURLConnectionPriority)priority {
+    NSUInteger index = MIN((NSUInteger)priority, FBURLConnectionPriorityCount - 1);
+    dispatch_async(_queue, ^{
+        [_pending[index] addObject:connection];
+        [self startPendingConnections];
+    });
+}
+
+- (void)removeConnection:(NSURLConnection *)connection {
+    dispatch_async(_queue, ^{
+        if ([_active containsObject:connection]) {
+            [_activeHosts removeObject:[FBURLConnectionPool hostOfConnection:connection]];
+            [_active removeObject:connection];
+            [self startPendingConnections];
+        } else {
+            for (NSUInteger i = 0; i < FBURLConnectionPriorityCount; i++) {
+                [_pending[i] removeObjectIdenticalTo:connection];
+            }
+        }
+    });
+}
+
+// Called on _queue.
+- (void)startPendingConnections {
+    NSUInteger maxPerHost = MAX(self.maxConnectionsPerHost, 1);
+    NSUInteger maxTotal = MAX(self.maxConnections, 1);
+
+    for (NSUInteger priority = 0; priority < FBURLConnectionPriorityCount; priority++) {
+        // keep a slot per host free for user-initiated work
+        NSUInteger hostLimit = (priority == FBURLConnectionPriorityUserInitiated || maxPerHost == 1)
+            ? maxPerHost
+            : maxPerHost - 1;
+
+        NSMutableArray *pending = _pending[priority];
+        for (NSUInteger i = 0; i < pending.count && _active.count < maxTotal; ) {
+            NSURLConnection *connection = [pending objectAtIndex:i];
+            NSString *host = [FBURLConnectionPool hostOfConnection:connection];
+            if ([_activeHosts countForObject:host] >= hostLimit) {
+                i++;
+                continue;
+            }
+
+            [_active addObject:connection];
+            [_activeHosts addObject:host];
+            [pending removeObjectAtIndex:i];
+
+            [connection setDelegateQueue:self.delegateQueue];
+            [connection start];
+        }
+    }
+}
+
+@end
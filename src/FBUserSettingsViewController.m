@@ -17,9 +17,9 @@
 #import "FBUserSettingsViewController.h"
 
 #import "FBAppEvents+Internal.h"
+#import "FBCurrentUserStore.h"
 #import "FBGraphUser.h"
 #import "FBProfilePictureView.h"
-#import "FBRequest.h"
 #import "FBSession+Internal.h"
 #import "FBSession.h"
 #import "FBUtility.h"
@@ -35,7 +35,6 @@
 @property (nonatomic) BOOL attemptingLogin;
 @property (nonatomic, retain) NSBundle *bundle;
 @property (copy, nonatomic) FBSessionStateHandler sessionStateHandler;
-@property (copy, nonatomic) FBRequestHandler requestHandler;
 
 - (void)loginLogoutButtonPressed:(id)sender;
 - (void)sessionStateChanged:(FBSession *)session
@@ -44,6 +43,7 @@
 - (void)openSession;
 - (void)updateControls;
 - (void)updateBackgroundImage;
+- (void)handleCurrentUserStoreDidChange:(NSNotification *)notification;
 
 @end
 
@@ -61,7 +61,6 @@
 @synthesize backgroundImageView = _backgroundImageView;
 @synthesize bundle = _bundle;
 @synthesize sessionStateHandler = _sessionStateHandler;
-@synthesize requestHandler = _requestHandler;
 
 #pragma mark View controller lifecycle
 
@@ -73,18 +72,12 @@
     __block FBUserSettingsViewController *weakSelf = self;
     self.sessionStateHandler = ^(FBSession *session, FBSessionState status, NSError *error) {
         if (session == nil) {
-            // The nil sentinel value for session indicates both blocks should no-op thereafter.
+            // The nil sentinel value for session indicates the block should no-op thereafter.
             weakSelf = nil;
         } else {
             [weakSelf sessionStateChanged:session state:status error:error];
         }
     };
-    self.requestHandler = ^(FBRequestConnection *connection, id result, NSError *error) {
-        if (result) {
-            weakSelf.me = result;
-            [weakSelf updateControls];
-        }
-    };
 }
 
 - (id)init {
@@ -124,7 +117,6 @@
     // to prevent EXC_BAD_ACCESS errors.
     self.sessionStateHandler(nil, FBSessionStateClosed, nil);
     [_sessionStateHandler release];
-    [_requestHandler release];
 
     [_profilePicture release];
     [_connectedStateLabel release];
@@ -244,6 +236,10 @@
                                              selector:@selector(handleActiveSessionStateChanged:)
                                                  name:FBSessionDidBecomeClosedActiveSessionNotification
                                                object:nil];
+    [[NSNotificationCenter defaultCenter] addObserver:self
+                                             selector:@selector(handleCurrentUserStoreDidChange:)
+                                                 name:FBCurrentUserStoreDidChangeNotification
+                                               object:nil];
 
     [self updateControls];
 }
@@ -304,7 +300,16 @@
                                                     20);
         self.profilePicture.hidden = NO;
 
-        // Do we know the user's name? If not, request it.
+        // Do we know the user's name? If not, request it; the store shares the
+        // result with any FBLoginView and profile picture showing the same user.
+        if (self.me == nil) {
+            FBCurrentUserStore *store = [FBCurrentUserStore sharedStore];
+            [store fetchForSession:FBSession.activeSession];
+            if (store.session == FBSession.activeSession) {
+                self.me = store.user;
+            }
+        }
+
         if (self.me != nil) {
             self.connectedStateLabel.text = self.me.name;
             self.profilePicture.profileID = [self.me objectForKey:@"id"];
@@ -313,8 +318,6 @@
                                                                  withDefault:@"Logged in"
                                                                     inBundle:self.bundle];
             self.profilePicture.profileID = nil;
-
-            [[FBRequest requestForMe] startWithCompletionHandler:self.requestHandler];
         }
     } else {
         self.me = nil;
@@ -435,4 +438,12 @@
     [self updateControls];
 }
 
+- (void)handleCurrentUserStoreDidChange:(NSNotification *)notification {
+    FBCurrentUserStore *store = notification.object;
+    if (store.user && store.session == FBSession.activeSession) {
+        self.me = store.user;
+        [self updateControls];
+    }
+}
+
 @end
@@ -177,8 +177,8 @@ static NSString *const FBexpirationDatePropertyName = @"expirationDate";
 
     [FBUtility deleteFacebookCookies];
 
-    // setting to nil also terminates any active request for whitelist
-    [_frictionlessRequestSettings updateRecipientCacheWithRecipients:nil];
+    // also terminates any active request for whitelist
+    [_frictionlessRequestSettings clearRecipientCache];
 }
 
 
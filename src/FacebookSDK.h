@@ -22,6 +22,7 @@
 #import "FBDialogs.h"
 #import "FBError.h"
 #import "FBErrorUtility.h"
+#import "FBFileLogSink.h"
 #import "FBFrictionlessRecipientCache.h"
 #import "FBFriendPickerViewController.h"
 #import "FBGraphLocation.h"
@@ -29,6 +30,7 @@
 #import "FBGraphPlace.h"
 #import "FBGraphUser.h"
 #import "FBInsights.h"
+#import "FBLogSink.h"
 #import "FBLoginView.h"
 #import "FBNativeDialogs.h"         // deprecated, use FBDialogs.h
 #import "FBOpenGraphAction.h"
@@ -0,0 +1,47 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+// Runs one benchmark body `iterations` times; the body owns its loop so that the
+// measured time is not dominated by block dispatch.
+typedef void (^FBBenchmarkBlock)(NSUInteger iterations);
+
+// FBBenchmarkSuite
+//
+// Summary:
+// Minimal microbenchmark runner shared by the FacebookSDKBenchmarks test target and the
+// GNUstep command line tool. Each benchmark is run once to warm up and then sampled
+// several times; the median time per operation is reported.
+//
+// Results are plain property lists, so they can be written as JSON and compared against
+// a stored baseline by scripts/compare_benchmarks.py:
+//   { "version": 1, "benchmarks": { "<name>": { "ns_per_op": ..., "iterations": ... } } }
+@interface FBBenchmarkSuite : NSObject
+
+// Number of timed samples per benchmark; defaults to 5.
+@property (nonatomic, assign) NSUInteger sampleCount;
+
+- (void)addBenchmarkWithName:(NSString *)name
+                  iterations:(NSUInteger)iterations
+                       block:(FBBenchmarkBlock)block;
+
+// Runs every benchmark, in the order added, and returns the results dictionary.
+- (NSDictionary *)run;
+
++ (BOOL)writeResults:(NSDictionary *)results toFile:(NSString *)path;
+
+@end
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "FBBenchmark.h"
+
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#else
+#include <time.h>
+#endif
+
+static const NSUInteger FBBenchmarkDefaultSampleCount = 5;
+
+// Monotonic time in nanoseconds.
+static uint64_t FBBenchmarkNow(void) {
+#ifdef __APPLE__
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
+@interface FBBenchmark : NSObject
+
+@property (nonatomic, copy) NSString *name;
+@property (nonatomic, assign) NSUInteger iterations;
+@property (nonatomic, copy) FBBenchmarkBlock block;
+
+@end
+
+@implementation FBBenchmark
+
+@synthesize name = _name;
+@synthesize iterations = _iterations;
+@synthesize block = _block;
+
+- (void)dealloc {
+    [_name release];
+    [_block release];
+    [super dealloc];
+}
+
+- (double)measureNanosecondsPerOperation {
+    uint64_t start = FBBenchmarkNow();
+    @autoreleasepool {
+        self.block(self.iterations);
+    }
+    return (double)(FBBenchmarkNow() - start) / self.iterations;
+}
+
+@end
+
+@interface FBBenchmarkSuite ()
+
+@property (nonatomic, retain) NSMutableArray *benchmarks;
+
+@end
+
+@implementation FBBenchmarkSuite
+
+@synthesize sampleCount = _sampleCount;
+@synthesize benchmarks = _benchmarks;
+
+- (id)init {
+    if ((self = [super init])) {
+        _sampleCount = FBBenchmarkDefaultSampleCount;
+        _benchmarks = [[NSMutableArray alloc] init];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [_benchmarks release];
+    [super dealloc];
+}
+
+- (void)addBenchmarkWithName:(NSString *)name
+                  iterations:(NSUInteger)iterations
+                       block:(FBBenchmarkBlock)block {
+    FBBenchmark *benchmark = [[FBBenchmark alloc] init];
+    benchmark.name = name;
+    benchmark.iterations = MAX(iterations, 1);
+    benchmark.block = block;
+    [self.benchmarks addObject:benchmark];
+    [benchmark release];
+}
+
+- (NSDictionary *)run {
+    NSMutableDictionary *results = [NSMutableDictionary dictionaryWithCapacity:self.benchmarks.count];
+    NSUInteger sampleCount = MAX(self.sampleCount, 1);
+
+    for (FBBenchmark *benchmark in self.benchmarks) {
+        // warm caches, lazily created statics and the allocator before sampling
+        [benchmark measureNanosecondsPerOperation];
+
+        NSMutableArray *samples = [NSMutableArray arrayWithCapacity:sampleCount];
+        for (NSUInteger i = 0; i < sampleCount; i++) {
+            [samples addObject:[NSNumber numberWithDouble:[benchmark measureNanosecondsPerOperation]]];
+        }
+        [samples sortUsingSelector:@selector(compare:)];
+
+        NSNumber *median = [samples objectAtIndex:sampleCount / 2];
+        NSLog(@"FBBenchmark: %@ %.1f ns/op", benchmark.name, median.doubleValue);
+        [results setObject:[NSDictionary dictionaryWithObjectsAndKeys:
+                            median, @"ns_per_op",
+                            [NSNumber numberWithUnsignedInteger:benchmark.iterations], @"iterations",
+                            nil]
+                    forKey:benchmark.name];
+    }
+
+    return [NSDictionary dictionaryWithObjectsAndKeys:
+            [NSNumber numberWithInt:1], @"version",
+            results, @"benchmarks",
+            nil];
+}
+
++ (BOOL)writeResults:(NSDictionary *)results toFile:(NSString *)path {
+    NSError *error = nil;
+    NSData *data = [NSJSONSerialization dataWithJSONObject:results
+                                                   options:NSJSONWritingPrettyPrinted
+                                                     error:&error];
+    if (!data) {
+        NSLog(@"FBBenchmark: could not encode results: %@", error);
+        return NO;
+    }
+    return [data writeToFile:path atomically:YES];
+}
+
+@end
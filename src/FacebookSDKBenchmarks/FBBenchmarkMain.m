@@ -0,0 +1,45 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+#import "FBBenchmark.h"
+#import "FBDataBenchmarks.h"
+
+// Entry point of the GNUstep build (see GNUmakefile), which runs the Foundation-only
+// benchmarks:
+//   fb-benchmarks [output.json]
+int main(int argc, const char *argv[])
+{
+    int status = 0;
+    @autoreleasepool {
+        FBBenchmarkSuite *suite = [[[FBBenchmarkSuite alloc] init] autorelease];
+        [FBDataBenchmarks addBenchmarksToSuite:suite];
+
+        NSDictionary *results = [suite run];
+
+        NSString *path = argc > 1
+            ? [NSString stringWithUTF8String:argv[1]]
+            : [NSTemporaryDirectory() stringByAppendingPathComponent:@"FacebookSDKBenchmarks-gnustep.json"];
+        if ([FBBenchmarkSuite writeResults:results toFile:path]) {
+            NSLog(@"FBBenchmark: results written to %@", path);
+        } else {
+            NSLog(@"FBBenchmark: could not write results to %@", path);
+            status = 1;
+        }
+    }
+    return status;
+}
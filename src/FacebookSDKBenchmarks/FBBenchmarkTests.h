@@ -0,0 +1,25 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <SenTestingKit/SenTestingKit.h>
+
+// Runs the microbenchmark suite and writes the results as JSON to the path in the
+// FB_BENCHMARK_OUTPUT environment variable (set by scripts/run_benchmarks.sh), or to the
+// temporary directory. Regression checks against the stored baseline are done by the
+// script, so this test only fails if the results cannot be written.
+@interface FBBenchmarkTests : SenTestCase
+
+@end
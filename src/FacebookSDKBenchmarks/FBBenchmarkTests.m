@@ -0,0 +1,41 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "FBBenchmarkTests.h"
+
+#import "FBBenchmark.h"
+#import "FBDataBenchmarks.h"
+#import "FBSDKBenchmarks.h"
+
+@implementation FBBenchmarkTests
+
+- (void)testBenchmarks
+{
+    FBBenchmarkSuite *suite = [[[FBBenchmarkSuite alloc] init] autorelease];
+    [FBDataBenchmarks addBenchmarksToSuite:suite];
+    [FBSDKBenchmarks addBenchmarksToSuite:suite];
+
+    NSDictionary *results = [suite run];
+
+    NSString *path = [[[NSProcessInfo processInfo] environment] objectForKey:@"FB_BENCHMARK_OUTPUT"];
+    if (path.length == 0) {
+        path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"FacebookSDKBenchmarks.json"];
+    }
+    STAssertTrue([FBBenchmarkSuite writeResults:results toFile:path], @"could not write results to %@", path);
+    NSLog(@"FBBenchmark: results written to %@", path);
+}
+
+@end
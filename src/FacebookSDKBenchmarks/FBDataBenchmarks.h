@@ -0,0 +1,28 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+@class FBBenchmarkSuite;
+
+// Benchmarks over code that only depends on Foundation (FBGraphObject and FBBase64).
+// These are also built by the GNUstep GNUmakefile in this directory, so they must not
+// pull in UIKit or any other iOS-only framework.
+@interface FBDataBenchmarks : NSObject
+
++ (void)addBenchmarksToSuite:(FBBenchmarkSuite *)suite;
+
+@end
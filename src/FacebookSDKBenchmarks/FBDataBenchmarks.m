@@ -0,0 +1,140 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "FBDataBenchmarks.h"
+
+#import "FBBase64.h"
+#import "FBBenchmark.h"
+#import "FBGraphObject.h"
+#import "FBGraphSnapshot.h"
+#import "FBGraphUser.h"
+
+static NSDictionary *FBBenchmarkUserDictionary(NSUInteger index) {
+    NSDictionary *location = [NSDictionary dictionaryWithObjectsAndKeys:
+                              @"108424279189115", @"id",
+                              @"Menlo Park, California", @"name",
+                              nil];
+    return [NSDictionary dictionaryWithObjectsAndKeys:
+            [NSString stringWithFormat:@"%lu", (unsigned long)(100000000000000ULL + index)], @"id",
+            @"Jane Q. Benchmark", @"name",
+            @"Jane", @"first_name",
+            @"Benchmark", @"last_name",
+            @"https://www.facebook.com/jane.benchmark", @"link",
+            @"01/01/1980", @"birthday",
+            location, @"location",
+            [NSArray arrayWithObjects:location, location, nil], @"places",
+            nil];
+}
+
+@implementation FBDataBenchmarks
+
++ (void)addBenchmarksToSuite:(FBBenchmarkSuite *)suite {
+    NSMutableArray *users = [NSMutableArray arrayWithCapacity:100];
+    for (NSUInteger i = 0; i < 100; i++) {
+        [users addObject:FBBenchmarkUserDictionary(i)];
+    }
+
+    [suite addBenchmarkWithName:@"graph_object_wrap" iterations:200000 block:^(NSUInteger iterations) {
+        for (NSUInteger i = 0; i < iterations; i++) {
+            [FBGraphObject graphObjectWrappingDictionary:[users objectAtIndex:i % users.count]];
+        }
+    }];
+
+    NSMutableArray *graphUsers = [NSMutableArray arrayWithCapacity:users.count];
+    for (NSDictionary *user in users) {
+        [graphUsers addObject:[FBGraphObject graphObjectWrappingDictionary:user]];
+    }
+
+    // property access through the protocol is resolved dynamically by FBGraphObject
+    [suite addBenchmarkWithName:@"graph_object_accessors" iterations:200000 block:^(NSUInteger iterations) {
+        NSUInteger length = 0;
+        for (NSUInteger i = 0; i < iterations; i++) {
+            NSDictionary<FBGraphUser> *user = [graphUsers objectAtIndex:i % graphUsers.count];
+            length += user.first_name.length + user.last_name.length + user.id.length;
+        }
+        if (length == 0) {
+            NSLog(@"FBBenchmark: unexpected empty graph users");
+        }
+    }];
+
+    // nested containers are wrapped lazily on first access
+    [suite addBenchmarkWithName:@"graph_object_nested_access" iterations:200000 block:^(NSUInteger iterations) {
+        for (NSUInteger i = 0; i < iterations; i++) {
+            NSDictionary<FBGraphUser> *user = [FBGraphObject graphObjectWrappingDictionary:[users objectAtIndex:i % users.count]];
+            [[[user objectForKey:@"places"] objectAtIndex:0] objectForKey:@"name"];
+            [user.location objectForKey:@"name"];
+        }
+    }];
+
+    // a picker opening from its cache: sort a large friend list by name, then show a page of rows
+    NSMutableArray *friends = [NSMutableArray arrayWithCapacity:2000];
+    for (NSUInteger i = 0; i < 2000; i++) {
+        [friends addObject:FBBenchmarkUserDictionary(i)];
+    }
+    NSDictionary *friendList = [NSDictionary dictionaryWithObject:friends forKey:@"data"];
+    NSData *friendListJSON = [NSJSONSerialization dataWithJSONObject:friendList options:0 error:nil];
+    NSData *friendListSnapshot = [FBGraphSnapshot dataWithJSONObject:friendList];
+
+    void (^openPicker)(NSDictionary *) = ^(NSDictionary *list) {
+        NSArray *data = [[FBGraphObject graphObjectWrappingDictionary:list] objectForKey:@"data"];
+        NSUInteger length = 0;
+        for (NSDictionary<FBGraphUser> *user in data) {
+            length += user.name.length;
+        }
+        for (NSUInteger i = 0; i < 20; i++) {
+            NSDictionary<FBGraphUser> *user = [data objectAtIndex:i];
+            length += user.id.length + [[user.location objectForKey:@"name"] length];
+        }
+        if (length == 0) {
+            NSLog(@"FBBenchmark: unexpected empty friend list");
+        }
+    };
+
+    [suite addBenchmarkWithName:@"friend_list_open_json" iterations:20 block:^(NSUInteger iterations) {
+        for (NSUInteger i = 0; i < iterations; i++) {
+            openPicker([NSJSONSerialization JSONObjectWithData:friendListJSON options:0 error:nil]);
+        }
+    }];
+
+    [suite addBenchmarkWithName:@"friend_list_open_snapshot" iterations:20 block:^(NSUInteger iterations) {
+        for (NSUInteger i = 0; i < iterations; i++) {
+            FBGraphSnapshot *snapshot = [[FBGraphSnapshot alloc] initWithData:friendListSnapshot];
+            openPicker(snapshot.rootObject);
+            [snapshot release];
+        }
+    }];
+
+    NSMutableData *payload = [NSMutableData dataWithLength:4096];
+    uint8_t *bytes = payload.mutableBytes;
+    for (NSUInteger i = 0; i < payload.length; i++) {
+        bytes[i] = (uint8_t)(i * 31);
+    }
+    NSString *encodedPayload = FBEncodeBase64(payload);
+
+    [suite addBenchmarkWithName:@"base64_encode_4k" iterations:20000 block:^(NSUInteger iterations) {
+        for (NSUInteger i = 0; i < iterations; i++) {
+            FBEncodeBase64(payload);
+        }
+    }];
+
+    [suite addBenchmarkWithName:@"base64_decode_4k" iterations:20000 block:^(NSUInteger iterations) {
+        for (NSUInteger i = 0; i < iterations; i++) {
+            FBDecodeBase64(encodedPayload);
+        }
+    }];
+}
+
+@end
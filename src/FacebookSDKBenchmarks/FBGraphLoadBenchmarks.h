@@ -0,0 +1,29 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <SenTestingKit/SenTestingKit.h>
+
+@class FBGraphStandIn;
+
+// Load benchmarks for the networking paths of the SDK, run against FBGraphStandIn in the
+// FacebookSDKBenchmarks target. Each scenario checks that every operation completed, and
+// logs a single line of JSON (prefixed with "FBBenchmark:") holding its throughput,
+// latency percentiles, bytes served and heap growth.
+@interface FBGraphLoadBenchmarks : SenTestCase
+
+@property (nonatomic, retain) FBGraphStandIn *standIn;
+
+@end
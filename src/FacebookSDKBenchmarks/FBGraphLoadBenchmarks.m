@@ -0,0 +1,319 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "FBGraphLoadBenchmarks.h"
+
+#import <malloc/malloc.h>
+
+#import "FBAccessTokenData.h"
+#import "FBAppEvents.h"
+#import "FBGraphObjectPagingLoader.h"
+#import "FBGraphObjectTableDataSource.h"
+#import "FBGraphStandIn.h"
+#import "FBRequest.h"
+#import "FBRequestConnection.h"
+#import "FBSession.h"
+#import "FBSessionTokenCachingStrategy.h"
+#import "FBSettings.h"
+#import "FBTestBlocker.h"
+#import "FBURLConnection.h"
+#import "FBUtility.h"
+
+static const NSUInteger kBatchConnectionCount = 20;
+static const NSUInteger kRequestsPerBatch = 50;
+static const NSUInteger kPagingLoadCount = 10;
+static const NSUInteger kAppEventFlushCount = 10;
+static const NSUInteger kEventsPerFlush = 100;
+static const NSUInteger kImageLoadCount = 200;
+static const NSTimeInterval kScenarioTimeout = 120;
+
+// Snapshot of the default malloc zone, to report net heap growth over a scenario.
+typedef struct {
+    size_t blocksInUse;
+    size_t sizeInUse;
+} FBHeapSnapshot;
+
+static FBHeapSnapshot FBHeapSnapshotTake(void) {
+    malloc_statistics_t stats;
+    malloc_zone_statistics(NULL, &stats);
+    FBHeapSnapshot snapshot = { stats.blocks_in_use, stats.size_in_use };
+    return snapshot;
+}
+
+@interface FBGraphLoadBenchmarks () <FBGraphObjectPagingLoaderDelegate>
+
+@property (nonatomic, retain) FBTestBlocker *pagingBlocker;
+@property (nonatomic, retain) FBSession *session;
+
+@end
+
+@implementation FBGraphLoadBenchmarks
+
+@synthesize standIn = _standIn;
+@synthesize pagingBlocker = _pagingBlocker;
+@synthesize session = _session;
+
+- (void)setUp {
+    [super setUp];
+
+    FBGraphStandIn *standIn = [[FBGraphStandIn alloc] init];
+    standIn.latency = 0.005;
+    standIn.payloadBytes = 256;
+    self.standIn = standIn;
+    [standIn release];
+
+    [self.standIn start];
+
+    // Paging follows `next` links only for a session; the stand-in accepts any token, and a
+    // fresh refresh date keeps the session from extending it during a scenario.
+    FBAccessTokenData *token = [FBAccessTokenData createTokenFromString:@"standInAccessToken"
+                                                            permissions:nil
+                                                         expirationDate:[NSDate distantFuture]
+                                                              loginType:FBSessionLoginTypeNone
+                                                            refreshDate:[NSDate date]];
+    FBSession *session = [[FBSession alloc] initWithAppID:@"123456789012345"
+                                              permissions:nil
+                                          urlSchemeSuffix:nil
+                                       tokenCacheStrategy:[FBSessionTokenCachingStrategy nullCacheInstance]];
+    [session openFromAccessTokenData:token completionHandler:nil];
+    self.session = session;
+    [session release];
+}
+
+- (void)tearDown {
+    [self.session close];
+    self.session = nil;
+    [self.standIn stop];
+    self.standIn = nil;
+    self.pagingBlocker = nil;
+
+    [super tearDown];
+}
+
+#pragma mark - Reporting
+
+- (void)reportScenario:(NSString *)scenario
+            operations:(NSUInteger)operations
+             latencies:(NSMutableArray *)latencies
+               elapsed:(NSTimeInterval)elapsed
+          heapSnapshot:(FBHeapSnapshot)before {
+    FBHeapSnapshot after = FBHeapSnapshotTake();
+
+    [latencies sortUsingSelector:@selector(compare:)];
+    double p50 = 0, p99 = 0;
+    if (latencies.count) {
+        p50 = [[latencies objectAtIndex:latencies.count / 2] doubleValue];
+        p99 = [[latencies objectAtIndex:MIN(latencies.count - 1, latencies.count * 99 / 100)] doubleValue];
+    }
+
+    NSDictionary *result = [NSDictionary dictionaryWithObjectsAndKeys:
+                            scenario, @"scenario",
+                            [NSNumber numberWithUnsignedInteger:operations], @"operations",
+                            [NSNumber numberWithDouble:elapsed], @"seconds",
+                            [NSNumber numberWithDouble:elapsed > 0 ? operations / elapsed : 0], @"ops_per_second",
+                            [NSNumber numberWithDouble:p50 * 1000], @"p50_ms",
+                            [NSNumber numberWithDouble:p99 * 1000], @"p99_ms",
+                            [NSNumber numberWithLongLong:self.standIn.requestCount], @"http_requests",
+                            [NSNumber numberWithLongLong:self.standIn.bytesServed], @"bytes_served",
+                            [NSNumber numberWithLongLong:(long long)after.blocksInUse - (long long)before.blocksInUse], @"heap_blocks_delta",
+                            [NSNumber numberWithLongLong:(long long)after.sizeInUse - (long long)before.sizeInUse], @"heap_bytes_delta",
+                            nil];
+    NSLog(@"FBBenchmark: %@", [FBUtility simpleJSONEncode:result]);
+}
+
+#pragma mark - Scenarios
+
+- (void)testBatchedRequestThroughput {
+    NSMutableArray *latencies = [NSMutableArray arrayWithCapacity:kBatchConnectionCount];
+    FBTestBlocker *blocker = [[[FBTestBlocker alloc] initWithExpectedSignalCount:kBatchConnectionCount] autorelease];
+    __block NSUInteger failures = 0;
+
+    FBHeapSnapshot heap = FBHeapSnapshotTake();
+    NSDate *start = [NSDate date];
+    for (NSUInteger i = 0; i < kBatchConnectionCount; i++) {
+        FBRequestConnection *connection = [[FBRequestConnection alloc] init];
+        __block NSUInteger outstanding = kRequestsPerBatch;
+        NSDate *connectionStart = [NSDate date];
+
+        for (NSUInteger j = 0; j < kRequestsPerBatch; j++) {
+            FBRequest *request = [[FBRequest alloc] initWithSession:nil
+                                                          graphPath:[NSString stringWithFormat:@"%lu", (unsigned long)(1000 + j)]];
+            [connection addRequest:request completionHandler:^(FBRequestConnection *innerConnection, id result, NSError *error) {
+                if (error) {
+                    failures++;
+                }
+                if (--outstanding == 0) {
+                    [latencies addObject:[NSNumber numberWithDouble:-[connectionStart timeIntervalSinceNow]]];
+                    [blocker signal];
+                }
+            }];
+            [request release];
+        }
+
+        [connection start];
+        [connection release];
+    }
+
+    STAssertTrue([blocker waitWithTimeout:kScenarioTimeout], @"batches did not complete");
+    NSTimeInterval elapsed = -[start timeIntervalSinceNow];
+
+    STAssertEquals(failures, (NSUInteger)0, @"unexpected request failures");
+    STAssertEquals(self.standIn.batchItemCount, (int64_t)(kBatchConnectionCount * kRequestsPerBatch), @"batch items not all served");
+    [self reportScenario:@"batch_requests"
+              operations:kBatchConnectionCount * kRequestsPerBatch
+               latencies:latencies
+                 elapsed:elapsed
+            heapSnapshot:heap];
+}
+
+- (void)testPagingLoaderThroughput {
+    self.standIn.edgeItemCount = 1000;
+    self.standIn.pageSize = 100;
+
+    NSMutableArray *latencies = [NSMutableArray arrayWithCapacity:kPagingLoadCount];
+    FBHeapSnapshot heap = FBHeapSnapshotTake();
+    NSDate *start = [NSDate date];
+    [self.standIn resetCounters];
+
+    for (NSUInteger i = 0; i < kPagingLoadCount; i++) {
+        FBGraphObjectTableDataSource *dataSource = [[FBGraphObjectTableDataSource alloc] init];
+        FBGraphObjectPagingLoader *loader = [[FBGraphObjectPagingLoader alloc] initWithDataSource:dataSource
+                                                                                      pagingMode:FBGraphObjectPagingModeImmediateViewless];
+        loader.delegate = self;
+        loader.session = self.session;
+        self.pagingBlocker = [[[FBTestBlocker alloc] init] autorelease];
+
+        NSDate *loadStart = [NSDate date];
+        FBRequest *request = [[FBRequest alloc] initWithSession:self.session graphPath:@"me/friends"];
+        [loader startLoadingWithRequest:request cacheIdentity:nil skipRoundtripIfCached:NO];
+        [request release];
+
+        STAssertTrue([self.pagingBlocker waitWithTimeout:kScenarioTimeout], @"paging did not finish");
+        [latencies addObject:[NSNumber numberWithDouble:-[loadStart timeIntervalSinceNow]]];
+
+        loader.delegate = nil;
+        [loader release];
+        [dataSource release];
+    }
+
+    NSTimeInterval elapsed = -[start timeIntervalSinceNow];
+
+    // each load is every page of the edge, then the empty page that ends it
+    NSUInteger pagesPerLoad = (self.standIn.edgeItemCount + self.standIn.pageSize - 1) / self.standIn.pageSize + 1;
+    STAssertTrue(self.standIn.requestCount >= (int64_t)(kPagingLoadCount * pagesPerLoad), @"not every page was loaded");
+    [self reportScenario:@"paging_loader"
+              operations:kPagingLoadCount * self.standIn.edgeItemCount
+               latencies:latencies
+                 elapsed:elapsed
+            heapSnapshot:heap];
+}
+
+- (void)testAppEventsFlushThroughput {
+    NSString *savedAppID = [[FBSettings defaultAppID] retain];
+    NSString *savedClientToken = [[FBSettings clientToken] retain];
+    FBAppEventsFlushBehavior savedFlushBehavior = [FBAppEvents flushBehavior];
+
+    [FBSettings setDefaultAppID:@"123456789012345"];
+    [FBSettings setClientToken:@"standInClientToken"];
+    [FBAppEvents setFlushBehavior:FBAppEventsFlushBehaviorExplicitOnly];
+
+    NSMutableArray *latencies = [NSMutableArray arrayWithCapacity:kAppEventFlushCount];
+    FBHeapSnapshot heap = FBHeapSnapshotTake();
+    NSDate *start = [NSDate date];
+
+    for (NSUInteger i = 0; i < kAppEventFlushCount; i++) {
+        for (NSUInteger j = 0; j < kEventsPerFlush; j++) {
+            [FBAppEvents logEvent:FBAppEventNameViewedContent
+                       parameters:[NSDictionary dictionaryWithObject:[NSString stringWithFormat:@"item%lu", (unsigned long)j]
+                                                              forKey:FBAppEventParameterNameContentID]];
+        }
+
+        int64_t expectedPosts = self.standIn.activitiesPostCount + 1;
+        NSDate *flushStart = [NSDate date];
+        [FBAppEvents flush];
+
+        FBTestBlocker *blocker = [[[FBTestBlocker alloc] init] autorelease];
+        FBGraphStandIn *standIn = self.standIn;
+        STAssertTrue([blocker waitWithTimeout:kScenarioTimeout periodicHandler:^(FBTestBlocker *innerBlocker) {
+            if (standIn.activitiesPostCount >= expectedPosts) {
+                [innerBlocker signal];
+            }
+        }], @"flush did not reach the server");
+        [latencies addObject:[NSNumber numberWithDouble:-[flushStart timeIntervalSinceNow]]];
+    }
+
+    NSTimeInterval elapsed = -[start timeIntervalSinceNow];
+    [self reportScenario:@"app_events_flush"
+              operations:kAppEventFlushCount * kEventsPerFlush
+               latencies:latencies
+                 elapsed:elapsed
+            heapSnapshot:heap];
+
+    [FBAppEvents setFlushBehavior:savedFlushBehavior];
+    [FBSettings setClientToken:savedClientToken];
+    [FBSettings setDefaultAppID:savedAppID];
+    [savedClientToken release];
+    [savedAppID release];
+}
+
+- (void)testImageLoadThroughput {
+    self.standIn.imageBytes = 32 * 1024;
+
+    NSMutableArray *latencies = [NSMutableArray arrayWithCapacity:kImageLoadCount];
+    FBTestBlocker *blocker = [[[FBTestBlocker alloc] initWithExpectedSignalCount:kImageLoadCount] autorelease];
+    __block NSUInteger bytesReceived = 0;
+
+    FBHeapSnapshot heap = FBHeapSnapshotTake();
+    NSDate *start = [NSDate date];
+    for (NSUInteger i = 0; i < kImageLoadCount; i++) {
+        NSURL *url = [NSURL URLWithString:[NSString stringWithFormat:@"https://fbcdn-profile-a.akamaihd.net/standin/%lu_q.jpg",
+                                           (unsigned long)i]];
+        NSDate *loadStart = [NSDate date];
+        FBURLConnection *connection = [[FBURLConnection alloc] initWithURL:url
+                                                          completionHandler:^(FBURLConnection *innerConnection,
+                                                                              NSError *error,
+                                                                              NSURLResponse *response,
+                                                                              NSData *responseData) {
+            bytesReceived += responseData.length;
+            [latencies addObject:[NSNumber numberWithDouble:-[loadStart timeIntervalSinceNow]]];
+            [blocker signal];
+        }];
+        [connection release];
+    }
+
+    STAssertTrue([blocker waitWithTimeout:kScenarioTimeout], @"image loads did not complete");
+    NSTimeInterval elapsed = -[start timeIntervalSinceNow];
+
+    STAssertEquals(bytesReceived, kImageLoadCount * self.standIn.imageBytes, @"unexpected image bytes");
+    [self reportScenario:@"image_loads"
+              operations:kImageLoadCount
+               latencies:latencies
+                 elapsed:elapsed
+            heapSnapshot:heap];
+}
+
+#pragma mark - FBGraphObjectPagingLoaderDelegate
+
+- (void)pagingLoaderDidFinishLoading:(FBGraphObjectPagingLoader *)pagingLoader {
+    [self.pagingBlocker signal];
+}
+
+- (void)pagingLoader:(FBGraphObjectPagingLoader *)pagingLoader handleError:(NSError *)error {
+    STFail(@"paging failed: %@", error);
+    [self.pagingBlocker signal];
+}
+
+@end
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+/*
+ A local stand-in for the Graph API, for load and performance testing without network
+ access or a live app. It intercepts every request the SDK makes (through OHHTTPStubs)
+ and answers:
+
+   - batch requests (POST to the Graph root with a `batch` parameter), item by item
+   - `me/permissions`
+   - `<app id>/activities` (app events)
+   - `me/friends` and any other `.../friends` or `.../feed` edge, paged with `after`
+     cursors and absolute `next` links, and ending with an empty page
+   - `.../picture` and CDN (fbcdn) image URLs, with image bytes of a configurable size
+   - anything else as a single graph object
+
+ Latency, error rate and payload sizes are configurable, and the stand-in counts the
+ requests and bytes it has served.
+ */
+@interface FBGraphStandIn : NSObject
+
+// Simulated response time for each HTTP round trip.
+@property (nonatomic, assign) NSTimeInterval latency;
+// Fraction (0-1) of requests, or of batch items, that fail with a transient server error.
+@property (nonatomic, assign) double errorRate;
+// Bytes of padding added to every graph object returned.
+@property (nonatomic, assign) NSUInteger payloadBytes;
+// Total number of objects on a paged edge, and how many are returned per page.
+@property (nonatomic, assign) NSUInteger edgeItemCount;
+@property (nonatomic, assign) NSUInteger pageSize;
+// Size of image responses.
+@property (nonatomic, assign) NSUInteger imageBytes;
+
+@property (nonatomic, readonly) int64_t requestCount;
+@property (nonatomic, readonly) int64_t batchItemCount;
+@property (nonatomic, readonly) int64_t activitiesPostCount;
+@property (nonatomic, readonly) int64_t bytesServed;
+
+// Starts answering requests; only one stand-in should be started at a time.
+- (void)start;
+- (void)stop;
+- (void)resetCounters;
+
+@end
@@ -0,0 +1,294 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "FBGraphStandIn.h"
+
+#import <libkern/OSAtomic.h>
+#import <OHHTTPStubs/OHHTTPStubs.h>
+
+#import "FBUtility.h"
+
+static NSString *const kStandInUserID = @"100000000000001";
+
+@interface FBGraphStandIn () {
+    volatile int64_t _requestCount;
+    volatile int64_t _batchItemCount;
+    volatile int64_t _activitiesPostCount;
+    volatile int64_t _bytesServed;
+    BOOL _started;
+}
+
+@end
+
+@implementation FBGraphStandIn
+
+@synthesize latency = _latency;
+@synthesize errorRate = _errorRate;
+@synthesize payloadBytes = _payloadBytes;
+@synthesize edgeItemCount = _edgeItemCount;
+@synthesize pageSize = _pageSize;
+@synthesize imageBytes = _imageBytes;
+
+- (id)init {
+    if ((self = [super init])) {
+        _edgeItemCount = 500;
+        _pageSize = 100;
+        _imageBytes = 16 * 1024;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [self stop];
+    [super dealloc];
+}
+
+#pragma mark - Counters
+
+- (int64_t)requestCount {
+    return OSAtomicAdd64Barrier(0, &_requestCount);
+}
+
+- (int64_t)batchItemCount {
+    return OSAtomicAdd64Barrier(0, &_batchItemCount);
+}
+
+- (int64_t)activitiesPostCount {
+    return OSAtomicAdd64Barrier(0, &_activitiesPostCount);
+}
+
+- (int64_t)bytesServed {
+    return OSAtomicAdd64Barrier(0, &_bytesServed);
+}
+
+static void FBGraphStandInResetCounter(volatile int64_t *counter) {
+    int64_t value;
+    do {
+        value = *counter;
+    } while (!OSAtomicCompareAndSwap64Barrier(value, 0, counter));
+}
+
+- (void)resetCounters {
+    FBGraphStandInResetCounter(&_requestCount);
+    FBGraphStandInResetCounter(&_batchItemCount);
+    FBGraphStandInResetCounter(&_activitiesPostCount);
+    FBGraphStandInResetCounter(&_bytesServed);
+}
+
+#pragma mark - Lifetime
+
+- (void)start {
+    if (_started) {
+        return;
+    }
+    _started = YES;
+
+    // The handler is only removed in stop, which runs no later than dealloc.
+    FBGraphStandIn *standIn = self;
+    [OHHTTPStubs shouldStubRequestsPassingTest:^BOOL(NSURLRequest *request) {
+        return YES;
+    } withStubResponse:^OHHTTPStubsResponse *(NSURLRequest *request) {
+        return [standIn responseForRequest:request];
+    }];
+}
+
+- (void)stop {
+    if (_started) {
+        _started = NO;
+        [OHHTTPStubs removeAllRequestHandlers];
+    }
+}
+
+#pragma mark - Routing
+
+- (BOOL)shouldFail {
+    return self.errorRate > 0 && arc4random_uniform(10000) < self.errorRate * 10000;
+}
+
+- (OHHTTPStubsResponse *)responseForRequest:(NSURLRequest *)request {
+    OSAtomicIncrement64Barrier(&_requestCount);
+
+    NSURL *url = request.URL;
+    NSData *data;
+    int statusCode = 200;
+    NSString *contentType = @"text/javascript; charset=UTF-8";
+
+    if ([self isImageURL:url]) {
+        data = [NSMutableData dataWithLength:self.imageBytes];
+        contentType = @"image/jpeg";
+    } else if ([self shouldFail]) {
+        statusCode = 500;
+        data = [self encode:[self errorObject]];
+    } else {
+        NSString *batch = [self batchParameterFromRequest:request];
+        if (batch) {
+            data = [self encode:[self responseForBatch:batch]];
+        } else {
+            NSDictionary *query = [FBUtility dictionaryByParsingURLQueryPart:url.query];
+            NSDictionary *item = [self responseForMethod:request.HTTPMethod path:url.path query:query];
+            statusCode = [[item objectForKey:@"code"] intValue];
+            data = [self encode:[item objectForKey:@"body"]];
+        }
+    }
+
+    OSAtomicAdd64Barrier(data.length, &_bytesServed);
+    return [OHHTTPStubsResponse responseWithData:data
+                                      statusCode:statusCode
+                                    responseTime:self.latency
+                                         headers:[NSDictionary dictionaryWithObject:contentType forKey:@"Content-Type"]];
+}
+
+- (BOOL)isImageURL:(NSURL *)url {
+    return [url.host rangeOfString:@"fbcdn"].location != NSNotFound ||
+        [url.lastPathComponent isEqualToString:@"picture"];
+}
+
+- (NSData *)encode:(id)object {
+    return [[FBUtility simpleJSONEncode:object] dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+- (NSDictionary *)errorObject {
+    return [NSDictionary dictionaryWithObject:[NSDictionary dictionaryWithObjectsAndKeys:
+                                               @"Stand-in transient error", @"message",
+                                               @"FacebookApiException", @"type",
+                                               [NSNumber numberWithInt:2], @"code",
+                                               nil]
+                                       forKey:@"error"];
+}
+
+// The SDK posts batches as multipart form data; pull out the `batch` field.
+- (NSString *)batchParameterFromRequest:(NSURLRequest *)request {
+    NSData *body = request.HTTPBody;
+    if (!body.length || ![request.HTTPMethod isEqualToString:@"POST"]) {
+        return nil;
+    }
+
+    NSData *fieldName = [@"name=\"batch\"" dataUsingEncoding:NSUTF8StringEncoding];
+    NSRange nameRange = [body rangeOfData:fieldName options:0 range:NSMakeRange(0, body.length)];
+    if (nameRange.location == NSNotFound) {
+        return nil;
+    }
+
+    NSData *separator = [@"\r\n\r\n" dataUsingEncoding:NSUTF8StringEncoding];
+    NSUInteger searchStart = NSMaxRange(nameRange);
+    NSRange separatorRange = [body rangeOfData:separator options:0 range:NSMakeRange(searchStart, body.length - searchStart)];
+    if (separatorRange.location == NSNotFound) {
+        return nil;
+    }
+
+    NSUInteger valueStart = NSMaxRange(separatorRange);
+    NSData *terminator = [@"\r\n--" dataUsingEncoding:NSUTF8StringEncoding];
+    NSRange terminatorRange = [body rangeOfData:terminator options:0 range:NSMakeRange(valueStart, body.length - valueStart)];
+    NSUInteger valueEnd = terminatorRange.location == NSNotFound ? body.length : terminatorRange.location;
+
+    return [[[NSString alloc] initWithData:[body subdataWithRange:NSMakeRange(valueStart, valueEnd - valueStart)]
+                                  encoding:NSUTF8StringEncoding] autorelease];
+}
+
+- (NSArray *)responseForBatch:(NSString *)batch {
+    NSArray *items = [FBUtility simpleJSONDecode:batch];
+    NSMutableArray *responses = [NSMutableArray arrayWithCapacity:items.count];
+    for (NSDictionary *item in items) {
+        OSAtomicIncrement64Barrier(&_batchItemCount);
+
+        NSString *relativeURL = [item objectForKey:@"relative_url"];
+        NSURL *url = [NSURL URLWithString:[@"/" stringByAppendingString:relativeURL ?: @""]];
+        NSDictionary *query = [FBUtility dictionaryByParsingURLQueryPart:url.query];
+        NSDictionary *response = [self shouldFail]
+            ? [NSDictionary dictionaryWithObjectsAndKeys:[NSNumber numberWithInt:500], @"code", [self errorObject], @"body", nil]
+            : [self responseForMethod:[item objectForKey:@"method"] path:url.path query:query];
+
+        // batch item bodies are JSON strings
+        [responses addObject:[NSDictionary dictionaryWithObjectsAndKeys:
+                              [response objectForKey:@"code"], @"code",
+                              [FBUtility simpleJSONEncode:[response objectForKey:@"body"]], @"body",
+                              nil]];
+    }
+    return responses;
+}
+
+- (NSDictionary *)responseForMethod:(NSString *)method path:(NSString *)path query:(NSDictionary *)query {
+    NSArray *components = [path.pathComponents filteredArrayUsingPredicate:
+                           [NSPredicate predicateWithFormat:@"SELF != '/'"]];
+    NSString *edge = components.lastObject;
+    id body;
+
+    if ([edge isEqualToString:@"permissions"]) {
+        NSDictionary *permissions = [NSDictionary dictionaryWithObjectsAndKeys:
+                                     [NSNumber numberWithInt:1], @"installed",
+                                     [NSNumber numberWithInt:1], @"basic_info",
+                                     [NSNumber numberWithInt:1], @"user_friends",
+                                     nil];
+        body = [NSDictionary dictionaryWithObject:[NSArray arrayWithObject:permissions] forKey:@"data"];
+    } else if ([edge isEqualToString:@"activities"] && [[method uppercaseString] isEqualToString:@"POST"]) {
+        OSAtomicIncrement64Barrier(&_activitiesPostCount);
+        body = [NSNumber numberWithBool:YES];
+    } else if ([edge isEqualToString:@"friends"] || [edge isEqualToString:@"feed"]) {
+        body = [self pageOfPath:path query:query];
+    } else {
+        body = [self objectWithID:(components.count ? [components objectAtIndex:0] : kStandInUserID)];
+    }
+
+    return [NSDictionary dictionaryWithObjectsAndKeys:[NSNumber numberWithInt:200], @"code", body, @"body", nil];
+}
+
+- (NSDictionary *)objectWithID:(NSString *)objectID {
+    if ([objectID isEqualToString:@"me"]) {
+        objectID = kStandInUserID;
+    }
+
+    NSMutableDictionary *object = [NSMutableDictionary dictionaryWithObjectsAndKeys:
+                                   objectID, @"id",
+                                   [NSString stringWithFormat:@"Stand-in %@", objectID], @"name",
+                                   nil];
+    if (self.payloadBytes) {
+        [object setObject:[@"" stringByPaddingToLength:self.payloadBytes withString:@"x" startingAtIndex:0]
+                   forKey:@"padding"];
+    }
+    return object;
+}
+
+- (NSDictionary *)pageOfPath:(NSString *)path query:(NSDictionary *)query {
+    NSUInteger limit = [[query objectForKey:@"limit"] integerValue] ?: self.pageSize;
+    NSUInteger start = MIN((NSUInteger)[[query objectForKey:@"after"] integerValue], self.edgeItemCount);
+    NSUInteger end = MIN(start + limit, self.edgeItemCount);
+
+    NSMutableArray *data = [NSMutableArray arrayWithCapacity:end - start];
+    for (NSUInteger i = start; i < end; i++) {
+        [data addObject:[self objectWithID:[NSString stringWithFormat:@"%llu", 200000000000000ULL + i]]];
+    }
+
+    NSMutableDictionary *paging = [NSMutableDictionary dictionaryWithObject:
+                                   [NSDictionary dictionaryWithObjectsAndKeys:
+                                    [NSString stringWithFormat:@"%lu", (unsigned long)start], @"before",
+                                    [NSString stringWithFormat:@"%lu", (unsigned long)end], @"after",
+                                    nil]
+                                                                     forKey:@"cursors"];
+    // as in the Graph API, every non-empty page links to the next one, and the edge ends
+    // with an empty page; that empty page is what tells the paging loader it is done
+    if (end > start) {
+        NSString *next = [NSString stringWithFormat:@"%@%@?limit=%lu&after=%lu",
+                          [FBUtility buildFacebookUrlWithPre:@"https://graph."],
+                          path,
+                          (unsigned long)limit,
+                          (unsigned long)end];
+        [paging setObject:next forKey:@"next"];
+    }
+
+    return [NSDictionary dictionaryWithObjectsAndKeys:data, @"data", paging, @"paging", nil];
+}
+
+@end
@@ -0,0 +1,296 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "FBSDKBenchmarks.h"
+
+#import "FBBenchmark.h"
+#import "FBCacheIndex.h"
+#import "FBCrypto.h"
+#import "FBLogRedactor.h"
+#import "FBRequest.h"
+#import "FBRequestBody.h"
+#import "FBRequestConnection.h"
+#import "FBRequestConnection+Internal.h"
+#import "FBTask.h"
+#import "FBTaskCompletionSource.h"
+#import "FBUtility.h"
+
+static const NSUInteger kBatchSize = 50;
+static const NSUInteger kContinuationsPerPool = 10000;
+
+// FBCacheIndex only reports file operations; the benchmarks measure the index itself,
+// so every file is reported as placed right away.
+@interface FBBenchmarkCacheIndexDelegate : NSObject <FBCacheIndexFileDelegate>
+@end
+
+@implementation FBBenchmarkCacheIndexDelegate
+
+- (void)cacheIndex:(FBCacheIndex *)cacheIndex writeFileWithName:(NSString *)name data:(NSData *)data completion:(void (^)(BOOL))completion {
+    completion(YES);
+}
+
+- (void)cacheIndex:(FBCacheIndex *)cacheIndex moveFileAtPath:(NSString *)path toFileWithName:(NSString *)name completion:(void (^)(BOOL))completion {
+    completion(YES);
+}
+
+- (void)cacheIndex:(FBCacheIndex *)cacheIndex deleteFileWithName:(NSString *)name {
+}
+
+- (void)cacheIndex:(FBCacheIndex *)cacheIndex deleteFilesWithNames:(NSArray *)names {
+}
+
+@end
+
+@implementation FBSDKBenchmarks
+
++ (NSDictionary *)graphResponseObject {
+    NSMutableArray *data = [NSMutableArray arrayWithCapacity:25];
+    for (int i = 0; i < 25; i++) {
+        [data addObject:[NSDictionary dictionaryWithObjectsAndKeys:
+                         [NSString stringWithFormat:@"%d", 100000 + i], @"id",
+                         @"Jane Q. Benchmark", @"name",
+                         [NSNumber numberWithDouble:37.4847 + i], @"latitude",
+                         [NSNumber numberWithBool:i % 2], @"installed",
+                         nil]];
+    }
+    return [NSDictionary dictionaryWithObjectsAndKeys:
+            data, @"data",
+            [NSDictionary dictionaryWithObject:@"https://graph.facebook.com/me/friends?after=25" forKey:@"next"], @"paging",
+            nil];
+}
+
++ (void)addBenchmarksToSuite:(FBBenchmarkSuite *)suite {
+    [self addEncodingBenchmarksToSuite:suite];
+    [self addRequestBenchmarksToSuite:suite];
+    [self addCacheIndexBenchmarksToSuite:suite];
+    [self addCryptoBenchmarksToSuite:suite];
+    [self addLoggerBenchmarksToSuite:suite];
+    [self addTaskBenchmarksToSuite:suite];
+}
+
++ (void)addEncodingBenchmarksToSuite:(FBBenchmarkSuite *)suite {
+    NSDictionary *object = [self graphResponseObject];
+    NSString *json = [FBUtility simpleJSONEncode:object];
+
+    [suite addBenchmarkWithName:@"json_encode" iterations:5000 block:^(NSUInteger iterations) {
+        for (NSUInteger i = 0; i < iterations; i++) {
+            [FBUtility simpleJSONEncode:object];
+        }
+    }];
+
+    [suite addBenchmarkWithName:@"json_decode" iterations:5000 block:^(NSUInteger iterations) {
+        for (NSUInteger i = 0; i < iterations; i++) {
+            [FBUtility simpleJSONDecode:json];
+        }
+    }];
+
+    NSDictionary *parameters = [NSDictionary dictionaryWithObjectsAndKeys:
+                                @"id,name,picture.width(100).height(100),installed", @"fields",
+                                @"CAAAbenchmarkAccessToken1234567890", @"access_token",
+                                @"100", @"limit",
+                                @"json", @"format",
+                                @"ios", @"sdk",
+                                @"name = \"Jane & John\"", @"q",
+                                nil];
+    NSString *query = [FBUtility stringBySerializingQueryParameters:parameters];
+
+    [suite addBenchmarkWithName:@"query_serialize" iterations:20000 block:^(NSUInteger iterations) {
+        for (NSUInteger i = 0; i < iterations; i++) {
+            [FBUtility stringBySerializingQueryParameters:parameters];
+        }
+    }];
+
+    [suite addBenchmarkWithName:@"query_parse" iterations:20000 block:^(NSUInteger iterations) {
+        for (NSUInteger i = 0; i < iterations; i++) {
+            [FBUtility dictionaryByParsingURLQueryPart:query];
+        }
+    }];
+}
+
++ (void)addRequestBenchmarksToSuite:(FBBenchmarkSuite *)suite {
+    NSMutableArray *batch = [NSMutableArray arrayWithCapacity:kBatchSize];
+    NSMutableArray *batchResponse = [NSMutableArray arrayWithCapacity:kBatchSize];
+    NSString *body = [FBUtility simpleJSONEncode:[self graphResponseObject]];
+    for (NSUInteger i = 0; i < kBatchSize; i++) {
+        [batch addObject:[NSDictionary dictionaryWithObjectsAndKeys:
+                          @"GET", @"method",
+                          [NSString stringWithFormat:@"%lu?fields=id,name", (unsigned long)(1000 + i)], @"relative_url",
+                          nil]];
+        [batchResponse addObject:[NSDictionary dictionaryWithObjectsAndKeys:
+                                  [NSNumber numberWithInt:200], @"code",
+                                  body, @"body",
+                                  nil]];
+    }
+    NSString *batchJSON = [FBUtility simpleJSONEncode:batch];
+    NSData *attachment = [NSMutableData dataWithLength:16 * 1024];
+
+    [suite addBenchmarkWithName:@"request_body_batch" iterations:2000 block:^(NSUInteger iterations) {
+        for (NSUInteger i = 0; i < iterations; i++) {
+            FBRequestBody *requestBody = [[FBRequestBody alloc] init];
+            [requestBody appendWithKey:@"batch" formValue:batchJSON logger:nil];
+            [requestBody appendWithKey:@"access_token" formValue:@"CAAAbenchmarkAccessToken1234567890" logger:nil];
+            [requestBody appendWithKey:@"file1" dataValue:attachment logger:nil];
+            [requestBody data];
+            [requestBody release];
+        }
+    }];
+
+    FBRequestConnection *connection = [[[FBRequestConnection alloc] init] autorelease];
+    for (NSUInteger i = 0; i < kBatchSize; i++) {
+        [connection addRequest:[FBRequest requestForGraphPath:[NSString stringWithFormat:@"%lu", (unsigned long)(1000 + i)]]
+             completionHandler:nil];
+    }
+    NSData *responseData = [[FBUtility simpleJSONEncode:batchResponse] dataUsingEncoding:NSUTF8StringEncoding];
+
+    [suite addBenchmarkWithName:@"parse_batch_response" iterations:200 block:^(NSUInteger iterations) {
+        for (NSUInteger i = 0; i < iterations; i++) {
+            NSError *error = nil;
+            [connection parseJSONResponse:responseData error:&error statusCode:200];
+        }
+    }];
+}
+
++ (void)addCacheIndexBenchmarksToSuite:(FBBenchmarkSuite *)suite {
+    NSString *folder = [NSTemporaryDirectory() stringByAppendingPathComponent:@"FBBenchmarkCacheIndex"];
+    [[NSFileManager defaultManager] removeItemAtPath:folder error:nil];
+    [[NSFileManager defaultManager] createDirectoryAtPath:folder withIntermediateDirectories:YES attributes:nil error:nil];
+
+    // the index does not retain its delegate, and lives as long as the suite's blocks
+    static FBBenchmarkCacheIndexDelegate *delegate = nil;
+    if (!delegate) {
+        delegate = [[FBBenchmarkCacheIndexDelegate alloc] init];
+    }
+    FBCacheIndex *index = [[[FBCacheIndex alloc] initWithCacheFolder:folder] autorelease];
+    index.delegate = delegate;
+    index.diskCapacity = NSUIntegerMax;
+
+    NSData *entry = [NSMutableData dataWithLength:1024];
+    NSMutableArray *keys = [NSMutableArray arrayWithCapacity:1000];
+    // files are shared by identical payloads, so trimming needs distinct ones
+    NSMutableArray *distinctEntries = [NSMutableArray arrayWithCapacity:1000];
+    for (NSUInteger i = 0; i < 1000; i++) {
+        [keys addObject:[NSString stringWithFormat:@"https://graph.facebook.com/%lu/picture", (unsigned long)i]];
+        NSMutableData *distinctEntry = [NSMutableData dataWithLength:entry.length];
+        memcpy(distinctEntry.mutableBytes, &i, sizeof(i));
+        [distinctEntries addObject:distinctEntry];
+    }
+
+    // stores are applied asynchronously, and indexed in a second pass once the file is placed;
+    // the time includes draining the database queue twice
+    [suite addBenchmarkWithName:@"cache_index_insert" iterations:1000 block:^(NSUInteger iterations) {
+        for (NSUInteger i = 0; i < iterations; i++) {
+            [index storeFileForKey:[keys objectAtIndex:i % keys.count] withData:entry];
+        }
+        dispatch_sync(index.databaseQueue, ^{});
+        dispatch_sync(index.databaseQueue, ^{});
+    }];
+
+    [suite addBenchmarkWithName:@"cache_index_lookup" iterations:20000 block:^(NSUInteger iterations) {
+        for (NSUInteger i = 0; i < iterations; i++) {
+            [index fileNameForKey:[keys objectAtIndex:i % keys.count]];
+        }
+    }];
+
+    // reopening a populated index: the time until it is open and the most recently used entries are in memory
+    [suite addBenchmarkWithName:@"cache_index_open_warm" iterations:50 block:^(NSUInteger iterations) {
+        for (NSUInteger i = 0; i < iterations; i++) {
+            FBCacheIndex *reopened = [[FBCacheIndex alloc] initWithCacheFolder:folder];
+            reopened.delegate = delegate;
+            [reopened warmUpWithMostRecentlyUsedCount:64];
+            dispatch_sync(reopened.databaseQueue, ^{});
+            [reopened release];
+        }
+    }];
+
+    // with the capacity below the working set, every store evicts older entries
+    [suite addBenchmarkWithName:@"cache_index_insert_trim" iterations:1000 block:^(NSUInteger iterations) {
+        index.diskCapacity = 256 * entry.length;
+        for (NSUInteger i = 0; i < iterations; i++) {
+            [index storeFileForKey:[NSString stringWithFormat:@"trim%lu", (unsigned long)i]
+                          withData:[distinctEntries objectAtIndex:i % distinctEntries.count]];
+        }
+        dispatch_sync(index.databaseQueue, ^{});
+        dispatch_sync(index.databaseQueue, ^{});
+        index.diskCapacity = NSUIntegerMax;
+    }];
+}
+
++ (void)addCryptoBenchmarksToSuite:(FBBenchmarkSuite *)suite {
+    FBCrypto *crypto = [[[FBCrypto alloc] initWithMasterKey:[FBCrypto makeMasterKey]] autorelease];
+    NSData *plainText = [NSMutableData dataWithLength:4096];
+    NSData *signedData = [@"com.facebook.benchmark" dataUsingEncoding:NSUTF8StringEncoding];
+    NSString *cipherText = [crypto encrypt:plainText additionalDataToSign:signedData];
+
+    [suite addBenchmarkWithName:@"crypto_encrypt_4k" iterations:2000 block:^(NSUInteger iterations) {
+        for (NSUInteger i = 0; i < iterations; i++) {
+            [crypto encrypt:plainText additionalDataToSign:signedData];
+        }
+    }];
+
+    [suite addBenchmarkWithName:@"crypto_decrypt_4k" iterations:2000 block:^(NSUInteger iterations) {
+        for (NSUInteger i = 0; i < iterations; i++) {
+            [crypto decrypt:cipherText additionalSignedData:signedData];
+        }
+    }];
+}
+
++ (void)addLoggerBenchmarksToSuite:(FBBenchmarkSuite *)suite {
+    FBLogRedactor *redactor = [[[FBLogRedactor alloc] initWithCapacity:64] autorelease];
+    NSMutableArray *tokens = [NSMutableArray arrayWithCapacity:64];
+    for (NSUInteger i = 0; i < 64; i++) {
+        NSString *token = [NSString stringWithFormat:@"CAAB%06luZCZBbenchmarkZBZAtoken", (unsigned long)i];
+        [tokens addObject:token];
+        [redactor registerString:token replacement:@"ACCESS_TOKEN_REMOVED"];
+    }
+
+    // an 8k request log with a registered token on every other line
+    NSMutableString *entry = [NSMutableString string];
+    while (entry.length < 8192) {
+        [entry appendFormat:@"  URL:\thttps://graph.facebook.com/me/friends?access_token=%@&format=json\n",
+         [tokens objectAtIndex:entry.length % tokens.count]];
+        [entry appendString:@"  Body (w/o attachments):\t{\"batch\":[{\"method\":\"GET\",\"relative_url\":\"me\"}]}\n"];
+    }
+
+    [suite addBenchmarkWithName:@"log_redact_8k_64_tokens" iterations:2000 block:^(NSUInteger iterations) {
+        for (NSUInteger i = 0; i < iterations; i++) {
+            [redactor redactString:entry];
+        }
+    }];
+}
+
++ (void)addTaskBenchmarksToSuite:(FBBenchmarkSuite *)suite {
+    // each continuation is added to a completed task and runs inline, as a long chain does
+    [suite addBenchmarkWithName:@"task_chain_continuation" iterations:200000 block:^(NSUInteger iterations) {
+        FBTaskCompletionSource *tcs = [FBTaskCompletionSource taskCompletionSource];
+        FBTask *task = [tcs.task retain];
+        tcs.result = [NSNumber numberWithInt:0];
+
+        for (NSUInteger i = 0; i < iterations; i += kContinuationsPerPool) {
+            NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+            for (NSUInteger j = 0; j < kContinuationsPerPool && i + j < iterations; j++) {
+                FBTask *next = [[task dependentTaskWithBlock:^id(FBTask *task) {
+                    return task.result;
+                } queue:[FBTask immediateQueue]] retain];
+                [task release];
+                task = next;
+            }
+            [pool drain];
+        }
+        [task release];
+    }];
+}
+
+@end
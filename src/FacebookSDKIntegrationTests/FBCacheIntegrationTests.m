@@ -99,12 +99,38 @@ static FBCacheIndex* initTempCacheIndex(
 - (void)cacheIndex:(FBCacheIndex*)cacheIndex
     writeFileWithName:(NSString*)name 
     data:(NSData*)data
+    completion:(void (^)(BOOL))completion
 {
     NSString* path =
         [_dataCachePath stringByAppendingPathComponent:name];
         
     dispatch_async(_fileQueue, ^{
-        [data writeToFile:path atomically:YES];
+        [[NSFileManager defaultManager]
+            createDirectoryAtPath:[path stringByDeletingLastPathComponent]
+            withIntermediateDirectories:YES
+            attributes:nil
+            error:nil];
+        completion([data writeToFile:path atomically:YES]);
+    });
+}
+
+- (void)cacheIndex:(FBCacheIndex*)cacheIndex
+    moveFileAtPath:(NSString*)sourcePath
+    toFileWithName:(NSString*)name
+    completion:(void (^)(BOOL))completion
+{
+    NSString* path =
+        [_dataCachePath stringByAppendingPathComponent:name];
+
+    dispatch_async(_fileQueue, ^{
+        [[NSFileManager defaultManager]
+            createDirectoryAtPath:[path stringByDeletingLastPathComponent]
+            withIntermediateDirectories:YES
+            attributes:nil
+            error:nil];
+        completion(rename(
+            sourcePath.fileSystemRepresentation,
+            path.fileSystemRepresentation) == 0);
     });
 }
 
@@ -119,6 +145,36 @@ static FBCacheIndex* initTempCacheIndex(
     });
 }
 
+- (void)cacheIndex:(FBCacheIndex*)cacheIndex
+    deleteFilesWithNames:(NSArray*)names
+{
+    for (NSString* name in names) {
+        [self cacheIndex:cacheIndex deleteFileWithName:name];
+    }
+}
+
+#pragma mark - Helpers
+
+// Entries are indexed on the database queue once their file has been placed
+// on the file queue, so both have to be drained, in that order, and then the
+// database queue once more.
+- (void)flushCacheIndex:(FBCacheIndex*)cacheIndex
+{
+    dispatch_sync(cacheIndex.databaseQueue, ^{});
+    dispatch_sync(_fileQueue, ^{});
+    dispatch_sync(cacheIndex.databaseQueue, ^{});
+}
+
+- (NSData*)dummyDataWithLength:(NSUInteger)length index:(NSUInteger)index
+{
+    // Distinct payloads, so that entries don't share a file
+    NSString* dummy = [[NSString stringWithFormat:@"%lu-", (unsigned long)index]
+        stringByPaddingToLength:length
+        withString:@"1"
+        startingAtIndex:0];
+    return [dummy dataUsingEncoding:NSUTF8StringEncoding];
+}
+
 #pragma mark - Test methods
 
 - (void)testStoreAndRetrieve
@@ -146,6 +202,47 @@ static FBCacheIndex* initTempCacheIndex(
     STAssertNil(readData, @"Data should be removed.");
 }
 
+- (void)testStreamedStoreAndRetrieve
+{
+    FBDataDiskCache* cache = [FBDataDiskCache sharedCache];
+
+    NSMutableData* data = [NSMutableData data];
+    NSURL* url = [NSURL URLWithString:@"http://www.facebook.com/test/url3"];
+    FBDataDiskCacheWriter* writer = [cache writerForURL:url];
+    STAssertNotNil(writer, @"Writer not created");
+    for (int i = 0; i < 16; i++) {
+        NSData* chunk = [[NSString stringWithFormat:@"Chunk %d", i]
+            dataUsingEncoding:NSUTF8StringEncoding];
+        STAssertTrue([writer appendData:chunk], @"Append failed");
+        [data appendData:chunk];
+    }
+
+    NSData* committedData = [writer commit];
+    STAssertTrue([committedData isEqualToData:data], @"Data equality fail.");
+    STAssertNil([writer commit], @"Writer committed twice");
+
+    // The entry is registered on the database queue, its file placed on the file
+    // queue, and then it is published back on the database queue
+    dispatch_sync(cache.cacheIndex.databaseQueue, ^{});
+    dispatch_sync(cache.fileQueue, ^{});
+    dispatch_sync(cache.cacheIndex.databaseQueue, ^{});
+    NSData* readData = [cache dataForURL:url];
+    STAssertTrue([readData isEqualToData:data], @"Streamed data not cached");
+}
+
+- (void)testAbortedStreamIsNotCached
+{
+    FBDataDiskCache* cache = [FBDataDiskCache sharedCache];
+
+    NSURL* url = [NSURL URLWithString:@"http://www.facebook.com/test/url4"];
+    FBDataDiskCacheWriter* writer = [cache writerForURL:url];
+    [writer appendData:[@"Partial" dataUsingEncoding:NSUTF8StringEncoding]];
+    [writer abort];
+
+    STAssertNil([writer commit], @"Aborted writer committed");
+    STAssertNil([cache dataForURL:url], @"Aborted data cached");
+}
+
 - (void)testCacheIndex
 {
     NSString* tempFolder;
@@ -162,8 +259,8 @@ static FBCacheIndex* initTempCacheIndex(
         [cacheIndex storeFileForKey:@"test1" withData:dummyData];
     NSString* filePath = [tempFolder stringByAppendingPathComponent:fileName];
     
-    // Flush the write queue
-    dispatch_sync(cacheIndex.databaseQueue, ^{});
+    // Flush the write queues
+    [self flushCacheIndex:cacheIndex];
 
     __block FBCacheEntityInfo *info = nil;
     dispatch_sync(cacheIndex.databaseQueue, ^{
@@ -176,9 +273,6 @@ static FBCacheIndex* initTempCacheIndex(
         dummyData.length, 
         @"Cache disk usage incorrect");
 
-    // Flush background databaseQueue
-    dispatch_sync(_fileQueue, ^{});
-
     BOOL fileExists = 
         [[NSFileManager defaultManager] fileExistsAtPath:filePath];
     STAssertTrue(fileExists, @"File not written to disk");
@@ -186,9 +280,8 @@ static FBCacheIndex* initTempCacheIndex(
     // Delete the entry
     [cacheIndex removeEntryForKey:@"test1"];
     
-    // Flush the write queue
-    dispatch_sync(cacheIndex.databaseQueue, ^{});
-    dispatch_sync(_fileQueue, ^{});
+    // Flush the write queues
+    [self flushCacheIndex:cacheIndex];
 
     fileExists = [[NSFileManager defaultManager] fileExistsAtPath:filePath];
     STAssertFalse(fileExists, @"File not deleted on removal");
@@ -200,9 +293,163 @@ static FBCacheIndex* initTempCacheIndex(
     [[NSFileManager defaultManager] removeItemAtPath:tempFolder error:NULL];
 }
 
-- (void)testCacheIndexFailsInitWithBadPath {
+- (void)testRemoveEntriesWithTag
+{
+    NSString* tempFolder;
+    FBCacheIndex* cacheIndex = initTempCacheIndex(self, &tempFolder);
+    cacheIndex.diskCapacity = 100000; // no trimming for this simple test
+
+    // Distinct payloads, so that the entries don't share a file
+    NSData* dummyData = [@"dummy1" dataUsingEncoding:NSUTF8StringEncoding];
+    NSString* taggedFile = [cacheIndex
+        storeFileForKey:@"tagged"
+        withData:dummyData
+        tag:@"token1"];
+    [cacheIndex
+        storeFileForKey:@"otherTag"
+        withData:[@"dummy2" dataUsingEncoding:NSUTF8StringEncoding]
+        tag:@"token2"];
+    [cacheIndex
+        storeFileForKey:@"untagged"
+        withData:[@"dummy3" dataUsingEncoding:NSUTF8StringEncoding]];
+
+    [self flushCacheIndex:cacheIndex];
+    [cacheIndex removeEntriesWithTag:@"token1"];
+
+    // Flush the write queues
+    [self flushCacheIndex:cacheIndex];
+
+    STAssertNil([cacheIndex fileNameForKey:@"tagged"], @"Tagged entry not removed");
+    STAssertNotNil([cacheIndex fileNameForKey:@"otherTag"], @"Wrong tag removed");
+    STAssertNotNil([cacheIndex fileNameForKey:@"untagged"], @"Untagged entry removed");
+    STAssertFalse([[NSFileManager defaultManager]
+        fileExistsAtPath:[tempFolder stringByAppendingPathComponent:taggedFile]],
+        @"File not deleted on removal");
+    STAssertEquals(
+        cacheIndex.currentDiskUsage,
+        dummyData.length * 2,
+        @"Cache disk usage incorrect");
+
+    [cacheIndex removeEntriesWithTag:nil];
+    [self flushCacheIndex:cacheIndex];
+
+    STAssertNil([cacheIndex fileNameForKey:@"untagged"], @"Untagged entry not removed");
+    STAssertNotNil([cacheIndex fileNameForKey:@"otherTag"], @"Tagged entry removed");
+
+    [cacheIndex release];
+    [[NSFileManager defaultManager] removeItemAtPath:tempFolder error:NULL];
+}
+
+- (void)testIdenticalDataSharesFile
+{
+    NSString* tempFolder;
+    FBCacheIndex* cacheIndex = initTempCacheIndex(self, &tempFolder);
+    cacheIndex.diskCapacity = 100000; // no trimming for this simple test
+
+    NSData* dummyData = [@"shared" dataUsingEncoding:NSUTF8StringEncoding];
+    NSString* fileName1 = [cacheIndex storeFileForKey:@"test1" withData:dummyData];
+    NSString* fileName2 = [cacheIndex storeFileForKey:@"test2" withData:dummyData];
+    STAssertEqualObjects(fileName1, fileName2, @"Identical data not deduped");
+    STAssertEquals(
+        fileName1.pathComponents.count,
+        (NSUInteger)3,
+        @"File name not sharded");
+
+    NSString* filePath = [tempFolder stringByAppendingPathComponent:fileName1];
+
+    // The shared file is only counted once
+    [self flushCacheIndex:cacheIndex];
+    STAssertEquals(
+        cacheIndex.currentDiskUsage,
+        dummyData.length,
+        @"Shared file counted per entry");
+
+    // Removing one entry must keep the file for the other one
+    [cacheIndex removeEntryForKey:@"test1"];
+    [self flushCacheIndex:cacheIndex];
+    STAssertTrue(
+        [[NSFileManager defaultManager] fileExistsAtPath:filePath],
+        @"Shared file deleted while still referenced");
+    STAssertEquals(
+        cacheIndex.currentDiskUsage,
+        dummyData.length,
+        @"Shared file uncounted while still referenced");
+
+    [cacheIndex removeEntryForKey:@"test2"];
+    [self flushCacheIndex:cacheIndex];
+    STAssertFalse(
+        [[NSFileManager defaultManager] fileExistsAtPath:filePath],
+        @"Shared file not deleted with its last entry");
+    STAssertEquals(
+        cacheIndex.currentDiskUsage,
+        (NSUInteger)0,
+        @"Cache disk usage incorrect");
+
+    [cacheIndex release];
+    [[NSFileManager defaultManager] removeItemAtPath:tempFolder error:NULL];
+}
+
+- (void)testCacheIndexFailsOpenWithBadPath {
     FBCacheIndex *cacheIndex = [[FBCacheIndex alloc] initWithCacheFolder:@"/no/such/folder"];
-    STAssertNil(cacheIndex, @"initWithCacheFolder should fail");
+    cacheIndex.delegate = self;
+
+    // Work queued before the open fails must be dropped, not crash
+    [cacheIndex
+        storeFileForKey:@"test1"
+        withData:[@"dummy" dataUsingEncoding:NSUTF8StringEncoding]];
+    dispatch_sync(cacheIndex.databaseQueue, ^{});
+
+    STAssertTrue(cacheIndex.failedToOpen, @"Open should fail");
+    STAssertFalse(cacheIndex.isReady, @"Index should not be ready");
+
+    [cacheIndex removeEntryForKey:@"test2"];
+    STAssertNil([cacheIndex fileNameForKey:@"test2"], @"Lookup should miss");
+    dispatch_sync(cacheIndex.databaseQueue, ^{});
+
+    [cacheIndex release];
+}
+
+- (void)testWarmUpLoadsMostRecentEntries
+{
+    NSString* tempFolder;
+    FBCacheIndex* cacheIndex = initTempCacheIndex(self, &tempFolder);
+    cacheIndex.diskCapacity = 100000; // no trimming for this simple test
+
+    for (NSUInteger counter = 0; counter < 10; counter++) {
+        [cacheIndex
+            storeFileForKey:[NSString stringWithFormat:@"test%lu", (unsigned long)counter]
+            withData:[[NSString stringWithFormat:@"dummy%lu", (unsigned long)counter]
+                dataUsingEncoding:NSUTF8StringEncoding]];
+    }
+    [self flushCacheIndex:cacheIndex];
+    [cacheIndex release];
+
+    cacheIndex = [[FBCacheIndex alloc] initWithCacheFolder:tempFolder];
+    cacheIndex.delegate = self;
+    [cacheIndex warmUpWithMostRecentlyUsedCount:3];
+    dispatch_sync(cacheIndex.databaseQueue, ^{});
+    STAssertTrue(cacheIndex.isReady, @"Index not opened");
+
+    FBCacheTierStatistics before = cacheIndex.entryCacheStatistics;
+    for (NSUInteger counter = 7; counter < 10; counter++) {
+        STAssertNotNil(
+            [cacheIndex fileNameForKey:[NSString stringWithFormat:@"test%lu", (unsigned long)counter]],
+            @"Entry missing from the cache");
+    }
+    STAssertEquals(
+        cacheIndex.entryCacheStatistics.hits - before.hits,
+        (int64_t)3,
+        @"Recent entries not warmed up");
+
+    // Older entries still come from the database
+    STAssertNotNil([cacheIndex fileNameForKey:@"test0"], @"Entry missing from the cache");
+    STAssertEquals(
+        cacheIndex.entryCacheStatistics.misses - before.misses,
+        (int64_t)1,
+        @"Old entry unexpectedly warmed up");
+
+    [cacheIndex release];
+    [[NSFileManager defaultManager] removeItemAtPath:tempFolder error:NULL];
 }
 
 - (void)testDataPersistence
@@ -214,21 +461,15 @@ static FBCacheIndex* initTempCacheIndex(
     FBCacheIndex* cacheIndex = initTempCacheIndex(self, &tempFolder);
     cacheIndex.diskCapacity = numberOfFiles * fileSize;
     
-    NSString *dummy = [@"" 
-        stringByPaddingToLength:fileSize 
-        withString:@"1" startingAtIndex:0];
-        
-    NSData *dummyData = [dummy 
-        dataUsingEncoding:NSUTF8StringEncoding];
     for (NSUInteger counter = 0; counter < numberOfFiles; counter++) {
         NSString *fileName = [cacheIndex 
             storeFileForKey:[NSString stringWithFormat:@"test%lu", (unsigned long)counter]
-            withData:dummyData];    
+            withData:[self dummyDataWithLength:fileSize index:counter]];
         STAssertNotNil(fileName, @"");
     }
 
-    // Wait for the queue to finish
-    dispatch_sync(cacheIndex.databaseQueue, ^{});
+    // Wait for the queues to finish
+    [self flushCacheIndex:cacheIndex];
     STAssertEquals(
         cacheIndex.currentDiskUsage, 
         fileSize*numberOfFiles, 
@@ -276,20 +517,15 @@ static FBCacheIndex* initTempCacheIndex(
     FBCacheIndex* cacheIndex = initTempCacheIndex(self, &tempFolder);
     cacheIndex.diskCapacity = fileSize * numberOfFiles / 2;
     
-    NSString *dummy = [@"" 
-        stringByPaddingToLength:fileSize 
-        withString:@"1" 
-        startingAtIndex:0];
-    NSData *dummyData = [dummy dataUsingEncoding:NSUTF8StringEncoding];
     for (NSUInteger counter = 0; counter < numberOfFiles; counter++) {
         NSString *fileName = [cacheIndex 
             storeFileForKey:[NSString stringWithFormat:@"test%lu", (unsigned long)counter]
-            withData:dummyData];    
+            withData:[self dummyDataWithLength:fileSize index:counter]];
         STAssertNotNil(fileName, @"");
     }
     
-    // Wait for the queue to flush
-    dispatch_sync(cacheIndex.databaseQueue, ^{});
+    // Wait for the queues to flush
+    [self flushCacheIndex:cacheIndex];
   
     // We stored twice as much as the cache would support - let's ensure 
     // the first 50% of the files are gone
@@ -339,8 +575,7 @@ static FBCacheIndex* initTempCacheIndex(
         stringByAppendingPathComponent:fileName];
         
     // Flush the write queues
-    dispatch_sync(cacheIndex.databaseQueue, ^{});
-    dispatch_sync(_fileQueue, ^{});
+    [self flushCacheIndex:cacheIndex];
 
     NSData *dataFromFile = [NSData
         dataWithContentsOfFile:filePath
@@ -360,8 +595,7 @@ static FBCacheIndex* initTempCacheIndex(
 
     // Now delete the file and see what happens
     [cacheIndex removeEntryForKey:@"test1"];
-    dispatch_sync(cacheIndex.databaseQueue, ^{});
-    dispatch_sync(_fileQueue, ^{});
+    [self flushCacheIndex:cacheIndex];
 
     BOOL fileExists = [[NSFileManager defaultManager] 
         fileExistsAtPath:filePath];
@@ -47,6 +47,8 @@
 @property(readonly) GBSession *gbsession;
 @property(readonly) GDialog *gdialog;
 //@property(readonly) NSString *gUrl;
+// Service calls run concurrently, each on its own connection and buffer.
+// These describe the call that completed last; connection is always nil.
 @property(readonly) NSURLConnection *connection;
 @property(readonly) NSMutableData *responseData;
 @property(readonly) NSURLResponse *response;
@@ -72,4 +74,14 @@
  * Called when dialog failed to load due to an error.
  */
 - (void)didFailWithError:(NSError *)error;
+
+@optional
+
+/**
+ * Typed variants of didComplete:result: and didNotComplete:result:.  When
+ * implemented they are called instead, with the decoded result (a
+ * dictionary with "status" and "data" keys), and no JSON string is built.
+ */
+- (void)didComplete:(NSInteger) code resultObject:(NSDictionary *)result;
+- (void)didNotComplete:(NSInteger) code resultObject:(NSDictionary *)result;
 @end
\ No newline at end of file
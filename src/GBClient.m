@@ -21,6 +21,8 @@
 #import "FBSessionTokenCachingStrategy.h"
 #import "GBDeviceId.h"
 #import "FBAppCall.h"
+#import "GBLogger.h"
+#import "GBURLConnection.h"
 
 static NSString *const GDialogMethod = @"index.php";
 static NSString *const AppCallBackMethod = @"app_callback.php";
@@ -29,9 +31,23 @@ static NSString* GB_API_SERVICE_URL   = @"http://apiv2.gbombgames.com/";
 static const NSTimeInterval TIMEOUT = 180.0;
 static NSString* USER_AGENT = @"GBomb";
 
-
-
-@interface GBClient () <NSURLConnectionDelegate,GDialogDelegate,GBDeviceIdDelegate> {
+// Install tracking runs once per app version, a while after the first client
+// is created so that it stays off the launch path.  A failed attempt is
+// retried a few times; past that, the next launch tries again.
+static NSString *const GBTrackingInstalledVersionKey = @"GBClientTrackingInstalledVersion";
+static const NSTimeInterval GBTrackingInstalledDelay = 5.0;
+static const NSTimeInterval GBTrackingInstalledRetryDelay = 30.0;
+static const NSUInteger GBTrackingInstalledMaxAttempts = 3;
+static dispatch_once_t g_trackingInstalledOnceToken;
+static BOOL g_trackingInstalledInFlight = NO;
+
+// Completion of one GB API call.  Each call runs on its own GBURLConnection,
+// so any number can be in flight at once.
+typedef void (^GBClientRequestHandler)(NSHTTPURLResponse *response,
+                                       NSData *responseData,
+                                       NSError *error);
+
+@interface GBClient () <GDialogDelegate,GBDeviceIdDelegate> {
     id<GBClientDelegate> _delegate;
     GBSession* _gbsession;
     FTSession* _ftsession;
@@ -42,8 +58,54 @@ static NSString* USER_AGENT = @"GBomb";
     NSURLResponse *_response;
     NSString *_gameId;
 }
+
++ (void)scheduleTrackingInstalled;
++ (void)sendTrackingInstalled:(NSNumber *)attempt;
++ (NSString *)trackingInstalledVersion;
++ (GBURLConnection *)startRequestWithURL:(NSString *)uri
+                                 handler:(GBClientRequestHandler)handler;
+- (void)startRequestWithURL:(NSString *)uri
+                    handler:(GBClientRequestHandler)handler;
+- (void)didLoadResult:(NSData *)responseData
+           statusCode:(NSInteger)statusCode
+                error:(NSError *)error;
+- (void)didLoadProfile:(NSData *)responseData
+            statusCode:(NSInteger)statusCode
+                 error:(NSError *)error;
+- (void)completeWithCode:(NSInteger)code result:(NSDictionary *)result;
+- (void)completeWithCode:(NSInteger)code responseData:(NSData *)responseData;
+- (void)notCompleteWithCode:(NSInteger)code result:(NSDictionary *)result;
+
 @end
 
+// Results are built as dictionaries and only turned into JSON strings for
+// delegates that don't implement the typed callbacks.
+static NSDictionary *GBClientResult(NSString *status, NSDictionary *data) {
+    return [NSDictionary dictionaryWithObjectsAndKeys:
+            status, @"status",
+            data, @"data",
+            nil];
+}
+
+static NSDictionary *GBClientErrorResult(NSString *key, NSInteger value) {
+    return GBClientResult(@"error", [NSDictionary dictionaryWithObject:[NSNumber numberWithInteger:value]
+                                                                forKey:key]);
+}
+
+static NSDictionary *GBClientLoginResult(NSString *uid,
+                                         NSString *token,
+                                         NSString *userId,
+                                         NSString *providerId) {
+    NSNull *null = [NSNull null];
+    return GBClientResult(@"success", [NSDictionary dictionaryWithObjectsAndKeys:
+                                       uid ?: (id)null, @"uid",
+                                       token ?: (id)null, @"token",
+                                       userId ?: (id)null, @"user_id",
+                                       @"100000000", @"expires",
+                                       providerId ?: (id)null, @"provider_id",
+                                       nil]);
+}
+
 @implementation GBClient {
 
 }
@@ -79,21 +141,41 @@ static NSString* USER_AGENT = @"GBomb";
 //    if (fclient == nil) {
 //        fclient = @"1234567890";
 //    }
-    [self createGbSession];
-    [self createFbSession];
-    
-    _ftsession=[[FTSession alloc] initWithGameId:_gameId];
-    [self trackingInstalled];
+    // The sessions load their token caches from NSUserDefaults, so they are
+    // only created on first use; see the session getters.
+    [GBClient scheduleTrackingInstalled];
     
     return self;
 }
 
+- (GBSession *)gbsession {
+    if (_gbsession == nil) {
+        [self createGbSession];
+    }
+    return _gbsession;
+}
+
+- (FBSession *)fbsession {
+    if (_fbsession == nil) {
+        [self createFbSession];
+    }
+    return _fbsession;
+}
+
+- (FTSession *)ftsession {
+    if (_ftsession == nil) {
+        _ftsession = [[FTSession alloc] initWithGameId:_gameId];
+    }
+    return _ftsession;
+}
+
 - (void)createGbSession {
     NSDictionary* infoDict = [[NSBundle mainBundle] infoDictionary];
     NSString *gclient = [infoDict objectForKey:@"GbombAppID"];
     NSArray *permissions =[NSArray arrayWithObjects:@"email", nil];
     NSString *urlSchemeSuffix = [GBSettings defaultUrlSchemeSuffix];
     GBSessionTokenCachingStrategy *gbtokenCaching= [GBSessionTokenCachingStrategy defaultInstance];
+    [_gbsession release];
     _gbsession=[[GBSession alloc] initWithAppID:gclient
                                     permissions:permissions
                                 urlSchemeSuffix:urlSchemeSuffix
@@ -106,6 +188,7 @@ static NSString* USER_AGENT = @"GBomb";
     NSString *urlSchemeSuffix = [FBSettings defaultUrlSchemeSuffix];
     NSArray *permissions =[NSArray arrayWithObjects:@"email", nil];
     FBSessionTokenCachingStrategy *fbtokenCaching= [FBSessionTokenCachingStrategy defaultInstance];
+    [_fbsession release];
     _fbsession=[[FBSession alloc] initWithAppID:fclient
                                     permissions:permissions
                                 urlSchemeSuffix:urlSchemeSuffix
@@ -118,6 +201,8 @@ static NSString* USER_AGENT = @"GBomb";
     [_fbsession release];
     [_gbsession release];
     [_gameId release];
+    [_responseData release];
+    [_response release];
 
     [super dealloc];
 }
@@ -188,19 +273,9 @@ static NSString* USER_AGENT = @"GBomb";
     NSString* uri=[GB_API_SERVICE_URL
                    stringByAppendingString:api];
     
-    NSMutableURLRequest* request =
-    [NSMutableURLRequest requestWithURL:[NSURL URLWithString:uri]
-                            cachePolicy:NSURLRequestReloadIgnoringLocalCacheData
-                        timeoutInterval:TIMEOUT];
-    
-    
-    [request setValue:USER_AGENT forHTTPHeaderField:@"User-Agent"];
-    
-    
-    [request setHTTPMethod:@"GET"];
-    
-    
-    _connection = [[NSURLConnection alloc] initWithRequest:request delegate:self];
+    [self startRequestWithURL:uri handler:^(NSHTTPURLResponse *response, NSData *responseData, NSError *error) {
+        [self didLoadResult:responseData statusCode:response.statusCode error:error];
+    }];
 }
 
 - (void)unsubPush : (NSString*) regid {
@@ -208,19 +283,9 @@ static NSString* USER_AGENT = @"GBomb";
     NSString* uri=[GB_API_SERVICE_URL
                    stringByAppendingString:api];
     
-    NSMutableURLRequest* request =
-    [NSMutableURLRequest requestWithURL:[NSURL URLWithString:uri]
-                            cachePolicy:NSURLRequestReloadIgnoringLocalCacheData
-                        timeoutInterval:TIMEOUT];
-    
-    
-    [request setValue:USER_AGENT forHTTPHeaderField:@"User-Agent"];
-    
-    
-    [request setHTTPMethod:@"GET"];
-    
-    
-    _connection = [[NSURLConnection alloc] initWithRequest:request delegate:self];
+    [self startRequestWithURL:uri handler:^(NSHTTPURLResponse *response, NSData *responseData, NSError *error) {
+        [self didLoadResult:responseData statusCode:response.statusCode error:error];
+    }];
 }
 
 
@@ -306,113 +371,183 @@ static NSString* USER_AGENT = @"GBomb";
     }
 }
 
-- (void)connection:(NSURLConnection *)connection didReceiveResponse:(NSURLResponse *)response {
-    _response=response;
-    _statusCode=(NSInteger)[(NSHTTPURLResponse *)_response statusCode];
-    [_responseData setLength:0];
-}
-
-- (void)connection:(NSURLConnection *)connection didReceiveData:(NSData *)data {
-    [_responseData appendData:data];
-}
-
-- (NSCachedURLResponse *)connection:(NSURLConnection *)connection
-                  willCacheResponse:(NSCachedURLResponse*)cachedResponse {
-    return nil;
+- (void)completeWithCode:(NSInteger)code result:(NSDictionary *)result {
+    if (![_delegate respondsToSelector:@selector(didComplete:resultObject:)]) {
+        [self gbClientDidComplete:code result:[GBUtility simpleJSONEncode:result]];
+        return;
+    }
+    
+    // retain self for the life of this method, in case we are released by a client
+    id me = [self retain];
+    @try {
+        [_delegate didComplete:code resultObject:result];
+    } @catch (NSException *exception) {
+        NSLog(@"Exception:%@",exception);
+    } @finally {
+        [me release];
+    }
 }
 
-- (void)connectionDidFinishLoading:(NSURLConnection *)connection {
-    NSString* path=[[[connection originalRequest] URL] path];
-
-    if( _statusCode != 200) {
-        NSString* rstr= [[NSString alloc] stringByAppendingFormat: @"{ \"status\": \"error\", \"data\": { \"status_code\": %d } }",[(NSHTTPURLResponse *)_response statusCode]];
-        [self gbClientDidComplete:115 result:rstr];
-        [rstr release];
+// Service calls other than the profile hand back the server's response as is.
+- (void)completeWithCode:(NSInteger)code responseData:(NSData *)responseData {
+    NSString* rstr= [[[NSString alloc] initWithData:responseData   encoding:NSUTF8StringEncoding] autorelease];
+    if (![_delegate respondsToSelector:@selector(didComplete:resultObject:)]) {
+        [self gbClientDidComplete:code result:rstr];
+        return;
     }
     
-    if([path isEqualToString:@"/v1/profile.php"] ) {
-        
-        NSString* jstr= [[NSString alloc] initWithData:_responseData   encoding:NSUTF8StringEncoding];
-        NSDictionary *dict = [GBUtility simpleJSONDecode:jstr];
-        [jstr release];
-        
-        NSString* rstr;
-        if (![dict isKindOfClass:[NSDictionary class]]) {
-            rstr=[[NSString alloc] initWithFormat: @"{ \"status\": \"error\", \"data\": { \"status_code\": %d } }"
-                  ,[(NSHTTPURLResponse *)_response statusCode]];
-            [self gbClientDidComplete:115 result:rstr];
-            [rstr release];
-            [connection release];
-            return;
-        }
-        if([(NSString *)[dict objectForKey:@"provider_id"] isEqualToString: @"FreeTrial"]) {
-            NSString* uid=[dict objectForKey:@"uid"];
-            NSString* token=self.ftsession.token;
-            NSString* provider_id=[dict objectForKey:@"provider_id"];
-            
-            rstr=[[NSString alloc] initWithFormat: @"{ \"status\": \"success\", \"data\": { \"uid\": \"%s\", \"token\": \"%s\" , \"user_id\":null,\"expires\":\"100000000\",\"provider_id\":\"%s\" } }"
-                  ,[uid UTF8String], [token UTF8String], [provider_id UTF8String] ];
-            [self gbClientDidComplete:100 result:rstr];
-        }
-        else if([(NSString *)[dict objectForKey:@"provider_id"] isEqualToString: @"Facebook"]) {
-            NSString* uid=[dict objectForKey:@"uid"];
-            NSString* token=self.fbsession.accessTokenData.accessToken;
-            NSString* provider_id=[dict objectForKey:@"provider_id"];
-            NSString* user_id=[dict objectForKey:@"id"];
-            
-            rstr=[[NSString alloc] initWithFormat: @"{ \"status\": \"success\", \"data\": { \"uid\": \"%s\", \"token\": \"%s\" , \"user_id\":\"%s\",\"expires\":\"100000000\",\"provider_id\":\"%s\" } }"
-                  ,[uid UTF8String], [token UTF8String], [user_id UTF8String], [provider_id UTF8String] ];
-           [self gbClientDidComplete:100 result:rstr];
-        }
-        else if([(NSString *)[dict objectForKey:@"provider_id"] isEqualToString: @"Gbomb"]) {
-            NSString* uid=[dict objectForKey:@"uid"];
-            NSString* token=self.gbsession.accessTokenData.accessToken;
-            NSString* provider_id=[dict objectForKey:@"provider_id"];
-            NSString* user_id=[dict objectForKey:@"id"];
-            
-            rstr=[[NSString alloc] initWithFormat: @"{ \"status\": \"success\", \"data\": { \"uid\": \"%s\", \"token\": \"%s\" , \"user_id\":\"%s\",\"expires\":\"100000000\",\"provider_id\":\"%s\" } }"
-                  ,[uid UTF8String], [token UTF8String],  [user_id UTF8String],  [provider_id UTF8String] ];
-            [self gbClientDidComplete:100 result:rstr];
-        }
-        else {
-            rstr=@"{ \"status\": \"error\", \"data\": { \"status_code\": 115 } }";
-            [self gbClientDidComplete:115 result:rstr];
-        }
-        [rstr release];
-        [connection release];
+    id result = [GBUtility simpleJSONDecode:rstr];
+    if (![result isKindOfClass:[NSDictionary class]]) {
+        result = [NSDictionary dictionaryWithObjectsAndKeys:
+                  @"success", @"status",
+                  rstr ?: @"", @"data",
+                  nil];
     }
-    else if ([path isEqualToString:@"/v1/tracking_installed.php"] ) {
-        [connection release];
+    [self completeWithCode:code result:result];
+}
+
+- (void)notCompleteWithCode:(NSInteger)code result:(NSDictionary *)result {
+    if (![_delegate respondsToSelector:@selector(didNotComplete:resultObject:)]) {
+        [self gbClientDidNotComplete:code result:[GBUtility simpleJSONEncode:result]];
+        return;
     }
-    else  {
-        NSString* rstr= [[NSString alloc] initWithData:_responseData   encoding:NSUTF8StringEncoding];
-        [self gbClientDidComplete:100 result:rstr];
-        [rstr release];
-        [connection release];
+    
+    // retain self for the life of this method, in case we are released by a client
+    id me = [self retain];
+    @try {
+        [_delegate didNotComplete:code resultObject:result];
+    } @catch (NSException *exception) {
+        NSLog(@"Exception:%@",exception);
+    } @finally {
+        [me release];
     }
 }
 
-- (void)connection:(NSURLConnection *)connection didFailWithError:(NSError *)error {
-    NSString* rstr= [NSString alloc];
-    NSString* path=[[[connection originalRequest] URL] path];
++ (GBURLConnection *)startRequestWithURL:(NSString *)uri
+                                 handler:(GBClientRequestHandler)handler {
+    NSMutableURLRequest* request =
+    [NSMutableURLRequest requestWithURL:[NSURL URLWithString:uri]
+                            cachePolicy:NSURLRequestReloadIgnoringLocalCacheData
+                        timeoutInterval:TIMEOUT];
+    
+    [request setValue:USER_AGENT forHTTPHeaderField:@"User-Agent"];
     
-    if([path isEqualToString:@"/v1/tracking_installed.php"] ) {
-       [connection release];
-       [rstr release];
+    
+    [request setHTTPMethod:@"GET"];
+    
+    // The connection is kept alive by its NSURLConnection until it completes;
+    // the handler runs on the calling thread's run loop.
+    handler = [[handler copy] autorelease];
+    return [[[GBURLConnection alloc] initWithRequest:request
+                               skipRoundTripIfCached:NO
+                                   completionHandler:^(GBURLConnection *connection,
+                                                       NSError *error,
+                                                       NSURLResponse *response,
+                                                       NSData *responseData) {
+        handler((NSHTTPURLResponse *)response, responseData, error);
+    }] autorelease];
+}
+
+- (void)startRequestWithURL:(NSString *)uri
+                    handler:(GBClientRequestHandler)handler {
+    [GBClient startRequestWithURL:uri
+                          handler:^(NSHTTPURLResponse *response, NSData *responseData, NSError *error) {
+        // Kept for the legacy properties: the last call to complete
+        [_response release];
+        _response = [response retain];
+        [_responseData release];
+        _responseData = [responseData mutableCopy];
+        _statusCode = response.statusCode;
+
+        handler(response, responseData, error);
+    }];
+}
+
+- (void)didLoadResult:(NSData *)responseData
+           statusCode:(NSInteger)statusCode
+                error:(NSError *)error {
+    if (error) {
+        NSDictionary *data = [NSDictionary dictionaryWithObjectsAndKeys:
+                              [NSNumber numberWithInteger:error.code], @"error_code",
+                              [NSNumber numberWithInteger:statusCode], @"status_code",
+                              nil];
+        [self notCompleteWithCode:115 result:GBClientResult(@"error", data)];
         return;
     }
     
-        [rstr initWithFormat: @"{ \"status\": \"error\", \"data\": { \"error_code\":%d , \"status_code\": %d } }",
-     error.code,
-         (NSInteger)[(NSHTTPURLResponse *)_response statusCode]];
+    if( statusCode != 200) {
+        [self completeWithCode:115 result:GBClientErrorResult(@"status_code", statusCode)];
+        return;
+    }
+    
+    [self completeWithCode:100 responseData:responseData];
+}
 
-    [self gbClientDidNotComplete:115 result:rstr];
-    [connection release];
-    [rstr release];
+- (void)didLoadProfile:(NSData *)responseData
+            statusCode:(NSInteger)statusCode
+                 error:(NSError *)error {
+    if (error || statusCode != 200) {
+        [self didLoadResult:responseData statusCode:statusCode error:error];
+        return;
+    }
+    
+    NSString* jstr= [[NSString alloc] initWithData:responseData   encoding:NSUTF8StringEncoding];
+    NSDictionary *dict = [GBUtility simpleJSONDecode:jstr];
+    [jstr release];
+    
+    if (![dict isKindOfClass:[NSDictionary class]]) {
+        [self completeWithCode:115 result:GBClientErrorResult(@"status_code", statusCode)];
+        return;
+    }
+    NSString* provider_id=[dict objectForKey:@"provider_id"];
+    NSString* uid=[dict objectForKey:@"uid"];
+    if([provider_id isEqualToString: @"FreeTrial"]) {
+        NSString* token=self.ftsession.token;
+        [self completeWithCode:100 result:GBClientLoginResult(uid, token, nil, provider_id)];
+    }
+    else if([provider_id isEqualToString: @"Facebook"]) {
+        NSString* token=self.fbsession.accessTokenData.accessToken;
+        NSString* user_id=[dict objectForKey:@"id"];
+        [self completeWithCode:100 result:GBClientLoginResult(uid, token, user_id, provider_id)];
+    }
+    else if([provider_id isEqualToString: @"Gbomb"]) {
+        NSString* token=self.gbsession.accessTokenData.accessToken;
+        NSString* user_id=[dict objectForKey:@"id"];
+        [self completeWithCode:100 result:GBClientLoginResult(uid, token, user_id, provider_id)];
+    }
+    else {
+        [self completeWithCode:115 result:GBClientErrorResult(@"status_code", 115)];
+    }
 }
 
 
 - (void)trackingInstalled  {
+    [GBClient sendTrackingInstalled:[NSNumber numberWithUnsignedInteger:0]];
+}
+
++ (NSString *)trackingInstalledVersion {
+    NSBundle *mainBundle = [NSBundle mainBundle];
+    NSString *version = [mainBundle objectForInfoDictionaryKey:@"CFBundleVersion"];
+    return version ?: [mainBundle objectForInfoDictionaryKey:@"CFBundleShortVersionString"];
+}
+
++ (void)scheduleTrackingInstalled {
+    dispatch_once(&g_trackingInstalledOnceToken, ^{
+        NSString *trackedVersion = [[NSUserDefaults standardUserDefaults] stringForKey:GBTrackingInstalledVersionKey];
+        if ([trackedVersion isEqualToString:[GBClient trackingInstalledVersion]]) {
+            return;
+        }
+        [[GBClient class] performSelector:@selector(sendTrackingInstalled:)
+                               withObject:[NSNumber numberWithUnsignedInteger:0]
+                               afterDelay:GBTrackingInstalledDelay];
+    });
+}
+
++ (void)sendTrackingInstalled:(NSNumber *)attempt {
+    if (g_trackingInstalledInFlight) {
+        return;
+    }
+    g_trackingInstalledInFlight = YES;
     
     NSString *bundle=[GBUtility stringByURLEncodingString:[[NSBundle mainBundle] bundleIdentifier]];
     NSString *systemName=[GBUtility stringByURLEncodingString:[GBUtility getSystemName]];
@@ -434,21 +569,20 @@ static NSString* USER_AGENT = @"GBomb";
              stringByAppendingString:advertiserID];
     }
     
-    NSMutableURLRequest* request =
-    [NSMutableURLRequest requestWithURL:[NSURL URLWithString:uri]
-                            cachePolicy:NSURLRequestReloadIgnoringLocalCacheData
-                        timeoutInterval:TIMEOUT];
-    
-    _responseData = [[NSMutableData data] retain];
-    
-    
-    [request setValue:USER_AGENT forHTTPHeaderField:@"User-Agent"];
-    
-    
-    [request setHTTPMethod:@"GET"];
-    
-    
-    _connection = [[NSURLConnection alloc] initWithRequest:request delegate:self];
+    // Nobody waits on this one
+    [GBClient startRequestWithURL:uri
+                          handler:^(NSHTTPURLResponse *response, NSData *responseData, NSError *error) {
+        g_trackingInstalledInFlight = NO;
+        if (!error && response.statusCode == 200) {
+            NSUserDefaults *defaults = [NSUserDefaults standardUserDefaults];
+            [defaults setObject:[GBClient trackingInstalledVersion] forKey:GBTrackingInstalledVersionKey];
+            [defaults synchronize];
+        } else if (attempt.unsignedIntegerValue + 1 < GBTrackingInstalledMaxAttempts) {
+            [[GBClient class] performSelector:@selector(sendTrackingInstalled:)
+                                   withObject:[NSNumber numberWithUnsignedInteger:attempt.unsignedIntegerValue + 1]
+                                   afterDelay:GBTrackingInstalledRetryDelay * (attempt.unsignedIntegerValue + 1)];
+        }
+    }];
 }
 
 - (void)getUserProfile:(NSString *) provider_id token:(NSString *)token {
@@ -466,22 +600,15 @@ static NSString* USER_AGENT = @"GBomb";
                     stringByAppendingString:token]
                     stringByAppendingString:@"&game_id="]
                     stringByAppendingString:game_id];
-    
-    NSMutableURLRequest* request =
-    [NSMutableURLRequest requestWithURL:[NSURL URLWithString:uri]
-                            cachePolicy:NSURLRequestReloadIgnoringLocalCacheData
-                        timeoutInterval:TIMEOUT];
-    
-    _responseData = [[NSMutableData data] retain];
-    
-    
-    [request setValue:USER_AGENT forHTTPHeaderField:@"User-Agent"];
-    
-    
-    [request setHTTPMethod:@"GET"];
-    
-    
-    _connection = [[NSURLConnection alloc] initWithRequest:request delegate:self];
+
+    // The token is part of the URL, which GBURLConnection logs
+    if (token.length && ![[GBSettings loggingBehavior] containsObject:GBLoggingBehaviorAccessTokens]) {
+        [GBLogger registerStringToReplace:token replaceWith:@"ACCESS_TOKEN_REMOVED"];
+    }
+
+    [self startRequestWithURL:uri handler:^(NSHTTPURLResponse *response, NSData *responseData, NSError *error) {
+        [self didLoadProfile:responseData statusCode:response.statusCode error:error];
+    }];
 }
 
 
@@ -497,28 +624,25 @@ static NSString* USER_AGENT = @"GBomb";
  */
 - (void)dialogCompleteWithUrl:(NSURL *)url {
     if ([url.path isEqualToString:@"/trial.html"]) {
-        if (!(_ftsession.state == FTSessionStateCreated ||
-              _ftsession.state == FTSessionStateCreatedTokenLoaded)) {
-            [self getUserProfile:@"FreeTrial" token:_ftsession.token];
+        FTSession *ftsession = self.ftsession;
+        if (!(ftsession.state == FTSessionStateCreated ||
+              ftsession.state == FTSessionStateCreatedTokenLoaded)) {
+            [self getUserProfile:@"FreeTrial" token:ftsession.token];
             return;
         }
-        [_ftsession openWithCompletionHandler:^(FTSession *session, FTSessionState status, NSError *error) {
-            NSString* rstr = nil;
+        [ftsession openWithCompletionHandler:^(FTSession *session, FTSessionState status, NSError *error) {
             switch (status) {
                 case FTSessionStateOpen:
                     
                     [self getUserProfile:@"FreeTrial" token:_ftsession.token];
                     break;
                 case FTSessionStateClosedLoginFailed:
-                    rstr=[[NSString alloc] initWithFormat: @"{ \"status\": \"error\", \"data\": { \"error_code\": %d } }", error.code];
-                    [self gbClientDidComplete:104 result:rstr];
+                    [self completeWithCode:104 result:GBClientErrorResult(@"error_code", error.code)];
                    break;
                 default:
-                    rstr=[[NSString alloc] initWithFormat: @"{ \"status\": \"error\", \"data\": { \"error_code\": 115 } }"];
-                    [self gbClientDidComplete:115 result:rstr];                    
+                    [self completeWithCode:115 result:GBClientErrorResult(@"error_code", 115)];
                     break; // so we do nothing in response to those state transitions
             }
-            if(rstr != nil) [rstr release];
         }];
     }
     else if([url.path isEqualToString:@"/facebook.html"]) {
@@ -531,7 +655,6 @@ static NSString* USER_AGENT = @"GBomb";
         [self createFbSession];
         [FBSession setActiveSession:_fbsession];
         [_fbsession openWithCompletionHandler:^(FBSession *session, FBSessionState status, NSError *error) {
-            NSString* rstr=nil;
             switch (status) {
                 case FBSessionStateOpen:
                 {
@@ -553,15 +676,12 @@ static NSString* USER_AGENT = @"GBomb";
                 }
                 break;
                 case FBSessionStateClosedLoginFailed:
-                    rstr=[[NSString alloc] initWithFormat: @"{ \"status\": \"error\", \"data\": { \"error_code\": %d } }", error.code];
-                    [self gbClientDidComplete:104 result:rstr];
+                    [self completeWithCode:104 result:GBClientErrorResult(@"error_code", error.code)];
                     break;
                 default:
-//                    rstr=[[NSString alloc] initWithFormat: @"{ \"status\": \"error\", \"data\": { \"error_code\": 115 } }"];
-//                    [self gbClientDidComplete:115 result:rstr];
+//                    [self completeWithCode:115 result:GBClientErrorResult(@"error_code", 115)];
                     break; // so we do nothing in response to those state transitions
             }
-            if(rstr != nil) [rstr release];
         }];
     }
     else if([url.path isEqualToString:@"/gbomb.html"]) {
@@ -571,37 +691,30 @@ static NSString* USER_AGENT = @"GBomb";
         }
         [self createGbSession];
         [_gbsession openWithCompletionHandler:^(GBSession *session, GBSessionState status, NSError *error) {
-            NSString* rstr=nil;
             switch (status) {
                 case GBSessionStateOpen:
                     [self getUserProfile:@"Gbomb" token:_gbsession.accessTokenData.accessToken];
                     break;
                 case GBSessionStateClosedLoginFailed:
-                    rstr=[[NSString alloc] initWithFormat: @"{ \"status\": \"error\", \"data\": { \"error_code\": %d } }", error.code];
-                    [self gbClientDidComplete:104 result:rstr];
+                    [self completeWithCode:104 result:GBClientErrorResult(@"error_code", error.code)];
                     break;
                 default:
-                    rstr=[[NSString alloc] initWithFormat: @"{ \"status\": \"error\", \"data\": { \"error_code\": 115 } }"];
-                    [self gbClientDidComplete:115 result:rstr];
+                    [self completeWithCode:115 result:GBClientErrorResult(@"error_code", 115)];
                     break; // so we do nothing in response to those state transitions
             }
-            if(rstr != nil) [rstr release];
         }];
     }
     else if([url.path isEqualToString:@"/login_success.html"]) {
-        NSString* rstr=nil;
-        switch (_fbsession.state) {
+        switch (self.fbsession.state) {
             case FBSessionStateCreated:
             case FBSessionStateCreatedTokenLoaded:
             case FBSessionStateOpen:
                 [self getUserProfile:@"Facebook" token:_fbsession.accessTokenData.accessToken];
                 break;
             default:
-                rstr=[[NSString alloc] initWithFormat: @"{ \"status\": \"error\", \"data\": { \"error_code\": 115 } }"];
-                [self gbClientDidComplete:115 result:rstr];
+                [self completeWithCode:115 result:GBClientErrorResult(@"error_code", 115)];
                 break; // so we do nothing in response to those state transitions
         }
-        if(rstr != nil) [rstr release];
     }
     else if([url.path isEqualToString:@"/logout.html"]) {
         [GBUtility deleteGbombCookies];
@@ -630,9 +743,7 @@ static NSString* USER_AGENT = @"GBomb";
  * Called when dialog failed to load due to an error.
  */
 - (void)dialog:(GDialog*)dialog didFailWithError:(NSError *)error {
-    NSString* rstr= [[NSString alloc] initWithFormat:  @"{ \"status\": \"error\", \"data\": { \"error_code\": %d } }", error.code];
-    [self gbClientDidComplete:115 result:rstr];
-    [rstr release];
+    [self completeWithCode:115 result:GBClientErrorResult(@"error_code", error.code)];
 }
 
 /**
@@ -19,17 +19,15 @@
 
 #import "GBSession.h"
 
-@class GBCacheIndex;
+@class FBDataDiskCache;
 
-// This is a Disk based cache used internally by Facebook SDK
+// This is a Disk based cache used internally by Facebook SDK.  It fronts the
+// same engine as FBDataDiskCache -- one index, one disk budget and one
+// in-memory tier -- so entries stored by either stack are served to both.
 @interface GBDataDiskCache : NSObject
 {
 @private
-    NSCache* _inMemoryCache;
-    GBCacheIndex* _cacheIndex;
-    NSString* _dataCachePath;
-
-    dispatch_queue_t _fileQueue;
+    FBDataDiskCache* _engine;
 }
 
 + (GBDataDiskCache*)sharedCache;
@@ -16,59 +16,22 @@
 
 #import "GBDataDiskCache.h"
 
+#import "FBDataDiskCache.h"
 #import "GBAccessTokenData.h"
-#import "GBCacheIndex.h"
 
-static const NSUInteger kMaxDataInMemorySize = 1 * 1024 * 1024; // 1MB
-static const NSUInteger kMaxDiskCacheSize = 10 * 1024 * 1024; // 10MB
-
-static NSString* const kDataDiskCachePath = @"DataDiskCache";
-static NSString* const kCacheInfoFile = @"CacheInfo";
-static NSString *const kAccessTokenKey = @"access_token";
-
-@interface GBDataDiskCache() <GBCacheIndexFileDelegate>
-@property (nonatomic, copy) NSString* dataCachePath;
+@interface GBDataDiskCache()
+- (id)initWithEngine:(FBDataDiskCache*)engine;
 @end
 
 @implementation GBDataDiskCache
 
-@synthesize dataCachePath = _dataCachePath;
-@synthesize fileQueue = _fileQueue;
-
 #pragma mark - Lifecycle
 
-- (id)init
+- (id)initWithEngine:(FBDataDiskCache*)engine
 {
     self = [super init];
     if (self) {
-        NSArray* cacheList = NSSearchPathForDirectoriesInDomains(
-            NSCachesDirectory,
-            NSUserDomainMask,
-            YES);
-
-        NSString* cachePath = [cacheList objectAtIndex:0];
-        _dataCachePath =
-            [[cachePath stringByAppendingPathComponent:kDataDiskCachePath]
-                copy];
-        [[NSFileManager defaultManager]
-            createDirectoryAtPath:_dataCachePath
-            withIntermediateDirectories:YES
-            attributes:nil
-            error:nil];
-
-        dispatch_queue_t bgPriQueue =
-            dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0);
-        _fileQueue = dispatch_queue_create(
-            "File Cache Queue",
-            DISPATCH_QUEUE_SERIAL);
-        dispatch_set_target_queue(_fileQueue, bgPriQueue);
-
-        _cacheIndex = [[GBCacheIndex alloc] initWithCacheFolder:_dataCachePath];
-        _cacheIndex.diskCapacity = kMaxDiskCacheSize;
-        _cacheIndex.delegate = self;
-
-        _inMemoryCache = [[NSCache alloc] init];
-        _inMemoryCache.totalCostLimit = kMaxDataInMemorySize;
+        _engine = [engine retain];
     }
 
     return self;
@@ -76,15 +39,7 @@ static NSString *const kAccessTokenKey = @"access_token";
 
 - (void)dealloc
 {
-    if (_fileQueue) {
-        dispatch_release(_fileQueue);
-    }
-    if (_cacheIndex) {
-        _cacheIndex.delegate = nil;
-        [_cacheIndex release];
-    }
-    [_dataCachePath release];
-    [_inMemoryCache release];
+    [_engine release];
     [super dealloc];
 }
 
@@ -94,7 +49,8 @@ static NSString *const kAccessTokenKey = @"access_token";
     static dispatch_once_t onceToken;
 
     dispatch_once(&onceToken, ^{
-        _instance = [[GBDataDiskCache alloc] init];
+        _instance = [[GBDataDiskCache alloc]
+            initWithEngine:[FBDataDiskCache sharedCache]];
     });
 
     return _instance;
@@ -104,90 +60,34 @@ static NSString *const kAccessTokenKey = @"access_token";
 
 - (NSUInteger)cacheSizeMemory
 {
-    return _inMemoryCache.totalCostLimit;
+    return _engine.cacheSizeMemory;
 }
 
 - (void)setCacheSizeMemory:(NSUInteger)cacheSizeMemory
 {
-    _inMemoryCache.totalCostLimit = cacheSizeMemory;
+    _engine.cacheSizeMemory = cacheSizeMemory;
 }
 
-#pragma mark - GBCacheIndexFileDelegate
-
-- (void) cacheIndex:(GBCacheIndex*)cacheIndex
-    writeFileWithName:(NSString*)name
-    data:(NSData*)data
+- (dispatch_queue_t)fileQueue
 {
-    NSString* filePath = [_dataCachePath stringByAppendingPathComponent:name];
-    dispatch_async(_fileQueue, ^{
-        [data writeToFile:filePath atomically:YES];
-    });
-}
-
-- (void) cacheIndex:(GBCacheIndex*)cacheIndex
-    deleteFileWithName:(NSString*)name
-{
-    NSString* filePath = [_dataCachePath stringByAppendingPathComponent:name];
-    dispatch_async(_fileQueue, ^{
-        [[NSFileManager defaultManager]
-            removeItemAtPath:filePath
-            error:nil];
-    });
+    return _engine.fileQueue;
 }
 
 #pragma mark - Other Methods
 
-- (BOOL)_doesFileExist:(NSString*)name
+- (NSData*)dataForURL:(NSURL*)dataURL
 {
-    NSString* filePath = [_dataCachePath stringByAppendingPathComponent:name];
-    return [[NSFileManager defaultManager] fileExistsAtPath:filePath];
+    return [_engine dataForURL:dataURL];
 }
 
-- (NSData*)dataForURL:(NSURL*)dataURL
+- (void)setData:(NSData*)data forURL:(NSURL*)url
 {
-    // TODO: Synchronize this across threads
-    NSData* data = nil;
-    @try {
-        data = (NSData*)[_inMemoryCache objectForKey:dataURL];
-        NSString* fileName =
-            [_cacheIndex fileNameForKey:dataURL.absoluteString];
-
-        if (data == nil && fileName != nil) {
-            // Not in-memory, on-disk only, read in
-            if ([self _doesFileExist:fileName]) {
-                NSString* cachePath =
-                    [_dataCachePath stringByAppendingPathComponent:fileName];
-
-                data = [NSData
-                    dataWithContentsOfFile:cachePath
-                    options:NSDataReadingMappedAlways | NSDataReadingUncached
-                    error:nil];
-
-                if (data) {
-                    // It is possible that the file doesn't exist
-                    [_inMemoryCache
-                        setObject:data
-                        forKey:dataURL
-                        cost:data.length];
-                }
-            }
-        }
-    } @catch (NSException* exception) {
-        NSLog(@"GBDiskCache error: %@", exception.reason);
-    } @finally {
-        return data;
-    }
+    [_engine setData:data forURL:url];
 }
 
 - (void)removeDataForUrl:(NSURL*)url
 {
-    // TODO: Synchronize this across threads
-    @try {
-        [_inMemoryCache removeObjectForKey:url];
-        [_cacheIndex removeEntryForKey:url.absoluteString];
-    } @catch (NSException* exception) {
-        NSLog(@"GBDiskCache error: %@", exception.reason);
-    }
+    [_engine removeDataForUrl:url];
 }
 
 - (void)removeDataForSession:(GBSession*)session
@@ -196,36 +96,7 @@ static NSString *const kAccessTokenKey = @"access_token";
         return;
     }
 
-    // Here we are removing all cache entries that don't have session context
-    // These are things like images and the like. The thorough way would
-    // be to maintain refCounts of these entries associated with accessTokens
-    // and use that to decide which images to delete. However, this might be
-    // overkill for a cache. Maybe revisit later?
-    [_cacheIndex removeEntries:kAccessTokenKey excludingFragment:YES];
-
-    NSString* accessToken = session.accessTokenData.accessToken;
-    if (accessToken != nil) {
-        // Here we are removing all cache entries that have this session's access
-        // token in the url.
-        [_cacheIndex removeEntries:accessToken excludingFragment:NO];
-    }
-}
-
-- (void)setData:(NSData*)data forURL:(NSURL*)url
-{
-    // TODO: Synchronize this across threads
-    @try {
-        [_cacheIndex
-            storeFileForKey:url.absoluteString
-            withData:data];
-
-        [_inMemoryCache
-            setObject:data
-            forKey:url
-            cost:data.length];
-    } @catch (NSException* exception) {
-        NSLog(@"GBDiskCache error: %@", exception.reason);
-    }
+    [_engine removeDataForAccessToken:session.accessTokenData.accessToken];
 }
 
 @end
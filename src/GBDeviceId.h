@@ -16,6 +16,7 @@
 
 @interface GBDeviceId : NSObject {
     id<GBDeviceIdDelegate> _deviceIdDelegate;
+    NSString *_deviceId;
 }
 
 @property(nonatomic, assign) id<GBDeviceIdDelegate> deviceIdDelegate;
@@ -95,36 +95,39 @@
     return macAddressString;
 }
 
-- (void)generateDeviceId {
+// The id can't change while the app runs, so it is computed once; the
+// sysctl walk behind the MAC address is not cheap.
+- (NSString *)computeDeviceId {
     NSString *systemId = @"";
     if (([[[UIDevice currentDevice] systemVersion] floatValue] < 6.0f)) {
         systemId = [systemId stringByAppendingString:@"IOS_MAC-"];
         systemId= [systemId stringByAppendingString:[self getMacAddress]];
     }
     else {
+        //systemId = [systemId stringByAppendingString:@"VENDOR-"];
+        //systemId = [systemId stringByAppendingString:[[[UIDevice currentDevice] identifierForVendor] UUIDString]];
         systemId = [systemId stringByAppendingString:@"ADVERTISER-"];
         systemId = [systemId stringByAppendingString:[GBUtility advertiserID]];
     }
     
+    return systemId;
+}
+
+- (void)generateDeviceId {
+    NSString *systemId = [self getDeviceId];
+    
     if ([self.deviceIdDelegate respondsToSelector:@selector(gbDidDeviceIdGenerate:)]) {
         [_deviceIdDelegate gbDidDeviceIdGenerate:systemId];
     }
 }
 
 - (NSString *)getDeviceId {
-    NSString *systemId = @"";
-    if (([[[UIDevice currentDevice] systemVersion] floatValue] < 6.0f)) {
-        systemId = [systemId stringByAppendingString:@"IOS_MAC-"];
-        systemId= [systemId stringByAppendingString:[self getMacAddress]];
-    }
-    else {
-        //systemId = [systemId stringByAppendingString:@"VENDOR-"];
-        //systemId = [systemId stringByAppendingString:[[[UIDevice currentDevice] identifierForVendor] UUIDString]];
-        systemId = [systemId stringByAppendingString:@"ADVERTISER-"];
-        systemId = [systemId stringByAppendingString:[GBUtility advertiserID]];
+    @synchronized(self) {
+        if (_deviceId == nil) {
+            _deviceId = [[self computeDeviceId] copy];
+        }
+        return [[_deviceId retain] autorelease];
     }
-    
-    return systemId;
 }
 
 @end
\ No newline at end of file
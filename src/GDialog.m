@@ -16,6 +16,7 @@
 
 #import "GDialog.h"
 
+#import "FBDialogWebViewPool.h"
 #import "GBDialogClosePNG.h"
 //#import "FTFrictionlessRequestSettings.h"
 #import "GBUtility.h"
@@ -346,7 +347,9 @@ params   = _params;
         self.autoresizingMask = UIViewAutoresizingFlexibleWidth | UIViewAutoresizingFlexibleHeight;
         self.contentMode = UIViewContentModeRedraw;
         
-        _webView = [[UIWebView alloc] initWithFrame:CGRectMake(kPadding, kPadding, 480, 480)];
+        // Reuses a warm web view from an earlier dialog when there is one
+        _webView = [[[FBDialogWebViewPool sharedPool] dequeueWebView] retain];
+        _webView.frame = CGRectMake(kPadding, kPadding, 480, 480);
         _webView.delegate = self;
         _webView.transform = [self webViewTransformForOrientation];
         _webView.autoresizingMask = UIViewAutoresizingFlexibleWidth | UIViewAutoresizingFlexibleHeight;
@@ -392,7 +395,7 @@ params   = _params;
 
 - (void)dealloc {
     [[NSNotificationCenter defaultCenter] removeObserver:self];
-    _webView.delegate = nil;
+    [[FBDialogWebViewPool sharedPool] enqueueWebView:_webView];
     [_webView release];
     [_params release];
     [_serverURL release];
@@ -613,6 +616,9 @@ params   = _params;
     _params = [params retain];
     _delegate = delegate;
     _isViewInvisible = isViewInvisible;
+
+    // Opens the connection while the dialog is being set up and shown
+    [[FBDialogWebViewPool sharedPool] preconnectToURL:[NSURL URLWithString:serverURL]];
     
     return self;
 }
@@ -625,9 +631,24 @@ params   = _params;
     
     [_loadingURL release];
     _loadingURL = [[self generateURL:url params:getParams] retain];
-    NSMutableURLRequest* request = [NSMutableURLRequest requestWithURL:_loadingURL];
     
-    [_webView loadRequest:request];
+    // Takes over the web view that prefetched the page, if there is one
+    UIWebView* webView = [[FBDialogWebViewPool sharedPool] loadURL:_loadingURL
+                                                          inWebView:_webView
+                                                           ofDialog:self];
+    [webView retain];
+    [_webView release];
+    _webView = webView;
+}
+
+- (void)prefetch {
+    [[FBDialogWebViewPool sharedPool] prefetchURL:[self generateURL:_serverURL params:_params]];
+}
+
++ (void)warmUpForURL:(NSString*)serverURL {
+    FBDialogWebViewPool* pool = [FBDialogWebViewPool sharedPool];
+    [pool warmUp];
+    [pool preconnectToURL:[NSURL URLWithString:serverURL]];
 }
 
 - (void)show {
@@ -17,6 +17,7 @@
 #import "FBCacheTests.h"
 #import "FBDataDiskCache.h"
 #import "FBCacheIndex.h"
+#import "FBMemoryCache.h"
 #import "FBTests.h"
 #import "FBTestBlocker.h"
 #import "FBCacheDescriptor.h"
@@ -42,4 +43,45 @@
 
 // TODO: write unit tests
 
+- (void)testMemoryCacheScanDoesNotEvictWorkingSet
+{
+    FBMemoryCache* cache = [[FBMemoryCache alloc] init];
+    cache.totalCostLimit = 1000;
+
+    // Storing a key a second time admits it to the main queue
+    NSString* hotKey = @"hot";
+    NSData* hotData = [NSData dataWithBytes:"hot" length:3];
+    [cache setObject:hotData forKey:hotKey cost:100];
+    [cache setObject:hotData forKey:hotKey cost:100];
+
+    // A scan over many one-off objects only churns the probationary queue
+    for (int i = 0; i < 100; i++) {
+        [cache
+            setObject:[NSData dataWithBytes:"cold" length:4]
+            forKey:[NSString stringWithFormat:@"cold%d", i]
+            cost:100];
+    }
+
+    // The probationary queue holds 250 of the 1000, so only the last two
+    // cold objects are left in it, and the hot one was never there
+    NSArray* expectedKeys = [NSArray arrayWithObjects:@"cold98", @"cold99", nil];
+    STAssertEqualObjects(cache.probationaryKeys, expectedKeys, @"Scan overflowed the probationary queue");
+    STAssertEquals(cache.probationaryCost, (NSUInteger)200, @"");
+
+    STAssertEqualObjects([cache objectForKey:hotKey], hotData, @"Working set evicted by scan");
+    STAssertNil([cache objectForKey:@"cold0"], @"Scan overflowed the probationary queue");
+
+    FBCacheTierStatistics statistics = cache.statistics;
+    STAssertEquals(statistics.hits, (int64_t)1, @"");
+    STAssertEquals(statistics.misses, (int64_t)1, @"");
+    STAssertEquals(statistics.bytes, (int64_t)3, @"");
+
+    // Everything the probationary accounting counts is still held
+    for (NSString* key in cache.probationaryKeys) {
+        STAssertNotNil([cache objectForKey:key], @"Probationary object dropped behind the accounting");
+    }
+
+    [cache release];
+}
+
 @end
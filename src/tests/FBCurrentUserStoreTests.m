@@ -0,0 +1,85 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <OHHTTPStubs/OHHTTPStubs.h>
+#import <libkern/OSAtomic.h>
+
+#import "FBCurrentUserStore.h"
+#import "FBCurrentUserStoreTests.h"
+#import "FBSession.h"
+#import "FBTestBlocker.h"
+
+@implementation FBCurrentUserStoreTests
+
+- (void)testConcurrentFetchesShareOneBatch
+{
+    __block int32_t requestCount = 0;
+    [OHHTTPStubs shouldStubRequestsPassingTest:^BOOL(NSURLRequest *request) {
+        return YES;
+    } withStubResponse:^OHHTTPStubsResponse *(NSURLRequest *request) {
+        OSAtomicIncrement32(&requestCount);
+        NSData *data = [@"[{\"code\":200,\"body\":\"{\\\"id\\\":\\\"4\\\",\\\"name\\\":\\\"Test User\\\"}\"},"
+                        "{\"code\":200,\"body\":\"{\\\"data\\\":{\\\"url\\\":\\\"https://fbcdn-profile-a.akamaihd.net/4.jpg\\\"}}\"}]"
+                        dataUsingEncoding:NSUTF8StringEncoding];
+        return [OHHTTPStubsResponse responseWithData:data
+                                          statusCode:200
+                                        responseTime:0
+                                             headers:nil];
+    }];
+
+    FBSession *session = [self createAndOpenSessionWithMockToken];
+    // a private store, so that controls observing the shared one are not involved
+    FBCurrentUserStore *store = [[[FBCurrentUserStore alloc] init] autorelease];
+
+    FBTestBlocker *blocker = [[[FBTestBlocker alloc] init] autorelease];
+    id observer = [[NSNotificationCenter defaultCenter]
+                   addObserverForName:FBCurrentUserStoreDidChangeNotification
+                   object:store
+                   queue:nil
+                   usingBlock:^(NSNotification *notification) {
+                       if (store.user) {
+                           [blocker signal];
+                       }
+                   }];
+
+    [store fetchForSession:session];
+    [store fetchForSession:session];
+
+    STAssertTrue([blocker waitWithTimeout:1], @"timed out waiting for the user");
+    STAssertEquals(requestCount, 1, @"fetches not coalesced");
+    STAssertEqualObjects(store.user.id, @"4", @"unexpected user");
+    STAssertEqualObjects([store pictureURLForProfileID:@"4" pixelWidth:100].absoluteString,
+                         @"https://fbcdn-profile-a.akamaihd.net/4.jpg",
+                         @"picture URL not shared");
+    STAssertNil([store pictureURLForProfileID:@"5" pixelWidth:100], @"picture URL shared with another profile");
+    STAssertNil([store pictureURLForProfileID:@"4" pixelWidth:FBCurrentUserStorePictureSize + 1],
+                @"picture URL shared with a larger view");
+
+    [[NSNotificationCenter defaultCenter] removeObserver:observer];
+
+    // a user persisted for the session is used without a round trip when asked to
+    FBCurrentUserStore *relaunchedStore = [[[FBCurrentUserStore alloc] init] autorelease];
+    [relaunchedStore fetchForSession:session skipRoundtripIfCached:YES];
+    STAssertEqualObjects(relaunchedStore.user.id, @"4", @"persisted user not loaded");
+    [self waitForMainQueueToFinish];
+    STAssertEquals(requestCount, 1, @"round trip made for a persisted user");
+
+    [session close];
+    [session release];
+    [OHHTTPStubs removeAllRequestHandlers];
+}
+
+@end
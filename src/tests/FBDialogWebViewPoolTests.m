@@ -0,0 +1,150 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <UIKit/UIKit.h>
+
+#import "FBDialogWebViewPool.h"
+#import "FBDialogWebViewPoolTests.h"
+#import "FBTestBlocker.h"
+
+@interface FBDialogWebViewPool (Testing)
+
+@property (nonatomic, readonly) UIWebView *prefetchWebView;
+
+@end
+
+// Stands in for a dialog, recording what its web view tells it
+@interface FBDialogWebViewPoolTestDialog : UIView <UIWebViewDelegate>
+
+@property (nonatomic, retain) UIWebView *webView;
+@property (nonatomic, retain) NSURLRequest *callbackRequest;
+@property (nonatomic, retain) FBTestBlocker *blocker;
+@property (nonatomic) BOOL didFinishLoad;
+
+@end
+
+@implementation FBDialogWebViewPoolTestDialog
+
+@synthesize webView = _webView;
+@synthesize callbackRequest = _callbackRequest;
+@synthesize blocker = _blocker;
+@synthesize didFinishLoad = _didFinishLoad;
+
+- (void)dealloc {
+    [_webView release];
+    [_callbackRequest release];
+    [_blocker release];
+    [super dealloc];
+}
+
+- (BOOL)webView:(UIWebView *)webView shouldStartLoadWithRequest:(NSURLRequest *)request
+ navigationType:(UIWebViewNavigationType)navigationType {
+    if ([request.URL.scheme isEqualToString:@"fbconnect"]) {
+        self.callbackRequest = request;
+        [self.blocker signal];
+        return NO;
+    }
+    return YES;
+}
+
+- (void)webViewDidFinishLoad:(UIWebView *)webView {
+    self.didFinishLoad = YES;
+    [self.blocker signal];
+}
+
+@end
+
+@implementation FBDialogWebViewPoolTests
+
+- (void)testReturnedWebViewIsNotReused
+{
+    FBDialogWebViewPool *pool = [[[FBDialogWebViewPool alloc] init] autorelease];
+    [pool warmUp];
+
+    UIWebView *first = [pool dequeueWebView];
+    STAssertNotNil(first, @"no web view");
+    STAssertFalse([pool dequeueWebView] == first, @"web view handed out twice");
+
+    // A dismissed dialog's web view would carry its history into the next dialog
+    [pool enqueueWebView:first];
+    UIWebView *second = [pool dequeueWebView];
+    STAssertNotNil(second, @"no spare after a web view was returned");
+    STAssertFalse(second == first, @"returned web view reused");
+    STAssertFalse(second.canGoBack, @"spare has history");
+}
+
+- (void)testCallbackDuringPrefetchIsReplayedToDialog
+{
+    FBDialogWebViewPool *pool = [[[FBDialogWebViewPool alloc] init] autorelease];
+    NSURL *dialogURL = [NSURL URLWithString:@"https://m.facebook.com/dialog/apprequests?frictionless=1"];
+    NSURLRequest *callback = [NSURLRequest requestWithURL:[NSURL URLWithString:@"fbconnect://success?request=1"]];
+
+    [pool prefetchURL:dialogURL];
+    UIWebView *prefetched = pool.prefetchWebView;
+    STAssertNotNil(prefetched, @"nothing prefetched");
+    STAssertFalse([pool webView:prefetched shouldStartLoadWithRequest:callback navigationType:UIWebViewNavigationTypeOther],
+                  @"callback loaded before a dialog took the web view");
+
+    UIWindow *window = [[[UIWindow alloc] initWithFrame:CGRectMake(0, 0, 320, 480)] autorelease];
+    FBDialogWebViewPoolTestDialog *dialog = [[[FBDialogWebViewPoolTestDialog alloc] initWithFrame:window.bounds] autorelease];
+    dialog.webView = [pool dequeueWebView];
+    dialog.blocker = [[[FBTestBlocker alloc] init] autorelease];
+    [dialog addSubview:dialog.webView];
+    [window addSubview:dialog];
+
+    UIWebView *webView = [pool loadURL:dialogURL inWebView:dialog.webView ofDialog:dialog];
+    STAssertTrue(webView == prefetched, @"prefetched web view not adopted");
+    STAssertTrue(webView.superview == dialog, @"prefetched web view not in the dialog");
+    STAssertNil(dialog.webView.superview, @"replaced web view left in the dialog");
+    STAssertNil(dialog.callbackRequest, @"callback replayed before the dialog finished showing");
+
+    STAssertTrue([dialog.blocker waitWithTimeout:1], @"callback not replayed");
+    STAssertEqualObjects(dialog.callbackRequest.URL, callback.URL, @"wrong callback replayed");
+    STAssertNil(pool.prefetchWebView, @"prefetch kept after it was adopted");
+
+    webView.delegate = nil;
+    [webView stopLoading];
+    [dialog removeFromSuperview];
+}
+
+- (void)testFinishedPrefetchIsReplayedToInvisibleDialog
+{
+    FBDialogWebViewPool *pool = [[[FBDialogWebViewPool alloc] init] autorelease];
+    NSURL *dialogURL = [NSURL URLWithString:@"https://m.facebook.com/dialog/apprequests?frictionless=1"];
+
+    [pool prefetchURL:dialogURL];
+    UIWebView *prefetched = pool.prefetchWebView;
+    STAssertNotNil(prefetched, @"nothing prefetched");
+    [pool webViewDidFinishLoad:prefetched];
+
+    // frictionless requests load in a dialog that is never added to a window
+    FBDialogWebViewPoolTestDialog *dialog = [[[FBDialogWebViewPoolTestDialog alloc] initWithFrame:CGRectMake(0, 0, 320, 480)] autorelease];
+    dialog.webView = [pool dequeueWebView];
+    dialog.blocker = [[[FBTestBlocker alloc] init] autorelease];
+    [dialog addSubview:dialog.webView];
+
+    UIWebView *webView = [pool loadURL:dialogURL inWebView:dialog.webView ofDialog:dialog];
+    STAssertTrue(webView == prefetched, @"prefetched web view not adopted");
+    STAssertNil(webView.window, @"invisible dialog in a window");
+
+    STAssertTrue([dialog.blocker waitWithTimeout:1], @"finished load not replayed");
+    STAssertTrue(dialog.didFinishLoad, @"finished load not replayed");
+
+    webView.delegate = nil;
+    [webView stopLoading];
+}
+
+@end
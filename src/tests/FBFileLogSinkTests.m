@@ -0,0 +1,120 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "FBFileLogSinkTests.h"
+#import "FBFileLogSink.h"
+#import "FBLogger.h"
+#import "FBSettings.h"
+
+@interface FBRecordingLogSink : NSObject <FBLogSink>
+
+@property (nonatomic, readonly) NSMutableArray *entries;
+
+@end
+
+@implementation FBRecordingLogSink
+
+@synthesize entries = _entries;
+
+- (id)init {
+    if (self = [super init]) {
+        _entries = [[NSMutableArray alloc] init];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [_entries release];
+    [super dealloc];
+}
+
+- (void)logEntry:(NSString *)entry loggingBehavior:(NSString *)loggingBehavior {
+    @synchronized(self) {
+        [_entries addObject:entry];
+    }
+}
+
+@end
+
+@implementation FBFileLogSinkTests
+{
+    NSString *_directory;
+}
+
+- (void)setUp {
+    [super setUp];
+    _directory = [[NSTemporaryDirectory() stringByAppendingPathComponent:
+                   [NSString stringWithFormat:@"FBFileLogSinkTests-%u", arc4random()]] retain];
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtPath:_directory error:nil];
+    [_directory release];
+    _directory = nil;
+    [super tearDown];
+}
+
+- (void)testRotatesPastMaximumFileSize {
+    FBFileLogSink *sink = [[[FBFileLogSink alloc] initWithDirectory:_directory
+                                                    maximumFileSize:1024
+                                                   maximumFileCount:3] autorelease];
+    NSString *entry = [@"" stringByPaddingToLength:200 withString:@"x" startingAtIndex:0];
+    for (int i = 0; i < 100; i++) {
+        [sink logEntry:entry loggingBehavior:FBLoggingBehaviorFBRequests];
+        [sink flush];
+    }
+
+    NSArray *paths = sink.logFilePaths;
+    STAssertEquals(paths.count, (NSUInteger)3, @"expected the file count to be capped");
+    for (NSString *path in paths) {
+        unsigned long long size = [[[NSFileManager defaultManager] attributesOfItemAtPath:path error:nil] fileSize];
+        STAssertTrue(size <= 1024, @"log file grew past the maximum size");
+    }
+    STAssertEquals(sink.droppedEntryCount, (NSUInteger)0, @"no entries should be dropped when flushing");
+}
+
+- (void)testDropsEntriesPastPendingLimit {
+    FBFileLogSink *sink = [[[FBFileLogSink alloc] initWithDirectory:_directory] autorelease];
+    sink.maximumPendingBytes = 0;
+
+    [sink logEntry:@"dropped" loggingBehavior:FBLoggingBehaviorFBRequests];
+    [sink flush];
+
+    STAssertEquals(sink.droppedEntryCount, (NSUInteger)1, @"entry past the pending limit was not dropped");
+    NSString *contents = [NSString stringWithContentsOfFile:[sink.logFilePaths objectAtIndex:0]
+                                                   encoding:NSUTF8StringEncoding
+                                                      error:nil];
+    STAssertEquals(contents.length, (NSUInteger)0, @"dropped entry was written");
+}
+
+- (void)testLoggerDeliversScrubbedEntriesToSinks {
+    NSSet *behaviors = [FBSettings loggingBehavior];
+    [FBSettings setLoggingBehavior:[NSSet setWithObject:FBLoggingBehaviorFBRequests]];
+    FBRecordingLogSink *sink = [[[FBRecordingLogSink alloc] init] autorelease];
+    [FBSettings addLogSink:sink];
+
+    [FBLogger registerStringToReplace:@"FBFileLogSinkTestsToken" replaceWith:@"ACCESS_TOKEN_REMOVED"];
+    [FBLogger singleShotLogEntry:FBLoggingBehaviorFBRequests logEntry:@"token=FBFileLogSinkTestsToken"];
+    [FBLogger singleShotLogEntry:FBLoggingBehaviorAccessTokens logEntry:@"inactive behavior"];
+
+    [FBSettings removeLogSink:sink];
+    [FBSettings setLoggingBehavior:behaviors];
+
+    STAssertEquals(sink.entries.count, (NSUInteger)1, @"expected only the active behavior to be logged");
+    STAssertEqualObjects([sink.entries lastObject], @"token=ACCESS_TOKEN_REMOVED", @"entry was not scrubbed");
+}
+
+@end
@@ -0,0 +1,182 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <libkern/OSAtomic.h>
+
+#import "FBFrictionlessRequestSettings.h"
+#import "FBFrictionlessRequestSettingsTests.h"
+#import "FBTestBlocker.h"
+
+static NSString *const kTestAppID = @"FBFrictionlessRequestSettingsTests";
+
+@implementation FBFrictionlessRequestSettingsTests
+
+- (void)setUp {
+    [super setUp];
+    [FBFrictionlessRequestSettings removePersistedRecipientsForAppID:kTestAppID];
+}
+
+- (void)tearDown {
+    [FBFrictionlessRequestSettings removePersistedRecipientsForAppID:kTestAppID];
+    [super tearDown];
+}
+
+- (NSString *)persistencePathForUserID:(NSString *)userID {
+    NSString *cachesDirectory = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) objectAtIndex:0];
+    return [cachesDirectory stringByAppendingPathComponent:
+            [NSString stringWithFormat:@"com.facebook.sdk.frictionlessRecipients.%@.%@", kTestAppID, userID]];
+}
+
+// Writes and removals happen on a background queue; waits until the file reaches the given state.
+- (void)waitForFileAtPath:(NSString *)path toExist:(BOOL)exists {
+    FBTestBlocker *blocker = [[[FBTestBlocker alloc] init] autorelease];
+    BOOL reached = [blocker waitWithTimeout:2 periodicHandler:^(FBTestBlocker *blocker) {
+        if ([[NSFileManager defaultManager] fileExistsAtPath:path] == exists) {
+            [blocker signal];
+        }
+    }];
+    STAssertTrue(reached, @"timed out waiting for %@ to be %@", path, exists ? @"written" : @"removed");
+}
+
+- (void)testCanonicalizesRecipientIDs {
+    FBFrictionlessRequestSettings *settings = [[[FBFrictionlessRequestSettings alloc] init] autorelease];
+    [settings updateRecipientCacheWithRecipients:@[@"100000000000001", [NSNumber numberWithUnsignedLongLong:18446744073709551615ULL], @" 42\t"]];
+
+    STAssertTrue([settings isFrictionlessEnabledForRecipient:[NSNumber numberWithLongLong:100000000000001LL]], @"NSNumber lookup of a string id");
+    STAssertTrue([settings isFrictionlessEnabledForRecipient:@"18446744073709551615"], @"string lookup of the largest id");
+    STAssertTrue([settings isFrictionlessEnabledForRecipient:@"42"], @"padding should be ignored");
+    STAssertFalse([settings isFrictionlessEnabledForRecipient:@"43"], @"unexpected recipient");
+    STAssertFalse([settings isFrictionlessEnabledForRecipient:@"18446744073709551616"], @"overflowing id accepted");
+    STAssertFalse([settings isFrictionlessEnabledForRecipient:@"42abc"], @"malformed id accepted");
+    STAssertFalse([settings isFrictionlessEnabledForRecipient:@"0"], @"zero is never an id");
+
+    STAssertTrue([settings isFrictionlessEnabledForRecipients:@[@"42", [NSNumber numberWithInt:42]]], @"all recipients are cached");
+    STAssertFalse([settings isFrictionlessEnabledForRecipients:@[@"42", @"43"]], @"one recipient is not cached");
+    STAssertThrows([settings isFrictionlessEnabledForRecipients:@[@"42", @{}]], @"invalid ids should throw");
+}
+
+- (void)testSetGrowsAndKeepsEveryRecipient {
+    NSMutableArray *ids = [NSMutableArray array];
+    for (unsigned long long i = 1; i <= 5000; i++) {
+        // ids sharing their low bits, which would all collide without mixing
+        [ids addObject:[NSNumber numberWithUnsignedLongLong:i << 32]];
+    }
+    FBFrictionlessRequestSettings *settings = [[[FBFrictionlessRequestSettings alloc] init] autorelease];
+    [settings updateRecipientCacheWithRecipients:ids];
+
+    STAssertEquals(settings.recipientIDs.count, ids.count, @"duplicate or missing recipients");
+    for (NSNumber *fbid in ids) {
+        STAssertTrue([settings isFrictionlessEnabledForRecipient:fbid], @"missing %@", fbid);
+        STAssertFalse([settings isFrictionlessEnabledForRecipient:[NSNumber numberWithUnsignedLongLong:fbid.unsignedLongLongValue + 1]],
+                      @"unexpected neighbour of %@", fbid);
+    }
+}
+
+- (void)testRecipientsCanBeReadWhileReplaced {
+    FBFrictionlessRequestSettings *settings = [[[FBFrictionlessRequestSettings alloc] init] autorelease];
+    dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+    dispatch_group_t group = dispatch_group_create();
+    __block int32_t misses = 0;
+
+    // 7 is in every set that is ever published
+    dispatch_group_async(group, queue, ^{
+        for (int i = 0; i < 2000; i++) {
+            [settings updateRecipientCacheWithRecipients:@[@"7", [NSNumber numberWithInt:1000 + i]]];
+        }
+    });
+    for (int reader = 0; reader < 4; reader++) {
+        dispatch_group_async(group, queue, ^{
+            for (int i = 0; i < 20000; i++) {
+                if (![settings isFrictionlessEnabledForRecipient:@"7"]) {
+                    OSAtomicIncrement32(&misses);
+                }
+            }
+        });
+    }
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    dispatch_release(group);
+
+    STAssertEquals(misses, 0, @"a reader saw a partially replaced set");
+}
+
+- (void)testRecipientsArePersistedPerUser {
+    NSString *path = [self persistencePathForUserID:@"1"];
+
+    FBFrictionlessRequestSettings *settings = [[[FBFrictionlessRequestSettings alloc] init] autorelease];
+    [settings persistRecipientCacheForAppID:kTestAppID userID:@"1"];
+    [settings updateRecipientCacheWithRecipients:@[@"11", @"12"]];
+    [self waitForFileAtPath:path toExist:YES];
+
+    // another launch, same user
+    FBFrictionlessRequestSettings *relaunched = [[[FBFrictionlessRequestSettings alloc] init] autorelease];
+    [relaunched persistRecipientCacheForAppID:kTestAppID userID:@"1"];
+    STAssertTrue([relaunched isFrictionlessEnabledForRecipients:@[@"11", @"12"]], @"persisted recipients were not loaded");
+
+    // switching users drops the first user's recipients
+    [relaunched persistRecipientCacheForAppID:kTestAppID userID:@"2"];
+    STAssertFalse([relaunched isFrictionlessEnabledForRecipient:@"11"], @"recipients leaked across users");
+    STAssertEquals(relaunched.recipientIDs.count, (NSUInteger)0, @"recipients leaked across users");
+}
+
+- (void)testClearingRemovesPersistedRecipients {
+    NSString *path = [self persistencePathForUserID:@"1"];
+
+    FBFrictionlessRequestSettings *settings = [[[FBFrictionlessRequestSettings alloc] init] autorelease];
+    [settings persistRecipientCacheForAppID:kTestAppID userID:@"1"];
+    [settings updateRecipientCacheWithRecipients:@[@"11"]];
+    [self waitForFileAtPath:path toExist:YES];
+
+    [settings clearRecipientCache];
+    STAssertFalse([settings isFrictionlessEnabledForRecipient:@"11"], @"recipients survived clearing");
+    [self waitForFileAtPath:path toExist:NO];
+
+    // no longer persisted after clearing
+    [settings updateRecipientCacheWithRecipients:@[@"12"]];
+    FBFrictionlessRequestSettings *relaunched = [[[FBFrictionlessRequestSettings alloc] init] autorelease];
+    [relaunched persistRecipientCacheForAppID:kTestAppID userID:@"1"];
+    STAssertFalse([relaunched isFrictionlessEnabledForRecipient:@"12"], @"recipients persisted after clearing");
+}
+
+- (void)testUnloadingKeepsPersistedRecipients {
+    NSString *path = [self persistencePathForUserID:@"1"];
+
+    FBFrictionlessRequestSettings *settings = [[[FBFrictionlessRequestSettings alloc] init] autorelease];
+    [settings persistRecipientCacheForAppID:kTestAppID userID:@"1"];
+    [settings updateRecipientCacheWithRecipients:@[@"11"]];
+    [self waitForFileAtPath:path toExist:YES];
+
+    // closing the session, as apps do when they terminate, only empties the cache in memory
+    [settings unloadRecipientCache];
+    STAssertFalse([settings isFrictionlessEnabledForRecipient:@"11"], @"recipients survived unloading");
+
+    FBFrictionlessRequestSettings *relaunched = [[[FBFrictionlessRequestSettings alloc] init] autorelease];
+    [relaunched persistRecipientCacheForAppID:kTestAppID userID:@"1"];
+    STAssertTrue([relaunched isFrictionlessEnabledForRecipient:@"11"], @"persisted recipients lost on unloading");
+}
+
+- (void)testRemovingPersistedRecipientsForApp {
+    NSString *path = [self persistencePathForUserID:@"3"];
+
+    FBFrictionlessRequestSettings *settings = [[[FBFrictionlessRequestSettings alloc] init] autorelease];
+    [settings persistRecipientCacheForAppID:kTestAppID userID:@"3"];
+    [settings updateRecipientCacheWithRecipients:@[@"31"]];
+    [self waitForFileAtPath:path toExist:YES];
+
+    [FBFrictionlessRequestSettings removePersistedRecipientsForAppID:kTestAppID];
+    [self waitForFileAtPath:path toExist:NO];
+}
+
+@end
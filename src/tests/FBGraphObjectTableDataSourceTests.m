@@ -0,0 +1,109 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <OHHTTPStubs/OHHTTPStubs.h>
+
+#import "FBGraphObject.h"
+#import "FBGraphObjectTableDataSource.h"
+#import "FBGraphObjectTableDataSourceTests.h"
+
+// Counts how often the data source asks for picture URLs
+@interface FBPictureCountingTableDelegate : NSObject <FBGraphObjectViewControllerDelegate>
+
+@property (nonatomic, assign) NSUInteger pictureURLCount;
+
+@end
+
+@implementation FBPictureCountingTableDelegate
+
+@synthesize pictureURLCount = _pictureURLCount;
+
+- (NSString *)graphObjectTableDataSource:(FBGraphObjectTableDataSource *)dataSource
+                             titleOfItem:(id<FBGraphObject>)graphObject {
+    return [graphObject objectForKey:@"name"];
+}
+
+- (NSString *)graphObjectTableDataSource:(FBGraphObjectTableDataSource *)dataSource
+                        pictureUrlOfItem:(id<FBGraphObject>)graphObject {
+    self.pictureURLCount++;
+    return [NSString stringWithFormat:@"https://fbcdn-profile-a.akamaihd.net/%@.jpg",
+            [graphObject objectForKey:@"id"]];
+}
+
+@end
+
+@implementation FBGraphObjectTableDataSourceTests
+
+- (void)testPrefetchOnlyRunsWhenVisibleRowsChange
+{
+    [OHHTTPStubs shouldStubRequestsPassingTest:^BOOL(NSURLRequest *request) {
+        return YES;
+    } withStubResponse:^OHHTTPStubsResponse *(NSURLRequest *request) {
+        return [OHHTTPStubsResponse responseWithData:[NSData dataWithBytes:"jpg" length:3]
+                                          statusCode:200
+                                        responseTime:0
+                                             headers:nil];
+    }];
+
+    FBPictureCountingTableDelegate *delegate = [[[FBPictureCountingTableDelegate alloc] init] autorelease];
+    FBGraphObjectTableDataSource *dataSource = [[FBGraphObjectTableDataSource alloc] init];
+    dataSource.controllerDelegate = delegate;
+    dataSource.itemPicturesEnabled = YES;
+
+    NSMutableArray *friends = [NSMutableArray array];
+    for (int i = 0; i < 200; i++) {
+        [friends addObject:[FBGraphObject graphObjectWrappingDictionary:
+                            [NSDictionary dictionaryWithObjectsAndKeys:
+                             [NSString stringWithFormat:@"%d", 1000 + i], @"id",
+                             [NSString stringWithFormat:@"Friend %03d", i], @"name",
+                             nil]]];
+    }
+    [dataSource appendGraphObjects:friends];
+    [dataSource appendGraphObjects:nil];
+    [dataSource update];
+
+    UITableView *tableView = [[[UITableView alloc] initWithFrame:CGRectMake(0, 0, 320, 480)
+                                                           style:UITableViewStylePlain] autorelease];
+    [dataSource bindTableView:tableView];
+    [tableView reloadData];
+    [tableView layoutIfNeeded];
+
+    [dataSource prefetchPicturesForTableView:tableView];
+    NSUInteger firstCount = delegate.pictureURLCount;
+    STAssertTrue(firstCount > 0, @"nothing prefetched");
+
+    // Scroll events that don't change the visible rows are free
+    tableView.contentOffset = CGPointMake(0, 1);
+    [tableView layoutIfNeeded];
+    [dataSource prefetchPicturesForTableView:tableView];
+    [dataSource prefetchPicturesForTableView:tableView];
+    STAssertEquals(delegate.pictureURLCount, firstCount, @"prefetch redone without a row change");
+
+    tableView.contentOffset = CGPointMake(0, tableView.rowHeight * 10);
+    [tableView layoutIfNeeded];
+    [dataSource prefetchPicturesForTableView:tableView];
+    STAssertTrue(delegate.pictureURLCount > firstCount, @"prefetch not redone after scrolling");
+
+    // Prefetches in flight are cancelled rather than calling back into a
+    // released data source
+    tableView.dataSource = nil;
+    [dataSource release];
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.1]];
+
+    [OHHTTPStubs removeAllRequestHandlers];
+}
+
+@end
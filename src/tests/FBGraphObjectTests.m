@@ -18,11 +18,27 @@
 #import "FBRequestConnection.h"
 #import "FBGraphObjectTests.h"
 #import "FBGraphObject.h"
+#import "FBGraphSnapshot.h"
 #import "FBGraphUser.h"
 #import "FBGraphPlace.h"
 #import "FBGraphLocation.h"
 #import "FBTestBlocker.h"
 #import "FBTests.h"
+#import "FBUtility.h"
+
+static BOOL g_snapshotDeallocated = NO;
+
+@interface FBDeallocTrackingGraphSnapshot : FBGraphSnapshot
+@end
+
+@implementation FBDeallocTrackingGraphSnapshot
+
+- (void)dealloc {
+    g_snapshotDeallocated = YES;
+    [super dealloc];
+}
+
+@end
 
 @protocol TestGraphProtocolTooManyArgs<FBGraphObject>
 - (int)thisMethod:(int)has too:(int)many args:(int)yikes;
@@ -257,6 +273,102 @@
     [self traverseGraphObject:graphObject];
 }
 
+- (void)testSnapshotRoundTrip
+{
+    NSDictionary *rawObject = @{ @"data" : @[ @{ @"id" : @"4", @"name" : @"Mark", @"installed" : @YES },
+                                              @{ @"id" : @"5", @"name" : @"Mark", @"score" : @12.5 } ],
+                                 @"paging" : @{ @"next" : [NSNull null], @"count" : @2 } };
+    NSData *data = [FBGraphSnapshot dataWithJSONObject:rawObject];
+    STAssertTrue([FBGraphSnapshot isSnapshotData:data], @"not a snapshot");
+
+    FBGraphSnapshot *snapshot = [[[FBGraphSnapshot alloc] initWithData:data] autorelease];
+    NSDictionary *rootObject = snapshot.rootObject;
+    STAssertEqualObjects(rootObject, rawObject, @"snapshot does not round-trip");
+    STAssertEqualObjects([FBUtility simpleJSONDecode:[snapshot JSONString]], rawObject, @"JSON does not round-trip");
+
+    // interned strings are shared between records
+    NSArray *friends = [rootObject objectForKey:@"data"];
+    STAssertTrue([[friends objectAtIndex:0] objectForKey:@"name"] == [[friends objectAtIndex:1] objectForKey:@"name"],
+                 @"strings not interned");
+
+    STAssertNil([[[FBGraphSnapshot alloc] initWithData:[data subdataWithRange:NSMakeRange(0, data.length - 1)]] autorelease],
+                @"truncated snapshot accepted");
+    STAssertNil([FBGraphSnapshot dataWithJSONObject:@{ @"date" : [NSDate date] }], @"non-JSON type encoded");
+}
+
+- (void)testSnapshotBackedGraphObject
+{
+    NSDictionary *rawObject = @{ @"data" : @[ @{ @"id" : @"4", @"name" : @"Mark", @"location" : @{ @"name" : @"Menlo Park" } } ] };
+    FBGraphSnapshot *snapshot = [[[FBGraphSnapshot alloc] initWithData:[FBGraphSnapshot dataWithJSONObject:rawObject]] autorelease];
+
+    NSDictionary<FBGraphObject> *graphObject = [FBGraphObject graphObjectWrappingDictionary:snapshot.rootObject];
+    NSDictionary<FBGraphUser> *user = [[graphObject objectForKey:@"data"] objectAtIndex:0];
+    assertThat(user.name, equalTo(@"Mark"));
+    assertThat([user.location objectForKey:@"name"], equalTo(@"Menlo Park"));
+    STAssertTrue([user.location conformsToProtocol:@protocol(FBGraphObject)], @"nested object not wrapped");
+
+    NSMutableDictionary<FBGraphUser> *mutableUser = (NSMutableDictionary<FBGraphUser> *)user;
+    mutableUser.first_name = @"Mark";
+    [mutableUser removeObjectForKey:@"name"];
+    assertThat([mutableUser objectForKey:@"first_name"], equalTo(@"Mark"));
+    assertThat([mutableUser objectForKey:@"name"], nilValue());
+    assertThatInt(mutableUser.count, equalToInt(3));
+
+    // the graph object works on its own copy, so the cached result is left as it was
+    STAssertEqualObjects(snapshot.rootObject, rawObject, @"snapshot changed through a graph object");
+}
+
+- (void)testSnapshotReadFromManyThreads
+{
+    NSMutableArray *friends = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 256; i++) {
+        [friends addObject:@{ @"id" : [NSString stringWithFormat:@"%lu", (unsigned long)i],
+                              @"name" : @"Mark",
+                              @"location" : @{ @"name" : @"Menlo Park" } }];
+    }
+    NSDictionary *rawObject = @{ @"data" : friends };
+    FBGraphSnapshot *snapshot = [[[FBGraphSnapshot alloc] initWithData:[FBGraphSnapshot dataWithJSONObject:rawObject]] autorelease];
+
+    // every thread decodes the same entries at once; each entry must be published once
+    NSDictionary *rootObject = snapshot.rootObject;
+    NSUInteger readers = 8;
+    id *seen = calloc(readers * friends.count, sizeof(id));
+    dispatch_apply(readers, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t reader) {
+        NSArray *data = [rootObject objectForKey:@"data"];
+        for (NSUInteger i = 0; i < data.count; i++) {
+            NSDictionary *user = [data objectAtIndex:i];
+            [[user objectForKey:@"location"] objectForKey:@"name"];
+            seen[reader * friends.count + i] = user;
+        }
+    });
+
+    for (NSUInteger reader = 1; reader < readers; reader++) {
+        for (NSUInteger i = 0; i < friends.count; i++) {
+            STAssertTrue(seen[reader * friends.count + i] == seen[i], @"entry decoded into two objects");
+        }
+    }
+    free(seen);
+    STAssertEqualObjects(rootObject, rawObject, @"snapshot does not round-trip");
+}
+
+- (void)testReleasedSnapshotDeallocates
+{
+    NSDictionary *rawObject = @{ @"data" : @[ @{ @"id" : @"4", @"name" : @"Mark", @"location" : @{ @"name" : @"Menlo Park" } } ] };
+    NSData *data = [FBGraphSnapshot dataWithJSONObject:rawObject];
+
+    g_snapshotDeallocated = NO;
+    @autoreleasepool {
+        FBGraphSnapshot *snapshot = [[FBDeallocTrackingGraphSnapshot alloc] initWithData:data];
+        NSDictionary *user = [[snapshot.rootObject objectForKey:@"data"] objectAtIndex:0];
+        assertThat([[user objectForKey:@"location"] objectForKey:@"name"], equalTo(@"Menlo Park"));
+        [snapshot release];
+        STAssertFalse(g_snapshotDeallocated, @"snapshot released while its containers are in use");
+    }
+
+    // once the containers decoded from it are gone, nothing holds the snapshot
+    STAssertTrue(g_snapshotDeallocated, @"snapshot leaked");
+}
+
 - (void)testArrayObjectEnumerator
 {
     NSMutableDictionary<FBGraphObject> *obj = [self createGraphObjectWithArray];
@@ -0,0 +1,60 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "FBLogRedactorTests.h"
+#import "FBLogRedactor.h"
+
+@implementation FBLogRedactorTests
+
+- (void)testReplacesEveryRegisteredString {
+    FBLogRedactor *redactor = [[[FBLogRedactor alloc] initWithCapacity:10] autorelease];
+    [redactor registerString:@"tokenA" replacement:@"A"];
+    [redactor registerString:@"tokenB" replacement:@"B"];
+
+    STAssertEqualObjects([redactor redactString:@"x=tokenA&y=tokenB&z=tokenA"], @"x=A&y=B&z=A", @"");
+    STAssertEqualObjects([redactor redactString:@"nothing to see"], @"nothing to see", @"");
+}
+
+- (void)testPrefersEarliestThenLongestMatch {
+    FBLogRedactor *redactor = [[[FBLogRedactor alloc] initWithCapacity:10] autorelease];
+    [redactor registerString:@"abc" replacement:@"1"];
+    [redactor registerString:@"abcdef" replacement:@"2"];
+    [redactor registerString:@"cdx" replacement:@"3"];
+
+    STAssertEqualObjects([redactor redactString:@"abcdef abcdx"], @"2 1dx", @"");
+}
+
+- (void)testMatchesNonASCIIStrings {
+    FBLogRedactor *redactor = [[[FBLogRedactor alloc] initWithCapacity:10] autorelease];
+    [redactor registerString:@"café☃" replacement:@"-"];
+
+    STAssertEqualObjects([redactor redactString:@"über café☃ café"], @"über - café", @"");
+}
+
+- (void)testEvictsLeastRecentlyUsedString {
+    FBLogRedactor *redactor = [[[FBLogRedactor alloc] initWithCapacity:2] autorelease];
+    [redactor registerString:@"first" replacement:@"1"];
+    [redactor registerString:@"second" replacement:@"2"];
+
+    // Finding "first" in a log entry makes "second" the least recently used
+    [redactor redactString:@"first"];
+    [redactor registerString:@"third" replacement:@"3"];
+
+    STAssertEquals(redactor.count, (NSUInteger)2, @"");
+    STAssertEqualObjects([redactor redactString:@"first second third"], @"1 second 3", @"");
+}
+
+@end
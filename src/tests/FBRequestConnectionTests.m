@@ -137,6 +137,117 @@
     [OHHTTPStubs removeAllRequestHandlers];
 }
 
+- (void)testCompletionQueue
+{
+    [OHHTTPStubs shouldStubRequestsPassingTest:^BOOL(NSURLRequest *request) {
+        return YES;
+    } withStubResponse:^OHHTTPStubsResponse *(NSURLRequest *request) {
+        NSData *data = [@"[{\"code\":200,\"body\":\"{\\\"id\\\":\\\"1\\\"}\"},{\"code\":200,\"body\":\"{\\\"id\\\":\\\"2\\\"}\"}]" dataUsingEncoding:NSUTF8StringEncoding];
+        return [OHHTTPStubsResponse responseWithData:data
+                                          statusCode:200
+                                        responseTime:0
+                                             headers:nil];
+    }];
+
+    dispatch_queue_t queue = dispatch_queue_create("FBRequestConnectionTests.completionQueue", DISPATCH_QUEUE_SERIAL);
+    FBTestBlocker *blocker = [[[FBTestBlocker alloc] initWithExpectedSignalCount:2] autorelease];
+    FBRequestConnection *connection = [[[FBRequestConnection alloc] init] autorelease];
+    connection.completionQueue = queue;
+
+    for (int i = 0; i < 2; i++) {
+        FBRequest *request = [[[FBRequest alloc] initWithSession:nil graphPath:@"me"] autorelease];
+        [connection addRequest:request completionHandler:^(FBRequestConnection *connection, id result, NSError *error) {
+            STAssertNil(error, @"unexpected error");
+            STAssertFalse([NSThread isMainThread], @"handler invoked on the main thread");
+            STAssertNotNil(result[@"id"], @"missing result");
+            [blocker signal];
+        }];
+    }
+    [connection start];
+
+    STAssertTrue([blocker waitWithTimeout:1], @"timed out waiting for handlers");
+
+    dispatch_release(queue);
+    [OHHTTPStubs removeAllRequestHandlers];
+}
+
+- (void)testCachedResultIsDeliveredAfterStartReturns
+{
+    __block int networkRequests = 0;
+    [OHHTTPStubs shouldStubRequestsPassingTest:^BOOL(NSURLRequest *request) {
+        return YES;
+    } withStubResponse:^OHHTTPStubsResponse *(NSURLRequest *request) {
+        networkRequests++;
+        NSData *data = [@"{\"id\":\"1\"}" dataUsingEncoding:NSUTF8StringEncoding];
+        return [OHHTTPStubsResponse responseWithData:data
+                                          statusCode:200
+                                        responseTime:0
+                                             headers:nil];
+    }];
+
+    // unique per run, so that the first pass always goes to the network
+    NSString *cacheIdentity = [NSString stringWithFormat:@"FBRequestConnectionTests.%f",
+                               [NSDate timeIntervalSinceReferenceDate]];
+    for (int pass = 0; pass < 2; pass++) {
+        FBTestBlocker *blocker = [[[FBTestBlocker alloc] init] autorelease];
+        __block BOOL completed = NO;
+        FBRequestConnection *connection = [[[FBRequestConnection alloc] init] autorelease];
+        FBRequest *request = [[[FBRequest alloc] initWithSession:nil graphPath:@"me"] autorelease];
+        [connection addRequest:request completionHandler:^(FBRequestConnection *connection, id result, NSError *error) {
+            STAssertNil(error, @"unexpected error");
+            STAssertEqualObjects(result[@"id"], @"1", @"unexpected result");
+            completed = YES;
+            [blocker signal];
+        }];
+        [connection startWithCacheIdentity:cacheIdentity skipRoundtripIfCached:YES];
+        STAssertFalse(completed, @"handler invoked from within start");
+
+        STAssertTrue([blocker waitWithTimeout:1], @"timed out waiting for handler");
+        STAssertEquals(connection.isResultFromCache, (BOOL)(pass == 1), @"unexpected cache state");
+    }
+    STAssertEquals(networkRequests, 1, @"cached result should not go to the network");
+
+    [OHHTTPStubs removeAllRequestHandlers];
+}
+
+- (void)testCachedResultIsDroppedWhenCancelledBeforeDelivery
+{
+    [OHHTTPStubs shouldStubRequestsPassingTest:^BOOL(NSURLRequest *request) {
+        return YES;
+    } withStubResponse:^OHHTTPStubsResponse *(NSURLRequest *request) {
+        NSData *data = [@"{\"id\":\"1\"}" dataUsingEncoding:NSUTF8StringEncoding];
+        return [OHHTTPStubsResponse responseWithData:data
+                                          statusCode:200
+                                        responseTime:0
+                                             headers:nil];
+    }];
+
+    // the first pass fills the cache, the second is cancelled before the cached result is delivered
+    NSString *cacheIdentity = [NSString stringWithFormat:@"FBRequestConnectionTests.%f",
+                               [NSDate timeIntervalSinceReferenceDate]];
+    FBTestBlocker *blocker = [[[FBTestBlocker alloc] init] autorelease];
+    __block int handlerCalls = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        FBRequestConnection *connection = [[[FBRequestConnection alloc] init] autorelease];
+        FBRequest *request = [[[FBRequest alloc] initWithSession:nil graphPath:@"me"] autorelease];
+        [connection addRequest:request completionHandler:^(FBRequestConnection *connection, id result, NSError *error) {
+            handlerCalls++;
+            [blocker signal];
+        }];
+        [connection startWithCacheIdentity:cacheIdentity skipRoundtripIfCached:YES];
+        if (pass == 0) {
+            STAssertTrue([blocker waitWithTimeout:1], @"timed out waiting for handler");
+        } else {
+            STAssertTrue(connection.isResultFromCache, @"result not read from the cache");
+            [connection cancel];
+            STAssertFalse([blocker waitWithTimeout:0.5], @"handler invoked after cancel");
+        }
+    }
+    STAssertEquals(handlerCalls, 1, @"cancelled connection completed");
+
+    [OHHTTPStubs removeAllRequestHandlers];
+}
+
 // happy path test for FBRequestConnectionErrorBehaviorReconnectSession
 - (void)testReconnectBehavior
 {
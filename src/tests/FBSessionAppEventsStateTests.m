@@ -0,0 +1,100 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "FBSessionAppEventsState.h"
+#import "FBSessionAppEventsStateTests.h"
+
+@implementation FBSessionAppEventsStateTests
+
+- (NSArray *)flushedEventsFromEvents:(NSArray *)events implicit:(BOOL)implicit {
+    NSMutableArray *flushed = [NSMutableArray arrayWithCapacity:events.count];
+    for (NSDictionary *event in events) {
+        [flushed addObject:@{@"event" : event,
+                             kFBAppEventIsImplicit : [NSNumber numberWithBool:implicit]}];
+    }
+    return flushed;
+}
+
+- (id)decode:(NSData *)data {
+    STAssertNotNil(data, @"nothing encoded");
+    NSError *error = nil;
+    id decoded = [NSJSONSerialization JSONObjectWithData:data options:0 error:&error];
+    STAssertNil(error, @"encoded events are not valid JSON: %@", error);
+    return decoded;
+}
+
+- (void)testEncodedEventsRoundTripThroughNSJSONSerialization {
+    NSString *eventName = [FBSessionAppEventsState internedString:@"fb_mobile_purchase"];
+    NSArray *events = @[
+        @{@"_eventName" : eventName,
+          @"quote\"and\\backslash" : @"a \"quoted\" \\ value",
+          @"_logTime" : [NSNumber numberWithLong:1380000000]},
+        @{@"_eventName" : eventName,
+          @"control" : @"tab\there\nnewline\rreturn\x01\x1f end",
+          @"_valueToSum" : [NSNumber numberWithDouble:9.99]},
+        @{@"_eventName" : eventName,
+          @"unicode" : @"café   \U0001F600 \U00010437",
+          @"\U0001F600" : @"non-BMP key",
+          @"flag" : [NSNumber numberWithBool:YES]},
+    ];
+
+    NSData *encoded = [FBSessionAppEventsState jsonEncodeEvents:[self flushedEventsFromEvents:events implicit:NO]
+                                          includeImplicitEvents:YES];
+    STAssertEqualObjects([self decode:encoded], events, @"");
+}
+
+- (void)testLargeBatchesEncodeInOrderAcrossChunks {
+    NSMutableArray *events = [NSMutableArray array];
+    for (int i = 0; i < 1000; i++) {
+        [events addObject:@{@"_eventName" : [FBSessionAppEventsState internedString:@"fb_mobile_activate_app"],
+                            @"index" : [NSNumber numberWithInt:i],
+                            @"label" : [NSString stringWithFormat:@"event \"%d\"\n", i]}];
+    }
+
+    NSData *encoded = [FBSessionAppEventsState jsonEncodeEvents:[self flushedEventsFromEvents:events implicit:NO]
+                                          includeImplicitEvents:YES];
+    STAssertEqualObjects([self decode:encoded], events, @"");
+}
+
+- (void)testEventsTheFastEncoderRejectsFallBack {
+    // One chunk of the batch holds values only the general encoder handles
+    NSMutableArray *events = [NSMutableArray array];
+    for (int i = 0; i < 300; i++) {
+        [events addObject:@{@"_eventName" : @"fb_mobile_search",
+                            @"index" : [NSNumber numberWithInt:i]}];
+    }
+    [events replaceObjectAtIndex:200 withObject:@{@"_eventName" : @"fb_mobile_search",
+                                                   @"nested" : @[@1, @2]}];
+
+    NSData *encoded = [FBSessionAppEventsState jsonEncodeEvents:[self flushedEventsFromEvents:events implicit:NO]
+                                          includeImplicitEvents:YES];
+    STAssertEqualObjects([self decode:encoded], events, @"");
+}
+
+- (void)testImplicitEventsCanBeExcluded {
+    NSArray *explicitEvents = @[@{@"_eventName" : @"explicit"}];
+    NSMutableArray *flushed = [NSMutableArray arrayWithArray:[self flushedEventsFromEvents:explicitEvents implicit:NO]];
+    [flushed addObjectsFromArray:[self flushedEventsFromEvents:@[@{@"_eventName" : @"implicit"}] implicit:YES]];
+
+    NSData *encoded = [FBSessionAppEventsState jsonEncodeEvents:flushed includeImplicitEvents:NO];
+    STAssertEqualObjects([self decode:encoded], explicitEvents, @"");
+
+    STAssertNil([FBSessionAppEventsState jsonEncodeEvents:[self flushedEventsFromEvents:@[@{@"_eventName" : @"implicit"}]
+                                                                               implicit:YES]
+                                    includeImplicitEvents:NO], @"");
+}
+
+@end
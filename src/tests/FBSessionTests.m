@@ -28,6 +28,7 @@
 #import "FBError.h"
 #import "FBUtility.h"
 #import "FBSettings.h"
+#import <libkern/OSAtomic.h>
 #import <objc/objc-runtime.h>
 
 static NSString *kURLSchemeSuffix = @"URLSuffix";
@@ -938,6 +939,95 @@ static NSString *kURLSchemeSuffix = @"URLSuffix";
     assertThatBool(shouldExtend, equalToBool(YES));
 }
 
+- (void)testTokenExtensionIsClaimedOnceAcrossThreads {
+    FBAccessTokenData *token = [FBAccessTokenData createTokenFromString:@"token"
+                                                            permissions:nil
+                                                         expirationDate:[NSDate distantFuture]
+                                                              loginType:FBSessionLoginTypeFacebookApplication
+                                                            refreshDate:[NSDate dateWithTimeIntervalSince1970:0]];
+    
+    FBSessionTokenCachingStrategy *mockStrategy = [self createMockTokenCachingStrategyWithToken:token];
+    
+    FBSession *session = [[FBSession alloc] initWithAppID:kTestAppId
+                                              permissions:nil
+                                          defaultAudience:FBSessionDefaultAudienceNone
+                                          urlSchemeSuffix:nil
+                                       tokenCacheStrategy:mockStrategy];
+    [session openWithCompletionHandler:nil];
+    
+    __block int32_t claims = 0;
+    dispatch_apply(64, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+        if ([session shouldExtendAccessToken]) {
+            OSAtomicIncrement32(&claims);
+        }
+    });
+    
+    assertThatInt(claims, equalToInt(1));
+    [session release];
+}
+
+- (void)testHandlerQueueReceivesStateChanges {
+    FBAccessTokenData *mockToken = [self createValidMockToken];
+    FBSessionTokenCachingStrategy *mockStrategy = [self createMockTokenCachingStrategyWithToken:mockToken];
+
+    FBSession *session = [[FBSession alloc] initWithAppID:kTestAppId
+                                              permissions:nil
+                                          defaultAudience:FBSessionDefaultAudienceNone
+                                          urlSchemeSuffix:nil
+                                       tokenCacheStrategy:mockStrategy];
+    dispatch_queue_t queue = dispatch_queue_create("FBSessionTests.handlerQueue", DISPATCH_QUEUE_SERIAL);
+    session.handlerQueue = queue;
+
+    __block BOOL handlerCalled = NO;
+    __block FBSessionState handlerState = FBSessionStateCreated;
+    [session openWithCompletionHandler:^(FBSession *session, FBSessionState status, NSError *error) {
+        handlerCalled = YES;
+        handlerState = status;
+    }];
+
+    // the session is open right away, the handler runs once the queue gets to it
+    assertThatInt(session.state, equalToInt(FBSessionStateOpen));
+    dispatch_sync(queue, ^{});
+    assertThatBool(handlerCalled, equalToBool(YES));
+    assertThatInt(handlerState, equalToInt(FBSessionStateOpen));
+
+    [session release];
+    dispatch_release(queue);
+}
+
+- (void)testSessionCanBeReadAndClosedFromAnyThread {
+    FBAccessTokenData *mockToken = [self createValidMockToken];
+    FBSessionTokenCachingStrategy *mockStrategy = [self createMockTokenCachingStrategyWithToken:mockToken];
+
+    FBSession *session = [[FBSession alloc] initWithAppID:kTestAppId
+                                              permissions:nil
+                                          defaultAudience:FBSessionDefaultAudienceNone
+                                          urlSchemeSuffix:nil
+                                       tokenCacheStrategy:mockStrategy];
+    [session openWithCompletionHandler:nil];
+
+    // an open session always has a token and a closed one never does, so any other pair is torn
+    __block int32_t tornReads = 0;
+    dispatch_apply(64, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+        if (i == 32) {
+            [session close];
+        }
+        for (int read = 0; read < 100; read++) {
+            FBAccessTokenData *accessTokenData = nil;
+            FBSessionState state = [session stateAndAccessTokenData:&accessTokenData];
+            if (FB_ISSESSIONOPENWITHSTATE(state) != (accessTokenData.accessToken.length > 0)) {
+                OSAtomicIncrement32(&tornReads);
+            }
+        }
+    });
+
+    assertThatInt(session.state, equalToInt(FBSessionStateClosed));
+    assertThat(session.accessTokenData, nilValue());
+    assertThatInt(tornReads, equalToInt(0));
+
+    [session release];
+}
+
 
 #pragma mark Active session tests
 
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "FBTaskTests.h"
+#import "FBTask.h"
+#import "FBTask+Private.h"
+#import "FBTaskCompletionSource.h"
+
+static const NSUInteger kChainedContinuationCount = 10000;
+
+@implementation FBTaskTests
+
+- (void)testDependentTaskRunsAfterCompletion
+{
+    FBTaskCompletionSource *tcs = [FBTaskCompletionSource taskCompletionSource];
+    FBTask *task = [tcs.task dependentTaskWithBlock:^id(FBTask *task) {
+        return [NSNumber numberWithInt:[task.result intValue] + 1];
+    }];
+
+    STAssertFalse(task.isCompleted, @"dependent task completed early");
+    tcs.result = [NSNumber numberWithInt:41];
+
+    STAssertEqualObjects([task waitForResult:nil], [NSNumber numberWithInt:42], @"unexpected result");
+}
+
+- (void)testImmediateContinuationRunsInline
+{
+    __block BOOL ran = NO;
+    FBTask *task = [[FBTask taskWithResult:nil] dependentTaskWithBlock:^id(FBTask *task) {
+        ran = YES;
+        return nil;
+    } queue:[FBTask immediateQueue]];
+
+    STAssertTrue(ran, @"continuation of a completed task did not run inline");
+    STAssertTrue(task.isCompleted, @"dependent task not completed");
+}
+
+- (void)testCompletionTaskPropagatesError
+{
+    NSError *error = [NSError errorWithDomain:@"FBTaskTests" code:1 userInfo:nil];
+    __block BOOL ran = NO;
+    FBTask *task = [[FBTask taskWithError:error] completionTaskWithBlock:^id(FBTask *task) {
+        ran = YES;
+        return nil;
+    }];
+
+    [task waitUntilFinished];
+    STAssertFalse(ran, @"completion block ran for a failed task");
+    STAssertEqualObjects(task.error, error, @"error not propagated");
+}
+
+- (void)testTaskDependentOnTasks
+{
+    NSMutableArray *sources = [NSMutableArray array];
+    NSMutableArray *tasks = [NSMutableArray array];
+    for (int i = 0; i < 100; i++) {
+        FBTaskCompletionSource *tcs = [FBTaskCompletionSource taskCompletionSource];
+        [sources addObject:tcs];
+        [tasks addObject:tcs.task];
+    }
+
+    FBTask *task = [FBTask taskDependentOnTasks:tasks];
+    dispatch_apply(sources.count, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+        [[sources objectAtIndex:i] setResult:nil];
+    });
+
+    [task waitUntilFinished];
+    STAssertTrue(task.isCompleted, @"task not completed after all dependencies");
+}
+
+// How fast this goes is measured by the task_chain_continuation benchmark
+- (void)testChainingContinuations
+{
+    FBTaskCompletionSource *tcs = [FBTaskCompletionSource taskCompletionSource];
+    FBTask *task = tcs.task;
+    tcs.result = [NSNumber numberWithInt:0];
+
+    for (NSUInteger i = 0; i < kChainedContinuationCount; i++) {
+        task = [task dependentTaskWithBlock:^id(FBTask *task) {
+            return task.result;
+        } queue:[FBTask immediateQueue]];
+    }
+
+    STAssertTrue(task.isCompleted, @"end of chain not completed");
+    STAssertEqualObjects(task.result, [NSNumber numberWithInt:0], @"result not carried through the chain");
+}
+
+@end
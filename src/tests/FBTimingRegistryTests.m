@@ -0,0 +1,96 @@
+/*
+ * Copyright 2010-present Facebook.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "FBTimingRegistryTests.h"
+#import "FBSettings.h"
+#import "FBTimingRegistry.h"
+
+static NSString *const kTestBehavior = @"FBTimingRegistryTests";
+
+@implementation FBTimingRegistryTests
+
+- (void)testNestedSpansEndInnermostFirst {
+    FBTimingRegistry *registry = [[[FBTimingRegistry alloc] initWithCapacity:64] autorelease];
+    NSObject *tag = [[[NSObject alloc] init] autorelease];
+
+    STAssertTrue([registry beginSpanWithTag:tag], @"");
+    [NSThread sleepForTimeInterval:0.05];
+    STAssertTrue([registry beginSpanWithTag:tag], @"");
+
+    NSTimeInterval inner = 0;
+    NSTimeInterval outer = 0;
+    STAssertTrue([registry endSpanWithTag:tag loggingBehavior:kTestBehavior duration:&inner], @"");
+    STAssertTrue([registry endSpanWithTag:tag loggingBehavior:kTestBehavior duration:&outer], @"");
+    STAssertFalse([registry endSpanWithTag:tag loggingBehavior:kTestBehavior duration:NULL], @"no span should be left open");
+
+    STAssertTrue(inner < 0.05, @"inner span included the outer span's time");
+    STAssertTrue(outer >= 0.05, @"outer span lost its start time");
+}
+
+- (void)testStatisticsReportPercentiles {
+    FBTimingRegistry *registry = [[[FBTimingRegistry alloc] initWithCapacity:64] autorelease];
+    NSObject *tag = [[[NSObject alloc] init] autorelease];
+    STAssertNil([registry statisticsForLoggingBehavior:kTestBehavior], @"");
+
+    for (int i = 0; i < 10; i++) {
+        [registry beginSpanWithTag:tag];
+        [registry endSpanWithTag:tag loggingBehavior:kTestBehavior duration:NULL];
+    }
+    [registry beginSpanWithTag:tag];
+    [NSThread sleepForTimeInterval:0.05];
+    [registry endSpanWithTag:tag loggingBehavior:kTestBehavior duration:NULL];
+
+    NSDictionary *statistics = [registry statisticsForLoggingBehavior:kTestBehavior];
+    STAssertEqualObjects([statistics objectForKey:FBTimingStatisticsCountKey], [NSNumber numberWithInt:11], @"");
+    STAssertTrue([[statistics objectForKey:FBTimingStatisticsP50Key] doubleValue] < 10, @"");
+    STAssertTrue([[statistics objectForKey:FBTimingStatisticsP99Key] doubleValue] >= 45, @"");
+    STAssertTrue([[statistics objectForKey:FBTimingStatisticsMaxKey] doubleValue] >= 50, @"");
+    STAssertEqualObjects([[registry statistics] objectForKey:kTestBehavior], statistics, @"");
+
+    [registry resetStatistics];
+    STAssertNil([registry statisticsForLoggingBehavior:kTestBehavior], @"");
+}
+
+- (void)testFullTableReusesAbandonedSpans {
+    FBTimingRegistry *registry = [[[FBTimingRegistry alloc] initWithCapacity:32] autorelease];
+    registry.maximumSpanAge = 0;
+
+    // Tags are only used as addresses
+    for (uintptr_t tag = 1; tag <= 1000; tag++) {
+        STAssertTrue([registry beginSpanWithTag:(const void *)(tag * 16)], @"abandoned spans were not reused");
+    }
+    STAssertEquals(registry.overflowCount, (NSUInteger)0, @"");
+}
+
+- (void)testNestedSpansThroughSettings {
+    NSString *behavior = [NSString stringWithFormat:@"%@.%f", kTestBehavior, [NSDate timeIntervalSinceReferenceDate]];
+    NSObject *tag = [[[NSObject alloc] init] autorelease];
+
+    [FBSettings beginTimingSpanWithTag:tag];
+    [NSThread sleepForTimeInterval:0.05];
+    [FBSettings beginTimingSpanWithTag:tag];
+    NSTimeInterval inner = [FBSettings endTimingSpanWithTag:tag loggingBehavior:behavior];
+    NSTimeInterval outer = [FBSettings endTimingSpanWithTag:tag loggingBehavior:behavior];
+
+    STAssertTrue(inner >= 0 && inner < 0.05, @"inner span included the outer span's time");
+    STAssertTrue(outer >= 0.05, @"outer span lost its start time");
+    STAssertTrue([FBSettings endTimingSpanWithTag:tag loggingBehavior:behavior] < 0, @"no span should be left open");
+
+    NSDictionary *statistics = [[FBSettings timingStatistics] objectForKey:behavior];
+    STAssertEqualObjects([statistics objectForKey:FBTimingStatisticsCountKey], [NSNumber numberWithInt:2], @"");
+}
+
+@end
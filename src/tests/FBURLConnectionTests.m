@@ -19,6 +19,7 @@
 #import "FBTestBlocker.h"
 #import "FBDataDiskCache.h"
 #import "FBError.h"
+#import "FBURLConnectionPool.h"
 
 #import <OHHTTPStubs/OHHTTPStubs.h>
 
@@ -128,6 +129,35 @@
 
 @end
 
+// Releases pool slots and reports the order in which pooled connections finish.
+@interface TestPoolConnectionDelegate : NSObject
+
+@property (nonatomic, assign) FBURLConnectionPool *pool;
+@property (nonatomic, retain) FBTestBlocker *blocker;
+@property (nonatomic, retain) NSMutableArray *finishedPaths;
+
+@end
+
+@implementation TestPoolConnectionDelegate
+
+@synthesize pool;
+@synthesize blocker;
+@synthesize finishedPaths;
+
+- (void)connectionDidFinishLoading:(NSURLConnection *)connection {
+    [self.pool removeConnection:connection];
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [self.finishedPaths addObject:connection.originalRequest.URL.path];
+        [self.blocker signal];
+    });
+}
+
+- (void)connection:(NSURLConnection *)connection didFailWithError:(NSError *)error {
+    [self connectionDidFinishLoading:connection];
+}
+
+@end
+
 #pragma mark - Test suite
 
 @implementation FBURLConnectionTests {
@@ -153,6 +183,45 @@
 
 #pragma mark Test cases
 
+- (void)testPoolStartsHigherPriorityConnectionsFirst {
+    [OHHTTPStubs shouldStubRequestsPassingTest:^BOOL(NSURLRequest *request) {
+        return YES;
+    } withStubResponse:^OHHTTPStubsResponse *(NSURLRequest *request) {
+        return [OHHTTPStubsResponse responseWithData:[NSData data]
+                                          statusCode:200
+                                        responseTime:0.05
+                                             headers:nil];
+    }];
+
+    FBURLConnectionPool *pool = [[[FBURLConnectionPool alloc] init] autorelease];
+    pool.maxConnections = 1;
+
+    TestPoolConnectionDelegate *delegate = [[[TestPoolConnectionDelegate alloc] init] autorelease];
+    delegate.pool = pool;
+    delegate.blocker = [[[FBTestBlocker alloc] initWithExpectedSignalCount:4] autorelease];
+    delegate.finishedPaths = [NSMutableArray array];
+
+    // the first connection takes the only slot; the rest wait and start by priority
+    NSArray *paths = [NSArray arrayWithObjects:@"/first", @"/background", @"/prefetch", @"/user", nil];
+    FBURLConnectionPriority priorities[] = {
+        FBURLConnectionPriorityUserInitiated,
+        FBURLConnectionPriorityBackground,
+        FBURLConnectionPriorityPrefetch,
+        FBURLConnectionPriorityUserInitiated,
+    };
+    for (NSUInteger i = 0; i < paths.count; i++) {
+        NSURL *url = [NSURL URLWithString:[@"http://www.example.com" stringByAppendingString:[paths objectAtIndex:i]]];
+        NSURLConnection *connection = [[NSURLConnection alloc] initWithRequest:[NSURLRequest requestWithURL:url]
+                                                                      delegate:delegate
+                                                              startImmediately:NO];
+        [pool enqueueConnection:connection priority:priorities[i]];
+        [connection release];
+    }
+
+    assertThatBool([delegate.blocker waitWithTimeout:5], equalToBool(YES));
+    assertThat(delegate.finishedPaths, equalTo([NSArray arrayWithObjects:@"/first", @"/user", @"/prefetch", @"/background", nil]));
+}
+
 - (void)testHandlerIsCalledOnSuccessfulCall {
     [self setupHTTPStubWithStatus:200 andString:nil delayed:0];
     